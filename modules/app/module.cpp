@@ -13,14 +13,19 @@ namespace eokas {
     }
     
     void ModuleManager::tick(float deltaTime) {
+        _eokas_profile_zone("ModuleManager::tick");
+        
         for(auto iter = mInitModules.begin(); iter != mInitModules.end(); ++iter) {
             mTickModules.push_back(*iter);
         }
         mInitModules.clear();
         
-        for(auto iter = mTickModules.begin(); iter != mTickModules.end(); ++iter) {
-            Module* module = *iter;
-            module->tick(deltaTime);
+        {
+            _eokas_profile_zone("ModuleManager::tickModules");
+            for(auto iter = mTickModules.begin(); iter != mTickModules.end(); ++iter) {
+                Module* module = *iter;
+                module->tick(deltaTime);
+            }
         }
         
         for(auto iter = mQuitModules.begin(); iter != mQuitModules.end(); ++iter) {
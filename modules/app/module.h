@@ -38,7 +38,7 @@ namespace eokas {
         void clearModules();
     
     private:
-        std::map<String, Module*> mModules = {};
+        HashMap<String, Module*> mModules = {};
         std::list<Module*> mInitModules = {};
         std::list<Module*> mTickModules = {};
         std::list<Module*> mQuitModules = {};
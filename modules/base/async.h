@@ -4,9 +4,15 @@
 #include "./header.h"
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
 #include <future>
+#include <mutex>
+#include <queue>
 #include <stdexcept>
-#include <functional>
+#include <thread>
+#include <vector>
 
 namespace eokas {
 
@@ -62,13 +68,13 @@ namespace eokas {
         // 1, bind: .exec(std::bind(&Dog::sayHello, &dog));
         // 2, mem_fn: .exec(std::mem_fn(&Dog::sayHello), this)
         template<typename F, typename... Args>
-        auto exec(F&& f, Args&& ... args) -> future<decltype(f(args...))> {
+        auto exec(F&& f, Args&& ... args) -> std::future<decltype(f(args...))> {
             if (!mRunning)
                 throw std::runtime_error("commit on ThreadPool is stopped.");
             
             using RetType = decltype(f(args...));
             
-            auto task = std::make_shared<std::packaged_task<RetType()>>(bind(std::forward<F>(f), std::forward<Args>(args)...));
+            auto task = std::make_shared<std::packaged_task<RetType()>>(std::bind(std::forward<F>(f), std::forward<Args>(args)...));
             
             std::future<RetType> future = task->get_future();
             {
@@ -87,6 +93,29 @@ namespace eokas {
             return future;
         }
         
+        // run queued tasks on the calling thread until the future is ready, so a
+        // task of the pool can wait for the tasks it queued without a deadlock.
+        template<typename T>
+        T wait(std::future<T>& future) {
+            while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                Task task;
+                {
+                    std::lock_guard<std::mutex> lock{mMutex};
+                    if (!mTasks.empty()) {
+                        task = std::move(mTasks.front());
+                        mTasks.pop();
+                    }
+                }
+                if (!task) {
+                    // what it waits for is running on another thread.
+                    future.wait();
+                    break;
+                }
+                task();
+            }
+            return future.get();
+        }
+        
         int idle_size() const {
             return mIdleCount;
         }
@@ -7,6 +7,22 @@ namespace eokas::cli {
         return String::format("\t%s\t\t\t\t%s (default:%s)\n", name.cstr(), info.cstr(), value.string().cstr());
     }
     
+    bool Option::match(const String& names, const String& name) {
+        return Option::match(names, HashKey(name));
+    }
+    
+    bool Option::match(const String& names, const HashKey& name) {
+        const char* begin = names.cstr();
+        const char* end = begin + names.length();
+        while (begin <= end) {
+            const char* comma = std::find(begin, end, ',');
+            if (name.equals(begin, size_t(comma - begin)))
+                return true;
+            begin = comma + 1;
+        }
+        return false;
+    }
+    
     Command::Command()
         : name(), info(), options(), func(), subCommands() {
     }
@@ -16,10 +32,21 @@ namespace eokas::cli {
     }
     
     Command& Command::option(const String& name, const String& info, const StringValue& defaultValue) {
-        Option& opt = this->options[name];
+        auto iter = std::find_if(this->options.begin(), this->options.end(), [&name](const Option& opt) {
+            return opt.name == name;
+        });
+        Option& opt = iter != this->options.end() ? *iter : this->options.emplace_back();
         opt.name = name;
         opt.info = info;
         opt.value = defaultValue;
+        opt.keys.clear();
+        const char* begin = name.cstr();
+        const char* end = begin + name.length();
+        while (begin <= end) {
+            const char* comma = std::find(begin, end, ',');
+            opt.keys.push_back(HashKey::fnv1a(begin, size_t(comma - begin)));
+            begin = comma + 1;
+        }
         
         return *this;
     }
@@ -38,6 +65,10 @@ namespace eokas::cli {
     }
     
     StringValue Command::fetchValue(const String& shortName) const {
+        return this->fetchValue(HashKey(shortName));
+    }
+    
+    StringValue Command::fetchValue(const HashKey& shortName) const {
         auto opt = this->fetchOption(shortName);
         if (opt == std::nullopt)
             return StringValue();
@@ -45,18 +76,22 @@ namespace eokas::cli {
     }
     
     std::optional<Option> Command::fetchOption(const String& shortName) const {
-        for (auto& iter: this->options) {
-            auto fragments = iter.first.split(",");
-            if (std::find(fragments.begin(), fragments.end(), shortName) != fragments.end())
-                return iter.second;
+        return this->fetchOption(HashKey(shortName));
+    }
+    
+    std::optional<Option> Command::fetchOption(const HashKey& shortName) const {
+        for (auto& opt: this->options) {
+            if (!opt.keys.empty() && std::find(opt.keys.begin(), opt.keys.end(), shortName.hash) == opt.keys.end())
+                continue;
+            if (Option::match(opt.name, shortName))
+                return opt;
         }
         return std::nullopt;
     }
     
     std::optional<Command> Command::fetchCommand(const String& shortName) const {
         for (auto& iter: this->subCommands) {
-            auto fragments = iter.first.split(",");
-            if (std::find(fragments.begin(), fragments.end(), shortName) != fragments.end())
+            if (Option::match(iter.first, shortName))
                 return iter.second;
         }
         return std::nullopt;
@@ -65,7 +100,7 @@ namespace eokas::cli {
     String Command::toString() const {
         String str = String::format("%s\t\t\t\t%s\n", name.cstr(), info.cstr());
         for (auto& opt: this->options) {
-            str += opt.second.toString();
+            str += opt.toString();
         }
         for (auto& cmd: this->subCommands) {
             str += cmd.second.toString();
@@ -91,8 +126,7 @@ namespace eokas::cli {
             String cmdName = args[1];
             for (auto& cmd: this->subCommands) {
                 // compatible with "-v,--version"
-                auto fragments = cmd.first.split(",");
-                if (std::find(fragments.begin(), fragments.end(), cmdName) == fragments.end())
+                if (!Option::match(cmd.first, cmdName))
                     continue;
                 
                 isArgumentsConsumedByCommands = true;
@@ -105,7 +139,7 @@ namespace eokas::cli {
         if (args.size() > 1 && this->options.size() > 0) {
             for (auto& opt: this->options) {
                 // compatible with "-v,--version"
-                auto fragments = opt.first.split(",");
+                auto fragments = opt.name.split(",");
                 for (const auto& frag: fragments) {
                     auto argIter = std::find(args.begin(), args.end(), frag);
                     if (argIter == args.end())
@@ -114,7 +148,7 @@ namespace eokas::cli {
                     ++argIter;
                     
                     // --option0 --option1
-                    opt.second.value = argIter == args.end() || argIter->string().startsWith("-") ? "true" : *argIter;
+                    opt.value = argIter == args.end() || argIter->string().startsWith("-") ? "true" : *argIter;
                     
                     isArgumentsConsumedByOptions = true;
                 }
@@ -4,6 +4,8 @@
 
 #include "./header.h"
 #include "./string.h"
+#include "./symbol.h"
+#include "./smallvector.h"
 #include <optional>
 
 namespace eokas::cli {
@@ -12,8 +14,14 @@ namespace eokas::cli {
         String name = "";
         String info = "";
         StringValue value = StringValue::falseValue;
+        /// hashes of the comma separated names, filled by Command::option.
+        SmallVector<u64_t, 2> keys = {};
         
         String toString() const;
+        
+        /// true if name is one of the comma separated names, "-v,--version".
+        static bool match(const String& names, const String& name);
+        static bool match(const String& names, const HashKey& name);
     };
     
     struct Command {
@@ -21,7 +29,7 @@ namespace eokas::cli {
         
         String name;
         String info;
-        std::map<String, Option> options = {};
+        SmallVector<Option, 8> options = {};
         Func func;
         
         std::map<String, Command> subCommands = {};
@@ -37,8 +45,10 @@ namespace eokas::cli {
         Command& subCommand(const String& name, const String& info);
         
         StringValue fetchValue(const String& shortName) const;
+        StringValue fetchValue(const HashKey& shortName) const;
         
         std::optional<Option> fetchOption(const String& shortName) const;
+        std::optional<Option> fetchOption(const HashKey& shortName) const;
         
         std::optional<Command> fetchCommand(const String& shortName) const;
         
@@ -4,6 +4,7 @@
 
 #include "./header.h"
 #include "./string.h"
+#include "./hashmap.h"
 
 namespace eokas {
 
@@ -115,7 +116,7 @@ namespace eokas {
         DataCell* getCell(const String& colName);
     
     private:
-        std::map<String, DataCell*> mCells;
+        HashMap<String, DataCell*> mCells;
     };
     
     /*
@@ -152,7 +153,7 @@ namespace eokas {
     private:
         String mName;
         String mComm;
-        std::map<String, DataCol*> mCols;
+        HashMap<String, DataCol*> mCols;
         size_t mRowCount;
     };
     
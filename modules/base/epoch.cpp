@@ -0,0 +1,124 @@
+
+#include "./epoch.h"
+#include "./queue.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+
+namespace eokas {
+
+    /* 0 means the thread is outside of any read section. */
+    struct alignas(_EOKAS_CACHE_LINE_SIZE) EpochRecord {
+        std::atomic<u64_t> epoch = {0};
+        u32_t depth = 0;
+    };
+
+    struct EpochRetired {
+        void* ptr = nullptr;
+        EpochDomain::Deleter deleter = nullptr;
+        u64_t epoch = 0;
+    };
+
+    static std::atomic<u64_t> sEpochDomainIds = {0};
+    static thread_local std::vector<std::pair<u64_t, EpochRecord*>> tEpochRecords;
+
+    struct EpochDomainImpl {
+        u64_t id = ++sEpochDomainIds;
+        std::atomic<u64_t> epoch = {1};
+
+        mutable std::mutex mutex = {};
+        std::vector<std::unique_ptr<EpochRecord>> records = {};
+        std::vector<EpochRetired> retired = {};
+
+        EpochRecord* local() {
+            for (auto& pair: tEpochRecords) {
+                if (pair.first == id)
+                    return pair.second;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            records.emplace_back(new EpochRecord());
+            EpochRecord* record = records.back().get();
+            tEpochRecords.emplace_back(id, record);
+            return record;
+        }
+    };
+
+    EpochDomain::EpochDomain()
+        : mImpl(new EpochDomainImpl()) {
+    }
+
+    EpochDomain::~EpochDomain() {
+        for (auto& item: mImpl->retired) {
+            item.deleter(item.ptr);
+        }
+        delete mImpl;
+    }
+
+    void EpochDomain::enter() {
+        EpochRecord* record = mImpl->local();
+        if (record->depth++ > 0)
+            return;
+        record->epoch.store(mImpl->epoch.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        // pairs with the fence in collect(): either the writer sees this record,
+        // or this reader sees everything unlinked before the writer scanned.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    void EpochDomain::leave() {
+        EpochRecord* record = mImpl->local();
+        if (record->depth == 0 || --record->depth > 0)
+            return;
+        record->epoch.store(0, std::memory_order_release);
+    }
+
+    void EpochDomain::retire(void* ptr, Deleter deleter) {
+        if (ptr == nullptr || deleter == nullptr)
+            return;
+        std::lock_guard<std::mutex> lock(mImpl->mutex);
+        EpochRetired item;
+        item.ptr = ptr;
+        item.deleter = deleter;
+        item.epoch = mImpl->epoch.load(std::memory_order_relaxed);
+        mImpl->retired.push_back(item);
+    }
+
+    size_t EpochDomain::collect() {
+        std::vector<EpochRetired> expired;
+        {
+            std::lock_guard<std::mutex> lock(mImpl->mutex);
+            u64_t minimum = mImpl->epoch.fetch_add(1, std::memory_order_acq_rel) + 1;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            for (auto& record: mImpl->records) {
+                u64_t epoch = record->epoch.load(std::memory_order_acquire);
+                if (epoch != 0 && epoch < minimum) {
+                    minimum = epoch;
+                }
+            }
+
+            // a reader in epoch e may hold anything retired in e or later.
+            auto& retired = mImpl->retired;
+            auto iter = std::partition(retired.begin(), retired.end(), [minimum](const EpochRetired& item) {
+                return item.epoch >= minimum;
+            });
+            expired.assign(iter, retired.end());
+            retired.erase(iter, retired.end());
+        }
+
+        // deleters run outside of the lock, they may retire more.
+        for (auto& item: expired) {
+            item.deleter(item.ptr);
+        }
+        return this->pending();
+    }
+
+    size_t EpochDomain::pending() const {
+        std::lock_guard<std::mutex> lock(mImpl->mutex);
+        return mImpl->retired.size();
+    }
+
+    u64_t EpochDomain::epoch() const {
+        return mImpl->epoch.load(std::memory_order_relaxed);
+    }
+
+}
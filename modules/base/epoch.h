@@ -0,0 +1,77 @@
+
+#ifndef  _EOKAS_BASE_EPOCH_H_
+#define  _EOKAS_BASE_EPOCH_H_
+
+#include "./header.h"
+
+namespace eokas {
+
+    /*
+    =================================================================
+    == EpochDomain
+    =================================================================
+    */
+    /*
+    Epoch based reclamation for read-mostly structures.
+    Readers bracket their accesses with enter() and leave(), which only
+    stores to a record owned by the calling thread, so they never block
+    and never touch a shared cache line.
+    A writer unlinks an object first and then retires it, collect()
+    deletes it once every reader which may still hold it has left.
+    Thread records are kept until the domain is destroyed.
+    */
+    class EpochDomain {
+        _ForbidCopy(EpochDomain);
+        _ForbidAssign(EpochDomain);
+
+    public:
+        using Deleter = void (*)(void* ptr);
+
+    public:
+        EpochDomain();
+        ~EpochDomain();
+
+    public:
+        /// may be nested, only the outermost pair is effective.
+        void enter();
+        void leave();
+
+        void retire(void* ptr, Deleter deleter);
+
+        template<typename T>
+        void retire(T* ptr) {
+            this->retire((void*) ptr, [](void* p) {
+                delete (T*) p;
+            });
+        }
+
+        /// advance the epoch and delete what no reader can see, returns the count still pending.
+        size_t collect();
+        size_t pending() const;
+        u64_t epoch() const;
+
+    private:
+        struct EpochDomainImpl* mImpl;
+    };
+
+    class EpochGuard {
+        _ForbidCopy(EpochGuard);
+        _ForbidAssign(EpochGuard);
+
+    public:
+        explicit EpochGuard(EpochDomain& domain)
+            : mDomain(domain) {
+            mDomain.enter();
+        }
+
+        ~EpochGuard() {
+            mDomain.leave();
+        }
+
+    private:
+        EpochDomain& mDomain;
+    };
+
+}
+
+#endif//_EOKAS_BASE_EPOCH_H_
@@ -108,7 +108,7 @@ namespace eokas {
         for (int i = 0; i < DIGEST_SIZE; i++)
         {
             // sprintf(buf + i * 2, "%02x", digest[i]);
-            snprintf(buf + i * 2, 2, "%02x", digest[i]);
+            snprintf(buf + i * 2, 3, "%02x", digest[i]);
         }
         buf[DIGEST_SIZE * 2] = 0;
 
@@ -352,7 +352,7 @@ namespace eokas {
         for (int i = 0; i < SHA256::DIGEST_SIZE; i++)
         {
             // sprintf(buf + i * 2, "%02x", digest[i]);
-            snprintf(buf + i * 2, 2, "%02x", digest[i]);
+            snprintf(buf + i * 2, 3, "%02x", digest[i]);
         }
         buf[SHA256::DIGEST_SIZE * 2] = 0;
 
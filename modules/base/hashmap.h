@@ -0,0 +1,493 @@
+
+#ifndef  _EOKAS_BASE_HASHMAP_H_
+#define  _EOKAS_BASE_HASHMAP_H_
+
+#include "./header.h"
+#include "./string.h"
+#include "./symbol.h"
+#include <cstring>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+namespace eokas {
+
+    /*
+    =================================================================
+    == HashOf / EqualOf
+    =================================================================
+    */
+    /*
+    Default hasher and key comparer of HashMap and HashSet. The String
+    and Symbol versions are transparent, so those tables can be searched
+    with a const char* or a precomputed HashKey ("name"_hash) without
+    building a String or interning anything.
+    */
+    template<typename T>
+    struct HashOf : std::hash<T> {
+    };
+
+    template<typename T>
+    struct EqualOf : std::equal_to<T> {
+    };
+
+    template<>
+    struct HashOf<String> {
+        using is_transparent = void;
+
+        size_t operator()(const String& str) const noexcept {
+            return size_t(SymbolTable::hash(str.cstr(), str.length()));
+        }
+
+        size_t operator()(const char* str) const noexcept {
+            return size_t(SymbolTable::hash(str, strlen(str)));
+        }
+
+        size_t operator()(const HashKey& key) const noexcept {
+            return size_t(key.hash);
+        }
+    };
+
+    template<>
+    struct EqualOf<String> {
+        using is_transparent = void;
+
+        bool operator()(const String& a, const String& b) const noexcept {
+            return a.length() == b.length() && memcmp(a.cstr(), b.cstr(), a.length()) == 0;
+        }
+
+        bool operator()(const String& a, const char* b) const noexcept {
+            return strcmp(a.cstr(), b) == 0;
+        }
+
+        bool operator()(const char* a, const String& b) const noexcept {
+            return strcmp(a, b.cstr()) == 0;
+        }
+
+        bool operator()(const String& a, const HashKey& b) const noexcept {
+            return b.equals(a);
+        }
+    };
+
+    template<>
+    struct HashOf<Symbol> {
+        using is_transparent = void;
+
+        size_t operator()(const Symbol& symbol) const noexcept {
+            return size_t(symbol.hash());
+        }
+
+        size_t operator()(const HashKey& key) const noexcept {
+            return size_t(key.hash);
+        }
+    };
+
+    template<>
+    struct EqualOf<Symbol> {
+        using is_transparent = void;
+
+        bool operator()(const Symbol& a, const Symbol& b) const noexcept {
+            return a == b;
+        }
+
+        bool operator()(const Symbol& a, const HashKey& b) const noexcept {
+            return !a.isNull() && a.hash() == b.hash && b.equals(a.str());
+        }
+    };
+
+    /*
+    =================================================================
+    == HashTable
+    =================================================================
+    */
+    /*
+    Open addressing with Robin Hood probing. Entries live densely in a
+    vector in insertion order, the bucket array only holds a probe distance,
+    an 8 bit fingerprint and the index of the entry, so a probe touches
+    8 bytes per bucket and iteration is a plain vector walk.
+    Erasing moves the last entry into the hole; with Stable set the
+    following entries shift down instead, so the iteration order stays the
+    insertion order at the price of a linear erase.
+    Inserting or erasing invalidates iterators and references to entries.
+    */
+    template<typename Key, typename Entry, typename Hash, typename Equal, bool Stable>
+    class HashTable {
+    public:
+        using key_type = Key;
+        using value_type = Entry;
+        using size_type = size_t;
+        using hasher = Hash;
+        using key_equal = Equal;
+        using iterator = typename std::vector<Entry>::iterator;
+        using const_iterator = typename std::vector<Entry>::const_iterator;
+
+    protected:
+        struct Bucket {
+            u32_t info;   // (distance + 1) << 8 | fingerprint, 0 for empty.
+            u32_t index;  // index of the entry.
+        };
+
+        static constexpr u32_t DIST_INC = 1u << 8;
+        static constexpr u32_t FINGERPRINT_MASK = DIST_INC - 1;
+        static constexpr size_t MIN_BUCKETS = 8;
+        static constexpr f32_t MAX_LOAD = 0.8f;
+
+        template<typename K, typename = void>
+        struct IsTransparent : std::false_type {
+        };
+
+        template<typename K>
+        struct IsTransparent<K, std::void_t<typename Hash::is_transparent, typename Equal::is_transparent>> : std::true_type {
+        };
+
+        template<typename K>
+        using Lookup = std::enable_if_t<IsTransparent<K>::value
+            && !std::is_convertible_v<const K&, const_iterator>, int>;
+
+    public:
+        HashTable()
+            : mEntries()
+            , mBuckets()
+            , mShift(64)
+            , mHash()
+            , mEqual() {
+        }
+
+        HashTable(std::initializer_list<Entry> entries)
+            : HashTable() {
+            this->reserve(entries.size());
+            for (auto& entry: entries) {
+                this->insert(entry);
+            }
+        }
+
+    public:
+        iterator begin() { return mEntries.begin(); }
+        const_iterator begin() const { return mEntries.begin(); }
+        iterator end() { return mEntries.end(); }
+        const_iterator end() const { return mEntries.end(); }
+
+        bool empty() const { return mEntries.empty(); }
+        size_t size() const { return mEntries.size(); }
+        size_t bucket_count() const { return mBuckets.size(); }
+        f32_t load_factor() const { return mBuckets.empty() ? 0.0f : f32_t(mEntries.size()) / mBuckets.size(); }
+
+        /// entries in insertion order (modulo erase when not Stable).
+        const std::vector<Entry>& values() const { return mEntries; }
+
+        void clear() {
+            mEntries.clear();
+            mBuckets.assign(mBuckets.size(), Bucket{0, 0});
+        }
+
+        void reserve(size_t count) {
+            mEntries.reserve(count);
+            size_t buckets = MIN_BUCKETS;
+            while (buckets * MAX_LOAD < count) {
+                buckets <<= 1;
+            }
+            if (buckets > mBuckets.size()) {
+                this->rehash(buckets);
+            }
+        }
+
+        iterator find(const Key& key) {
+            return this->iter(this->lookup(key));
+        }
+
+        const_iterator find(const Key& key) const {
+            return this->iter(this->lookup(key));
+        }
+
+        template<typename K, Lookup<K> = 0>
+        iterator find(const K& key) {
+            return this->iter(this->lookup(key));
+        }
+
+        template<typename K, Lookup<K> = 0>
+        const_iterator find(const K& key) const {
+            return this->iter(this->lookup(key));
+        }
+
+        bool contains(const Key& key) const {
+            return this->lookup(key) != NPOS;
+        }
+
+        template<typename K, Lookup<K> = 0>
+        bool contains(const K& key) const {
+            return this->lookup(key) != NPOS;
+        }
+
+        size_t count(const Key& key) const {
+            return this->contains(key) ? 1 : 0;
+        }
+
+        std::pair<iterator, bool> insert(const Entry& entry) {
+            return this->emplaceKey(keyOf(entry), entry);
+        }
+
+        std::pair<iterator, bool> insert(Entry&& entry) {
+            const Key& key = keyOf(entry);
+            return this->emplaceKey(key, std::move(entry));
+        }
+
+        size_t erase(const Key& key) {
+            size_t bucket = this->locate(key);
+            if (bucket == NPOS)
+                return 0;
+            this->eraseBucket(bucket);
+            return 1;
+        }
+
+        template<typename K, Lookup<K> = 0>
+        size_t erase(const K& key) {
+            size_t bucket = this->locate(key);
+            if (bucket == NPOS)
+                return 0;
+            this->eraseBucket(bucket);
+            return 1;
+        }
+
+        /// returns the iterator at the same position, which holds the next entry to visit.
+        iterator erase(const_iterator pos) {
+            size_t index = size_t(pos - mEntries.cbegin());
+            this->eraseBucket(this->bucketOf(index));
+            return mEntries.begin() + index;
+        }
+
+    protected:
+        static constexpr size_t NPOS = size_t(-1);
+
+        std::vector<Entry> mEntries;
+        std::vector<Bucket> mBuckets;
+        u32_t mShift;
+        Hash mHash;
+        Equal mEqual;
+
+        static const Key& keyOf(const Entry& entry) {
+            if constexpr (std::is_same_v<Key, Entry>) {
+                return entry;
+            }
+            else {
+                return entry.first;
+            }
+        }
+
+        /// std::hash of integers and pointers is the identity, spread it before taking the high bits.
+        static u64_t mix(u64_t h) {
+            h ^= h >> 33;
+            h *= 0xff51afd7ed558ccdULL;
+            h ^= h >> 33;
+            return h;
+        }
+
+        template<typename K>
+        u64_t hashOf(const K& key) const {
+            return mix(u64_t(mHash(key)));
+        }
+
+        size_t home(u64_t h) const {
+            return size_t(h >> mShift);
+        }
+
+        size_t next(size_t bucket) const {
+            return (bucket + 1) & (mBuckets.size() - 1);
+        }
+
+        iterator iter(size_t index) {
+            return index == NPOS ? mEntries.end() : mEntries.begin() + index;
+        }
+
+        const_iterator iter(size_t index) const {
+            return index == NPOS ? mEntries.end() : mEntries.begin() + index;
+        }
+
+        /// bucket holding the key, or NPOS.
+        template<typename K>
+        size_t locate(const K& key) const {
+            if (mEntries.empty())
+                return NPOS;
+            u64_t h = this->hashOf(key);
+            u32_t info = DIST_INC | u32_t(h & FINGERPRINT_MASK);
+            size_t bucket = this->home(h);
+            while (true) {
+                const Bucket& slot = mBuckets[bucket];
+                if (slot.info == info && mEqual(keyOf(mEntries[slot.index]), key))
+                    return bucket;
+                if (slot.info < info)
+                    return NPOS;
+                info += DIST_INC;
+                bucket = this->next(bucket);
+            }
+        }
+
+        /// entry index of the key, or NPOS.
+        template<typename K>
+        size_t lookup(const K& key) const {
+            size_t bucket = this->locate(key);
+            return bucket == NPOS ? NPOS : mBuckets[bucket].index;
+        }
+
+        size_t bucketOf(size_t index) const {
+            u64_t h = this->hashOf(keyOf(mEntries[index]));
+            size_t bucket = this->home(h);
+            while (mBuckets[bucket].index != index || mBuckets[bucket].info == 0) {
+                bucket = this->next(bucket);
+            }
+            return bucket;
+        }
+
+        template<typename... Args>
+        std::pair<iterator, bool> emplaceKey(const Key& key, Args&&... args) {
+            if (mEntries.size() + 1 > mBuckets.size() * MAX_LOAD) {
+                this->rehash(mBuckets.empty() ? MIN_BUCKETS : mBuckets.size() * 2);
+            }
+
+            u64_t h = this->hashOf(key);
+            u32_t info = DIST_INC | u32_t(h & FINGERPRINT_MASK);
+            size_t bucket = this->home(h);
+            while (info <= mBuckets[bucket].info) {
+                const Bucket& slot = mBuckets[bucket];
+                if (slot.info == info && mEqual(keyOf(mEntries[slot.index]), key))
+                    return std::make_pair(mEntries.begin() + slot.index, false);
+                info += DIST_INC;
+                bucket = this->next(bucket);
+            }
+
+            size_t index = mEntries.size();
+            mEntries.emplace_back(std::forward<Args>(args)...);
+            this->place(Bucket{info, u32_t(index)}, bucket);
+            return std::make_pair(mEntries.begin() + index, true);
+        }
+
+        /// robin hood: the richer occupant moves on.
+        void place(Bucket carry, size_t bucket) {
+            while (mBuckets[bucket].info != 0) {
+                std::swap(carry, mBuckets[bucket]);
+                carry.info += DIST_INC;
+                bucket = this->next(bucket);
+            }
+            mBuckets[bucket] = carry;
+        }
+
+        void eraseBucket(size_t bucket) {
+            size_t index = mBuckets[bucket].index;
+
+            // backward shift deletion, no tombstones.
+            size_t following = this->next(bucket);
+            while (mBuckets[following].info >= 2 * DIST_INC) {
+                mBuckets[bucket] = Bucket{mBuckets[following].info - DIST_INC, mBuckets[following].index};
+                bucket = following;
+                following = this->next(following);
+            }
+            mBuckets[bucket] = Bucket{0, 0};
+
+            size_t last = mEntries.size() - 1;
+            if (Stable) {
+                mEntries.erase(mEntries.begin() + index);
+                for (auto& slot: mBuckets) {
+                    if (slot.info != 0 && slot.index > index) {
+                        slot.index -= 1;
+                    }
+                }
+            }
+            else {
+                if (index != last) {
+                    mBuckets[this->bucketOf(last)].index = u32_t(index);
+                    mEntries[index] = std::move(mEntries[last]);
+                }
+                mEntries.pop_back();
+            }
+        }
+
+        void rehash(size_t buckets) {
+            u32_t shift = 64;
+            for (size_t n = buckets; n > 1; n >>= 1) {
+                shift -= 1;
+            }
+            mShift = shift;
+            mBuckets.assign(buckets, Bucket{0, 0});
+            for (size_t index = 0; index < mEntries.size(); index++) {
+                u64_t h = this->hashOf(keyOf(mEntries[index]));
+                u32_t info = DIST_INC | u32_t(h & FINGERPRINT_MASK);
+                size_t bucket = this->home(h);
+                while (info <= mBuckets[bucket].info) {
+                    info += DIST_INC;
+                    bucket = this->next(bucket);
+                }
+                this->place(Bucket{info, u32_t(index)}, bucket);
+            }
+        }
+    };
+
+    /*
+    =================================================================
+    == HashMap
+    =================================================================
+    */
+    template<typename Key, typename Value, typename Hash = HashOf<Key>, typename Equal = EqualOf<Key>, bool Stable = false>
+    class HashMap : public HashTable<Key, std::pair<Key, Value>, Hash, Equal, Stable> {
+        using Base = HashTable<Key, std::pair<Key, Value>, Hash, Equal, Stable>;
+
+    public:
+        using mapped_type = Value;
+        using iterator = typename Base::iterator;
+        using Base::Base;
+        using Base::insert;
+
+    public:
+        template<typename... Args>
+        std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args) {
+            return this->emplaceKey(key, std::piecewise_construct,
+                                    std::forward_as_tuple(key),
+                                    std::forward_as_tuple(std::forward<Args>(args)...));
+        }
+
+        template<typename V>
+        std::pair<iterator, bool> insert_or_assign(const Key& key, V&& value) {
+            auto result = this->try_emplace(key, std::forward<V>(value));
+            if (!result.second) {
+                result.first->second = std::forward<V>(value);
+            }
+            return result;
+        }
+
+        Value& operator[](const Key& key) {
+            return this->try_emplace(key).first->second;
+        }
+
+        /// nullptr when missing.
+        Value* get(const Key& key) {
+            size_t index = this->lookup(key);
+            return index == Base::NPOS ? nullptr : &this->mEntries[index].second;
+        }
+
+        template<typename K, typename Base::template Lookup<K> = 0>
+        Value* get(const K& key) {
+            size_t index = this->lookup(key);
+            return index == Base::NPOS ? nullptr : &this->mEntries[index].second;
+        }
+    };
+
+    template<typename Key, typename Value, typename Hash = HashOf<Key>, typename Equal = EqualOf<Key>>
+    using StableHashMap = HashMap<Key, Value, Hash, Equal, true>;
+
+    /*
+    =================================================================
+    == HashSet
+    =================================================================
+    */
+    template<typename Key, typename Hash = HashOf<Key>, typename Equal = EqualOf<Key>, bool Stable = false>
+    class HashSet : public HashTable<Key, Key, Hash, Equal, Stable> {
+        using Base = HashTable<Key, Key, Hash, Equal, Stable>;
+
+    public:
+        using Base::Base;
+    };
+
+    template<typename Key, typename Hash = HashOf<Key>, typename Equal = EqualOf<Key>>
+    using StableHashSet = HashSet<Key, Hash, Equal, true>;
+
+}
+
+#endif//_EOKAS_BASE_HASHMAP_H_
@@ -128,25 +128,34 @@ namespace eokas {
     HomNode HomNode::get(const String& key) {
         if(mType != HomType::Object)
             return HomNode{HomType::Null};
-        auto& map = ((HomObject*)mValue.get())->object;
-        if(map.find(key) == map.end())
+        auto* object = (HomObject*)mValue.get();
+        // a key never interned can not be a member.
+        auto iter = object->indices.find(Symbol::find(key));
+        if(iter == object->indices.end())
             return HomNode{HomType::Null};
-        return map[key];
+        return object->members[iter->second].second;
     }
     
     void HomNode::set(const String& key, const HomNode& val) {
         if(mType != HomType::Object)
             return;
-        auto& map = ((HomObject*)mValue.get())->object;
-        map[key] = val;
+        auto* object = (HomObject*)mValue.get();
+        Symbol symbol(key);
+        auto iter = object->indices.find(symbol);
+        if(iter != object->indices.end()) {
+            object->members[iter->second].second = val;
+            return;
+        }
+        object->indices.insert(std::make_pair(symbol, object->members.size()));
+        object->members.emplace_back(symbol, val);
     }
     
     void HomNode::foreach(const std::function<void(const String& key, const HomNode& val)>& func) const {
         if(!func || mType != HomType::Object)
             return;
-        auto& map = ((HomObject*)mValue.get())->object;
-        for(auto& pair : map) {
-            func(pair.first, pair.second);
+        auto* object = (HomObject*)mValue.get();
+        for(auto& pair : object->members) {
+            func(pair.first.str(), pair.second);
         }
     }
 }
@@ -9,6 +9,8 @@
  * */
 
 #include "./string.h"
+#include "./symbol.h"
+#include <unordered_map>
 #include <utility>
 
 namespace eokas {
@@ -74,9 +76,11 @@ namespace eokas {
             HomArray() :array() {}
         };
         
+        /// keys are interned and kept in the order they were added.
         struct HomObject :public HomValue {
-            std::map<String, HomNode> object;
-            HomObject() :object() {}
+            std::vector<std::pair<Symbol, HomNode>> members;
+            std::unordered_map<Symbol, size_t> indices;
+            HomObject() :members(), indices() {}
         };
         
         HomType mType;
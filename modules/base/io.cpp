@@ -9,7 +9,9 @@
 #include <io.h>
 #else
 #include <dirent.h>
+#include <fcntl.h>
 #include <unistd.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #endif
 
@@ -124,11 +126,125 @@ namespace eokas {
         fflush(mHandle);
     }
     
+    bool FileStream::sync()
+    {
+        if(mHandle == nullptr || fflush(mHandle) != 0)
+            return false;
+    #if _EOKAS_OS == _EOKAS_OS_WIN64 || _EOKAS_OS == _EOKAS_OS_WIN32
+        return _commit(_fileno(mHandle)) == 0;
+    #else
+        return fsync(fileno(mHandle)) == 0;
+    #endif
+    }
+    
     FILE* FileStream::handle() const
     {
         return mHandle;
     }
-    
+
+    /*
+    =================================================================
+    == MappedFile
+    =================================================================
+    */
+    MappedFile::MappedFile(const String& path)
+        :mPath(path)
+        ,mData(nullptr)
+        ,mSize(0)
+        ,mFile(nullptr)
+        ,mMapping(nullptr)
+    {
+    }
+
+    MappedFile::~MappedFile()
+    {
+        this->close();
+    }
+
+    bool MappedFile::open()
+    {
+        if(mData != nullptr)
+            return true;
+#if _EOKAS_OS == _EOKAS_OS_WIN64 || _EOKAS_OS == _EOKAS_OS_WIN32
+        HANDLE file = CreateFileA(mPath.cstr(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if(file == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER size;
+        if(!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+        {
+            CloseHandle(file);
+            return false;
+        }
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if(mapping == NULL)
+        {
+            CloseHandle(file);
+            return false;
+        }
+        void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if(data == NULL)
+        {
+            CloseHandle(mapping);
+            CloseHandle(file);
+            return false;
+        }
+        mFile = file;
+        mMapping = mapping;
+        mData = data;
+        mSize = size_t(size.QuadPart);
+#else
+        int fd = ::open(mPath.cstr(), O_RDONLY);
+        if(fd < 0)
+            return false;
+        struct stat status;
+        if(fstat(fd, &status) != 0 || status.st_size == 0)
+        {
+            ::close(fd);
+            return false;
+        }
+        void* data = mmap(NULL, size_t(status.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        // the mapping keeps the file referenced.
+        ::close(fd);
+        if(data == MAP_FAILED)
+            return false;
+        mData = data;
+        mSize = size_t(status.st_size);
+#endif
+        return true;
+    }
+
+    void MappedFile::close()
+    {
+        if(mData == nullptr)
+            return;
+#if _EOKAS_OS == _EOKAS_OS_WIN64 || _EOKAS_OS == _EOKAS_OS_WIN32
+        UnmapViewOfFile(mData);
+        CloseHandle((HANDLE)mMapping);
+        CloseHandle((HANDLE)mFile);
+#else
+        munmap(mData, mSize);
+#endif
+        mData = nullptr;
+        mSize = 0;
+        mFile = nullptr;
+        mMapping = nullptr;
+    }
+
+    bool MappedFile::isOpen() const
+    {
+        return mData != nullptr;
+    }
+
+    const void* MappedFile::data() const
+    {
+        return mData;
+    }
+
+    size_t MappedFile::size() const
+    {
+        return mSize;
+    }
+
     /*
     =================================================================
     == File System Interface
@@ -141,7 +257,7 @@ namespace eokas {
     
     bool File::readText(const String& path, String& content) {
         FileStream stream(path, "r");
-        if(!stream.isOpen())
+        if(!stream.open())
             return false;
         size_t size = stream.size();
         content = String(' ', size);
@@ -152,7 +268,7 @@ namespace eokas {
     
     bool File::readData(const String& path, void* data, size_t size) {
         FileStream stream(path, "rb");
-        if(!stream.isOpen())
+        if(!stream.open())
             return false;
         size = size <= stream.size() ? size : stream.size();
         stream.read(data, size);
@@ -162,7 +278,7 @@ namespace eokas {
     
     bool File::writeText(const String& path, String& content) {
         FileStream stream(path, "w");
-        if(!stream.isOpen())
+        if(!stream.open())
             return false;
         stream.write((void*)content.cstr(), content.length());
         stream.close();
@@ -171,7 +287,7 @@ namespace eokas {
     
     bool File::writeData(const String& path, void* data, size_t size) {
         FileStream stream(path, "wb");
-        if(!stream.isOpen())
+        if(!stream.open())
             return false;
         stream.write(data, size);
         stream.close();
@@ -187,6 +303,29 @@ namespace eokas {
     #endif
     }
     
+    bool File::remove(const String& path)
+    {
+        return ::remove(path.cstr()) == 0;
+    }
+    
+    bool File::replace(const String& src, const String& dst)
+    {
+    #if _EOKAS_OS == _EOKAS_OS_WIN64 || _EOKAS_OS == _EOKAS_OS_WIN32
+        return MoveFileExA(src.cstr(), dst.cstr(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+    #else
+        if(::rename(src.cstr(), dst.cstr()) != 0)
+            return false;
+        // the rename itself is only durable once the folder is flushed.
+        int folder = ::open(File::basePath(dst).cstr(), O_RDONLY);
+        if(folder >= 0)
+        {
+            fsync(folder);
+            ::close(folder);
+        }
+        return true;
+    #endif
+    }
+    
     bool File::isFile(const String& path)
     {
     #if _EOKAS_OS == _EOKAS_OS_WIN64 || _EOKAS_OS == _EOKAS_OS_WIN32
@@ -223,6 +362,20 @@ namespace eokas {
     #endif
     }
     
+    bool File::createFolder(const String& path)
+    {
+        if (path.isEmpty() || File::isFolder(path))
+            return true;
+        String parent = File::basePath(path);
+        if (parent != path && !File::createFolder(parent))
+            return false;
+    #if _EOKAS_OS == _EOKAS_OS_WIN64 || _EOKAS_OS == _EOKAS_OS_WIN32
+        return _mkdir(path.cstr()) == 0 || File::isFolder(path);
+    #else
+        return mkdir(path.cstr(), 0755) == 0 || File::isFolder(path);
+    #endif
+    }
+    
     FileList File::listFileInfos(const String& path, FileInfoPredicate predicate)
     {
         FileList list;
@@ -254,6 +407,8 @@ namespace eokas {
     #else
         dirent* ptr = nullptr;
         DIR* dir = opendir(path.cstr());
+        if (dir == nullptr)
+            return list;
         while ((ptr = readdir(dir)) != nullptr)
         {
             const char* name = ptr->d_name;
@@ -302,6 +457,8 @@ namespace eokas {
     #else
         dirent* ptr = nullptr;
         DIR* dir = opendir(path.cstr());
+        if (dir == nullptr)
+            return list;
         while ((ptr = readdir(dir)) != nullptr)
         {
             const char* name = ptr->d_name;
@@ -340,6 +497,8 @@ namespace eokas {
     #else
         dirent* ptr = nullptr;
         DIR* dir = opendir(path.cstr());
+        if (dir == nullptr)
+            return list;
         while ((ptr = readdir(dir)) != nullptr)
         {
             const char* name = ptr->d_name;
@@ -398,10 +557,10 @@ namespace eokas {
         if (index1 == String::npos && index2 == String::npos)
             return path;
         if (index1 == String::npos)
-            return path.substr(index2);
+            return path.substr(index2 + 1);
         if (index2 == String::npos)
-            return path.substr(index1);
-        return path.substr(index1 < index2 ? index1 : index2);
+            return path.substr(index1 + 1);
+        return path.substr((index1 > index2 ? index1 : index2) + 1);
     }
     
     String File::fileNameWithoutExtension(const String& path)
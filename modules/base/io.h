@@ -42,6 +42,8 @@ namespace eokas {
         virtual void flush() override;
     
     public:
+        /// flush and wait until the data reached the disk.
+        bool sync();
         FILE* handle() const;
     
     private:
@@ -50,6 +52,38 @@ namespace eokas {
         String mMode;
     };
     
+    /*
+    =================================================================
+    == MappedFile
+    =================================================================
+    */
+    /*
+    Read-only view of a whole file mapped into memory. The pages are shared
+    with every other process mapping the same file.
+    */
+    class MappedFile {
+        _ForbidCopy(MappedFile);
+        _ForbidAssign(MappedFile);
+    
+    public:
+        MappedFile(const String& path);
+        ~MappedFile();
+    
+    public:
+        bool open();
+        void close();
+        bool isOpen() const;
+        const void* data() const;
+        size_t size() const;
+    
+    private:
+        String mPath;
+        void* mData;
+        size_t mSize;
+        void* mFile;
+        void* mMapping;
+    };
+    
     /*
     =================================================================
     == FileInfo
@@ -83,8 +117,14 @@ namespace eokas {
         static bool writeText(const String& path, String& content);
         static bool writeData(const String& path, void* data, size_t size);
         static bool exists(const String& path);
+        static bool remove(const String& path);
+        /// rename over an existing file in one step, the target is either
+        /// the old or the new file even if the process dies meanwhile.
+        static bool replace(const String& src, const String& dst);
         static bool isFile(const String& path);
         static bool isFolder(const String& path);
+        /// create the folder and the missing ones above it.
+        static bool createFolder(const String& path);
         static FileList listFileInfos(const String& path, FileInfoPredicate predicate = FileInfoPredicate());
         static StringList listFileNames(const String& path, FileNamePredicate predicate = FileNamePredicate());
         static StringList listFolderNames(const String& path, FileNamePredicate predicate = FileNamePredicate());
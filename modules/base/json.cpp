@@ -34,7 +34,7 @@ namespace eokas {
         }
         
         HomNode nextValue() {
-            char c = this->nextChar();
+            char c = this->nextCleanChar();
             switch (c) {
                 case '[':
                     return this->nextArray();
@@ -69,7 +69,7 @@ namespace eokas {
             char first = this->nextCleanChar();
             if (first == ']') {
                 return list;
-            } else if (first == '\0') {
+            } else if (first != '\0') {
                 mPosition -= 1;
             }
             
@@ -133,47 +133,14 @@ namespace eokas {
         
         HomNode nextNumber(char first) {
             String str(first);
-            if (first != '+' && first != '-') {
-                char c = this->nextChar();
-                if (c == '.') {
-                    str += c;
-                    c = this->nextChar();
-                    while (_ascil_is_number(c)) {
-                        str += c;
-                        c = this->nextChar();
-                    }
-                } else {
-                    c = this->nextChar();
-                    while (_ascil_is_number(c)) {
-                        str += c;
-                        c = this->nextChar();
-                    }
-                    if (c == '.') {
-                        str += c;
-                        c = this->nextChar();
-                    }
-                    while (_ascil_is_number(c)) {
-                        str += c;
-                        c = this->nextChar();
-                    }
-                }
-            } else {
-                char c = this->nextChar();
-                while (_ascil_is_number(c)) {
-                    str += c;
-                    c = this->nextChar();
-                }
-                if (c == '.') {
-                    str += c;
-                    c = this->nextChar();
-                }
-                while (_ascil_is_number(c)) {
-                    str += c;
-                    c = this->nextChar();
-                }
+            char c = this->nextChar();
+            while (_ascil_is_number(c) || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-') {
+                str += c;
+                c = this->nextChar();
+            }
+            if (c != '\0') {
+                mPosition -= 1;
             }
-            
-            mPosition -= 1;
             
             auto value = String::stringToValue<f64_t>(str);
             return HomNode{value};
@@ -208,7 +175,9 @@ namespace eokas {
                 c = this->nextChar();
             }
             
-            mPosition -= 1;
+            if (c != '\0') {
+                mPosition -= 1;
+            }
             
             return str;
         }
@@ -255,7 +224,7 @@ namespace eokas {
         char nextCleanChar() {
             for (char c = this->nextChar(); c != '\0'; c = this->nextChar()) {
                 switch (c) {
-                    case ':':
+                    case ' ':
                     case '\t':
                     case '\n':
                     case '\r':
@@ -324,10 +293,10 @@ namespace eokas {
                 String str = "[";
                 bool first = true;
                 json.foreach([&](const HomNode& val)->void {
-                    if (first) {
+                    if (!first) {
                         str += ", ";
-                        first = false;
                     }
+                    first = false;
                     str += stringify(val);
                 });
                 str += "]";
@@ -337,10 +306,10 @@ namespace eokas {
                 String str = "{";
                 bool first = true;
                 json.foreach([&](const String& key, const HomNode& val)->void {
-                    if (first) {
+                    if (!first) {
                         str += ", ";
-                        first = false;
                     }
+                    first = false;
                     str += String::format("\"%s\":", key.cstr());
                     str += stringify(val);
                 });
@@ -1,6 +1,7 @@
 
 #include "./logger.h"
 #include "./string.h"
+#include "./hashmap.h"
 #include <stack>
 
 namespace eokas {
@@ -12,7 +13,7 @@ namespace eokas {
         }
         
         std::stack<String> names;
-        std::map<String, Logger*> loggers;
+        HashMap<String, Logger*> loggers;
         
         ~LoggerManager() {
             if (!loggers.empty()) {
@@ -44,16 +45,21 @@ namespace eokas {
     }
     
     Logger* Logger::log(const String& name) {
+        return Logger::log(HashKey(name));
+    }
+    
+    Logger* Logger::log(const HashKey& name) {
         LoggerManager& manager = LoggerManager::instance();
         auto iter = manager.loggers.find(name);
         if (iter != manager.loggers.end())
             return iter->second;
+        String path(name.str, name.len);
         Logger* logger = new Logger();
-        if (!logger->open(name)) {
+        if (!logger->open(path)) {
             delete logger;
             return nullptr;
         }
-        manager.loggers[name] = logger;
+        manager.loggers[path] = logger;
         return logger;
     }
     
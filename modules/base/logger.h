@@ -4,6 +4,7 @@
 
 #include "./header.h"
 #include "./string.h"
+#include "./symbol.h"
 #include "./signal.h"
 #include <fstream>
 
@@ -19,6 +20,8 @@ namespace eokas {
         static void pop();
         static Logger* log();
         static Logger* log(const String& name);
+        /// Logger::log("game"_hash) finds an open logger without building a String.
+        static Logger* log(const HashKey& name);
     
     public:
         Logger();
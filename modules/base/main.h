@@ -11,8 +11,11 @@
 #include "./time.h"
 #include "./signal.h"
 #include "./string.h"
+#include "./symbol.h"
 #include "./stream.h"
 #include "./hash.h"
+#include "./hashmap.h"
+#include "./smallvector.h"
 #include "./table.h"
 #include "./pool.h"
 #include "./logger.h"
@@ -24,6 +27,10 @@
 #include "./io.h"
 #include "./cli.h"
 #include "./timer.h"
+#include "./profiler.h"
+#include "./watcher.h"
+#include "./queue.h"
+#include "./epoch.h"
 #include "./memory.h"
 #include "./os.h"
 #include "./dll.h"
@@ -4,6 +4,7 @@
 #include <cstdlib>
 #include <exception>
 #include <algorithm>
+#include <mutex>
 
 #if _EOKAS_OS == _EOKAS_OS_WIN64 || _EOKAS_OS == _EOKAS_OS_WIN32
 #include <windows.h>
@@ -11,6 +12,8 @@
 #include <sys/mman.h>
 #else
 #include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 #endif
 
 namespace eokas {
@@ -29,6 +32,11 @@ namespace eokas {
         return ptr;
     }
     
+    void* MemoryUtility::alloc_uninit(size_t size)
+    {
+        return std::malloc(size);
+    }
+    
     void* MemoryUtility::alloc(size_t size, void* data)
     {
         void* ptr = std::malloc(size);
@@ -84,19 +92,19 @@ namespace eokas {
     
 #if _EOKAS_OS == _EOKAS_OS_WIN64 || _EOKAS_OS == _EOKAS_OS_WIN32
     
-    static u32_t encode_prot(DWORD prot)
+    static DWORD encode_prot(u32_t prot)
     {
         switch (prot)
         {
-            case PAGE_READONLY: return 1;
-            case PAGE_WRITECOPY: return 2;
-            case PAGE_READWRITE: return 3;
-            case PAGE_EXECUTE: return 4;
-            case PAGE_EXECUTE_READ: return 5;
-            case PAGE_EXECUTE_WRITECOPY: return 6;
-            case PAGE_EXECUTE_READWRITE: return 7;
+            case 1: return PAGE_READONLY;
+            case 2: return PAGE_READWRITE; // no write-only pages on windows.
+            case 3: return PAGE_READWRITE;
+            case 4: return PAGE_EXECUTE;
+            case 5: return PAGE_EXECUTE_READ;
+            case 6: return PAGE_EXECUTE_READWRITE;
+            case 7: return PAGE_EXECUTE_READWRITE;
         }
-        return 0;
+        return PAGE_NOACCESS;
     }
     
     void* MemoryUtility::alloc_v(size_t size, u32_t prot)
@@ -109,7 +117,8 @@ namespace eokas {
     
     void MemoryUtility::free_v(void* ptr, size_t size)
     {
-        VirtualFree(ptr, size, MEM_RELEASE);
+        // the size must be 0 when the memory is released.
+        VirtualFree(ptr, 0, MEM_RELEASE);
     }
     
     u32_t MemoryUtility::prot_v(void* ptr, size_t size, u32_t prot)
@@ -120,11 +129,60 @@ namespace eokas {
         return ret;
     }
     
+    void* MemoryUtility::reserve_v(size_t size, u32_t flags)
+    {
+        // large pages can't be reserved without being committed on windows,
+        // VF_EXPLICIT_HUGE_PAGES is a plain reservation here.
+        return VirtualAlloc(NULL, size, MEM_RESERVE, PAGE_NOACCESS);
+    }
+    
+    bool MemoryUtility::commit_v(void* ptr, size_t size, u32_t prot)
+    {
+        return VirtualAlloc(ptr, size, MEM_COMMIT, encode_prot(prot)) != NULL;
+    }
+    
+    bool MemoryUtility::decommit_v(void* ptr, size_t size)
+    {
+        return VirtualFree(ptr, size, MEM_DECOMMIT) != FALSE;
+    }
+    
+    void MemoryUtility::release_v(void* ptr, size_t size)
+    {
+        VirtualFree(ptr, 0, MEM_RELEASE);
+    }
+    
+    bool MemoryUtility::bind_v(void* ptr, size_t size, i32_t node)
+    {
+        return false;
+    }
+    
+    size_t MemoryUtility::page_size()
+    {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return info.dwPageSize;
+    }
+    
+    size_t MemoryUtility::huge_page_size()
+    {
+        size_t size = GetLargePageMinimum();
+        return size > 0 ? size : MemoryUtility::page_size();
+    }
+    
 #else
     
+    static int encode_prot(u32_t prot)
+    {
+        int _prot = PROT_NONE;
+        if(prot & 1) _prot |= PROT_READ;
+        if(prot & 2) _prot |= PROT_WRITE;
+        if(prot & 4) _prot |= PROT_EXEC;
+        return _prot;
+    }
+    
     void* MemoryUtility::alloc_v(size_t size, u32_t prot)
     {
-        void *p = mmap(NULL, size, prot, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        void *p = mmap(NULL, size, encode_prot(prot), MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
         if (p == MAP_FAILED) {
             return nullptr;
         }
@@ -138,16 +196,193 @@ namespace eokas {
     
     u32_t MemoryUtility::prot_v(void* ptr, size_t size, u32_t prot)
     {
-        return mprotect(ptr, size, prot);
+        return mprotect(ptr, size, encode_prot(prot));
+    }
+    
+    void* MemoryUtility::reserve_v(size_t size, u32_t flags)
+    {
+        int _flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+    #if defined(MAP_HUGETLB)
+        if(flags & VF_EXPLICIT_HUGE_PAGES) {
+            _flags |= MAP_HUGETLB;
+        }
+    #endif
+        void *p = mmap(NULL, size, PROT_NONE, _flags, -1, 0);
+        if (p == MAP_FAILED) {
+            return nullptr;
+        }
+    #if defined(MADV_HUGEPAGE)
+        if(flags & VF_HUGE_PAGES) {
+            madvise(p, size, MADV_HUGEPAGE);
+        }
+    #endif
+        return p;
+    }
+    
+    bool MemoryUtility::commit_v(void* ptr, size_t size, u32_t prot)
+    {
+        return mprotect(ptr, size, encode_prot(prot)) == 0;
+    }
+    
+    bool MemoryUtility::decommit_v(void* ptr, size_t size)
+    {
+        if(madvise(ptr, size, MADV_DONTNEED) != 0)
+            return false;
+        return mprotect(ptr, size, PROT_NONE) == 0;
+    }
+    
+    void MemoryUtility::release_v(void* ptr, size_t size)
+    {
+        munmap(ptr, size);
+    }
+    
+    bool MemoryUtility::bind_v(void* ptr, size_t size, i32_t node)
+    {
+    #if _EOKAS_OS == _EOKAS_OS_LINUX && defined(SYS_mbind)
+        if(node < 0 || node >= i32_t(sizeof(unsigned long) * 8))
+            return false;
+        // call mbind directly, so libnuma is not required.
+        const int MPOL_PREFERRED_MODE = 1;
+        unsigned long mask = 1UL << node;
+        return syscall(SYS_mbind, ptr, size, MPOL_PREFERRED_MODE, &mask, sizeof(mask) * 8, 0) == 0;
+    #else
+        return false;
+    #endif
+    }
+    
+    size_t MemoryUtility::page_size()
+    {
+        static size_t sPageSize = size_t(sysconf(_SC_PAGESIZE));
+        return sPageSize;
+    }
+    
+    size_t MemoryUtility::huge_page_size()
+    {
+    #if _EOKAS_OS == _EOKAS_OS_LINUX
+        static size_t sHugePageSize = []() -> size_t {
+            size_t size = 2 * 1024 * 1024;
+            FILE* file = fopen("/proc/meminfo", "r");
+            if(file == nullptr)
+                return size;
+            char line[256];
+            while(fgets(line, sizeof(line), file) != nullptr)
+            {
+                unsigned long kb = 0;
+                if(sscanf(line, "Hugepagesize: %lu kB", &kb) == 1)
+                {
+                    size = size_t(kb) * 1024;
+                    break;
+                }
+            }
+            fclose(file);
+            return size;
+        }();
+        return sHugePageSize;
+    #else
+        return MemoryUtility::page_size();
+    #endif
     }
     
 #endif
     
+    /*
+    ============================================================================================
+    ==== VirtualRegion
+    ============================================================================================
+    */
+    VirtualRegion::VirtualRegion(size_t reserveSize, u32_t prot, u32_t flags, i32_t node)
+        :mData(nullptr)
+        ,mReserved(0)
+        ,mCommitted(0)
+        ,mGranularity(MemoryUtility::page_size())
+        ,mProt(prot)
+    {
+        if(flags & (MemoryUtility::VF_HUGE_PAGES | MemoryUtility::VF_EXPLICIT_HUGE_PAGES))
+        {
+            mGranularity = MemoryUtility::huge_page_size();
+        }
+        reserveSize = (reserveSize + mGranularity - 1) / mGranularity * mGranularity;
+        mData = (u8_t*)MemoryUtility::reserve_v(reserveSize, flags);
+        if(mData != nullptr)
+        {
+            mReserved = reserveSize;
+            if(node >= 0)
+            {
+                MemoryUtility::bind_v(mData, mReserved, node);
+            }
+        }
+    }
+    
+    VirtualRegion::~VirtualRegion()
+    {
+        if(mData != nullptr)
+        {
+            MemoryUtility::release_v(mData, mReserved);
+        }
+        mData = nullptr;
+        mReserved = 0;
+        mCommitted = 0;
+    }
+    
+    void* VirtualRegion::data() const
+    {
+        return mData;
+    }
+    
+    size_t VirtualRegion::reserved() const
+    {
+        return mReserved;
+    }
+    
+    size_t VirtualRegion::committed() const
+    {
+        return mCommitted;
+    }
+    
+    size_t VirtualRegion::granularity() const
+    {
+        return mGranularity;
+    }
+    
+    bool VirtualRegion::grow(size_t size)
+    {
+        if(size <= mCommitted)
+            return true;
+        if(size > mReserved)
+            return false;
+        size_t target = (size + mGranularity - 1) / mGranularity * mGranularity;
+        target = std::min(target, mReserved);
+        if(!MemoryUtility::commit_v(mData + mCommitted, target - mCommitted, mProt))
+            return false;
+        mCommitted = target;
+        return true;
+    }
+    
+    void VirtualRegion::shrink(size_t size)
+    {
+        size_t target = (size + mGranularity - 1) / mGranularity * mGranularity;
+        if(target >= mCommitted)
+            return;
+        if(MemoryUtility::decommit_v(mData + target, mCommitted - target))
+        {
+            mCommitted = target;
+        }
+    }
+    
     /*
     ============================================================================================
     ==== MemoryBuffer
     ============================================================================================
     */
+    MemoryBuffer MemoryBuffer::uninitialized(size_t size)
+    {
+        MemoryBuffer buffer;
+        buffer.mData = MemoryUtility::alloc_uninit(size);
+        buffer.mSize = size;
+        buffer.mIsNewm = true;
+        return buffer;
+    }
+    
     MemoryBuffer::MemoryBuffer()
         :mData(nullptr)
         ,mSize(0)
@@ -420,7 +655,10 @@ namespace eokas {
     
         if(mPos + size > mBuffer->size())
         {
-            if (!mBuffer->expand(size * 2))
+            // grow geometrically, a sequence of small writes shouldn't reallocate every time.
+            size_t capacity = mBuffer->size();
+            size_t grow = std::max(mPos + size - capacity, capacity);
+            if (!mBuffer->expand(grow))
             {
                 return 0;
             }
@@ -484,4 +722,405 @@ namespace eokas {
         return mBuffer->data();
     }
     
+    /*
+    ============================================================================================
+    ==== MemoryPool
+    ============================================================================================
+    */
+    static const u32_t POOL_MIN_CLASS = 8;  // 256 bytes
+    static const u32_t POOL_MAX_CLASS = 20; // 1 MB
+    static const u32_t POOL_NO_CLASS = u32_t(-1);
+    
+    struct alignas(16) MemoryBlockHeader
+    {
+        size_t capacity;
+        u32_t sizeClass;
+    };
+    
+    struct MemoryPoolImpl
+    {
+        std::mutex mutex;
+        std::vector<void*> blocks[POOL_MAX_CLASS + 1];
+        size_t maxCachedBytes = 0;
+        size_t cachedBytes = 0;
+    };
+    
+    static inline MemoryBlockHeader* headerOf(void* ptr)
+    {
+        return (MemoryBlockHeader*)((u8_t*)ptr - sizeof(MemoryBlockHeader));
+    }
+    
+    MemoryPool& MemoryPool::instance()
+    {
+        static MemoryPool sInstance;
+        return sInstance;
+    }
+    
+    MemoryPool::MemoryPool(size_t maxCachedBytes)
+        :mImpl(new MemoryPoolImpl())
+    {
+        mImpl->maxCachedBytes = maxCachedBytes;
+    }
+    
+    MemoryPool::~MemoryPool()
+    {
+        this->trim();
+        delete mImpl;
+    }
+    
+    void* MemoryPool::acquire(size_t size)
+    {
+        u32_t sizeClass = POOL_MIN_CLASS;
+        while(sizeClass <= POOL_MAX_CLASS && (size_t(1) << sizeClass) < size)
+        {
+            sizeClass++;
+        }
+        
+        if(sizeClass > POOL_MAX_CLASS)
+        {
+            void* raw = std::malloc(sizeof(MemoryBlockHeader) + size);
+            if(raw == nullptr)
+                return nullptr;
+            MemoryBlockHeader* header = (MemoryBlockHeader*)raw;
+            header->capacity = size;
+            header->sizeClass = POOL_NO_CLASS;
+            return header + 1;
+        }
+        
+        size_t capacity = size_t(1) << sizeClass;
+        {
+            std::lock_guard<std::mutex> lock(mImpl->mutex);
+            std::vector<void*>& blocks = mImpl->blocks[sizeClass];
+            if(!blocks.empty())
+            {
+                void* ptr = blocks.back();
+                blocks.pop_back();
+                mImpl->cachedBytes -= capacity;
+                return ptr;
+            }
+        }
+        
+        void* raw = std::malloc(sizeof(MemoryBlockHeader) + capacity);
+        if(raw == nullptr)
+            return nullptr;
+        MemoryBlockHeader* header = (MemoryBlockHeader*)raw;
+        header->capacity = capacity;
+        header->sizeClass = sizeClass;
+        return header + 1;
+    }
+    
+    void MemoryPool::release(void* ptr)
+    {
+        if(ptr == nullptr)
+            return;
+        MemoryBlockHeader* header = headerOf(ptr);
+        if(header->sizeClass != POOL_NO_CLASS)
+        {
+            std::lock_guard<std::mutex> lock(mImpl->mutex);
+            if(mImpl->cachedBytes + header->capacity <= mImpl->maxCachedBytes)
+            {
+                mImpl->blocks[header->sizeClass].push_back(ptr);
+                mImpl->cachedBytes += header->capacity;
+                return;
+            }
+        }
+        std::free(header);
+    }
+    
+    size_t MemoryPool::capacity(void* ptr) const
+    {
+        if(ptr == nullptr)
+            return 0;
+        return headerOf(ptr)->capacity;
+    }
+    
+    size_t MemoryPool::cachedBytes() const
+    {
+        std::lock_guard<std::mutex> lock(mImpl->mutex);
+        return mImpl->cachedBytes;
+    }
+    
+    void MemoryPool::trim()
+    {
+        std::lock_guard<std::mutex> lock(mImpl->mutex);
+        for(auto& blocks : mImpl->blocks)
+        {
+            for(void* ptr : blocks)
+            {
+                std::free(headerOf(ptr));
+            }
+            blocks.clear();
+        }
+        mImpl->cachedBytes = 0;
+    }
+    
+    /*
+    ============================================================================================
+    ==== MemorySlice
+    ============================================================================================
+    */
+    MemorySlice::MemorySlice()
+        :mOwner()
+        ,mData(nullptr)
+        ,mSize(0)
+    {}
+    
+    MemorySlice::MemorySlice(const std::shared_ptr<const void>& owner, const void* data, size_t size)
+        :mOwner(owner)
+        ,mData((const u8_t*)data)
+        ,mSize(size)
+    {}
+    
+    const void* MemorySlice::data() const
+    {
+        return mData;
+    }
+    
+    size_t MemorySlice::size() const
+    {
+        return mSize;
+    }
+    
+    bool MemorySlice::isEmpty() const
+    {
+        return mSize == 0;
+    }
+    
+    MemorySlice MemorySlice::slice(size_t offset, size_t size) const
+    {
+        if(offset >= mSize)
+            return MemorySlice();
+        size = std::min(size, mSize - offset);
+        return MemorySlice(mOwner, mData + offset, size);
+    }
+    
+    /*
+    ============================================================================================
+    ==== ChunkStream
+    ============================================================================================
+    */
+    static const size_t CHUNK_MAX_SIZE = 1024 * 1024;
+    
+    struct ChunkStream::Chunk
+    {
+        MemoryPool& pool;
+        u8_t* data;
+        size_t capacity;
+        size_t size;
+        
+        Chunk(MemoryPool& pool, size_t capacity)
+            :pool(pool)
+            ,data((u8_t*)pool.acquire(capacity))
+            ,capacity(pool.capacity(data))
+            ,size(0)
+        {}
+        
+        ~Chunk()
+        {
+            pool.release(data);
+        }
+    };
+    
+    ChunkStream::ChunkStream(size_t chunkSize, MemoryPool& pool)
+        :mPool(pool)
+        ,mChunks()
+        ,mStarts()
+        ,mChunkSize(chunkSize > 0 ? chunkSize : 4096)
+        ,mSize(0)
+        ,mPos(0)
+        ,mIsOpen(false)
+    {}
+    
+    ChunkStream::~ChunkStream()
+    {
+        this->clear();
+    }
+    
+    bool ChunkStream::open()
+    {
+        mIsOpen = true;
+        mPos = 0;
+        return mIsOpen;
+    }
+    
+    void ChunkStream::close()
+    {
+        mIsOpen = false;
+        mPos = 0;
+    }
+    
+    bool ChunkStream::isOpen() const
+    {
+        return mIsOpen;
+    }
+    
+    bool ChunkStream::readable() const
+    {
+        return true;
+    }
+    
+    bool ChunkStream::writable() const
+    {
+        return true;
+    }
+    
+    bool ChunkStream::eos() const
+    {
+        return mPos >= mSize;
+    }
+    
+    size_t ChunkStream::pos() const
+    {
+        return mPos;
+    }
+    
+    size_t ChunkStream::size() const
+    {
+        return mSize;
+    }
+    
+    size_t ChunkStream::read(void* data, size_t size)
+    {
+        if(!mIsOpen)
+            return 0;
+        
+        u8_t* dst = (u8_t*)data;
+        size_t leng = 0;
+        while(leng < size && mPos < mSize)
+        {
+            size_t offset = 0;
+            size_t index = this->locate(mPos, offset);
+            const Chunk& chunk = *mChunks[index];
+            size_t count = std::min(size - leng, chunk.size - offset);
+            memcpy(dst + leng, chunk.data + offset, count);
+            leng += count;
+            mPos += count;
+        }
+        return leng;
+    }
+    
+    size_t ChunkStream::write(void* data, size_t size)
+    {
+        if(!mIsOpen)
+            return 0;
+        
+        const u8_t* src = (const u8_t*)data;
+        size_t leng = 0;
+        while(leng < size)
+        {
+            // only the last chunk may be partial, so reaching its capacity means the end.
+            if(mChunks.empty() || mPos == mStarts.back() + mChunks.back()->capacity)
+            {
+                if(!this->appendChunk())
+                    break;
+            }
+            
+            size_t offset = 0;
+            size_t index = this->locate(mPos, offset);
+            Chunk* chunk = this->writableChunk(index);
+            if(chunk == nullptr)
+                break;
+            size_t count = std::min(size - leng, chunk->capacity - offset);
+            memcpy(chunk->data + offset, src + leng, count);
+            chunk->size = std::max(chunk->size, offset + count);
+            leng += count;
+            mPos += count;
+        }
+        mSize = std::max(mSize, mPos);
+        return leng;
+    }
+    
+    bool ChunkStream::seek(int offset, int origin) // 0:beg, 1:cur, 2:end
+    {
+        if(!mIsOpen)
+            return false;
+        if(origin < 0 || origin > 2)
+            return false;
+        i64_t ori = (origin == 0) ? 0 : (origin == 1 ? i64_t(mPos) : i64_t(mSize));
+        i64_t ptr = ori + offset;
+        if(ptr < 0 || ptr > i64_t(mSize))
+            return false;
+        mPos = size_t(ptr);
+        return true;
+    }
+    
+    void ChunkStream::flush()
+    {}
+    
+    MemorySliceList ChunkStream::freeze() const
+    {
+        MemorySliceList slices;
+        slices.reserve(mChunks.size());
+        for(const ChunkRef& chunk : mChunks)
+        {
+            if(chunk->size == 0)
+                continue;
+            std::shared_ptr<const void> owner(chunk, chunk->data);
+            slices.emplace_back(owner, chunk->data, chunk->size);
+        }
+        return slices;
+    }
+    
+    MemoryBuffer ChunkStream::flatten() const
+    {
+        MemoryBuffer buffer = MemoryBuffer::uninitialized(mSize);
+        u8_t* dst = (u8_t*)buffer.data();
+        for(const ChunkRef& chunk : mChunks)
+        {
+            memcpy(dst, chunk->data, chunk->size);
+            dst += chunk->size;
+        }
+        return buffer;
+    }
+    
+    size_t ChunkStream::chunkCount() const
+    {
+        return mChunks.size();
+    }
+    
+    void ChunkStream::clear()
+    {
+        mChunks.clear();
+        mStarts.clear();
+        mSize = 0;
+        mPos = 0;
+    }
+    
+    size_t ChunkStream::locate(size_t pos, size_t& offset) const
+    {
+        auto iter = std::upper_bound(mStarts.begin(), mStarts.end(), pos);
+        size_t index = size_t(iter - mStarts.begin()) - 1;
+        offset = pos - mStarts[index];
+        return index;
+    }
+    
+    ChunkStream::Chunk* ChunkStream::writableChunk(size_t index)
+    {
+        ChunkRef& chunk = mChunks[index];
+        if(chunk.use_count() > 1)
+        {
+            // shared by frozen slices, copy on write.
+            ChunkRef copy = std::make_shared<Chunk>(mPool, chunk->capacity);
+            if(copy->data == nullptr)
+                return nullptr;
+            memcpy(copy->data, chunk->data, chunk->size);
+            copy->size = chunk->size;
+            chunk = copy;
+        }
+        return chunk.get();
+    }
+    
+    bool ChunkStream::appendChunk()
+    {
+        size_t start = mChunks.empty() ? 0 : mStarts.back() + mChunks.back()->capacity;
+        size_t capacity = std::min(std::max(mChunkSize, start), std::max(mChunkSize, CHUNK_MAX_SIZE));
+        ChunkRef chunk = std::make_shared<Chunk>(mPool, capacity);
+        // out of memory, the write stops short.
+        if(chunk->data == nullptr)
+            return false;
+        mChunks.push_back(chunk);
+        mStarts.push_back(start);
+        return true;
+    }
+    
 }
@@ -15,6 +15,8 @@ namespace eokas {
     class MemoryUtility {
     public:
         static void* alloc(size_t size);
+        /// the content of the returned memory is undefined.
+        static void* alloc_uninit(size_t size);
         static void* alloc(size_t size, void* data);
         static void* alloc(size_t size, void* data, size_t leng);
         static void* realloc(void* ptr, size_t size);
@@ -26,6 +28,56 @@ namespace eokas {
         static void* alloc_v(size_t size, u32_t prot);
         static void free_v(void* ptr, size_t size);
         static u32_t prot_v(void* ptr, size_t size, u32_t proto);
+        
+        /// flags of reserve_v
+        enum VirtualFlags : u32_t {
+            VF_NONE = 0,
+            VF_HUGE_PAGES = 1,          // transparent huge pages, a hint.
+            VF_EXPLICIT_HUGE_PAGES = 2, // pages from the huge page pool, fails if the pool is empty.
+        };
+        /// reserve address space only, the pages must be committed before they're accessed.
+        static void* reserve_v(size_t size, u32_t flags = VF_NONE);
+        static bool commit_v(void* ptr, size_t size, u32_t prot);
+        /// return the physical pages to the os, the address space stays reserved.
+        static bool decommit_v(void* ptr, size_t size);
+        static void release_v(void* ptr, size_t size);
+        /// prefer allocating the pages of the range on the numa node.
+        static bool bind_v(void* ptr, size_t size, i32_t node);
+        static size_t page_size();
+        static size_t huge_page_size();
+    };
+    
+    /*
+    ============================================================================================
+    ==== VirtualRegion
+    ============================================================================================
+    */
+    /*
+    A reserved range of address space which is committed on demand, so the
+    data in it can grow without being relocated.
+    */
+    class VirtualRegion {
+        _ForbidCopy(VirtualRegion);
+        _ForbidAssign(VirtualRegion);
+    
+    public:
+        VirtualRegion(size_t reserveSize, u32_t prot = 3, u32_t flags = MemoryUtility::VF_NONE, i32_t node = -1);
+        ~VirtualRegion();
+    
+    public:
+        void* data() const;
+        size_t reserved() const;
+        size_t committed() const;
+        size_t granularity() const;
+        bool grow(size_t size);
+        void shrink(size_t size);
+    
+    private:
+        u8_t* mData;
+        size_t mReserved;
+        size_t mCommitted;
+        size_t mGranularity;
+        u32_t mProt;
     };
     
     /*
@@ -34,6 +86,10 @@ namespace eokas {
     ============================================================================================
     */
     class MemoryBuffer {
+    public:
+        /// the content of the returned buffer is undefined, use it when it's overwritten immediately.
+        static MemoryBuffer uninitialized(size_t size);
+    
     public:
         MemoryBuffer();
         MemoryBuffer(MemoryBuffer&& temp);
@@ -101,6 +157,123 @@ namespace eokas {
         size_t mPos;
     };
     
+    /*
+    ============================================================================================
+    ==== MemoryPool
+    ============================================================================================
+    */
+    /*
+    Caches freed blocks in power-of-two size classes, so short-lived buffers
+    of serialization and networking don't go through malloc every time.
+    Blocks larger than the largest class are allocated directly.
+    Thread-safe.
+    */
+    class MemoryPool {
+        _ForbidCopy(MemoryPool);
+        _ForbidAssign(MemoryPool);
+    
+    public:
+        static MemoryPool& instance();
+    
+    public:
+        MemoryPool(size_t maxCachedBytes = 16 * 1024 * 1024);
+        ~MemoryPool();
+    
+    public:
+        void* acquire(size_t size);
+        void release(void* ptr);
+        size_t capacity(void* ptr) const;
+        size_t cachedBytes() const;
+        void trim();
+    
+    private:
+        struct MemoryPoolImpl* mImpl;
+    };
+    
+    /*
+    ============================================================================================
+    ==== MemorySlice
+    ============================================================================================
+    */
+    /*
+    A read-only view of a range of memory, which shares the ownership of
+    the memory block, so it's valid after the producer is destroyed.
+    */
+    class MemorySlice {
+    public:
+        MemorySlice();
+        MemorySlice(const std::shared_ptr<const void>& owner, const void* data, size_t size);
+    
+    public:
+        const void* data() const;
+        size_t size() const;
+        bool isEmpty() const;
+        MemorySlice slice(size_t offset, size_t size = size_t(-1)) const;
+    
+    private:
+        std::shared_ptr<const void> mOwner;
+        const u8_t* mData;
+        size_t mSize;
+    };
+    
+    using MemorySliceList = std::vector<MemorySlice>;
+    
+    /*
+    ============================================================================================
+    ==== ChunkStream
+    ============================================================================================
+    */
+    /*
+    A growable memory stream made of a list of chunks, writing at the end
+    appends without copying the written data, and freeze() gives out the
+    chunks as shared read-only slices.
+    A chunk referenced by slices is copied before it's overwritten.
+    */
+    class ChunkStream : public Stream {
+        _ForbidCopy(ChunkStream);
+        _ForbidAssign(ChunkStream);
+    
+    public:
+        ChunkStream(size_t chunkSize = 4096, MemoryPool& pool = MemoryPool::instance());
+        virtual ~ChunkStream();
+    
+    public:
+        virtual bool open() override;
+        virtual void close() override;
+        virtual bool isOpen() const override;
+        virtual bool readable() const override;
+        virtual bool writable() const override;
+        virtual bool eos() const override;
+        virtual size_t pos() const override;
+        virtual size_t size() const override;
+        virtual size_t read(void* data, size_t size) override;
+        virtual size_t write(void* data, size_t size) override;
+        virtual bool seek(int offset, int origin) override; // 0:beg, 1:cur, 2:end
+        virtual void flush() override;
+    
+    public:
+        MemorySliceList freeze() const;
+        MemoryBuffer flatten() const;
+        size_t chunkCount() const;
+        void clear();
+    
+    private:
+        struct Chunk;
+        using ChunkRef = std::shared_ptr<Chunk>;
+        
+        size_t locate(size_t pos, size_t& offset) const;
+        Chunk* writableChunk(size_t index);
+        bool appendChunk();
+        
+        MemoryPool& mPool;
+        std::vector<ChunkRef> mChunks;
+        std::vector<size_t> mStarts;
+        size_t mChunkSize;
+        size_t mSize;
+        size_t mPos;
+        bool mIsOpen;
+    };
+    
 }
 
 #endif//_EOKAS_BASE_MEMORY_H_
@@ -0,0 +1,235 @@
+
+#include "./profiler.h"
+#include "./timer.h"
+#include "./queue.h"
+#include "./io.h"
+#include <atomic>
+#include <mutex>
+
+namespace eokas {
+
+    static const size_t PROFILE_BUFFER_SIZE = 16 * 1024;
+
+    struct ProfileThreadBuffer {
+        u32_t thread = 0;
+        SpscRing<ProfileEvent> events = SpscRing<ProfileEvent>(PROFILE_BUFFER_SIZE);
+        std::vector<ProfileEvent> stack = {};
+        std::atomic<u64_t> dropped = {0};
+    };
+
+    static std::atomic<u64_t> sProfilerIds = {0};
+    static thread_local u64_t tProfilerId = 0;
+    static thread_local ProfileThreadBuffer* tProfileBuffer = nullptr;
+    /* the buffers of this thread by profiler, ids are never reused. */
+    static thread_local std::map<u64_t, ProfileThreadBuffer*> tProfileBuffers;
+
+    struct ProfilerImpl {
+        u64_t id = ++sProfilerIds;
+        std::atomic<bool> enabled = {true};
+        std::atomic<bool> capturing = {false};
+
+        mutable std::mutex mutex = {};
+        std::vector<std::unique_ptr<ProfileThreadBuffer>> buffers = {};
+        std::vector<ProfileEvent> trace = {};
+        ProfileFrame last = {};
+        u64_t frameIndex = 0;
+        u64_t frameStart = Timer::now();
+
+        ProfileThreadBuffer* local() {
+            if (tProfilerId == id)
+                return tProfileBuffer;
+
+            ProfileThreadBuffer*& buffer = tProfileBuffers[id];
+            if (buffer == nullptr) {
+                std::lock_guard<std::mutex> lock(mutex);
+                buffers.emplace_back(new ProfileThreadBuffer());
+                buffer = buffers.back().get();
+                buffer->thread = u32_t(buffers.size());
+            }
+            tProfilerId = id;
+            tProfileBuffer = buffer;
+            return buffer;
+        }
+
+        /* the caller holds the mutex, it is the only consumer of the rings. */
+        u64_t drain(std::vector<ProfileEvent>& events) {
+            u64_t dropped = 0;
+            ProfileEvent batch[256];
+            for (auto& buffer: buffers) {
+                size_t count = 0;
+                while ((count = buffer->events.popBatch(batch, 256)) > 0) {
+                    events.insert(events.end(), batch, batch + count);
+                }
+                dropped += buffer->dropped.exchange(0);
+            }
+            return dropped;
+        }
+    };
+
+    Profiler& Profiler::instance() {
+        static Profiler sInstance;
+        return sInstance;
+    }
+
+    Profiler::Profiler()
+        : mImpl(new ProfilerImpl()) {
+    }
+
+    Profiler::~Profiler() {
+        delete mImpl;
+    }
+
+    void Profiler::setEnabled(bool enabled) {
+        mImpl->enabled = enabled;
+    }
+
+    bool Profiler::isEnabled() const {
+        return mImpl->enabled;
+    }
+
+    bool Profiler::begin(const char* name) {
+        if (!mImpl->enabled.load(std::memory_order_relaxed))
+            return false;
+        ProfileThreadBuffer* buffer = mImpl->local();
+        ProfileEvent event;
+        event.name = name;
+        event.thread = buffer->thread;
+        event.depth = u32_t(buffer->stack.size());
+        event.start = Timer::now();
+        buffer->stack.push_back(event);
+        return true;
+    }
+
+    void Profiler::end() {
+        u64_t now = Timer::now();
+        ProfileThreadBuffer* buffer = mImpl->local();
+        if (buffer->stack.empty())
+            return;
+        ProfileEvent event = buffer->stack.back();
+        buffer->stack.pop_back();
+        event.end = now;
+        if (!buffer->events.push(event)) {
+            buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void Profiler::frame() {
+        std::lock_guard<std::mutex> lock(mImpl->mutex);
+        u64_t now = Timer::now();
+
+        std::vector<ProfileEvent> events;
+        u64_t dropped = mImpl->drain(events);
+
+        std::map<String, size_t> indices;
+        ProfileFrame& frame = mImpl->last;
+        frame.index = mImpl->frameIndex;
+        frame.start = mImpl->frameStart;
+        frame.duration = now - mImpl->frameStart;
+        frame.dropped = dropped;
+        frame.zones.clear();
+        for (auto& event: events) {
+            String name = event.name;
+            auto iter = indices.find(name);
+            if (iter == indices.end()) {
+                iter = indices.insert(std::make_pair(name, frame.zones.size())).first;
+                frame.zones.emplace_back();
+                frame.zones.back().name = name;
+            }
+            ProfileZoneStats& stats = frame.zones[iter->second];
+            u64_t duration = event.end - event.start;
+            stats.calls += 1;
+            stats.total += duration;
+            stats.max = duration > stats.max ? duration : stats.max;
+        }
+
+        if (mImpl->capturing) {
+            mImpl->trace.insert(mImpl->trace.end(), events.begin(), events.end());
+        }
+
+        mImpl->frameIndex += 1;
+        mImpl->frameStart = now;
+    }
+
+    const ProfileFrame& Profiler::lastFrame() const {
+        return mImpl->last;
+    }
+
+    void Profiler::setCapturing(bool capturing) {
+        mImpl->capturing = capturing;
+    }
+
+    bool Profiler::isCapturing() const {
+        return mImpl->capturing;
+    }
+
+    size_t Profiler::capturedCount() const {
+        std::lock_guard<std::mutex> lock(mImpl->mutex);
+        return mImpl->trace.size();
+    }
+
+    static void appendJsonString(std::string& json, const char* str) {
+        json += '"';
+        for (const char* ptr = str; *ptr != '\0'; ptr++) {
+            char c = *ptr;
+            if (c == '"' || c == '\\') {
+                json += '\\';
+                json += c;
+            }
+            else if (u8_t(c) < 0x20) {
+                char code[8];
+                snprintf(code, sizeof(code), "\\u%04x", c);
+                json += code;
+            }
+            else {
+                json += c;
+            }
+        }
+        json += '"';
+    }
+
+    /*
+    Chrome trace event format, load the file in chrome://tracing or Perfetto.
+    Zones become complete events ("ph":"X") with microsecond timestamps.
+    */
+    bool Profiler::exportChromeTrace(const String& path) const {
+        std::string json;
+        {
+            std::lock_guard<std::mutex> lock(mImpl->mutex);
+            u64_t origin = mImpl->trace.empty() ? 0 : mImpl->trace.front().start;
+            for (auto& event: mImpl->trace) {
+                origin = event.start < origin ? event.start : origin;
+            }
+
+            json.reserve(mImpl->trace.size() * 96 + 32);
+            json += "{\"traceEvents\":[";
+            char text[128];
+            for (size_t i = 0; i < mImpl->trace.size(); i++) {
+                const ProfileEvent& event = mImpl->trace[i];
+                json += i > 0 ? ",\n{\"name\":" : "\n{\"name\":";
+                appendJsonString(json, event.name != nullptr ? event.name : "");
+                snprintf(text, sizeof(text), ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                         event.thread, (event.start - origin) / 1000.0, (event.end - event.start) / 1000.0);
+                json += text;
+            }
+            json += "\n],\"displayTimeUnit\":\"ns\"}\n";
+        }
+
+        FileStream stream(path, "wb");
+        if (!stream.open())
+            return false;
+        size_t size = stream.write((void*) json.data(), json.size());
+        stream.close();
+        return size == json.size();
+    }
+
+    void Profiler::clear() {
+        std::lock_guard<std::mutex> lock(mImpl->mutex);
+        std::vector<ProfileEvent> events;
+        mImpl->drain(events);
+        mImpl->trace.clear();
+        mImpl->last = ProfileFrame();
+        mImpl->frameIndex = 0;
+        mImpl->frameStart = Timer::now();
+    }
+
+}
@@ -0,0 +1,109 @@
+
+#ifndef  _EOKAS_BASE_PROFILER_H_
+#define  _EOKAS_BASE_PROFILER_H_
+
+#include "./header.h"
+#include "./string.h"
+
+namespace eokas {
+
+    /*
+    =================================================================
+    == ProfileEvent
+    =================================================================
+    */
+    /// name must be a string literal or outlive the profiler.
+    struct ProfileEvent {
+        const char* name = nullptr;
+        u64_t start = 0;
+        u64_t end = 0;
+        u32_t thread = 0;
+        u32_t depth = 0;
+    };
+
+    struct ProfileZoneStats {
+        String name;
+        u32_t calls = 0;
+        u64_t total = 0;
+        u64_t max = 0;
+    };
+
+    struct ProfileFrame {
+        u64_t index = 0;
+        u64_t start = 0;
+        u64_t duration = 0;
+        u64_t dropped = 0;
+        std::vector<ProfileZoneStats> zones;
+    };
+
+    /*
+    =================================================================
+    == Profiler
+    =================================================================
+    */
+    /*
+    Records nested zones into a lock-free buffer owned by the calling
+    thread, so zones are cheap and may be used from any thread.
+    frame() is called once per frame by the owner's loop: it drains the
+    thread buffers, aggregates the zones of the frame and, while capturing,
+    keeps the raw events for exportChromeTrace().
+    All times are nanoseconds from Timer::now().
+    */
+    class Profiler {
+        _ForbidCopy(Profiler);
+        _ForbidAssign(Profiler);
+
+    public:
+        static Profiler& instance();
+
+    public:
+        Profiler();
+        ~Profiler();
+
+    public:
+        void setEnabled(bool enabled);
+        bool isEnabled() const;
+
+        /// false while disabled, end() is only called for a begin() that returned true.
+        bool begin(const char* name);
+        void end();
+
+        void frame();
+        const ProfileFrame& lastFrame() const;
+
+        void setCapturing(bool capturing);
+        bool isCapturing() const;
+        size_t capturedCount() const;
+        bool exportChromeTrace(const String& path) const;
+        void clear();
+
+    private:
+        struct ProfilerImpl* mImpl;
+    };
+
+    class ProfileZone {
+        _ForbidCopy(ProfileZone);
+        _ForbidAssign(ProfileZone);
+
+    public:
+        explicit ProfileZone(const char* name)
+            : mRecorded(Profiler::instance().begin(name)) {
+        }
+
+        ~ProfileZone() {
+            if (mRecorded) {
+                Profiler::instance().end();
+            }
+        }
+
+    private:
+        bool mRecorded;
+    };
+
+#define _EOKAS_PROFILE_CONCAT_IMPL(a, b) a##b
+#define _EOKAS_PROFILE_CONCAT(a, b) _EOKAS_PROFILE_CONCAT_IMPL(a, b)
+#define _eokas_profile_zone(name) eokas::ProfileZone _EOKAS_PROFILE_CONCAT(__eokas_profile_zone_, __LINE__)(name)
+
+}
+
+#endif//_EOKAS_BASE_PROFILER_H_
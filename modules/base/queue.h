@@ -0,0 +1,398 @@
+
+#ifndef  _EOKAS_BASE_QUEUE_H_
+#define  _EOKAS_BASE_QUEUE_H_
+
+#include "./header.h"
+#include <atomic>
+#include <new>
+
+namespace eokas {
+
+#ifndef _EOKAS_CACHE_LINE_SIZE
+#define _EOKAS_CACHE_LINE_SIZE 64
+#endif//_EOKAS_CACHE_LINE_SIZE
+
+    inline size_t queue_capacity(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        return size;
+    }
+
+    /*
+    =================================================================
+    == SpscRing
+    =================================================================
+    */
+    /*
+    Bounded ring buffer for exactly one producer thread and one consumer
+    thread. Each side caches the other side's index, so the shared cache
+    lines are only touched when the cached view says full or empty.
+    */
+    template<typename T>
+    class SpscRing {
+        _ForbidCopy(SpscRing);
+        _ForbidAssign(SpscRing);
+
+    public:
+        explicit SpscRing(size_t capacity)
+            : mItems(nullptr)
+            , mMask(queue_capacity(capacity) - 1)
+            , mHead(0), mTailCache(0)
+            , mTail(0), mHeadCache(0) {
+            mItems = static_cast<T*>(::operator new(sizeof(T) * (mMask + 1)));
+        }
+
+        ~SpscRing() {
+            size_t head = mHead.load(std::memory_order_relaxed);
+            size_t tail = mTail.load(std::memory_order_relaxed);
+            for (; head != tail; head++) {
+                mItems[head & mMask].~T();
+            }
+            ::operator delete(mItems);
+        }
+
+    public:
+        size_t capacity() const {
+            return mMask + 1;
+        }
+
+        size_t size() const {
+            size_t tail = mTail.load(std::memory_order_acquire);
+            size_t head = mHead.load(std::memory_order_acquire);
+            return tail - head;
+        }
+
+        bool empty() const {
+            return this->size() == 0;
+        }
+
+        /* producer */
+        template<typename... Args>
+        bool emplace(Args&& ... args) {
+            size_t tail = mTail.load(std::memory_order_relaxed);
+            if (tail - mHeadCache > mMask) {
+                mHeadCache = mHead.load(std::memory_order_acquire);
+                if (tail - mHeadCache > mMask)
+                    return false;
+            }
+            new(&mItems[tail & mMask]) T(std::forward<Args>(args)...);
+            mTail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool push(const T& item) {
+            return this->emplace(item);
+        }
+
+        bool push(T&& item) {
+            return this->emplace(std::move(item));
+        }
+
+        /* producer, publish as many items as fit with one release store. */
+        size_t pushBatch(const T* items, size_t count) {
+            size_t tail = mTail.load(std::memory_order_relaxed);
+            size_t free = mMask + 1 - (tail - mHeadCache);
+            if (free < count) {
+                mHeadCache = mHead.load(std::memory_order_acquire);
+                free = mMask + 1 - (tail - mHeadCache);
+            }
+            size_t n = count < free ? count : free;
+            for (size_t i = 0; i < n; i++) {
+                new(&mItems[(tail + i) & mMask]) T(items[i]);
+            }
+            if (n > 0) {
+                mTail.store(tail + n, std::memory_order_release);
+            }
+            return n;
+        }
+
+        /* consumer */
+        bool pop(T& item) {
+            size_t head = mHead.load(std::memory_order_relaxed);
+            if (head == mTailCache) {
+                mTailCache = mTail.load(std::memory_order_acquire);
+                if (head == mTailCache)
+                    return false;
+            }
+            T& slot = mItems[head & mMask];
+            item = std::move(slot);
+            slot.~T();
+            mHead.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        /* consumer */
+        size_t popBatch(T* items, size_t count) {
+            size_t head = mHead.load(std::memory_order_relaxed);
+            size_t avail = mTailCache - head;
+            if (avail < count) {
+                mTailCache = mTail.load(std::memory_order_acquire);
+                avail = mTailCache - head;
+            }
+            size_t n = count < avail ? count : avail;
+            for (size_t i = 0; i < n; i++) {
+                T& slot = mItems[(head + i) & mMask];
+                items[i] = std::move(slot);
+                slot.~T();
+            }
+            if (n > 0) {
+                mHead.store(head + n, std::memory_order_release);
+            }
+            return n;
+        }
+
+    private:
+        T* mItems;
+        size_t mMask;
+
+        // consumer side
+        alignas(_EOKAS_CACHE_LINE_SIZE) std::atomic<size_t> mHead;
+        size_t mTailCache;
+
+        // producer side
+        alignas(_EOKAS_CACHE_LINE_SIZE) std::atomic<size_t> mTail;
+        size_t mHeadCache;
+    };
+
+    /*
+    =================================================================
+    == MpmcQueue
+    =================================================================
+    */
+    /*
+    Bounded queue for any number of producers and consumers (Dmitry Vyukov's
+    design). Every cell carries a sequence number telling whether it is
+    ready to be written or read in the current lap, so producers and
+    consumers only contend on their own position counter.
+    */
+    template<typename T>
+    class MpmcQueue {
+        _ForbidCopy(MpmcQueue);
+        _ForbidAssign(MpmcQueue);
+
+        struct Cell {
+            std::atomic<size_t> sequence;
+            alignas(T) unsigned char storage[sizeof(T)];
+        };
+
+    public:
+        explicit MpmcQueue(size_t capacity)
+            : mCells(nullptr)
+            , mMask(queue_capacity(capacity) - 1)
+            , mEnqueuePos(0)
+            , mDequeuePos(0) {
+            mCells = new Cell[mMask + 1];
+            for (size_t i = 0; i <= mMask; i++) {
+                mCells[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        ~MpmcQueue() {
+            size_t pos = mDequeuePos.load(std::memory_order_relaxed);
+            size_t end = mEnqueuePos.load(std::memory_order_relaxed);
+            for (; pos != end; pos++) {
+                reinterpret_cast<T*>(mCells[pos & mMask].storage)->~T();
+            }
+            delete[] mCells;
+        }
+
+    public:
+        size_t capacity() const {
+            return mMask + 1;
+        }
+
+        /* approximate when other threads are running. */
+        size_t size() const {
+            size_t end = mEnqueuePos.load(std::memory_order_acquire);
+            size_t pos = mDequeuePos.load(std::memory_order_acquire);
+            return end > pos ? end - pos : 0;
+        }
+
+        bool empty() const {
+            return this->size() == 0;
+        }
+
+        template<typename... Args>
+        bool emplace(Args&& ... args) {
+            Cell* cell = nullptr;
+            size_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+            while (true) {
+                cell = &mCells[pos & mMask];
+                size_t seq = cell->sequence.load(std::memory_order_acquire);
+                intptr_t diff = intptr_t(seq) - intptr_t(pos);
+                if (diff == 0) {
+                    if (mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                }
+                else if (diff < 0) {
+                    return false;
+                }
+                else {
+                    pos = mEnqueuePos.load(std::memory_order_relaxed);
+                }
+            }
+            new(cell->storage) T(std::forward<Args>(args)...);
+            cell->sequence.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool push(const T& item) {
+            return this->emplace(item);
+        }
+
+        bool push(T&& item) {
+            return this->emplace(std::move(item));
+        }
+
+        bool pop(T& item) {
+            Cell* cell = nullptr;
+            size_t pos = mDequeuePos.load(std::memory_order_relaxed);
+            while (true) {
+                cell = &mCells[pos & mMask];
+                size_t seq = cell->sequence.load(std::memory_order_acquire);
+                intptr_t diff = intptr_t(seq) - intptr_t(pos + 1);
+                if (diff == 0) {
+                    if (mDequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                }
+                else if (diff < 0) {
+                    return false;
+                }
+                else {
+                    pos = mDequeuePos.load(std::memory_order_relaxed);
+                }
+            }
+            T* slot = reinterpret_cast<T*>(cell->storage);
+            item = std::move(*slot);
+            slot->~T();
+            cell->sequence.store(pos + mMask + 1, std::memory_order_release);
+            return true;
+        }
+
+        size_t pushBatch(const T* items, size_t count) {
+            size_t n = 0;
+            while (n < count && this->push(items[n])) {
+                n++;
+            }
+            return n;
+        }
+
+        size_t popBatch(T* items, size_t count) {
+            size_t n = 0;
+            while (n < count && this->pop(items[n])) {
+                n++;
+            }
+            return n;
+        }
+
+    private:
+        Cell* mCells;
+        size_t mMask;
+
+        alignas(_EOKAS_CACHE_LINE_SIZE) std::atomic<size_t> mEnqueuePos;
+        alignas(_EOKAS_CACHE_LINE_SIZE) std::atomic<size_t> mDequeuePos;
+    };
+
+    /*
+    =================================================================
+    == MpscQueue
+    =================================================================
+    */
+    /*
+    Intrusive queue for any number of producers and a single consumer.
+    Items derive from MpscNode and are linked in place, so pushing never
+    allocates, the queue is bounded by the nodes the owner creates.
+    The queue doesn't own the nodes.
+    */
+    struct MpscNode {
+        std::atomic<MpscNode*> mpscNext = {nullptr};
+    };
+
+    template<typename TNode>
+    class MpscQueue {
+        _ForbidCopy(MpscQueue);
+        _ForbidAssign(MpscQueue);
+
+    public:
+        MpscQueue()
+            : mHead(&mStub)
+            , mTail(&mStub)
+            , mStub() {
+        }
+
+    public:
+        /* producer */
+        void push(TNode* node) {
+            this->pushChain(node, node);
+        }
+
+        /* producer, link the nodes privately and publish them with one exchange. */
+        void pushBatch(TNode** nodes, size_t count) {
+            if (count == 0)
+                return;
+            for (size_t i = 0; i + 1 < count; i++) {
+                nodes[i]->mpscNext.store(nodes[i + 1], std::memory_order_relaxed);
+            }
+            this->pushChain(nodes[0], nodes[count - 1]);
+        }
+
+        /*
+        consumer, returns nullptr when the queue is empty or a producer
+        is in the middle of a push.
+        */
+        TNode* pop() {
+            MpscNode* tail = mTail;
+            MpscNode* next = tail->mpscNext.load(std::memory_order_acquire);
+            if (tail == &mStub) {
+                if (next == nullptr)
+                    return nullptr;
+                mTail = next;
+                tail = next;
+                next = next->mpscNext.load(std::memory_order_acquire);
+            }
+            if (next != nullptr) {
+                mTail = next;
+                return static_cast<TNode*>(tail);
+            }
+            if (tail != mHead.load(std::memory_order_acquire))
+                return nullptr;
+            this->pushChain(&mStub, &mStub);
+            next = tail->mpscNext.load(std::memory_order_acquire);
+            if (next != nullptr) {
+                mTail = next;
+                return static_cast<TNode*>(tail);
+            }
+            return nullptr;
+        }
+
+        /* consumer */
+        size_t popBatch(TNode** nodes, size_t count) {
+            size_t n = 0;
+            while (n < count && (nodes[n] = this->pop()) != nullptr) {
+                n++;
+            }
+            return n;
+        }
+
+        /* consumer */
+        bool empty() const {
+            return mTail == &mStub && mStub.mpscNext.load(std::memory_order_acquire) == nullptr;
+        }
+
+    private:
+        void pushChain(MpscNode* first, MpscNode* last) {
+            last->mpscNext.store(nullptr, std::memory_order_relaxed);
+            MpscNode* prev = mHead.exchange(last, std::memory_order_acq_rel);
+            prev->mpscNext.store(first, std::memory_order_release);
+        }
+
+        alignas(_EOKAS_CACHE_LINE_SIZE) std::atomic<MpscNode*> mHead;
+        alignas(_EOKAS_CACHE_LINE_SIZE) MpscNode* mTail;
+        MpscNode mStub;
+    };
+
+}
+
+#endif//_EOKAS_BASE_QUEUE_H_
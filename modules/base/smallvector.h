@@ -0,0 +1,474 @@
+
+#ifndef  _EOKAS_BASE_SMALLVECTOR_H_
+#define  _EOKAS_BASE_SMALLVECTOR_H_
+
+#include "./header.h"
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace eokas {
+
+    /*
+    =================================================================
+    == SmallVector
+    =================================================================
+    */
+    /*
+    A vector that keeps its first N elements inside the object and only
+    goes to the heap once it grows past them. Iterators are plain pointers
+    and are invalidated by any growth, like std::vector's. Moving a vector
+    that is still inline moves the elements one by one.
+    */
+    template<typename T, size_t N>
+    class SmallVector {
+        static_assert(N > 0, "SmallVector needs an inline capacity.");
+        static_assert(alignof(T) <= alignof(std::max_align_t), "over aligned types are not supported.");
+
+    public:
+        using value_type = T;
+        using size_type = size_t;
+        using reference = T&;
+        using const_reference = const T&;
+        using pointer = T*;
+        using const_pointer = const T*;
+        using iterator = T*;
+        using const_iterator = const T*;
+        using reverse_iterator = std::reverse_iterator<iterator>;
+        using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+    public:
+        SmallVector()
+            : mData(this->inlineData())
+            , mSize(0)
+            , mCapacity(N) {
+        }
+
+        explicit SmallVector(size_t count)
+            : SmallVector() {
+            this->resize(count);
+        }
+
+        SmallVector(size_t count, const T& value)
+            : SmallVector() {
+            this->resize(count, value);
+        }
+
+        template<typename Iter, typename = typename std::iterator_traits<Iter>::iterator_category>
+        SmallVector(Iter first, Iter last)
+            : SmallVector() {
+            this->assign(first, last);
+        }
+
+        SmallVector(std::initializer_list<T> items)
+            : SmallVector() {
+            this->assign(items.begin(), items.end());
+        }
+
+        SmallVector(const SmallVector& other)
+            : SmallVector() {
+            this->assign(other.begin(), other.end());
+        }
+
+        SmallVector(SmallVector&& other) noexcept(std::is_nothrow_move_constructible_v<T>)
+            : SmallVector() {
+            this->steal(std::move(other));
+        }
+
+        ~SmallVector() {
+            this->clear();
+            this->release();
+        }
+
+        SmallVector& operator=(const SmallVector& other) {
+            if (this != &other) {
+                this->assign(other.begin(), other.end());
+            }
+            return *this;
+        }
+
+        SmallVector& operator=(SmallVector&& other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+            if (this != &other) {
+                this->clear();
+                this->release();
+                this->steal(std::move(other));
+            }
+            return *this;
+        }
+
+        SmallVector& operator=(std::initializer_list<T> items) {
+            this->assign(items.begin(), items.end());
+            return *this;
+        }
+
+    public:
+        iterator begin() { return mData; }
+        const_iterator begin() const { return mData; }
+        const_iterator cbegin() const { return mData; }
+        iterator end() { return mData + mSize; }
+        const_iterator end() const { return mData + mSize; }
+        const_iterator cend() const { return mData + mSize; }
+        reverse_iterator rbegin() { return reverse_iterator(this->end()); }
+        const_reverse_iterator rbegin() const { return const_reverse_iterator(this->end()); }
+        reverse_iterator rend() { return reverse_iterator(this->begin()); }
+        const_reverse_iterator rend() const { return const_reverse_iterator(this->begin()); }
+
+        bool empty() const { return mSize == 0; }
+        size_t size() const { return mSize; }
+        size_t capacity() const { return mCapacity; }
+        /// true while the elements still live in the inline buffer.
+        bool isInline() const { return mData == this->inlineData(); }
+
+        T* data() { return mData; }
+        const T* data() const { return mData; }
+
+        T& operator[](size_t index) { return mData[index]; }
+        const T& operator[](size_t index) const { return mData[index]; }
+
+        T& at(size_t index) {
+            if (index >= mSize)
+                throw std::out_of_range("SmallVector::at");
+            return mData[index];
+        }
+
+        const T& at(size_t index) const {
+            if (index >= mSize)
+                throw std::out_of_range("SmallVector::at");
+            return mData[index];
+        }
+
+        T& front() { return mData[0]; }
+        const T& front() const { return mData[0]; }
+        T& back() { return mData[mSize - 1]; }
+        const T& back() const { return mData[mSize - 1]; }
+
+        template<typename Iter>
+        void assign(Iter first, Iter last) {
+            this->clear();
+            for (; first != last; ++first) {
+                this->emplace_back(*first);
+            }
+        }
+
+        void reserve(size_t capacity) {
+            if (capacity > mCapacity) {
+                this->reallocate(capacity);
+            }
+        }
+
+        void shrink_to_fit() {
+            if (!this->isInline() && mSize < mCapacity) {
+                this->reallocate(mSize);
+            }
+        }
+
+        void clear() {
+            std::destroy(mData, mData + mSize);
+            mSize = 0;
+        }
+
+        template<typename... Args>
+        T& emplace_back(Args&&... args) {
+            if (mSize == mCapacity) {
+                // build the new element first, args may refer into this vector.
+                size_t capacity = mCapacity * 2;
+                T* data = static_cast<T*>(::operator new(sizeof(T) * capacity));
+                new(data + mSize) T(std::forward<Args>(args)...);
+                std::uninitialized_move(mData, mData + mSize, data);
+                std::destroy(mData, mData + mSize);
+                this->release();
+                mData = data;
+                mCapacity = capacity;
+            }
+            else {
+                new(mData + mSize) T(std::forward<Args>(args)...);
+            }
+            mSize += 1;
+            return this->back();
+        }
+
+        void push_back(const T& value) {
+            this->emplace_back(value);
+        }
+
+        void push_back(T&& value) {
+            this->emplace_back(std::move(value));
+        }
+
+        void pop_back() {
+            mSize -= 1;
+            mData[mSize].~T();
+        }
+
+        template<typename... Args>
+        iterator emplace(const_iterator pos, Args&&... args) {
+            size_t index = size_t(pos - mData);
+            this->emplace_back(std::forward<Args>(args)...);
+            std::rotate(mData + index, mData + mSize - 1, mData + mSize);
+            return mData + index;
+        }
+
+        iterator insert(const_iterator pos, const T& value) {
+            return this->emplace(pos, value);
+        }
+
+        iterator insert(const_iterator pos, T&& value) {
+            return this->emplace(pos, std::move(value));
+        }
+
+        template<typename Iter, typename = typename std::iterator_traits<Iter>::iterator_category>
+        iterator insert(const_iterator pos, Iter first, Iter last) {
+            size_t index = size_t(pos - mData);
+            size_t oldSize = mSize;
+            for (; first != last; ++first) {
+                this->emplace_back(*first);
+            }
+            std::rotate(mData + index, mData + oldSize, mData + mSize);
+            return mData + index;
+        }
+
+        iterator erase(const_iterator pos) {
+            return this->erase(pos, pos + 1);
+        }
+
+        iterator erase(const_iterator first, const_iterator last) {
+            T* begin = mData + (first - mData);
+            T* end = mData + (last - mData);
+            if (begin != end) {
+                T* newEnd = std::move(end, mData + mSize, begin);
+                std::destroy(newEnd, mData + mSize);
+                mSize = size_t(newEnd - mData);
+            }
+            return begin;
+        }
+
+        void resize(size_t size) {
+            this->reserve(size);
+            while (mSize < size) {
+                this->emplace_back();
+            }
+            while (mSize > size) {
+                this->pop_back();
+            }
+        }
+
+        void resize(size_t size, const T& value) {
+            this->reserve(size);
+            while (mSize < size) {
+                this->emplace_back(value);
+            }
+            while (mSize > size) {
+                this->pop_back();
+            }
+        }
+
+        template<size_t M>
+        bool operator==(const SmallVector<T, M>& other) const {
+            return mSize == other.size() && std::equal(this->begin(), this->end(), other.begin());
+        }
+
+        template<size_t M>
+        bool operator!=(const SmallVector<T, M>& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        T* mData;
+        size_t mSize;
+        size_t mCapacity;
+        alignas(T) unsigned char mInline[sizeof(T) * N];
+
+        T* inlineData() { return reinterpret_cast<T*>(mInline); }
+        const T* inlineData() const { return reinterpret_cast<const T*>(mInline); }
+
+        void release() {
+            if (!this->isInline()) {
+                ::operator delete(mData);
+            }
+            mData = this->inlineData();
+            mCapacity = N;
+        }
+
+        /// moves the elements to a buffer of the capacity, inline if it fits.
+        void reallocate(size_t capacity) {
+            T* data = capacity <= N ? this->inlineData() : static_cast<T*>(::operator new(sizeof(T) * capacity));
+            if (data == mData)
+                return;
+            std::uninitialized_move(mData, mData + mSize, data);
+            std::destroy(mData, mData + mSize);
+            bool wasInline = this->isInline();
+            if (!wasInline) {
+                ::operator delete(mData);
+            }
+            mData = data;
+            mCapacity = capacity <= N ? N : capacity;
+        }
+
+        /// this must be empty and inline.
+        void steal(SmallVector&& other) {
+            if (other.isInline()) {
+                std::uninitialized_move(other.mData, other.mData + other.mSize, mData);
+                mSize = other.mSize;
+                other.clear();
+                return;
+            }
+            mData = other.mData;
+            mSize = other.mSize;
+            mCapacity = other.mCapacity;
+            other.mData = other.inlineData();
+            other.mSize = 0;
+            other.mCapacity = N;
+        }
+    };
+
+    /*
+    =================================================================
+    == StaticVector
+    =================================================================
+    */
+    /*
+    A vector with a fixed capacity that never allocates. Growing past the
+    capacity throws std::length_error, the same as std::vector throws when
+    it exceeds max_size().
+    */
+    template<typename T, size_t N>
+    class StaticVector {
+    public:
+        using value_type = T;
+        using size_type = size_t;
+        using iterator = T*;
+        using const_iterator = const T*;
+
+    public:
+        StaticVector()
+            : mSize(0) {
+        }
+
+        StaticVector(std::initializer_list<T> items)
+            : StaticVector() {
+            for (auto& item: items) {
+                this->push_back(item);
+            }
+        }
+
+        StaticVector(const StaticVector& other)
+            : StaticVector() {
+            for (auto& item: other) {
+                this->push_back(item);
+            }
+        }
+
+        StaticVector(StaticVector&& other) noexcept(std::is_nothrow_move_constructible_v<T>)
+            : StaticVector() {
+            for (auto& item: other) {
+                this->push_back(std::move(item));
+            }
+            other.clear();
+        }
+
+        ~StaticVector() {
+            this->clear();
+        }
+
+        StaticVector& operator=(const StaticVector& other) {
+            if (this != &other) {
+                this->clear();
+                for (auto& item: other) {
+                    this->push_back(item);
+                }
+            }
+            return *this;
+        }
+
+        StaticVector& operator=(StaticVector&& other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+            if (this != &other) {
+                this->clear();
+                for (auto& item: other) {
+                    this->push_back(std::move(item));
+                }
+                other.clear();
+            }
+            return *this;
+        }
+
+    public:
+        iterator begin() { return this->data(); }
+        const_iterator begin() const { return this->data(); }
+        iterator end() { return this->data() + mSize; }
+        const_iterator end() const { return this->data() + mSize; }
+
+        bool empty() const { return mSize == 0; }
+        bool full() const { return mSize == N; }
+        size_t size() const { return mSize; }
+        static constexpr size_t capacity() { return N; }
+
+        T* data() { return reinterpret_cast<T*>(mItems); }
+        const T* data() const { return reinterpret_cast<const T*>(mItems); }
+
+        T& operator[](size_t index) { return this->data()[index]; }
+        const T& operator[](size_t index) const { return this->data()[index]; }
+
+        T& at(size_t index) {
+            if (index >= mSize)
+                throw std::out_of_range("StaticVector::at");
+            return this->data()[index];
+        }
+
+        const T& at(size_t index) const {
+            if (index >= mSize)
+                throw std::out_of_range("StaticVector::at");
+            return this->data()[index];
+        }
+
+        T& front() { return this->data()[0]; }
+        const T& front() const { return this->data()[0]; }
+        T& back() { return this->data()[mSize - 1]; }
+        const T& back() const { return this->data()[mSize - 1]; }
+
+        template<typename... Args>
+        T& emplace_back(Args&&... args) {
+            if (mSize == N)
+                throw std::length_error("StaticVector is full");
+            T* item = new(this->data() + mSize) T(std::forward<Args>(args)...);
+            mSize += 1;
+            return *item;
+        }
+
+        void push_back(const T& value) {
+            this->emplace_back(value);
+        }
+
+        void push_back(T&& value) {
+            this->emplace_back(std::move(value));
+        }
+
+        void pop_back() {
+            mSize -= 1;
+            this->data()[mSize].~T();
+        }
+
+        iterator erase(const_iterator pos) {
+            T* item = this->data() + (pos - this->data());
+            std::move(item + 1, this->end(), item);
+            this->pop_back();
+            return item;
+        }
+
+        void clear() {
+            std::destroy(this->begin(), this->end());
+            mSize = 0;
+        }
+
+    private:
+        alignas(T) unsigned char mItems[sizeof(T) * N];
+        size_t mSize;
+    };
+
+}
+
+#endif//_EOKAS_BASE_SMALLVECTOR_H_
@@ -369,7 +369,8 @@ namespace eokas {
         : mData(mValue), mSize(0), mCapacity(_STRING_LITTLE_LENGTH), mMetric(0) {
         mValue[0] = '\0';
         if (mbcstr != nullptr) {
-            len = std::min(len, strlen(mbcstr));
+            // stops at len, a span of a bigger buffer is not measured to its end.
+            len = strnlen(mbcstr, len);
             if (len > 0) {
                 mMetric = String::measure(len);
                 if (mMetric == 1) {
@@ -317,4 +317,29 @@ using StringValueMap = std::map<String, StringValue>;
 
 }
 
+/*
+============================================================================================
+==== std::hash for String, FNV-1a
+============================================================================================
+*/
+namespace std {
+
+template<>
+struct hash<eokas::String>
+{
+  size_t operator()(const eokas::String& str) const noexcept
+  {
+    eokas::u64_t hash = 14695981039346656037ULL;
+    const char* ptr = str.cstr();
+    for(size_t i = 0; i < str.length(); i++)
+    {
+      hash ^= eokas::u8_t(ptr[i]);
+      hash *= 1099511628211ULL;
+    }
+    return size_t(hash);
+  }
+};
+
+}
+
 #endif//_EOKAS_BASE_STRING_H_
@@ -0,0 +1,132 @@
+
+#include "./symbol.h"
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <cstring>
+
+namespace eokas {
+
+    static const u32_t SYMBOL_SHARD_COUNT = 16;
+
+    /* keyed by the hash itself, the strings are compared on collision only. */
+    struct SymbolHashKey {
+        size_t operator()(u64_t hash) const noexcept {
+            return size_t(hash);
+        }
+    };
+
+    struct SymbolShard {
+        mutable std::shared_mutex mutex = {};
+        std::unordered_multimap<u64_t, const SymbolEntry*, SymbolHashKey> entries = {};
+        std::deque<SymbolEntry> storage = {};
+
+        const SymbolEntry* find(const char* str, size_t len, u64_t hash) const {
+            auto range = entries.equal_range(hash);
+            for (auto iter = range.first; iter != range.second; ++iter) {
+                const String& string = iter->second->string;
+                if (string.length() == len && memcmp(string.cstr(), str, len) == 0)
+                    return iter->second;
+            }
+            return nullptr;
+        }
+    };
+
+    struct SymbolTableImpl {
+        std::atomic<u32_t> ids = {0};
+        SymbolShard shards[SYMBOL_SHARD_COUNT];
+
+        SymbolShard& shard(u64_t hash) {
+            return shards[(hash >> 32) % SYMBOL_SHARD_COUNT];
+        }
+    };
+
+    Symbol::Symbol(const char* str)
+        : mEntry(nullptr) {
+        if (str == nullptr)
+            return;
+        *this = SymbolTable::instance().intern(str, strlen(str));
+    }
+
+    Symbol::Symbol(const String& str)
+        : mEntry(nullptr) {
+        *this = SymbolTable::instance().intern(str.cstr(), str.length());
+    }
+
+    Symbol::Symbol(const HashKey& key)
+        : mEntry(nullptr) {
+        *this = SymbolTable::instance().intern(key);
+    }
+
+    Symbol Symbol::find(const String& str) {
+        return SymbolTable::instance().find(str.cstr(), str.length());
+    }
+
+    Symbol Symbol::find(const HashKey& key) {
+        return SymbolTable::instance().find(key);
+    }
+
+    SymbolTable& SymbolTable::instance() {
+        static SymbolTable sInstance;
+        return sInstance;
+    }
+
+    u64_t SymbolTable::hash(const char* str, size_t len) {
+        return HashKey::fnv1a(str, len);
+    }
+
+    SymbolTable::SymbolTable()
+        : mImpl(new SymbolTableImpl()) {
+    }
+
+    SymbolTable::~SymbolTable() {
+        delete mImpl;
+    }
+
+    Symbol SymbolTable::intern(const char* str, size_t len) {
+        return this->intern(HashKey(str, len));
+    }
+
+    Symbol SymbolTable::intern(const HashKey& key) {
+        const char* str = key.str;
+        size_t len = key.len;
+        u64_t hash = key.hash;
+        SymbolShard& shard = mImpl->shard(hash);
+        {
+            std::shared_lock<std::shared_mutex> lock(shard.mutex);
+            const SymbolEntry* entry = shard.find(str, len, hash);
+            if (entry != nullptr)
+                return Symbol(entry);
+        }
+
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        // another thread may have interned it meanwhile.
+        const SymbolEntry* entry = shard.find(str, len, hash);
+        if (entry != nullptr)
+            return Symbol(entry);
+
+        SymbolEntry& created = shard.storage.emplace_back();
+        created.string = String(str, len);
+        created.hash = hash;
+        created.id = ++mImpl->ids;
+        shard.entries.insert(std::make_pair(hash, &created));
+        return Symbol(&created);
+    }
+
+    Symbol SymbolTable::find(const char* str, size_t len) const {
+        return this->find(HashKey(str, len));
+    }
+
+    Symbol SymbolTable::find(const HashKey& key) const {
+        SymbolShard& shard = mImpl->shard(key.hash);
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        return Symbol(shard.find(key.str, key.len, key.hash));
+    }
+
+    size_t SymbolTable::size() const {
+        return mImpl->ids.load();
+    }
+
+}
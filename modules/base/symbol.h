@@ -0,0 +1,175 @@
+
+#ifndef  _EOKAS_BASE_SYMBOL_H_
+#define  _EOKAS_BASE_SYMBOL_H_
+
+#include "./header.h"
+#include "./string.h"
+#include <cstring>
+
+namespace eokas {
+
+    struct SymbolEntry {
+        String string;
+        u64_t hash;
+        u32_t id;
+    };
+
+    /*
+    =================================================================
+    == HashKey
+    =================================================================
+    */
+    /*
+    A string together with its FNV-1a hash, the same hash as Symbol and
+    std::hash<String>. The _hash literal computes it at compile time:
+        library.getSchema("Int"_hash);
+    APIs taking a HashKey skip hashing and never build a String, they
+    still compare the characters, so a hash collision can't match.
+    A HashKey converts to its hash, literals can label switch cases:
+        switch(HashKey(name)) { case "int"_hash: ... }
+    the matched case must check the string if collisions matter.
+    */
+    struct HashKey {
+        const char* str;
+        size_t len;
+        u64_t hash;
+
+        constexpr HashKey(const char* str, size_t len)
+            : str(str), len(len), hash(HashKey::fnv1a(str, len)) {
+        }
+
+        constexpr explicit HashKey(const char* str)
+            : HashKey(str, HashKey::length(str)) {
+        }
+
+        explicit HashKey(const String& str)
+            : HashKey(str.cstr(), str.length()) {
+        }
+
+        constexpr operator u64_t() const {
+            return hash;
+        }
+
+        bool equals(const char* other, size_t otherLen) const {
+            return len == otherLen && (len == 0 || memcmp(str, other, len) == 0);
+        }
+
+        bool equals(const String& other) const {
+            return this->equals(other.cstr(), other.length());
+        }
+
+        static constexpr u64_t fnv1a(const char* str, size_t len) {
+            u64_t hash = 14695981039346656037ULL;
+            for (size_t i = 0; i < len; i++) {
+                hash ^= u8_t(str[i]);
+                hash *= 1099511628211ULL;
+            }
+            return hash;
+        }
+
+        static constexpr size_t length(const char* str) {
+            size_t len = 0;
+            while (str[len] != '\0') {
+                len++;
+            }
+            return len;
+        }
+    };
+
+    constexpr HashKey operator""_hash(const char* str, size_t len) {
+        return HashKey(str, len);
+    }
+
+    /*
+    =================================================================
+    == Symbol
+    =================================================================
+    */
+    /*
+    An interned string. Symbols of equal strings share one entry of the
+    process wide SymbolTable, so equality is a pointer compare and the
+    hash is computed once, when the string is interned.
+    A default constructed symbol is null and equals no interned string.
+    Entries are never freed, intern names and keys, not arbitrary data.
+    */
+    class Symbol {
+    public:
+        Symbol()
+            : mEntry(nullptr) {
+        }
+
+        Symbol(const char* str);
+        Symbol(const String& str);
+        Symbol(const HashKey& key);
+
+        explicit Symbol(const SymbolEntry* entry)
+            : mEntry(entry) {
+        }
+
+        /// the symbol of an already interned string, null otherwise.
+        static Symbol find(const String& str);
+        static Symbol find(const HashKey& key);
+
+    public:
+        bool isNull() const { return mEntry == nullptr; }
+        u32_t id() const { return mEntry != nullptr ? mEntry->id : 0; }
+        u64_t hash() const { return mEntry != nullptr ? mEntry->hash : 0; }
+        const String& str() const { return mEntry != nullptr ? mEntry->string : String::empty; }
+        const char* cstr() const { return this->str().cstr(); }
+        size_t length() const { return this->str().length(); }
+
+        bool operator==(const Symbol& rhs) const { return mEntry == rhs.mEntry; }
+        bool operator!=(const Symbol& rhs) const { return mEntry != rhs.mEntry; }
+        /// orders by id, which is the order of interning, not the string order.
+        bool operator<(const Symbol& rhs) const { return this->id() < rhs.id(); }
+
+    private:
+        const SymbolEntry* mEntry;
+    };
+
+    /*
+    =================================================================
+    == SymbolTable
+    =================================================================
+    */
+    /*
+    Thread safe interner. Strings are spread over shards by their hash,
+    a lookup takes the shard's shared lock only, interning a new string
+    takes it exclusively.
+    */
+    class SymbolTable {
+        _ForbidCopy(SymbolTable);
+        _ForbidAssign(SymbolTable);
+
+    public:
+        static SymbolTable& instance();
+        /// FNV-1a, the same as std::hash<String>.
+        static u64_t hash(const char* str, size_t len);
+
+    public:
+        SymbolTable();
+        ~SymbolTable();
+
+    public:
+        Symbol intern(const char* str, size_t len);
+        Symbol intern(const HashKey& key);
+        Symbol find(const char* str, size_t len) const;
+        Symbol find(const HashKey& key) const;
+        size_t size() const;
+
+    private:
+        struct SymbolTableImpl* mImpl;
+    };
+
+}
+
+namespace std {
+    template<>
+    struct hash<eokas::Symbol> {
+        size_t operator()(const eokas::Symbol& symbol) const noexcept {
+            return size_t(symbol.hash());
+        }
+    };
+}
+
+#endif//_EOKAS_BASE_SYMBOL_H_
@@ -3,12 +3,13 @@
 #define  _EOKAS_BASE_DICTIONARY_H_
 
 #include "./header.h"
+#include "./hashmap.h"
 
 namespace eokas {
     
     template<typename Index, typename IItem>
     class Table {
-        using ItemMap = std::map<Index, IItem*>;
+        using ItemMap = HashMap<Index, IItem*>;
     
     public:
         Table()
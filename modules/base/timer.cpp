@@ -6,43 +6,23 @@
 #include <windows.h>
 
 namespace eokas {
-    
-    struct TimerImpl {
-        f64_t lastCount;
-    };
-    
-    Timer::Timer()
-        : mImpl(new TimerImpl()) {
-        this->reset();
-    }
-    
-    Timer::~Timer() {
-        delete mImpl;
-    }
-    
-    void Timer::reset() {
+
+    u64_t Timer::now() {
+        // the frequency is fixed at boot, query it only once.
+        static const u64_t frequency = []() -> u64_t {
+            LARGE_INTEGER value;
+            QueryPerformanceFrequency(&value);
+            return u64_t(value.QuadPart);
+        }();
+
         LARGE_INTEGER counter;
         QueryPerformanceCounter(&counter);
-        mImpl->lastCount = (f64_t) (counter.QuadPart);
-    }
-    
-    i64_t Timer::elapse(bool isReset) {
-        LARGE_INTEGER count;
-        QueryPerformanceCounter(&count);
-        f64_t curCount = (f64_t) (count.QuadPart);
-        f64_t lastCount = mImpl->lastCount;
-        if (isReset) {
-            mImpl->lastCount = curCount;
-        }
-        
-        LARGE_INTEGER frequency;
-        QueryPerformanceFrequency(&frequency);
-        f64_t curFrequency = (f64_t) (frequency.QuadPart);
-        
-        i64_t result = (i64_t) ((curCount - lastCount) / curFrequency * 1000000);
-        return result;
+        u64_t count = u64_t(counter.QuadPart);
+
+        // split the conversion to keep the precision without overflowing.
+        return count / frequency * 1000000000 + count % frequency * 1000000000 / frequency;
     }
-    
+
 }
 
 #elif _EOKAS_OS == _EOKAS_OS_MACOS || _EOKAS_OS == _EOKAS_OS_IOS
@@ -51,43 +31,73 @@ namespace eokas {
 
 namespace eokas {
 
-    struct TimerImpl
-    {
+    u64_t Timer::now() {
+        static const mach_timebase_info_data_t info = []() -> mach_timebase_info_data_t {
+            mach_timebase_info_data_t value;
+            mach_timebase_info(&value);
+            return value;
+        }();
+
+        u64_t ticks = mach_absolute_time();
+        if (info.numer == info.denom)
+            return ticks;
+        return ticks / info.denom * info.numer + ticks % info.denom * info.numer / info.denom;
+    }
+
+}
+
+#else
+
+#include <time.h>
+
+namespace eokas {
+
+    u64_t Timer::now() {
+        struct timespec ts;
+#if defined(CLOCK_MONOTONIC_RAW)
+        // not slewed by ntp, so short intervals are measured in raw ticks.
+        if (clock_gettime(CLOCK_MONOTONIC_RAW, &ts) != 0)
+#endif
+        {
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+        }
+        return u64_t(ts.tv_sec) * 1000000000 + u64_t(ts.tv_nsec);
+    }
+
+}
+
+#endif
+
+namespace eokas {
+
+    struct TimerImpl {
         u64_t last;
     };
-    
+
     Timer::Timer()
-        :mImpl(new TimerImpl())
-    {
+        : mImpl(new TimerImpl()) {
         this->reset();
     }
-    
-    Timer::~Timer()
-    {
+
+    Timer::~Timer() {
         delete mImpl;
     }
-    
-    void Timer::reset()
-    {
-        mImpl->last = mach_absolute_time();
+
+    void Timer::reset() {
+        mImpl->last = Timer::now();
+    }
+
+    i64_t Timer::elapse(bool isReset) {
+        return this->elapseNanos(isReset) / 1000;
     }
-    
-    i64_t Timer::elapse(bool isReset)
-    {
-        u64_t now = mach_absolute_time();
+
+    i64_t Timer::elapseNanos(bool isReset) {
+        u64_t now = Timer::now();
         u64_t last = mImpl->last;
-        if (isReset)
-        {
+        if (isReset) {
             mImpl->last = now;
         }
-    
-        mach_timebase_info_data_t info;
-        mach_timebase_info(&info);
-        f64_t factor = f64_t(info.numer) / f64_t(info.denom) * 1e-9;
-    
-        i64_t result = i64_t((now - last) * factor * 1000000);
-        return result;
+        return i64_t(now - last);
     }
-}
 
-#endif
+}
@@ -5,23 +5,30 @@
 #include "header.h"
 
 namespace eokas {
-    
+
     class Timer {
         _ForbidCopy(Timer);
         _ForbidAssign(Timer);
-    
+
+    public:
+        /// monotonic timestamp in nanoseconds.
+        static u64_t now();
+
     public:
         Timer();
         ~Timer();
-    
+
     public:
         void reset();
+        /// microseconds
         i64_t elapse(bool isReset = true);
-    
+        /// nanoseconds
+        i64_t elapseNanos(bool isReset = true);
+
     private:
         struct TimerImpl* mImpl;
     };
-    
+
 }
 
 #endif//_EOKAS_BASE_TIMER_H_
@@ -0,0 +1,466 @@
+
+#include "./watcher.h"
+#include "./io.h"
+#include "./timer.h"
+#include <set>
+#include <sys/stat.h>
+
+#if _EOKAS_OS == _EOKAS_OS_LINUX || _EOKAS_OS == _EOKAS_OS_ANDROID
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#define _EOKAS_WATCHER_INOTIFY 1
+#endif
+
+namespace eokas {
+
+    /// st_mtime only has seconds, a rewrite of the same size within one would be missed.
+    struct FileStamp {
+        time_t mtime;
+        long mtimeNanos;
+        u64_t size;
+    };
+
+    using FileStampMap = std::map<String, FileStamp>;
+
+    static bool isSubPath(const String& path, const String& root) {
+        if (path == root)
+            return true;
+        if (!path.startsWith(root))
+            return false;
+        char end = root.at(root.length() - 1);
+        if (end == '/' || end == '\\')
+            return true;
+        char sep = path.at(root.length());
+        return sep == '/' || sep == '\\';
+    }
+
+    static bool stampFile(const String& path, FileStamp& stamp) {
+        struct stat status;
+        if (stat(path.cstr(), &status) != 0)
+            return false;
+#if _EOKAS_OS == _EOKAS_OS_LINUX || _EOKAS_OS == _EOKAS_OS_ANDROID
+        stamp = FileStamp{status.st_mtim.tv_sec, status.st_mtim.tv_nsec, u64_t(status.st_size)};
+#elif _EOKAS_OS == _EOKAS_OS_MACOS || _EOKAS_OS == _EOKAS_OS_IOS
+        stamp = FileStamp{status.st_mtimespec.tv_sec, status.st_mtimespec.tv_nsec, u64_t(status.st_size)};
+#else
+        stamp = FileStamp{status.st_mtime, 0, u64_t(status.st_size)};
+#endif
+        return true;
+    }
+
+    static void scanFiles(const String& path, bool recursive, FileStampMap& stamps) {
+        if (File::isFile(path)) {
+            FileStamp stamp;
+            if (stampFile(path, stamp)) {
+                stamps[path] = stamp;
+            }
+            return;
+        }
+        if (!File::isFolder(path))
+            return;
+        FileList infos = File::listFileInfos(path);
+        for (auto& info: infos) {
+            if (info.name == "." || info.name == "..")
+                continue;
+            String subPath = File::combinePath(path, info.name);
+            if (info.isFile) {
+                FileStamp stamp;
+                if (stampFile(subPath, stamp)) {
+                    stamps[subPath] = stamp;
+                }
+            }
+            else if (recursive) {
+                scanFiles(subPath, recursive, stamps);
+            }
+        }
+    }
+
+    struct FileWatcherImpl {
+        bool polling = true;
+        u32_t debounce = 100;
+        u32_t pollInterval = 500;
+
+        std::map<String, bool> roots = {};
+        std::map<String, FileChangeType> pending = {};
+        u64_t lastChange = 0;
+        u64_t lastPoll = 0;
+
+        // the files under the roots, polling compares their stamps, inotify
+        // needs them to report the files of a folder that was moved away.
+        FileStampMap stamps = {};
+
+#if _EOKAS_WATCHER_INOTIFY
+        struct WatchDesc {
+            String path;
+            bool recursive;
+        };
+
+        int fd = -1;
+        std::map<int, WatchDesc> watches = {};
+        // roots whose watch went away with them, armed again when they reappear.
+        std::set<String> lost = {};
+#endif
+
+        void record(const String& path, FileChangeType type) {
+            lastChange = Timer::now();
+
+            auto iter = pending.find(path);
+            if (iter == pending.end()) {
+                pending.insert(std::make_pair(path, type));
+                return;
+            }
+
+            FileChangeType& prev = iter->second;
+            if (prev == FileChangeType::Created) {
+                // created then removed in the same batch, nothing to report.
+                if (type == FileChangeType::Removed) {
+                    pending.erase(iter);
+                }
+                return;
+            }
+            if (prev == FileChangeType::Removed) {
+                // removed then re-created, e.g. saved by rename.
+                prev = FileChangeType::Modified;
+                return;
+            }
+            prev = type == FileChangeType::Removed ? FileChangeType::Removed : FileChangeType::Modified;
+        }
+
+        void poll() {
+            FileStampMap current;
+            for (auto& root: roots) {
+                scanFiles(root.first, root.second, current);
+            }
+
+            for (auto& pair: current) {
+                auto iter = stamps.find(pair.first);
+                if (iter == stamps.end()) {
+                    this->record(pair.first, FileChangeType::Created);
+                }
+                else if (iter->second.mtime != pair.second.mtime ||
+                         iter->second.mtimeNanos != pair.second.mtimeNanos || iter->second.size != pair.second.size) {
+                    this->record(pair.first, FileChangeType::Modified);
+                }
+            }
+            for (auto& pair: stamps) {
+                if (current.find(pair.first) == current.end()) {
+                    this->record(pair.first, FileChangeType::Removed);
+                }
+            }
+
+            stamps.swap(current);
+        }
+
+#if _EOKAS_WATCHER_INOTIFY
+        static const u32_t WATCH_MASK =
+            IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE |
+            IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF;
+
+        bool addWatch(const String& path, bool recursive) {
+            int wd = inotify_add_watch(fd, path.cstr(), WATCH_MASK);
+            if (wd < 0)
+                return false;
+            watches[wd] = WatchDesc{path, recursive};
+
+            if (recursive && File::isFolder(path)) {
+                StringList folders = File::listFolderNames(path);
+                for (auto& folder: folders) {
+                    this->addWatch(File::combinePath(path, folder), recursive);
+                }
+            }
+            return true;
+        }
+
+        void removeWatches(const String& root) {
+            auto iter = watches.begin();
+            while (iter != watches.end()) {
+                if (isSubPath(iter->second.path, root)) {
+                    inotify_rm_watch(fd, iter->first);
+                    iter = watches.erase(iter);
+                    continue;
+                }
+                ++iter;
+            }
+        }
+
+        void createFile(const String& path) {
+            FileStamp stamp;
+            if (stampFile(path, stamp)) {
+                stamps[path] = stamp;
+            }
+            this->record(path, FileChangeType::Created);
+        }
+
+        void removeFile(const String& path) {
+            stamps.erase(path);
+            this->record(path, FileChangeType::Removed);
+        }
+
+        /// a folder appeared, its files were there before the watch was added and have no events.
+        void createFolder(const String& path, bool recursive) {
+            if (!recursive)
+                return;
+            this->addWatch(path, true);
+            FileStampMap existing;
+            scanFiles(path, true, existing);
+            for (auto& pair: existing) {
+                stamps[pair.first] = pair.second;
+                this->record(pair.first, FileChangeType::Created);
+            }
+        }
+
+        /// a folder or a root went away, its watches would report events under the old path if it was moved.
+        void removeTree(const String& path) {
+            this->removeWatches(path);
+            auto iter = stamps.lower_bound(path);
+            while (iter != stamps.end() && iter->first.startsWith(path)) {
+                if (isSubPath(iter->first, path)) {
+                    this->record(iter->first, FileChangeType::Removed);
+                    iter = stamps.erase(iter);
+                    continue;
+                }
+                ++iter;
+            }
+        }
+
+        void rearm() {
+            auto iter = lost.begin();
+            while (iter != lost.end()) {
+                auto root = roots.find(*iter);
+                if (root == roots.end()) {
+                    iter = lost.erase(iter);
+                    continue;
+                }
+                if (!File::exists(root->first) || !this->addWatch(root->first, root->second)) {
+                    ++iter;
+                    continue;
+                }
+                FileStampMap existing;
+                scanFiles(root->first, root->second, existing);
+                for (auto& pair: existing) {
+                    stamps[pair.first] = pair.second;
+                    this->record(pair.first, FileChangeType::Created);
+                }
+                iter = lost.erase(iter);
+            }
+        }
+
+        void readEvents() {
+            alignas(inotify_event) char buffer[4096];
+            while (true) {
+                ssize_t length = read(fd, buffer, sizeof(buffer));
+                if (length <= 0)
+                    break;
+
+                for (char* ptr = buffer; ptr < buffer + length;) {
+                    const inotify_event* event = (const inotify_event*) ptr;
+                    ptr += sizeof(inotify_event) + event->len;
+
+                    if (event->mask & IN_Q_OVERFLOW) {
+                        // the kernel dropped events, let the consumer rebuild every root.
+                        for (auto& root: roots) {
+                            this->record(root.first, FileChangeType::Modified);
+                        }
+                        continue;
+                    }
+
+                    auto iter = watches.find(event->wd);
+                    if (iter == watches.end())
+                        continue;
+
+                    WatchDesc desc = iter->second;
+                    if (event->mask & IN_IGNORED) {
+                        watches.erase(iter);
+                        if (roots.find(desc.path) != roots.end()) {
+                            lost.insert(desc.path);
+                        }
+                        continue;
+                    }
+
+                    if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+                        // a root that was deleted or renamed, e.g. replaced by an editor saving through a rename.
+                        if (roots.find(desc.path) != roots.end()) {
+                            this->removeTree(desc.path);
+                            lost.insert(desc.path);
+                        }
+                        continue;
+                    }
+
+                    String path = event->len > 0 ? File::combinePath(desc.path, event->name) : desc.path;
+                    bool folder = (event->mask & IN_ISDIR) != 0;
+
+                    if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                        if (folder) {
+                            this->createFolder(path, desc.recursive);
+                        }
+                        else {
+                            this->createFile(path);
+                        }
+                    }
+                    else if (event->mask & (IN_MODIFY | IN_CLOSE_WRITE)) {
+                        if (!folder) {
+                            this->record(path, FileChangeType::Modified);
+                        }
+                    }
+                    else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                        if (folder) {
+                            this->removeTree(path);
+                        }
+                        else {
+                            this->removeFile(path);
+                        }
+                    }
+                }
+            }
+        }
+#endif
+    };
+
+    FileWatcher::FileWatcher(bool polling)
+        : callback()
+        , mImpl(new FileWatcherImpl()) {
+        mImpl->polling = true;
+#if _EOKAS_WATCHER_INOTIFY
+        if (!polling) {
+            mImpl->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+            mImpl->polling = mImpl->fd < 0;
+        }
+#endif
+    }
+
+    FileWatcher::~FileWatcher() {
+        this->clear();
+#if _EOKAS_WATCHER_INOTIFY
+        if (mImpl->fd >= 0) {
+            close(mImpl->fd);
+            mImpl->fd = -1;
+        }
+#endif
+        delete mImpl;
+    }
+
+    bool FileWatcher::watch(const String& path, bool recursive) {
+        if (!File::exists(path))
+            return false;
+        if (this->isWatching(path))
+            return true;
+
+#if _EOKAS_WATCHER_INOTIFY
+        if (!mImpl->polling) {
+            if (!mImpl->addWatch(path, recursive))
+                return false;
+        }
+#endif
+        scanFiles(path, recursive, mImpl->stamps);
+
+        mImpl->roots[path] = recursive;
+        return true;
+    }
+
+    void FileWatcher::unwatch(const String& path) {
+        auto iter = mImpl->roots.find(path);
+        if (iter == mImpl->roots.end())
+            return;
+        mImpl->roots.erase(iter);
+
+#if _EOKAS_WATCHER_INOTIFY
+        if (!mImpl->polling) {
+            mImpl->removeWatches(path);
+            mImpl->lost.erase(path);
+        }
+#endif
+
+        auto stamp = mImpl->stamps.begin();
+        while (stamp != mImpl->stamps.end()) {
+            if (isSubPath(stamp->first, path)) {
+                stamp = mImpl->stamps.erase(stamp);
+                continue;
+            }
+            ++stamp;
+        }
+
+        auto change = mImpl->pending.begin();
+        while (change != mImpl->pending.end()) {
+            if (isSubPath(change->first, path)) {
+                change = mImpl->pending.erase(change);
+                continue;
+            }
+            ++change;
+        }
+    }
+
+    void FileWatcher::clear() {
+#if _EOKAS_WATCHER_INOTIFY
+        for (auto& pair: mImpl->watches) {
+            inotify_rm_watch(mImpl->fd, pair.first);
+        }
+        mImpl->watches.clear();
+        mImpl->lost.clear();
+#endif
+        mImpl->roots.clear();
+        mImpl->stamps.clear();
+        mImpl->pending.clear();
+    }
+
+    bool FileWatcher::isWatching(const String& path) const {
+        return mImpl->roots.find(path) != mImpl->roots.end();
+    }
+
+    bool FileWatcher::isPolling() const {
+        return mImpl->polling;
+    }
+
+    void FileWatcher::setDebounce(u32_t milliseconds) {
+        mImpl->debounce = milliseconds;
+    }
+
+    u32_t FileWatcher::debounce() const {
+        return mImpl->debounce;
+    }
+
+    void FileWatcher::setPollInterval(u32_t milliseconds) {
+        mImpl->pollInterval = milliseconds;
+    }
+
+    u32_t FileWatcher::pollInterval() const {
+        return mImpl->pollInterval;
+    }
+
+    size_t FileWatcher::update() {
+        const u64_t MILLISECOND = 1000000;
+
+        if (mImpl->polling) {
+            u64_t now = Timer::now();
+            if (now - mImpl->lastPoll >= mImpl->pollInterval * MILLISECOND) {
+                mImpl->poll();
+                mImpl->lastPoll = now;
+            }
+        }
+#if _EOKAS_WATCHER_INOTIFY
+        else {
+            mImpl->readEvents();
+            mImpl->rearm();
+        }
+#endif
+
+        if (mImpl->pending.empty())
+            return 0;
+
+        if (Timer::now() - mImpl->lastChange < mImpl->debounce * MILLISECOND)
+            return 0;
+
+        FileChangeSignalMessage message;
+        message.changes.reserve(mImpl->pending.size());
+        for (auto& pair: mImpl->pending) {
+            message.changes.push_back(FileChange{pair.first, pair.second});
+        }
+        mImpl->pending.clear();
+
+        if (this->callback.hasHandler()) {
+            this->callback(message);
+        }
+        return message.changes.size();
+    }
+
+}
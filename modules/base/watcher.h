@@ -0,0 +1,79 @@
+
+#ifndef  _EOKAS_BASE_WATCHER_H_
+#define  _EOKAS_BASE_WATCHER_H_
+
+#include "./header.h"
+#include "./string.h"
+#include "./signal.h"
+
+namespace eokas {
+
+    /*
+    =================================================================
+    == FileChange
+    =================================================================
+    */
+    enum class FileChangeType {
+        Created, Modified, Removed
+    };
+
+    struct FileChange {
+        String path;
+        FileChangeType type;
+    };
+
+    using FileChangeList = std::vector<FileChange>;
+
+    /*
+    =================================================================
+    == FileWatcher
+    =================================================================
+    */
+    /*
+    Observe files and folders, and deliver the changed paths in batches.
+    Linux uses inotify, other platforms (or when inotify is unavailable)
+    fall back to scanning the watched paths periodically.
+    Both report files only: a folder that appears or goes away is
+    reported as its files being created or removed. A watched path that
+    is removed is watched again once it reappears, so a file replaced by
+    a rename reports as modified.
+    Changes of the same path are coalesced, and a batch is emitted only
+    after no new change arrived during the debounce interval.
+    update() must be called from the owner's loop, the callback is
+    invoked on that thread.
+    */
+    class FileWatcher {
+        _ForbidCopy(FileWatcher);
+        _ForbidAssign(FileWatcher);
+
+    public:
+        FileWatcher(bool polling = false);
+        ~FileWatcher();
+
+    public:
+        bool watch(const String& path, bool recursive = true);
+        void unwatch(const String& path);
+        void clear();
+        bool isWatching(const String& path) const;
+        bool isPolling() const;
+
+        void setDebounce(u32_t milliseconds);
+        u32_t debounce() const;
+        void setPollInterval(u32_t milliseconds);
+        u32_t pollInterval() const;
+
+        size_t update();
+
+    public:
+        struct FileChangeSignalMessage {
+            FileChangeList changes;
+        };
+        Signal<FileChangeSignalMessage&> callback;
+
+    private:
+        struct FileWatcherImpl* mImpl;
+    };
+
+}
+
+#endif//_EOKAS_BASE_WATCHER_H_
@@ -51,20 +51,34 @@ set(EOKAS_LIBRARY_FILES
 
 file(GLOB EOKAS_SOURCE_FILES
         "${EOKAS_TARGET_DIR}/src/*.cpp"
-        "${EOKAS_TARGET_DIR}/src/app/*.cpp"
         "${EOKAS_TARGET_DIR}/src/ast/*.cpp"
         "${EOKAS_TARGET_DIR}/src/omis/*.cpp"
         "${EOKAS_TARGET_DIR}/src/omis/llvm/*.cpp"
+        "${EOKAS_TARGET_DIR}/src/omis/vm/*.cpp"
+)
+
+file(GLOB EOKAS_APP_SOURCE_FILES
+        "${EOKAS_TARGET_DIR}/src/app/*.cpp"
 )
 
 message("EOKAS_HEADER_DIRS = ${EOKAS_HEADER_DIRS}")
 message("EOKAS_LIBRARY_DIRS = ${EOKAS_LIBRARY_DIRS}")
 message("EOKAS_HEADER_FILES = ${EOKAS_HEADER_FILES}")
 message("EOKAS_SOURCE_FILES = ${EOKAS_SOURCE_FILES}")
+message("EOKAS_APP_SOURCE_FILES = ${EOKAS_APP_SOURCE_FILES}")
 message("EOKAS_LIBRARY_FILES = ${EOKAS_LIBRARY_FILES}")
 
 
-add_executable(${EOKAS_TARGET_NAME} ${EOKAS_HEADER_FILES} ${EOKAS_SOURCE_FILES})
-target_include_directories(${EOKAS_TARGET_NAME} PRIVATE ${EOKAS_HEADER_DIRS})
-target_link_directories(${EOKAS_TARGET_NAME} PRIVATE ${EOKAS_LIBRARY_DIRS})
-target_link_libraries(${EOKAS_TARGET_NAME} ${EOKAS_LIBRARY_FILES})
+# the compiler is a library, so the tests can link it, and the command line an
+# executable of the same name on top of it.
+add_library(${EOKAS_TARGET_NAME} STATIC ${EOKAS_HEADER_FILES} ${EOKAS_SOURCE_FILES})
+target_include_directories(${EOKAS_TARGET_NAME} PUBLIC ${EOKAS_HEADER_DIRS})
+target_link_directories(${EOKAS_TARGET_NAME} PUBLIC ${EOKAS_LIBRARY_DIRS})
+target_link_libraries(${EOKAS_TARGET_NAME} PUBLIC ${EOKAS_LIBRARY_FILES})
+
+add_executable(${EOKAS_TARGET_NAME}-app ${EOKAS_APP_SOURCE_FILES})
+set_target_properties(${EOKAS_TARGET_NAME}-app PROPERTIES OUTPUT_NAME ${EOKAS_TARGET_NAME})
+target_link_libraries(${EOKAS_TARGET_NAME}-app ${EOKAS_TARGET_NAME})
+
+
+eokas_test_setup(${EOKAS_TARGET_NAME})
@@ -1,22 +1,50 @@
 #include "app.h"
 #include "./parser.h"
+#include "./scanner.h"
 #include "./coder.h"
+#include "base/async.h"
+#include "base/hash.h"
 
 using namespace eokas;
 
 #include <stdio.h>
 
-static void eokas_main(coder_t& coder, const String& fileName, const String& cmd);
+/// what the command line asks of a compile or a run.
+struct eokas_flags_t {
+    omis_compile_options_t options;
+    /// dump the sources and the IR.
+    bool verbose = false;
+    /// print the time spent in each phase.
+    bool time_passes = false;
+    /// load unchanged modules from the .eokas-cache folder beside the main file.
+    bool cache = false;
+};
+
+/// milliseconds spent to turn the sources into modules.
+struct eokas_timing_t {
+    double parse = 0;
+    double encode = 0;
+    int files = 0;
+    int cached = 0;
+    String report;
+};
+
+static omis_module_t* eokas_encode(coder_t& coder, const String& file, const eokas_flags_t& flags, eokas_timing_t& timing);
+static void eokas_main(coder_t& coder, const String& fileName, const String& cmd, const eokas_flags_t& flags);
+static void eokas_bench(const String& dir);
+static void eokas_build(const String& dir, const eokas_flags_t& flags);
+static cli::Command& with_compile_options(cli::Command& cmd);
+static omis_compile_options_t fetch_compile_options(const cli::Command& cmd);
+static eokas_flags_t fetch_flags(const cli::Command& cmd);
 static void about(void);
 static void help(void);
 static void bad_command(const char* command);
-static String read_text_file(String& filePath);
+static String read_text_file(const String& filePath);
+static unsigned short eokas_pool_size();
 
 int main(int argc, char** argv) {
     cli::Command program(argv[0]);
 
-    coder_t coder;
-
     program.action([&](const cli::Command& cmd) -> void {
         about();
     });
@@ -26,22 +54,24 @@ int main(int argc, char** argv) {
             help();
         });
 
-    program.subCommand("compile", "")
+    with_compile_options(program.subCommand("compile", ""))
         .option("--file,-f", "", "")
         .action([&](const cli::Command& cmd) -> void {
-            auto file = cmd.fetchValue("--file").string();
+            auto file = cmd.fetchValue("--file"_hash).string();
             if (file.isEmpty())
                 throw std::invalid_argument("The argument 'file' is empty.");
 
             printf("=> Source file: %s\n", file.cstr());
 
-            eokas_main(coder, file, cmd.name);
+            coder_t coder;
+            eokas_main(coder, file, cmd.name, fetch_flags(cmd));
         });
 
-    program.subCommand("run", "")
+    with_compile_options(program.subCommand("run", ""))
         .option("--file,-f", "", "")
+        .option("--tiered", "interpret first, jit the hot functions", false)
         .action([&](const cli::Command& cmd) -> void {
-            auto file = cmd.fetchValue("--file").string();
+            auto file = cmd.fetchValue("--file"_hash).string();
             if (file.isEmpty())
                 throw std::invalid_argument("The argument 'file' is empty.");
             if (!File::exists(file))
@@ -50,7 +80,30 @@ int main(int argc, char** argv) {
 
             printf("=> Source file: %s\n", file.cstr());
 
-            eokas_main(coder, file, cmd.name);
+            coder_t coder(cmd.fetchValue("--tiered"_hash) ? omis_backend_t::TIERED : omis_backend_t::LLVM);
+            eokas_main(coder, file, cmd.name, fetch_flags(cmd));
+        });
+
+    with_compile_options(program.subCommand("build", ""))
+        .option("--dir,-d", "", ".")
+        .action([&](const cli::Command& cmd) -> void {
+            auto dir = cmd.fetchValue("--dir"_hash).string();
+            if (!File::exists(File::combinePath(dir, "eokas.build.json")))
+                throw std::invalid_argument(
+                        String::format("The package folder '%s' has no eokas.build.json.", dir.cstr()).cstr());
+
+            eokas_build(dir, fetch_flags(cmd));
+        });
+
+    program.subCommand("bench", "")
+        .option("--dir,-d", "", "")
+        .action([&](const cli::Command& cmd) -> void {
+            auto dir = cmd.fetchValue("--dir"_hash).string();
+            if (!File::isFolder(dir))
+                throw std::invalid_argument(
+                        String::format("The sample folder '%s' is not found.", dir.cstr()).cstr());
+
+            eokas_bench(dir);
         });
 
     try {
@@ -63,72 +116,416 @@ int main(int argc, char** argv) {
     }
 }
 
-static void eokas_main(coder_t& coder, const String& file, const String& cmd) {
-    std::map<String, ast_node_module_t*> modules;
+/**
+ * What the cache keeps of a module next to its bitcode. The stamp says whether
+ * the source changed, the imports are what it parsed to, and the key also covers
+ * the options and the interfaces of the imports the bitcode was encoded against.
+ */
+struct eokas_manifest_t {
+    String stamp;
+    String key;
+    StringVector imports;
+    String interface;
+};
+
+/**
+ * A source file of the import graph, the parser owns its ast so it lives as
+ * long as the module is being encoded. A source that did not change since it
+ * was cached is not parsed, its imports come from the manifest.
+ */
+struct eokas_source_t {
+    String path;
+    String source;
+    String stamp;
+    parser_t parser;
+    ast_node_module_t* node = nullptr;
+    std::vector<String> imports;
+    eokas_manifest_t manifest;
+    bool unchanged = false;
+    bool cached = false;
+    double parse = 0;
+    /// the cache key, and where the bitcode of the module is or goes.
+    String key;
+    String bitcode;
+    /// encoded by a worker, which wrote the bitcode and the interface.
+    bool saved = false;
+    String interface;
+};
+
+/// bitcode written only for the workers to load, removed whatever the outcome.
+struct eokas_scratch_t {
+    StringVector files;
+
+    ~eokas_scratch_t() {
+        for(auto& file : files) {
+            File::remove(file);
+        }
+    }
+};
+
+static String eokas_cache_path(const String& folder, const String& name, const String& extension) {
+    return File::combinePath(folder, name + extension);
+}
 
-    std::vector<String> filesToParse;
-    filesToParse.push_back(file);
+static bool eokas_read_manifest(const String& path, eokas_manifest_t& manifest) {
+    String text;
+    if(!File::exists(path) || !File::readText(path, text))
+        return false;
+    for(auto& line : text.split("\n")) {
+        if(line.startsWith("stamp "))
+            manifest.stamp = line.substr(6);
+        else if(line.startsWith("key "))
+            manifest.key = line.substr(4);
+        else if(line.startsWith("import "))
+            manifest.imports.push_back(line.substr(7));
+        else if(line.startsWith("type "))
+            manifest.interface += line + "\n";
+    }
+    return !manifest.stamp.isEmpty() && !manifest.key.isEmpty();
+}
 
-    for(size_t index = 0; index < filesToParse.size(); index++) {
-        String& filePath = filesToParse[index];
+/// written aside and moved over the old one, a reader never sees half a file.
+static bool eokas_write_manifest(const String& path, const eokas_manifest_t& manifest) {
+    String text = String::format("stamp %s\nkey %s\n", manifest.stamp.cstr(), manifest.key.cstr());
+    for(auto& imp : manifest.imports) {
+        text += String::format("import %s\n", imp.cstr());
+    }
+    text += manifest.interface;
 
-        // parsed already
-        if(modules.find(filePath) != modules.end()) {
-            continue;
+    String temp = path + ".tmp";
+    return File::writeText(temp, text) && File::replace(temp, path);
+}
+
+static bool eokas_parse(eokas_source_t* unit) {
+    unit->node = unit->parser.parse(unit->source.cstr());
+    if(unit->node == nullptr) {
+        printf("ERROR: %s: %s\n", unit->path.cstr(), unit->parser.error().cstr());
+        return false;
+    }
+
+    unit->imports.clear();
+    String fileHome = File::basePath(unit->path);
+    for(auto& item : unit->node->imports) {
+        String targetPath = item.second->target;
+
+        // If the target is a relative path, it refers to a
+        // location relative to the current file.
+        if(targetPath.startsWith(".")) {
+            targetPath = File::combinePath(fileHome, targetPath);
+            targetPath = File::absolutePath(targetPath);
         }
 
-        String source = read_text_file(filePath);
-        printf("=> Source code:\n");
-        printf("------------------------------------------\n");
-        printf("%s\n", source.replace("%", "%%").cstr());
-        printf("------------------------------------------\n");
+        // modules are named by their path, which is what the coder imports.
+        item.second->target = targetPath;
+        unit->imports.push_back(targetPath);
+    }
+    unit->node->name = unit->path;
+    return true;
+}
+
+/**
+ * Encode the modules of a level on workers of their own, each with a coder and so an
+ * LLVM context of its own. A worker loads the imports of its module from bitcode the
+ * way the cache does, encodes the module and writes its bitcode, which the coder then
+ * loads next to the imports. The bytecode of the interpreter does not survive the
+ * bitcode, so the tiered backend encodes them one after another on its coder.
+ */
+static bool eokas_encode_level(coder_t& coder, const std::vector<eokas_source_t*>& order, const std::vector<eokas_source_t*>& level,
+                               const std::map<String, omis_module_t*>& encoded, const String& cacheFolder, bool cache, eokas_scratch_t& scratch, ThreadPool& pool) {
+    std::map<String, eokas_source_t*> units;
+    for(auto* unit : order) {
+        units[unit->path] = unit;
+    }
 
-        parser_t parser;
-        ast_node_module_t* node = parser.parse(source.cstr());
-        if (node == nullptr) {
-            const String& error = parser.error();
-            printf("ERROR: %s\n", error.cstr());
-            return;
+    // the imports of each module and theirs, in the order they were encoded.
+    std::map<eokas_source_t*, std::vector<eokas_source_t*>> closures;
+    std::map<String, String> interfaces;
+    for(auto* unit : level) {
+        HashSet<String> reached;
+        std::vector<String> pending = unit->imports;
+        while(!pending.empty()) {
+            String path = pending.back();
+            pending.pop_back();
+            if(!reached.insert(path).second)
+                continue;
+            for(auto& dep : units[path]->imports) {
+                pending.push_back(dep);
+            }
+        }
+        for(auto* dep : order) {
+            if(!reached.contains(dep->path))
+                continue;
+            closures[unit].push_back(dep);
+            if(interfaces.find(dep->path) != interfaces.end())
+                continue;
+            omis_module_t* mod = encoded.at(dep->path);
+            interfaces[dep->path] = coder.interface(mod);
+            // without the cache an import has no bitcode yet.
+            if(!File::exists(dep->bitcode)) {
+                dep->bitcode = eokas_cache_path(cacheFolder, sha256(dep->path), ".part.bc");
+                scratch.files.push_back(dep->bitcode);
+                if(!coder.save(mod, dep->bitcode))
+                    return false;
+            }
         }
+        if(!cache) {
+            unit->bitcode = eokas_cache_path(cacheFolder, sha256(unit->path), ".part.bc");
+            scratch.files.push_back(unit->bitcode);
+        }
+    }
 
-        if(!node->imports.empty()) {
-            String fileHome = File::basePath(filePath);
-            for(auto& item : node->imports) {
-                String targetPath = item.second->target;
+    std::vector<std::future<bool>> workers;
+    for(auto* unit : level) {
+        auto& imports = closures[unit];
+        workers.push_back(pool.exec([unit, &imports, &interfaces]() -> bool {
+            coder_t worker;
+            for(auto* dep : imports) {
+                if(worker.load(dep->path, dep->bitcode, dep->imports, interfaces.at(dep->path)) == nullptr) {
+                    printf("ERROR: %s can not be loaded to encode %s.\n", dep->path.cstr(), unit->path.cstr());
+                    return false;
+                }
+            }
+            // the source is the same but an import is not, parse it after all.
+            if(unit->node == nullptr && !eokas_parse(unit))
+                return false;
+            omis_module_t* mod = worker.encode(unit->node);
+            if(mod == nullptr)
+                return false;
+            unit->interface = worker.interface(mod);
+            String temp = unit->bitcode + ".tmp";
+            unit->saved = worker.save(mod, temp) && File::replace(temp, unit->bitcode);
+            return unit->saved;
+        }));
+    }
 
-                // If the target is a relative path, it refers to a
-                // location relative to the current file.
-                if(targetPath.startsWith(".")) {
-                    targetPath = File::combinePath(fileHome, targetPath);
-                    targetPath = File::absolutePath(targetPath);
+    bool failed = false;
+    for(auto& result : workers) {
+        failed |= !pool.wait(result);
+    }
+    return !failed;
+}
+
+/**
+ * Read and parse the files and everything they import, a level of the import graph
+ * at a time with the files of a level parsed concurrently, then encode the modules
+ * dependencies first. The modules that import only ones of lower levels are encoded
+ * at the same time, see eokas_encode_level. The modules of the files, which are
+ * absolute paths, are given back dependencies first.
+ *
+ * With the cache on, a module is loaded from the bitcode of an earlier run when its
+ * source, the options and the interfaces of its imports are the same as then. An
+ * import that is rebuilt but exports the same symbols keeps its importers cached.
+ *
+ * The work goes to the pool of the caller, which may be running this on one of its
+ * threads, the waits help with the queued tasks.
+ */
+static bool eokas_encode_all(coder_t& coder, const StringVector& files, const String& cacheFolder, const eokas_flags_t& flags, eokas_timing_t& timing, std::vector<omis_module_t*>& modules, ThreadPool& pool) {
+    std::map<String, std::unique_ptr<eokas_source_t>> sources;
+
+    Timer timer;
+    std::vector<String> level;
+    for(auto& file : files) {
+        if(std::find(level.begin(), level.end(), file) == level.end())
+            level.push_back(file);
+    }
+    while(!level.empty()) {
+        std::vector<std::future<bool>> parsed;
+        for(auto& path : level) {
+            auto* unit = new eokas_source_t();
+            unit->path = path;
+            sources[path].reset(unit);
+            parsed.push_back(pool.exec([unit, &flags, &cacheFolder]() -> bool {
+                Timer parseTimer;
+                unit->source = read_text_file(unit->path);
+                if(flags.cache) {
+                    unit->stamp = sha256(String(_ELANG_VERSION) + "\n" + unit->source);
+                    String manifestPath = eokas_cache_path(cacheFolder, sha256(unit->path), ".mod");
+                    if(eokas_read_manifest(manifestPath, unit->manifest) && unit->manifest.stamp == unit->stamp) {
+                        unit->unchanged = true;
+                        unit->imports = unit->manifest.imports;
+                        unit->parse = parseTimer.elapse() / 1000.0;
+                        return true;
+                    }
                 }
+                bool parsed = eokas_parse(unit);
+                unit->parse = parseTimer.elapse() / 1000.0;
+                return parsed;
+            }));
+        }
 
-                auto iter = std::find(filesToParse.begin(), filesToParse.end(), targetPath);
-                if(iter == filesToParse.end()) {
-                    filesToParse.push_back(targetPath);
+        bool failed = false;
+        for(auto& result : parsed) {
+            failed |= !pool.wait(result);
+        }
+        if(failed)
+            return false;
+
+        std::vector<String> next;
+        for(auto& path : level) {
+            for(auto& targetPath : sources[path]->imports) {
+                if(sources.find(targetPath) == sources.end() && std::find(next.begin(), next.end(), targetPath) == next.end()) {
+                    next.push_back(targetPath);
                 }
             }
         }
+        level = std::move(next);
+    }
+    timing.parse = timer.elapse() / 1000.0;
+    timing.files = (int)sources.size();
+
+    // dependencies first, a module on the stack is being visited so reaching it again is a cycle.
+    std::vector<eokas_source_t*> order;
+    std::map<String, bool> visited;
+    std::function<bool(const String&)> visit = [&](const String& path) -> bool {
+        auto iter = visited.find(path);
+        if(iter != visited.end()) {
+            if(!iter->second)
+                printf("ERROR: %s is imported in a cycle.\n", path.cstr());
+            return iter->second;
+        }
+        visited[path] = false;
+        auto& unit = sources[path];
+        for(auto& dep : unit->imports) {
+            if(!visit(dep))
+                return false;
+        }
+        visited[path] = true;
+        order.push_back(unit.get());
+        return true;
+    };
+    for(auto& file : files) {
+        if(!visit(file))
+            return false;
+    }
+
+    if(flags.verbose) {
+        for(auto* unit : order) {
+            printf("=> Source code: %s\n", unit->path.cstr());
+            printf("------------------------------------------\n");
+            printf("%s\n", unit->source.replace("%", "%%").cstr());
+            printf("------------------------------------------\n");
+        }
+    }
 
-        modules.insert(std::make_pair(filePath, node));
+    bool cache = flags.cache;
+    if(cache && !File::createFolder(cacheFolder)) {
+        printf("WARNING: The cache folder '%s' can not be created.\n", cacheFolder.cstr());
+        cache = false;
     }
 
-    omis_module_t* mainModule = nullptr;
-    // NOTE: index >= 0 is always true because of size_t is unsigned.
-    for(size_t index = filesToParse.size() - 1; index < filesToParse.size(); index--) {
-        const String& filePath = filesToParse[index];
-        ast_node_module_t* node = modules[filePath];
+    // a module imports only modules of lower levels than its own.
+    std::vector<std::vector<eokas_source_t*>> levels;
+    std::map<String, size_t> depths;
+    for(auto* unit : order) {
+        size_t depth = 0;
+        for(auto& dep : unit->imports) {
+            depth = std::max(depth, depths[dep] + 1);
+        }
+        depths[unit->path] = depth;
+        if(levels.size() <= depth)
+            levels.resize(depth + 1);
+        levels[depth].push_back(unit);
+    }
+
+    bool parallel = coder.get_backend() == omis_backend_t::LLVM;
+    eokas_scratch_t scratch;
+    std::map<String, omis_module_t*> encoded;
+    for(auto& level : levels) {
+        std::vector<eokas_source_t*> pending;
+        for(auto* unit : level) {
+            omis_module_t* mod = nullptr;
+            if(cache) {
+                String key = String::format("%s\n%d %d\n", unit->stamp.cstr(), (int)flags.options.opt_level, (int)flags.options.native);
+                for(auto& dep : unit->imports) {
+                    key += dep + "\n" + coder.interface(encoded[dep]);
+                }
+                unit->key = sha256(key);
+
+                unit->bitcode = eokas_cache_path(cacheFolder, unit->key, ".bc");
+                if(unit->unchanged && unit->manifest.key == unit->key && File::exists(unit->bitcode)) {
+                    mod = coder.load(unit->path, unit->bitcode, unit->imports, unit->manifest.interface);
+                    unit->cached = mod != nullptr;
+                }
+            }
+            if(mod != nullptr)
+                encoded[unit->path] = mod;
+            else
+                pending.push_back(unit);
+        }
+
+        // the workers load the imports from bitcode, the scratch files of it are kept beside the cache.
+        if(parallel && pending.size() > 1 && (cache || File::createFolder(cacheFolder))) {
+            if(!eokas_encode_level(coder, order, pending, encoded, cacheFolder, cache, scratch, pool))
+                return false;
+            for(auto* unit : pending) {
+                omis_module_t* mod = coder.load(unit->path, unit->bitcode, unit->imports, unit->interface);
+                if(mod == nullptr) {
+                    printf("ERROR: The module encoded from %s can not be loaded.\n", unit->path.cstr());
+                    return false;
+                }
+                encoded[unit->path] = mod;
+            }
+        }
+        else {
+            for(auto* unit : pending) {
+                // the source is the same but an import is not, parse it after all.
+                if(unit->node == nullptr && !eokas_parse(unit))
+                    return false;
+                omis_module_t* mod = coder.encode(unit->node);
+                if(mod == nullptr)
+                    return false;
+                encoded[unit->path] = mod;
+            }
+        }
 
-        omis_module_t* mod = coder.encode(node);
-        if (mod == nullptr) {
-            return;
+        if(!cache)
+            continue;
+        for(auto* unit : pending) {
+            omis_module_t* mod = encoded[unit->path];
+            eokas_manifest_t manifest;
+            manifest.stamp = unit->stamp;
+            manifest.key = unit->key;
+            manifest.imports = unit->imports;
+            manifest.interface = coder.interface(mod);
+
+            String temp = unit->bitcode + ".tmp";
+            String manifestPath = eokas_cache_path(cacheFolder, sha256(unit->path), ".mod");
+            bool saved = unit->saved || (coder.save(mod, temp) && File::replace(temp, unit->bitcode));
+            saved = saved && eokas_write_manifest(manifestPath, manifest);
+            if(saved && !unit->manifest.key.isEmpty() && unit->manifest.key != unit->key)
+                File::remove(eokas_cache_path(cacheFolder, unit->manifest.key, ".bc"));
         }
+    }
+    for(auto* unit : order) {
+        if(std::find(files.begin(), files.end(), unit->path) != files.end())
+            modules.push_back(encoded[unit->path]);
+    }
+    timing.encode = timer.elapse() / 1000.0;
 
-        if(filePath == file) {
-            mainModule = mod;
+    if(flags.time_passes) {
+        for(auto* unit : order) {
+            timing.cached += unit->cached ? 1 : 0;
+            timing.report += String::format("           %10.3f  %s%s\n", unit->parse, unit->path.cstr(), unit->cached ? " (cached)" : "");
         }
     }
 
+    return true;
+}
+
+static omis_module_t* eokas_encode(coder_t& coder, const String& mainFile, const eokas_flags_t& flags, eokas_timing_t& timing) {
+    // imports resolve to absolute paths, the main file has to match them.
+    String file = File::absolutePath(mainFile);
+    String cacheFolder = File::combinePath(File::basePath(file), ".eokas-cache");
+    std::vector<omis_module_t*> modules;
+    ThreadPool pool(eokas_pool_size());
+    if(!eokas_encode_all(coder, {file}, cacheFolder, flags, timing, modules, pool))
+        return nullptr;
+    return modules.back();
+}
+
+static void eokas_main(coder_t& coder, const String& file, const String& cmd, const eokas_flags_t& flags) {
+    eokas_timing_t timing;
+    omis_module_t* mainModule = eokas_encode(coder, file, flags, timing);
     if(mainModule == nullptr) {
         return;
     }
@@ -136,16 +533,407 @@ static void eokas_main(coder_t& coder, const String& file, const String& cmd) {
     if (!out.open())
         return;
 
-    printf("=> Encode to IR:\n");
+    if(flags.verbose) {
+        printf("=> Encode to IR:\n");
+        printf("------------------------------------------\n");
+        printf("%s", coder.dump(mainModule).cstr());
+        printf("------------------------------------------\n");
+    }
+
+    omis_compile_stats_t stats;
+    switch(HashKey(cmd)) {
+        case "run"_hash:
+            if(coder.jit(mainModule, flags.options, stats))
+                printf("RET: %lld \n", (long long)stats.result);
+            break;
+        default:
+            coder.aot(mainModule, flags.options, stats);
+            break;
+    }
+
+    if(flags.time_passes) {
+        printf("=> Time passes (ms):\n");
+        printf("------------------------------------------\n");
+        printf("  parse    %10.3f  %d files, %d cached\n", timing.parse, timing.files, timing.cached);
+        printf("%s", timing.report.cstr());
+        printf("  encode   %10.3f\n", timing.encode);
+        printf("  optimize %10.3f\n", stats.optimize);
+        printf("  codegen  %10.3f\n", stats.codegen);
+        if(cmd == "run")
+            printf("  run      %10.3f\n", stats.run);
+        printf("------------------------------------------\n");
+    }
+    out.close();
+}
+
+/**
+ * JIT every sample of the folder at each optimization level and tiered, with a
+ * fresh coder per run so that nothing is shared between them. first is the time
+ * to the first result, steady the best of the runs that follow it.
+ */
+static void eokas_bench(const String& dir) {
+    struct bench_mode_t {
+        const char* name;
+        omis_opt_level_t level;
+        omis_backend_t backend;
+    };
+    static const bench_mode_t modes[] = {
+        {"-O0", omis_opt_level_t::O0, omis_backend_t::LLVM},
+        {"-O1", omis_opt_level_t::O1, omis_backend_t::LLVM},
+        {"-O2", omis_opt_level_t::O2, omis_backend_t::LLVM},
+        {"-O3", omis_opt_level_t::O3, omis_backend_t::LLVM},
+        {"-Os", omis_opt_level_t::Os, omis_backend_t::LLVM},
+        {"tiered", omis_opt_level_t::O2, omis_backend_t::TIERED},
+    };
+    static const int steadyRuns = 3;
+
+    StringList files = File::listFileNames(dir, [](const String& name) -> bool {
+        return name.endsWith(".eokas");
+    });
+    files.sort();
+
+    String report = String::format("%-32s %-6s %10s %10s %10s %10s %10s\n", "sample", "mode", "encode", "optimize", "codegen", "first", "steady");
+    for(auto& name : files) {
+        String file = File::absolutePath(File::combinePath(dir, name));
+        for(auto& mode : modes) {
+            coder_t coder(mode.backend);
+            Timer timer;
+            eokas_timing_t timing;
+            omis_module_t* mod = eokas_encode(coder, file, eokas_flags_t(), timing);
+            double encode = timer.elapse() / 1000.0;
+
+            omis_compile_options_t options;
+            options.opt_level = mode.level;
+            options.native = true;
+            omis_compile_stats_t stats;
+            if(mod == nullptr || !coder.jit(mod, options, stats)) {
+                report += String::format("%-32s %-6s %10s\n", name.cstr(), mode.name, "failed");
+                continue;
+            }
+            double first = stats.codegen + stats.run;
+
+            double steady = stats.run;
+            for(int run = 0; run < steadyRuns; run++) {
+                omis_compile_stats_t again;
+                if(coder.jit(mod, options, again))
+                    steady = std::min(steady, again.run);
+            }
+            report += String::format("%-32s %-6s %10.3f %10.3f %10.3f %10.3f %10.3f\n",
+                name.cstr(), mode.name, encode, stats.optimize, stats.codegen, first, steady);
+        }
+    }
+
+    printf("=> Bench (ms, -march=native):\n");
     printf("------------------------------------------\n");
-    printf("%s", coder.dump(mainModule).cstr());
+    printf("%s", report.cstr());
     printf("------------------------------------------\n");
-    if(cmd == "run")
-        coder.jit(mainModule);
-    else
-        coder.aot(mainModule);
+
+    // the scanner alone, each sample scanned over and over for a while.
+    static const double scanMillis = 50;
+    String scanReport = String::format("%-32s %10s %10s %10s\n", "sample", "bytes", "tokens", "MB/s");
+    for(auto& name : files) {
+        String source = read_text_file(File::combinePath(dir, name));
+        scanner_t scanner;
+        size_t tokens = 0;
+        size_t bytes = 0;
+        Timer timer;
+        do {
+            scanner.ready(source.cstr());
+            tokens = 0;
+            do {
+                scanner.next_token();
+                tokens++;
+            } while(scanner.token().type != token_t::EOS && scanner.token().type != token_t::UNKNOWN);
+            bytes += source.length();
+        } while(timer.elapse(false) < scanMillis * 1000);
+        double seconds = timer.elapse() / 1000000.0;
+        scanReport += String::format("%-32s %10d %10d %10.1f\n", name.cstr(), (int)source.length(), (int)tokens, bytes / seconds / 1000000.0);
+    }
+
+    printf("=> Scanner (MB/s):\n");
     printf("------------------------------------------\n");
-    out.close();
+    printf("%s", scanReport.cstr());
+    printf("------------------------------------------\n");
+}
+
+/**
+ * A package as its eokas.build.json describes it, eokas.library.json fills in the
+ * version and the dependencies when the build file has none. A dependency is the
+ * package of that name in the folder beside it.
+ */
+struct eokas_package_t {
+    String name;
+    String version;
+    String home;
+    String out;
+    StringVector src;
+    std::vector<std::pair<String, String>> deps;
+    std::vector<eokas_package_t*> depends;
+    std::vector<eokas_package_t*> dependents;
+    /// dependencies not built yet.
+    size_t waiting = 0;
+    String stamp;
+    bool failed = false;
+};
+
+static bool eokas_read_json(const String& path, HomNode& json) {
+    String text;
+    if(!File::exists(path) || !File::readText(path, text))
+        return false;
+    json = JSON::parse(text);
+    return json.isObject();
+}
+
+static bool eokas_load_package(const String& home, eokas_package_t& package) {
+    HomNode build;
+    if(!eokas_read_json(File::combinePath(home, "eokas.build.json"), build)) {
+        printf("ERROR: %s has no readable eokas.build.json.\n", home.cstr());
+        return false;
+    }
+    HomNode library;
+    eokas_read_json(File::combinePath(home, "eokas.library.json"), library);
+
+    package.home = home;
+    package.name = build.get("name").isString() ? build.get("name").asString() : File::fileName(home);
+    package.version = library.get("version").isString() ? library.get("version").asString() : "";
+    package.out = File::combinePath(home, build.get("out").isString() ? build.get("out").asString() : "./out");
+    build.get("src").foreach([&](const HomNode& src) {
+        package.src.push_back(File::combinePath(home, src.asString()));
+    });
+    if(package.src.empty())
+        package.src.push_back(File::combinePath(home, "./src"));
+
+    HomNode deps = build.get("deps");
+    if(!deps.isObject())
+        deps = library.get("dependencies");
+    deps.foreach([&](const String& name, const HomNode& version) {
+        package.deps.push_back(std::make_pair(name, version.asString()));
+    });
+    return true;
+}
+
+static void eokas_list_sources(const String& folder, StringVector& files) {
+    StringList names = File::listFileNames(folder, [](const String& name) -> bool {
+        return name.endsWith(".eokas");
+    });
+    names.sort();
+    for(auto& name : names) {
+        files.push_back(File::absolutePath(File::combinePath(folder, name)));
+    }
+    StringList folders = File::listFolderNames(folder, [](const String& name) -> bool {
+        return name != "." && name != "..";
+    });
+    folders.sort();
+    for(auto& name : folders) {
+        eokas_list_sources(File::combinePath(folder, name), files);
+    }
+}
+
+/**
+ * The stamp covers the compiler, the options, every source of the package and the
+ * stamps of its dependencies, the library is up to date while it stays the same.
+ */
+static bool eokas_build_package(eokas_package_t* package, const eokas_flags_t& flags, ThreadPool& pool) {
+    StringVector files;
+    for(auto& src : package->src) {
+        if(!File::isFolder(src)) {
+            printf("ERROR: The source folder '%s' of the package '%s' is not found.\n", src.cstr(), package->name.cstr());
+            return false;
+        }
+        eokas_list_sources(src, files);
+    }
+    if(files.empty()) {
+        printf("ERROR: The package '%s' has no source files.\n", package->name.cstr());
+        return false;
+    }
+
+    String stamp = String::format("%s\n%d %d\n", _ELANG_VERSION, (int)flags.options.opt_level, (int)flags.options.native);
+    for(auto& file : files) {
+        stamp += file + "\n" + read_text_file(file) + "\n";
+    }
+    for(auto* dep : package->depends) {
+        stamp += dep->name + " " + dep->stamp + "\n";
+    }
+    package->stamp = sha256(stamp);
+
+    if(!File::createFolder(package->out)) {
+        printf("ERROR: The output folder '%s' can not be created.\n", package->out.cstr());
+        return false;
+    }
+
+    String libraryPath = File::combinePath(File::absolutePath(package->out), String::format("lib%s.a", package->name.cstr()));
+    String stampPath = libraryPath + ".stamp";
+    String oldStamp;
+    if(File::exists(libraryPath) && File::exists(stampPath) && File::readText(stampPath, oldStamp) && oldStamp == package->stamp) {
+        printf("=> Package %s is up to date.\n", package->name.cstr());
+        return true;
+    }
+
+    Timer timer;
+    coder_t coder;
+    eokas_timing_t timing;
+    std::vector<omis_module_t*> modules;
+    if(!eokas_encode_all(coder, files, File::combinePath(package->out, ".eokas-cache"), flags, timing, modules, pool))
+        return false;
+
+    omis_compile_stats_t stats;
+    if(!coder.archive(modules, libraryPath, flags.options, stats))
+        return false;
+
+    String temp = stampPath + ".tmp";
+    if(!File::writeText(temp, package->stamp) || !File::replace(temp, stampPath))
+        printf("WARNING: The stamp of the package '%s' can not be written.\n", package->name.cstr());
+
+    printf("=> Package %s: %d files to %s in %.3f ms.\n", package->name.cstr(), (int)files.size(), libraryPath.cstr(), timer.elapse() / 1000.0);
+    return true;
+}
+
+/**
+ * Build the package of the folder after the packages it depends on. A package is
+ * queued as soon as the last of its dependencies is built, and is built on a coder
+ * of its own. The packages and the modules they encode share one pool.
+ */
+static void eokas_build(const String& dir, const eokas_flags_t& flags) {
+    std::map<String, std::unique_ptr<eokas_package_t>> packages;
+    std::vector<eokas_package_t*> order;
+
+    // dependencies first, a package on the stack is being visited so reaching it again is a cycle.
+    std::map<String, bool> visited;
+    std::function<eokas_package_t*(const String&)> visit = [&](const String& home) -> eokas_package_t* {
+        auto iter = visited.find(home);
+        if(iter != visited.end()) {
+            if(!iter->second)
+                printf("ERROR: The package at %s is in a dependency cycle.\n", home.cstr());
+            return iter->second ? packages[home].get() : nullptr;
+        }
+        visited[home] = false;
+
+        auto* package = new eokas_package_t();
+        packages[home].reset(package);
+        if(!eokas_load_package(home, *package))
+            return nullptr;
+
+        for(auto& dep : package->deps) {
+            String depHome = File::combinePath(File::basePath(home), dep.first);
+            if(!File::isFolder(depHome)) {
+                printf("ERROR: The package '%s' required by '%s' is not found.\n", dep.first.cstr(), package->name.cstr());
+                return nullptr;
+            }
+            auto* depends = visit(depHome);
+            if(depends == nullptr)
+                return nullptr;
+            if(!depends->version.isEmpty() && depends->version != dep.second) {
+                printf("WARNING: '%s' requires '%s' %s, %s is found.\n",
+                    package->name.cstr(), dep.first.cstr(), dep.second.cstr(), depends->version.cstr());
+            }
+            package->depends.push_back(depends);
+        }
+
+        visited[home] = true;
+        order.push_back(package);
+        return package;
+    };
+    if(visit(File::absolutePath(dir)) == nullptr)
+        return;
+
+    for(auto* package : order) {
+        package->waiting = package->depends.size();
+        for(auto* dep : package->depends) {
+            dep->dependents.push_back(package);
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable finished;
+    size_t remaining = order.size();
+    std::function<void(eokas_package_t*)> schedule;
+    // destroyed first, its threads are joined before what they use goes away.
+    ThreadPool pool(eokas_pool_size());
+    schedule = [&](eokas_package_t* package) {
+        pool.exec([&, package]() {
+            bool failed = package->failed;
+            if(failed) {
+                printf("ERROR: The package '%s' is skipped, a dependency failed.\n", package->name.cstr());
+            }
+            else {
+                try {
+                    failed = !eokas_build_package(package, flags, pool);
+                }
+                catch(const std::exception& e) {
+                    printf("ERROR: The package '%s' failed: %s\n", package->name.cstr(), e.what());
+                    failed = true;
+                }
+            }
+
+            std::vector<eokas_package_t*> ready;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                package->failed = failed;
+                for(auto* dependent : package->dependents) {
+                    dependent->failed |= failed;
+                    if(--dependent->waiting == 0)
+                        ready.push_back(dependent);
+                }
+                remaining -= 1;
+            }
+            for(auto* dependent : ready) {
+                schedule(dependent);
+            }
+            finished.notify_all();
+        });
+    };
+
+    Timer timer;
+    for(auto* package : order) {
+        if(package->waiting == 0)
+            schedule(package);
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [&remaining]() { return remaining == 0; });
+    }
+
+    bool failed = std::any_of(order.begin(), order.end(), [](eokas_package_t* package) {
+        return package->failed;
+    });
+    printf("=> Build %s, %d packages in %.3f ms.\n", failed ? "failed" : "succeeded", (int)order.size(), timer.elapse() / 1000.0);
+}
+
+static cli::Command& with_compile_options(cli::Command& cmd) {
+    return cmd
+        .option("-O0", "no optimization", false)
+        .option("-O1", "", false)
+        .option("-O2", "", false)
+        .option("-O3", "", false)
+        .option("-Os", "optimize for size", false)
+        .option("-march=native", "target the host cpu", false)
+        .option("--verbose,-v", "dump the sources and the IR", false)
+        .option("--time-passes", "print the time spent in each phase", false)
+        .option("--no-cache", "encode every module from its source", false);
+}
+
+static omis_compile_options_t fetch_compile_options(const cli::Command& cmd) {
+    omis_compile_options_t options;
+    // the highest level given wins, -Os only when no -O level is.
+    if (cmd.fetchValue("-Os"_hash))
+        options.opt_level = omis_opt_level_t::Os;
+    if (cmd.fetchValue("-O1"_hash))
+        options.opt_level = omis_opt_level_t::O1;
+    if (cmd.fetchValue("-O2"_hash))
+        options.opt_level = omis_opt_level_t::O2;
+    if (cmd.fetchValue("-O3"_hash))
+        options.opt_level = omis_opt_level_t::O3;
+    options.native = cmd.fetchValue("-march=native"_hash);
+    return options;
+}
+
+static eokas_flags_t fetch_flags(const cli::Command& cmd) {
+    eokas_flags_t flags;
+    flags.options = fetch_compile_options(cmd);
+    flags.verbose = cmd.fetchValue("--verbose"_hash);
+    flags.time_passes = cmd.fetchValue("--time-passes"_hash);
+    flags.cache = !cmd.fetchValue("--no-cache"_hash);
+    return flags;
 }
 
 static void about(void) {
@@ -169,7 +957,11 @@ static void bad_command(const char* command) {
    );
 }
 
-static String read_text_file(String& filePath) {
+static unsigned short eokas_pool_size() {
+    return (unsigned short)std::clamp(std::thread::hardware_concurrency(), 1u, (unsigned)THREADPOOL_MAX_NUM);
+}
+
+static String read_text_file(const String& filePath) {
     FileStream in(filePath, "rb");
     if (!in.open())
         return "";
@@ -2,12 +2,14 @@
 #include "./coder.h"
 #include "../omis/model.h"
 #include "../omis/x-module-coder.h"
+#include "../omis/x-module-cache.h"
 
 namespace eokas
 {
-    coder_t::coder_t()
+    coder_t::coder_t(omis_backend_t backend)
+        : backend(backend)
     {
-        context = new omis_context_t();
+        context = new omis_context_t(backend);
         context->load_default_modules();
     }
     
@@ -16,6 +18,11 @@ namespace eokas
         _DeletePointer(context);
     }
     
+    omis_backend_t coder_t::get_backend() const
+    {
+        return backend;
+    }
+    
     omis_module_t* coder_t::encode(ast_node_module_t* node)
     {
         return context->load_module(node->name, [&]() -> omis_module_t*
@@ -30,18 +37,47 @@ namespace eokas
         });
     }
     
+    omis_module_t* coder_t::load(const String& name, const String& path, const StringVector& imports, const String& interface)
+    {
+        return context->load_module(name, [&]() -> omis_module_t*
+        {
+            auto mod = new omis_module_cache_t(context, name);
+            if (!mod->load_module(path, imports, interface))
+            {
+                _DeletePointer(mod);
+                return nullptr;
+            }
+            return mod;
+        });
+    }
+    
     String coder_t::dump(omis_module_t* mod)
     {
         return mod->dump();
     }
     
-    void coder_t::jit(omis_module_t* mod)
+    String coder_t::interface(omis_module_t* mod)
+    {
+        return mod->get_interface();
+    }
+    
+    bool coder_t::save(omis_module_t* mod, const String& path)
+    {
+        return mod->save(path);
+    }
+    
+    bool coder_t::jit(omis_module_t* mod, const omis_compile_options_t& options, omis_compile_stats_t& stats)
+    {
+        return context->jit(mod, options, stats);
+    }
+    
+    bool coder_t::aot(omis_module_t* mod, const omis_compile_options_t& options, omis_compile_stats_t& stats)
     {
-        context->jit(mod);
+        return context->aot(mod, options, stats);
     }
     
-    void coder_t::aot(omis_module_t* mod)
+    bool coder_t::archive(const std::vector<omis_module_t*>& mods, const String& path, const omis_compile_options_t& options, omis_compile_stats_t& stats)
     {
-        context->aot(mod);
+        return context->archive(mods, path, options, stats);
     }
 }
@@ -4,21 +4,29 @@
 
 #include "../ast/ast.h"
 #include "../omis/context.h"
+#include "../omis/bridge.h"
 
 namespace eokas
 {
     class coder_t
     {
     public:
-        coder_t();
+        explicit coder_t(omis_backend_t backend = omis_backend_t::LLVM);
         ~coder_t();
         
+        omis_backend_t get_backend() const;
         omis_module_t* encode(ast_node_module_t* node);
+        /// a module saved by an earlier run, its imports have to be loaded or encoded first.
+        omis_module_t* load(const String& name, const String& path, const StringVector& imports, const String& interface);
         String dump(omis_module_t* mod);
-        void jit(omis_module_t* mod);
-        void aot(omis_module_t* mod);
+        String interface(omis_module_t* mod);
+        bool save(omis_module_t* mod, const String& path);
+        bool jit(omis_module_t* mod, const omis_compile_options_t& options, omis_compile_stats_t& stats);
+        bool aot(omis_module_t* mod, const omis_compile_options_t& options, omis_compile_stats_t& stats);
+        bool archive(const std::vector<omis_module_t*>& mods, const String& path, const omis_compile_options_t& options, omis_compile_stats_t& stats);
     
     private:
+        omis_backend_t backend;
         omis_context_t* context;
     };
 }
@@ -81,7 +81,7 @@ namespace eokas {
 
 		String name = "";
 		if(this->check_token(token_t::ID, false, false)) {
-			name = this->token().value;
+			name = this->token().value();
 			this->next_token();
 
 			if(!this->check_token(token_t::COLON)) {
@@ -113,7 +113,7 @@ namespace eokas {
 			return nullptr;
 		}
 
-		String name = this->token().value;
+		String name = this->token().value();
 		this->next_token();
 		
 		auto node = factory->create<ast_node_export_t>(p);
@@ -130,7 +130,7 @@ namespace eokas {
 		if(!this->check_token(token_t::ID, true, false))
 			return nullptr;
 		
-		String name = this->token().value;
+		String name = this->token().value();
 		auto* node = factory->create<ast_node_type_t>(p);
 		node->name = name;
 		
@@ -367,7 +367,7 @@ namespace eokas {
 			return nullptr;
 
 		auto* node = factory->create<ast_node_symbol_ref_t>(p);
-		node->name = this->token().value;
+		node->name = this->token().value();
 
 		this->next_token();
 
@@ -382,21 +382,21 @@ namespace eokas {
 			case token_t::INT_B:
 			{
 				auto* node = factory->create<ast_node_literal_int_t>(p);
-				node->value = String::binstrToValue<i32_t>(token.value);
+				node->value = String::binstrToValue<i32_t>(token.value());
 				this->next_token();
 				return node;
 			}
 			case token_t::INT_X:
 			{
 				auto* node = factory->create<ast_node_literal_int_t>(p);
-				node->value = String::hexstrToValue<i32_t>(token.value);
+				node->value = String::hexstrToValue<i32_t>(token.value());
 				this->next_token();
 				return node;
 			}
 			case token_t::INT_D:
 			{
 				auto* node = factory->create<ast_node_literal_int_t>(p);
-				node->value = String::stringToValue<i32_t>(token.value);
+				node->value = String::stringToValue<i32_t>(token.value());
 				this->next_token();
 				return node;
 			}
@@ -414,7 +414,7 @@ namespace eokas {
 			case token_t::FLOAT:
 			{
 				auto* node = factory->create<ast_node_literal_float_t>(p);
-				node->value = String::stringToValue<f32_t>(token.value);
+				node->value = String::stringToValue<f32_t>(token.value());
 				this->next_token();
 				return node;
 			}
@@ -433,7 +433,7 @@ namespace eokas {
 			case token_t::FALSE:
 			{
 				auto* node = factory->create<ast_node_literal_bool_t>(p);
-				node->value = String::stringToValue<bool>(token.value);
+				node->value = String::stringToValue<bool>(token.value());
 				this->next_token();
 				return node;
 			}
@@ -451,7 +451,7 @@ namespace eokas {
 			case token_t::STRING:
 			{
 				auto* node = factory->create<ast_node_literal_string_t>(p);
-				node->value = token.value;
+				node->value = token.value();
 				this->next_token();
 				return node;
 			}
@@ -502,7 +502,7 @@ namespace eokas {
 
 			if(!this->check_token(token_t::ID, true, false))
 				return false;
-			const String name = this->token().value;
+			const String name = this->token().value();
 			if(node->getArg(name) != nullptr)
 			{
 				this->error_token_unexpected();
@@ -623,7 +623,7 @@ namespace eokas {
 		if(!this->check_token(token_t::ID, true, false))
 			return false;
 
-		const String key = this->token().value;
+		const String key = this->token().value();
 		this->next_token();
 
 		if(!this->check_token(token_t::ASSIGN, false) && !this->check_token(token_t::COLON, false))
@@ -705,7 +705,7 @@ namespace eokas {
 		if(!this->check_token(token_t::ID, true, false))
 			return nullptr;
 
-		node->key = this->token().value;
+		node->key = this->token().value();
 
 		this->next_token();
 
@@ -783,7 +783,7 @@ namespace eokas {
 		if(!this->check_token(token_t::ID, true, false))
 			return nullptr;
 
-		node->name = this->token().value;
+		node->name = this->token().value();
 		this->next_token();
 
 		// {
@@ -827,7 +827,7 @@ namespace eokas {
 		if(!this->check_token(token_t::ID, true, false))
 			return false;
 
-		const String& name = this->token().value;
+		const String& name = this->token().value();
 		auto* node = p->addMember(name);
 		if(node == nullptr)
 		{
@@ -869,7 +869,7 @@ namespace eokas {
 		if(!this->check_token(token_t::ID, true, false))
 			return nullptr;
 
-		node->name = this->token().value;
+		node->name = this->token().value();
 		this->next_token();
 
 		// {
@@ -886,7 +886,7 @@ namespace eokas {
 			if(!this->check_token(token_t::ID, true, false))
 				return nullptr;
 
-			const String memName = this->token().value;
+			const String memName = this->token().value();
 			if(node->members.find(memName) != node->members.end())
 			{
 				this->error_token_unexpected();
@@ -932,7 +932,7 @@ namespace eokas {
 		if(!this->check_token(token_t::ID, true, false))
 			return nullptr;
 
-		node->name = this->token().value;
+		node->name = this->token().value();
 		this->next_token();
 
 		// (
@@ -948,7 +948,7 @@ namespace eokas {
 			if(!this->check_token(token_t::ID, true, false))
 				return nullptr;
 
-			const String argName = this->token().value;
+			const String argName = this->token().value();
 			if(node->args.find(argName) != node->args.end())
 			{
 				this->error_token_unexpected();
@@ -998,7 +998,7 @@ namespace eokas {
 		if(!this->check_token(token_t::ID, true, false))
 			return nullptr;
 
-		node->name = this->token().value;
+		node->name = this->token().value();
 
 		this->next_token();
 
@@ -1380,11 +1380,11 @@ namespace eokas {
 	void parser_t::error_token_unexpected()
 	{
 		token_t& token = scanner->token();
-		const char* value = token.value.cstr();
+		String value = token.value();
 		if(token.type == token_t::EOS)
 			this->error("Unexpected eos");
 		else
-			this->error("Unexpected token '%s'", value);
+			this->error("Unexpected token '%s'", value.cstr());
 	}
 	
 	void parser_t::error_import_exists(const String& entry)
@@ -1,9 +1,172 @@
 #include "scanner.h"
+#include <array>
+#include <cstring>
+#include <string>
+
+#if _EOKAS_ARCH == _EOKAS_ARCH_X64 || (_EOKAS_ARCH == _EOKAS_ARCH_X86 && defined(__SSE2__))
+#define _EOKAS_SCANNER_SSE2
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
 
 namespace eokas
 {
+    static constexpr size_t keyword_length(const char* str)
+    {
+        size_t len = 0;
+        while (str[len] != '\0')
+            len++;
+        return len;
+    }
+    
+    static constexpr u32_t keyword_hash(const char* str, size_t len)
+    {
+        return (u32_t(u8_t(str[0])) * 3 + u32_t(u8_t(str[len - 1])) * 15 + u32_t(len)) & 63;
+    }
+    
+    struct keyword_table_t
+    {
+        i8_t slots[64];
+        size_t min_length;
+        size_t max_length;
+        bool perfect;
+    };
+    
+    /**
+     * The keywords are the leading token types. Each gets a slot of its own by the
+     * first and the last char and the length, so a lookup is one hash and at most
+     * one compare.
+     */
+    static constexpr keyword_table_t make_keyword_table()
+    {
+        keyword_table_t table = {};
+        table.min_length = 64;
+        table.max_length = 0;
+        table.perfect = true;
+        for (auto& slot : table.slots)
+            slot = -1;
+        for (int i = token_t::VAR; i <= token_t::FALSE; i++)
+        {
+            const char* name = token_t::names[i];
+            size_t len = keyword_length(name);
+            u32_t hash = keyword_hash(name, len);
+            table.perfect = table.perfect && table.slots[hash] < 0;
+            table.slots[hash] = i8_t(i);
+            table.min_length = len < table.min_length ? len : table.min_length;
+            table.max_length = len > table.max_length ? len : table.max_length;
+        }
+        return table;
+    }
+    
+    static constexpr keyword_table_t keyword_table = make_keyword_table();
+    static_assert(keyword_table.perfect, "Two keywords share a slot, keyword_hash needs other factors.");
+    
+    /// the token types of the operators that are a single char.
+    static constexpr std::array<u8_t, 128> make_operator_table()
+    {
+        std::array<u8_t, 128> table = {};
+        for (auto& type : table)
+            type = token_t::UNKNOWN;
+        for (int i = token_t::COMMA; i <= token_t::DOT3; i++)
+        {
+            const char* name = token_t::names[i];
+            if (name[1] == '\0')
+                table[u8_t(name[0])] = u8_t(i);
+        }
+        return table;
+    }
+    
+    static constexpr std::array<u8_t, 128> operator_table = make_operator_table();
+    
+    /**
+     * Runs of identifier chars, blanks and comment text are matched 16 bytes at a
+     * time where SSE2 is there, as long as 16 bytes are left before the end of the
+     * source. The rest goes byte by byte.
+     */
+#if defined(_EOKAS_SCANNER_SSE2)
+    static inline int first_set_bit(int mask)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward(&index, (unsigned long) mask);
+        return (int) index;
+#else
+        return __builtin_ctz((unsigned) mask);
+#endif
+    }
+#endif
+    
+    static const char* skip_identifier(const char* ptr, const char* end)
+    {
+#if defined(_EOKAS_SCANNER_SSE2)
+        while (end - ptr >= 16)
+        {
+            __m128i chars = _mm_loadu_si128((const __m128i*) ptr);
+            __m128i lower = _mm_or_si128(chars, _mm_set1_epi8(0x20));
+            __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+            __m128i number = _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(chars, _mm_set1_epi8('9' + 1)));
+            __m128i underline = _mm_cmpeq_epi8(chars, _mm_set1_epi8('_'));
+            int mask = _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(alpha, number), underline));
+            if (mask != 0xFFFF)
+                return ptr + first_set_bit(~mask & 0xFFFF);
+            ptr += 16;
+        }
+#endif
+        while (_ascil_is_alpha_number_(*ptr))
+            ptr++;
+        return ptr;
+    }
+    
+    static const char* skip_blanks(const char* ptr, const char* end)
+    {
+#if defined(_EOKAS_SCANNER_SSE2)
+        while (end - ptr >= 16)
+        {
+            __m128i chars = _mm_loadu_si128((const __m128i*) ptr);
+            __m128i space = _mm_cmpeq_epi8(chars, _mm_set1_epi8(' '));
+            __m128i tab = _mm_cmpeq_epi8(chars, _mm_set1_epi8('\t'));
+            __m128i feed = _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('\n')), _mm_cmplt_epi8(chars, _mm_set1_epi8('\r')));
+            int mask = _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(space, tab), feed));
+            if (mask != 0xFFFF)
+                return ptr + first_set_bit(~mask & 0xFFFF);
+            ptr += 16;
+        }
+#endif
+        while (*ptr == ' ' || *ptr == '\t' || *ptr == '\f' || *ptr == '\v')
+            ptr++;
+        return ptr;
+    }
+    
+    static const char* skip_line(const char* ptr, const char* end)
+    {
+#if defined(_EOKAS_SCANNER_SSE2)
+        while (end - ptr >= 16)
+        {
+            __m128i chars = _mm_loadu_si128((const __m128i*) ptr);
+            __m128i lf = _mm_cmpeq_epi8(chars, _mm_set1_epi8('\n'));
+            __m128i cr = _mm_cmpeq_epi8(chars, _mm_set1_epi8('\r'));
+            int mask = _mm_movemask_epi8(_mm_or_si128(lf, cr));
+            if (mask != 0)
+                return ptr + first_set_bit(mask);
+            ptr += 16;
+        }
+#endif
+        while (*ptr != '\n' && *ptr != '\r' && *ptr != '\0')
+            ptr++;
+        return ptr;
+    }
+    
+    static int hex_digit(char c)
+    {
+        if (_ascil_is_number(c))
+            return c - '0';
+        return (c | 0x20) - 'a' + 10;
+    }
+    
     token_t::token_t()
-        : type(UNKNOWN), value()
+        : type(UNKNOWN), source(""), offset(0), length(0), line(0), column(0)
     {
     }
     
@@ -14,34 +177,84 @@ namespace eokas
         return nullptr;
     }
     
-    bool token_t::infer(token_type defaultType)
+    const char* token_t::text() const
+    {
+        return source + offset;
+    }
+    
+    String token_t::value() const
     {
-        bool found = false;
-        int count = (int) (token_t::COUNT);
-        for (int i = 0; i < count; i++)
+        const char* ptr = this->text();
+        if (type != STRING)
+            return String(ptr, length);
+        
+        // the scanner checked the escapes, they only need to be decoded.
+        std::string str;
+        str.reserve(length);
+        const char* end = ptr + length;
+        while (ptr < end)
         {
-            if (this->value == token_t::names[i])
+            char c = *ptr++;
+            if (c != '\\')
             {
-                this->type = (token_t::token_type) i;
-                found = true;
-                break;
+                str.push_back(c);
+                continue;
+            }
+            c = *ptr++;
+            switch (c)
+            {
+                case 'a':
+                    str.push_back('\a');
+                    break;
+                case 'b':
+                    str.push_back('\b');
+                    break;
+                case 'f':
+                    str.push_back('\f');
+                    break;
+                case 'n':
+                    str.push_back('\n');
+                    break;
+                case 'r':
+                    str.push_back('\r');
+                    break;
+                case 't':
+                    str.push_back('\t');
+                    break;
+                case 'v':
+                    str.push_back('\v');
+                    break;
+                case 'x':
+                    str.push_back(char(hex_digit(ptr[0]) * 16 + hex_digit(ptr[1])));
+                    ptr += 2;
+                    break;
+                default:
+                    str.push_back(c);
+                    break;
             }
         }
-        if (!found)
-        {
-            this->type = defaultType;
-        }
-        return found;
+        return String(str.c_str(), str.size());
     }
     
     void token_t::clear()
     {
         this->type = token_t::UNKNOWN;
-        this->value = "";
+        this->offset = 0;
+        this->length = 0;
+    }
+    
+    token_t::token_type token_t::keyword(const char* str, size_t len)
+    {
+        if (len < keyword_table.min_length || len > keyword_table.max_length)
+            return ID;
+        i8_t index = keyword_table.slots[keyword_hash(str, len)];
+        if (index >= 0 && strncmp(names[index], str, len) == 0 && names[index][len] == '\0')
+            return (token_type) index;
+        return ID;
     }
     
     scanner_t::scanner_t()
-        : m_source(nullptr), m_position(nullptr), m_current(0), m_token(), m_look_ahead_token(), m_line(0), m_column(0)
+        : m_source(nullptr), m_end(nullptr), m_position(nullptr), m_current(0), m_token(), m_look_ahead_token(), m_line(0), m_column(0)
     {
     }
     
@@ -54,13 +267,17 @@ namespace eokas
     {
         this->clear();
         m_source = source;
+        m_end = source + strlen(source);
         m_position = source;
+        m_token.source = source;
+        m_look_ahead_token.source = source;
         this->read_char();
     }
     
     void scanner_t::clear()
     {
         m_source = nullptr;
+        m_end = nullptr;
         m_position = nullptr;
         m_current = 0;
         m_token.clear();
@@ -117,9 +334,21 @@ namespace eokas
     void scanner_t::scan()
     {
         m_token.clear();
+        this->scan_token();
         
+        // a string has measured its content already.
+        if (m_token.type != token_t::STRING)
+            m_token.length = this->offset() - m_token.offset;
+    }
+    
+    void scanner_t::scan_token()
+    {
         for (;;)
         {
+            m_token.offset = this->offset();
+            m_token.line = m_line;
+            m_token.column = m_column;
+            
             switch (m_current)
             {
                 case '\0':
@@ -135,12 +364,11 @@ namespace eokas
                 case '\f':
                 case '\t':
                 case '\v': // spaces
-                    this->read_char();
+                    this->skip_to(skip_blanks(m_position, m_end));
                     break;
                 
                 case '/':    // '//' '/*' '/'
                 {
-                    char div = m_current;
                     this->read_char();
                     if (m_current == '/') // line comment
                     {
@@ -153,16 +381,15 @@ namespace eokas
                         break;
                     }
                     
-                    this->save_char(div);
                     m_token.type = token_t::DIV;
                     return;
                 }
                 
                 case '&': // && or &
-                    this->save_and_read_char();
+                    this->read_char();
                     if (m_current == '&')
                     {
-                        this->save_and_read_char();
+                        this->read_char();
                         m_token.type = token_t::AND2;
                         return;
                     }
@@ -173,16 +400,16 @@ namespace eokas
                     }
                 
                 case '|': // ||, |< or |
-                    this->save_and_read_char();
+                    this->read_char();
                     if (m_current == '|')
                     {
-                        this->save_and_read_char();
+                        this->read_char();
                         m_token.type = token_t::OR2;
                         return;
                     }
                     else if (m_current == '<')
                     {
-                        this->save_and_read_char();
+                        this->read_char();
                         m_token.type = token_t::SHIFT_L;
                         return;
                     }
@@ -193,10 +420,10 @@ namespace eokas
                     }
                 
                 case '=': // == or =
-                    this->save_and_read_char();
+                    this->read_char();
                     if (m_current == '=')
                     {
-                        this->save_and_read_char();
+                        this->read_char();
                         m_token.type = token_t::EQ;
                         return;
                     }
@@ -207,10 +434,10 @@ namespace eokas
                     }
                 
                 case '<': // <=, <
-                    this->save_and_read_char();
+                    this->read_char();
                     if (m_current == '=')
                     {
-                        this->save_and_read_char();
+                        this->read_char();
                         m_token.type = token_t::LE;
                         return;
                     }
@@ -221,16 +448,16 @@ namespace eokas
                     }
                 
                 case '>': // >|, >= or >
-                    this->save_and_read_char();
+                    this->read_char();
                     if (m_current == '|')
                     {
-                        this->save_and_read_char();
+                        this->read_char();
                         m_token.type = token_t::SHIFT_R;
                         return;
                     }
                     else if (m_current == '=')
                     {
-                        this->save_and_read_char();
+                        this->read_char();
                         m_token.type = token_t::GE;
                         return;
                     }
@@ -241,10 +468,10 @@ namespace eokas
                     }
                 
                 case '!': // != or !
-                    this->save_and_read_char();
+                    this->read_char();
                     if (m_current == '=')
                     {
-                        this->save_and_read_char();
+                        this->read_char();
                         m_token.type = token_t::NE;
                         return;
                     }
@@ -255,13 +482,13 @@ namespace eokas
                     }
                 
                 case '.':
-                    this->save_and_read_char();
+                    this->read_char();
                     if (m_current == '.')
                     {
-                        this->save_and_read_char();
+                        this->read_char();
                         if (m_current == '.')
                         {
-                            this->save_and_read_char();
+                            this->read_char();
                             m_token.type = token_t::DOT3;
                             return;
                         }
@@ -297,8 +524,9 @@ namespace eokas
                     else
                     {
                         // single operator + - * / etc.
-                        this->save_and_read_char();
-                        m_token.infer(token_t::UNKNOWN);
+                        u8_t c = u8_t(m_current);
+                        this->read_char();
+                        m_token.type = c < operator_table.size() ? (token_t::token_type) operator_table[c] : token_t::UNKNOWN;
                         return;
                     }
             }
@@ -307,23 +535,23 @@ namespace eokas
     
     void scanner_t::scan_number()
     {
-        this->save_and_read_char();
+        this->read_char();
         
         if (m_current == 'b' || m_current == 'B') // bit
         {
-            this->save_and_read_char();
+            this->read_char();
             while (m_current == '0' || m_current == '1')
             {
-                this->save_and_read_char();
+                this->read_char();
             }
             m_token.type = token_t::INT_B;
         }
         else if (m_current == 'x' || m_current == 'X') // hex
         {
-            this->save_and_read_char();
+            this->read_char();
             while (_ascil_is_hex(m_current))
             {
-                this->save_and_read_char();
+                this->read_char();
             }
             m_token.type = token_t::INT_X;
         }
@@ -331,16 +559,16 @@ namespace eokas
         {
             while (_ascil_is_number(m_current))
             {
-                this->save_and_read_char();
+                this->read_char();
             }
             m_token.type = token_t::INT_D;
             
             if (m_current == '.')
             {
-                this->save_and_read_char();
+                this->read_char();
                 while (_ascil_is_number(m_current))
                 {
-                    this->save_and_read_char();
+                    this->read_char();
                 }
                 m_token.type = token_t::FLOAT;
             }
@@ -350,6 +578,7 @@ namespace eokas
     void scanner_t::scan_string(char delimiter)
     {
         this->read_char();
+        m_token.offset = this->offset();
         while (m_current != delimiter)
         {
             if (m_current == '\0')
@@ -368,31 +597,15 @@ namespace eokas
                 switch (m_current)
                 {
                     case 'a':
-                        this->save_char('\a');
-                        this->read_char();
-                        break;
                     case 'b':
-                        this->save_char('\b');
-                        this->read_char();
-                        break;
                     case 'f':
-                        this->save_char('\f');
-                        this->read_char();
-                        break;
                     case 'n':
-                        this->save_char('\n');
-                        this->read_char();
-                        break;
                     case 'r':
-                        this->save_char('\r');
-                        this->read_char();
-                        break;
                     case 't':
-                        this->save_char('\t');
-                        this->read_char();
-                        break;
                     case 'v':
-                        this->save_char('\v');
+                    case '\\':
+                    case '\'':
+                    case '"':
                         this->read_char();
                         break;
                     case 'x': // \xFF
@@ -402,18 +615,13 @@ namespace eokas
                             m_token.type = token_t::UNKNOWN;
                             return;
                         }
-                        this->save_and_read_char();
+                        this->read_char();
                         if (!_ascil_is_hex(m_current))
                         {
                             m_token.type = token_t::UNKNOWN;
                             return;
                         }
-                        this->save_and_read_char();
-                        break;
-                    case '\\':
-                    case '\'':
-                    case '"':
-                        this->save_and_read_char();
+                        this->read_char();
                         break;
                     default:
                         m_token.type = token_t::UNKNOWN;
@@ -422,28 +630,25 @@ namespace eokas
             }
             else
             {
-                this->save_and_read_char();
+                this->read_char();
             }
         }
+        m_token.length = this->offset() - m_token.offset;
         this->read_char();
         m_token.type = token_t::STRING;
     }
     
     void scanner_t::scan_identifier()
     {
-        this->save_and_read_char();
-        while (_ascil_is_alpha_number_(m_current))
-        {
-            this->save_and_read_char();
-        }
-        m_token.infer(token_t::ID);
+        const char* start = m_position - 1;
+        this->skip_to(skip_identifier(m_position, m_end));
+        m_token.type = token_t::keyword(start, size_t(m_position - 1 - start));
     }
     
     void scanner_t::scan_line_comment()
     {
-        this->read_char();
-        while (m_current != '\n' && m_current != '\r' && m_current != '\0')
-            this->read_char(); // skip to end-of-line or end-of-source
+        // skip to end-of-line or end-of-source
+        this->skip_to(skip_line(m_position, m_end));
     }
     
     void scanner_t::scan_section_comment()
@@ -497,15 +702,18 @@ namespace eokas
         m_column++;
     }
     
-    void scanner_t::save_char(char c)
+    /// read up to the char at the position as read_char would, a run at a time.
+    void scanner_t::skip_to(const char* position)
     {
-        m_token.value.append(c);
+        m_column += int(position - m_position) + 1;
+        m_current = *position;
+        m_position = position + 1;
     }
     
-    void scanner_t::save_and_read_char()
+    /// where the current char is in the source.
+    u32_t scanner_t::offset() const
     {
-        this->save_char(m_current);
-        this->read_char();
+        return u32_t(m_position - 1 - m_source);
     }
     
     bool scanner_t::check_char(const char* charset)
@@ -89,16 +89,29 @@ namespace eokas
             "continue", "return", "true", "false", ",", ";", ":", "?", "@", "#", "$", "+", "-", "*", "/", "%", "^", "~", "(", ")", "[", "]", "{", "}", "&", "&&", "|", "||", "=", "==", "!", "!=", ">",
             ">=", "<", "<=", ">|", "|<", ".", "..", "...", "<b-int>", "<x-int>", "<d-int>", "<float>", "<string>", "<identifier>", "<eos>"};
         
+        /**
+         * A token is a span of the source, which outlives it, and is only copied into
+         * a string when the parser asks for its value. A string literal spans what is
+         * between its quotes, the escapes are decoded by value().
+         */
         token_type type;
-        String value;
+        const char* source;
+        u32_t offset;
+        u32_t length;
+        i32_t line;
+        i32_t column;
         
         token_t();
         
         const char* const name() const;
         
-        bool infer(token_type default_type);
+        const char* text() const;
+        
+        String value() const;
         
         void clear();
+        
+        static token_type keyword(const char* str, size_t len);
     };
     
     class scanner_t
@@ -128,6 +141,8 @@ namespace eokas
     private:
         void scan();
         
+        void scan_token();
+        
         void scan_number();
         
         void scan_string(char delimiter);
@@ -142,14 +157,15 @@ namespace eokas
         
         void read_char();
         
-        void save_char(char c);
+        void skip_to(const char* position);
         
-        void save_and_read_char();
+        u32_t offset() const;
         
         bool check_char(const char* charset);
     
     private:
         const char* m_source;
+        const char* m_end;
         const char* m_position;
         char m_current;
         token_t m_token;
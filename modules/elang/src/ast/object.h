@@ -11,7 +11,7 @@ namespace eokas
 		ast_node_func_def_t* func;
 		ast_scope_t* parent;
 		std::list<ast_scope_t*> children;
-		std::map<String, ast_node_symbol_def_t*> symbols;
+		std::unordered_map<Symbol, ast_node_symbol_def_t*> symbols;
 
 	public:
 		ast_scope_t(ast_node_func_def_t* func, ast_scope_t* parent)
@@ -36,9 +36,13 @@ namespace eokas
 		
 		ast_node_symbol_def_t* get_symbol(const String& name, bool lookup = true)
 		{
+			Symbol key = Symbol::find(name);
+			if(key.isNull())
+				return nullptr;
+
 			if(!lookup)
 			{
-				auto iter = this->symbols.find(name);
+				auto iter = this->symbols.find(key);
 				if(iter != this->symbols.end())
 					return iter->second;
 				return nullptr;
@@ -46,7 +50,7 @@ namespace eokas
 
 			for (auto scope = this; scope != nullptr; scope = scope->parent)
 			{
-				auto iter = scope->symbols.find(name);
+				auto iter = scope->symbols.find(key);
 				if(iter != scope->symbols.end())
 					return iter->second;
 			}
@@ -56,7 +60,7 @@ namespace eokas
 
 		void set_symbol(const String& name, ast_node_symbol_def_t* symbol)
 		{
-			this->symbols.insert(std::make_pair(name, symbol));
+			this->symbols.insert(std::make_pair(Symbol(name), symbol));
 		}
 	};
 }
@@ -6,12 +6,36 @@
 
 namespace eokas {
 
+    enum class omis_opt_level_t {
+        O0, O1, O2, O3, Os
+    };
+
+    /// how a module is optimized and lowered to machine code.
+    struct omis_compile_options_t {
+        omis_opt_level_t opt_level = omis_opt_level_t::O0;
+        /// target the host cpu and its features instead of a generic one.
+        bool native = false;
+    };
+
+    /// milliseconds spent in each phase of the last jit/aot, the lazy jit
+    /// compiles functions on their first call so run includes their codegen.
+    struct omis_compile_stats_t {
+        double optimize = 0;
+        double codegen = 0;
+        double run = 0;
+        int64_t result = 0;
+    };
+
     struct omis_bridge_t {
         virtual ~omis_bridge_t() = default;
 
         virtual omis_handle_t make_module(const String& name) = 0;
         virtual void drop_module(omis_handle_t mod) = 0;
         virtual String dump_module(omis_handle_t mod) = 0;
+        /// write the module as bitcode, with what it uses of other modules declared in it.
+        virtual bool save_module(omis_handle_t mod, const String& path) = 0;
+        /// read a module saved by save_module, nullptr if it is missing or unreadable.
+        virtual omis_handle_t load_module(const String& name, const String& path) = 0;
 
         virtual omis_handle_t type_void() = 0;
         virtual omis_handle_t type_i8() = 0;
@@ -27,7 +51,9 @@ namespace eokas {
         virtual omis_handle_t type_bool() = 0;
         virtual omis_handle_t type_bytes() = 0;
         virtual omis_handle_t type_pointer(omis_handle_t type) = 0;
-        virtual omis_handle_t type_func(omis_handle_t ret, const std::vector<omis_handle_t>& args, bool varg) = 0;
+        virtual omis_handle_t type_func(omis_handle_t ret, const omis_handle_list_t& args, bool varg) = 0;
+        /// lanes values of the element type, a simd register of the target where one fits.
+        virtual omis_handle_t type_vector(omis_handle_t element, uint32_t lanes) = 0;
         virtual bool is_type_void(omis_handle_t type) = 0;
         virtual bool is_type_i8(omis_handle_t type) = 0;
         virtual bool is_type_i16(omis_handle_t type) = 0;
@@ -40,7 +66,13 @@ namespace eokas {
         virtual bool is_type_func(omis_handle_t type) = 0;
         virtual bool is_type_array(omis_handle_t type) = 0;
         virtual bool is_type_struct(omis_handle_t type) = 0;
+        virtual bool is_type_pointer(omis_handle_t type) = 0;
+        virtual bool is_type_vector(omis_handle_t type) = 0;
+        virtual uint32_t get_vector_lanes(omis_handle_t type) = 0;
+        virtual omis_handle_t get_ptr_element_type(omis_handle_t type) = 0;
 		virtual String get_type_name(omis_handle_t type) = 0;
+        /// the type get_type_name names, nullptr if the name does not tell enough to rebuild it.
+        virtual omis_handle_t find_type(const String& name) = 0;
         virtual omis_handle_t get_type_size(omis_handle_t type) = 0;
         virtual bool can_losslessly_cast(omis_handle_t a, omis_handle_t b) = 0;
 		
@@ -93,15 +125,35 @@ namespace eokas {
         virtual omis_handle_t jump(omis_handle_t pos) = 0;
         virtual omis_handle_t jump_cond(omis_handle_t cond, omis_handle_t branch_true, omis_handle_t branch_false) = 0;
         virtual omis_handle_t phi(omis_handle_t type, const std::map<omis_handle_t, omis_handle_t>& incomings) = 0;
-        virtual omis_handle_t call(omis_handle_t func, const std::vector<omis_handle_t>& args) = 0;
+        /// a phi without incomings at the start of the block, whether or not it is the active one.
+        virtual omis_handle_t block_phi(omis_handle_t block, omis_handle_t type) = 0;
+        virtual void add_incoming(omis_handle_t phi, omis_handle_t value, omis_handle_t block) = 0;
+        /// every use of value becomes a use of with, and the instruction of value is deleted.
+        virtual void replace_value(omis_handle_t value, omis_handle_t with) = 0;
+        /// delete unreachable blocks, dropped gets every handle that is no longer valid.
+        virtual void drop_blocks(const omis_handle_list_t& blocks, omis_handle_list_t& dropped) = 0;
+        /// the call calls func instead, which takes the same arguments, or is deleted when func is nullptr.
+        virtual void retarget_call(omis_handle_t call, omis_handle_t func) = 0;
+        /// the call, which returns the memory of count values of type, becomes a slot in the frame of its function.
+        virtual void stack_alloc(omis_handle_t call, omis_handle_t type, omis_handle_t count) = 0;
+        /// a call at the start of the block, or before its terminator, whether or not it is the active one.
+        virtual omis_handle_t block_call(omis_handle_t block, omis_handle_t func, const omis_handle_list_t& args, bool front) = 0;
+        virtual omis_handle_t call(omis_handle_t func, const omis_handle_list_t& args) = 0;
         virtual omis_handle_t ret(omis_handle_t value = nullptr) = 0;
         virtual omis_handle_t bitcast(omis_handle_t value, omis_handle_t type) = 0;
+        /// the vector with its lane at index set to value, which is converted to the type of the lanes.
+        virtual omis_handle_t insert_element(omis_handle_t vec, omis_handle_t value, omis_handle_t index) = 0;
+        virtual omis_handle_t extract_element(omis_handle_t vec, omis_handle_t index) = 0;
 
         virtual omis_handle_t get_ptr_val(omis_handle_t ptr) = 0;
         virtual omis_handle_t get_ptr_ref(omis_handle_t ptr) = 0;
 		
-        virtual bool jit(omis_handle_t module) = 0;
-        virtual bool aot(omis_handle_t module) = 0;
+        virtual bool jit(omis_handle_t module, const omis_handle_list_t& imports, const omis_compile_options_t& options, omis_compile_stats_t& stats) = 0;
+        /// address of a function of the module, compiled with its imports in the jit session.
+        virtual void* jit_symbol(omis_handle_t module, const omis_handle_list_t& imports, const String& name, const omis_compile_options_t& options) = 0;
+        virtual bool aot(omis_handle_t module, const omis_compile_options_t& options, omis_compile_stats_t& stats) = 0;
+        /// compile the modules into one object and write it as a static library.
+        virtual bool archive(const omis_handle_list_t& modules, const String& path, const omis_compile_options_t& options, omis_compile_stats_t& stats) = 0;
     };
 }
 
@@ -3,19 +3,24 @@
 #include "./model.h"
 #include "./bridge.h"
 #include "./llvm/llvm.h"
+#include "./vm/vm.h"
 #include "./x-module-core.h"
 #include "./x-module-cstd.h"
 
 namespace eokas {
-    omis_context_t::omis_context_t()
-        : bridge(nullptr)
+    omis_context_t::omis_context_t(omis_backend_t backend)
+        : backend(backend)
+        , bridge(nullptr)
         , modules() {
-        bridge = llvm_init();
+        bridge = backend == omis_backend_t::TIERED ? vm_init() : llvm_init();
     }
 
     omis_context_t::~omis_context_t() {
         _DeleteMap(this->modules);
-        llvm_quit(this->bridge);
+        if(this->backend == omis_backend_t::TIERED)
+            vm_quit(this->bridge);
+        else
+            llvm_quit(this->bridge);
     }
 
     omis_bridge_t* omis_context_t::get_bridge() {
@@ -62,11 +67,32 @@ namespace eokas {
         return true;
     }
 
-    bool omis_context_t::jit(eokas::omis_module_t *mod) {
-        return bridge->jit(mod->get_handle());
+    bool omis_context_t::jit(eokas::omis_module_t *mod, const omis_compile_options_t& options, omis_compile_stats_t& stats) {
+        // imported modules, dependencies first.
+        omis_handle_list_t imports;
+        HashSet<omis_module_t*> visited;
+        std::function<void(omis_module_t*)> collect = [&](omis_module_t* target) {
+            for(auto& dep : target->get_dependencies()) {
+                if(dep.second == mod || !visited.insert(dep.second).second)
+                    continue;
+                collect(dep.second);
+                imports.push_back(dep.second->get_handle());
+            }
+        };
+        collect(mod);
+
+        return bridge->jit(mod->get_handle(), imports, options, stats);
+    }
+
+    bool omis_context_t::aot(eokas::omis_module_t *mod, const omis_compile_options_t& options, omis_compile_stats_t& stats) {
+        return bridge->aot(mod->get_handle(), options, stats);
     }
 
-    bool omis_context_t::aot(eokas::omis_module_t *mod) {
-        return bridge->aot(mod->get_handle());
+    bool omis_context_t::archive(const std::vector<omis_module_t*>& mods, const String& path, const omis_compile_options_t& options, omis_compile_stats_t& stats) {
+        omis_handle_list_t handles;
+        for(auto* mod : mods) {
+            handles.push_back(mod->get_handle());
+        }
+        return bridge->archive(handles, path, options, stats);
     }
 }
@@ -5,9 +5,14 @@
 #include "./header.h"
 
 namespace eokas {
+    /// LLVM jits every script, TIERED interprets it first and jits only the hot functions.
+    enum class omis_backend_t {
+        LLVM, TIERED
+    };
+
     class omis_context_t {
     public:
-        omis_context_t();
+        explicit omis_context_t(omis_backend_t backend = omis_backend_t::LLVM);
         virtual ~omis_context_t();
 
         omis_bridge_t* get_bridge();
@@ -18,10 +23,12 @@ namespace eokas {
 
         bool load_default_modules();
 
-        bool jit(omis_module_t* mod);
-        bool aot(omis_module_t* mod);
+        bool jit(omis_module_t* mod, const omis_compile_options_t& options, omis_compile_stats_t& stats);
+        bool aot(omis_module_t* mod, const omis_compile_options_t& options, omis_compile_stats_t& stats);
+        bool archive(const std::vector<omis_module_t*>& mods, const String& path, const omis_compile_options_t& options, omis_compile_stats_t& stats);
 
     private:
+        omis_backend_t backend;
         omis_bridge_t* bridge;
         std::map<String, omis_module_t*> modules;
     };
@@ -6,8 +6,12 @@
 
 namespace eokas {
     using omis_handle_t = void*;
+    /// argument lists handed to the bridge, calls rarely take more than 8.
+    using omis_handle_list_t = SmallVector<omis_handle_t, 8>;
 
     struct omis_bridge_t;
+    struct omis_compile_options_t;
+    struct omis_compile_stats_t;
 
     class omis_context_t;
     class omis_module_t;
@@ -19,6 +23,7 @@ namespace eokas {
     class omis_struct_t;
 
     class omis_value_t;
+    class omis_variable_t;
 
     template<typename T>
     using omis_lambda_predicate_t = std::function<bool(const T&)>;
@@ -2,6 +2,7 @@
 
 #include "../bridge.h"
 #include "../model.h"
+#include "../runtime.h"
 
 #include <sstream>
 
@@ -21,18 +22,35 @@
 #include <llvm/IR/Function.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/CFG.h>
 
 #include <llvm/Target/TargetMachine.h>
 #include <llvm/Target/TargetOptions.h>
+#include <llvm/MC/SubtargetFeature.h>
+#include <llvm/Passes/PassBuilder.h>
 
 #include <llvm/Support/FileSystem.h>
 #include <llvm/Support/Host.h>
 #include <llvm/Support/TargetRegistry.h>
 #include <llvm/Support/TargetSelect.h>
 
-#include <llvm/ExecutionEngine/MCJIT.h>
-#include <llvm/ExecutionEngine/ExecutionEngine.h>
-#include <llvm/ExecutionEngine/GenericValue.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+
+#include <llvm/Linker/Linker.h>
+#include <llvm/Object/ArchiveWriter.h>
+
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/Support/MemoryBuffer.h>
+
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
 
 namespace eokas
 {
@@ -44,9 +62,18 @@ namespace eokas
 #define _Ins(handle) ((llvm::Instruction*)handle)
 
     struct llvm_bridge_t :public omis_bridge_t {
-        llvm::LLVMContext context;
+        // shared with the jit session, which locks it while it compiles.
+        llvm::orc::ThreadSafeContext tsc;
+        llvm::LLVMContext& context;
         llvm::IRBuilder<> IR;
 
+        // One lazy jit session per bridge, every module handed to jit() is added
+        // once and the imported ones resolve against each other in it.
+        std::unique_ptr<llvm::orc::LLLazyJIT> session;
+        omis_compile_options_t session_options;
+        HashSet<omis_handle_t> session_modules;
+        std::atomic<i64_t> session_optimize_time;
+
         llvm::Type* ty_void;
         llvm::Type* ty_i8;
         llvm::Type* ty_i16;
@@ -63,7 +90,14 @@ namespace eokas
         llvm::Type* ty_void_ptr;
 
         llvm_bridge_t()
-            : omis_bridge_t(), context(), IR(context) {
+            : omis_bridge_t()
+            , tsc(std::make_unique<llvm::LLVMContext>())
+            , context(*tsc.getContext())
+            , IR(context)
+            , session()
+            , session_options()
+            , session_modules()
+            , session_optimize_time(0) {
             ty_void = llvm::Type::getVoidTy(context);
             ty_i8 = llvm::Type::getInt8Ty(context);
             ty_i16 = llvm::Type::getInt16Ty(context);
@@ -102,6 +136,37 @@ namespace eokas
             return ret;
         }
 
+        virtual bool save_module(omis_handle_t mod, const String& path) override {
+            // the coder refers to the symbols of other modules as they are, the
+            // bitcode writer only knows about the ones of the module it writes.
+            auto clone = llvm::CloneModule(*_Mod(mod));
+            localize_imports(clone.get());
+
+            std::error_code EC;
+            llvm::raw_fd_ostream out(path.cstr(), EC, llvm::sys::fs::OF_None);
+            if(EC) {
+                llvm::errs() << "Could not open file: " << EC.message() << "\n";
+                return false;
+            }
+            llvm::WriteBitcodeToFile(*clone, out);
+            out.flush();
+            return !out.has_error();
+        }
+
+        virtual omis_handle_t load_module(const String& name, const String& path) override {
+            auto buffer = llvm::MemoryBuffer::getFile(path.cstr());
+            if(!buffer)
+                return nullptr;
+
+            auto module = llvm::parseBitcodeFile(buffer.get()->getMemBufferRef(), context);
+            if(!module) {
+                llvm::consumeError(module.takeError());
+                return nullptr;
+            }
+            module.get()->setModuleIdentifier(name.cstr());
+            return module.get().release();
+        }
+
         virtual omis_handle_t type_void() override {
             return ty_void;
         }
@@ -158,9 +223,9 @@ namespace eokas
             return _Ty(type)->getPointerTo();
         }
 
-        virtual omis_handle_t type_func(omis_handle_t ret, const std::vector<omis_handle_t>& args, bool varg) override {
+        virtual omis_handle_t type_func(omis_handle_t ret, const omis_handle_list_t& args, bool varg) override {
             llvm::Type* ret_type = _Ty(ret);
-            std::vector<llvm::Type*> args_type;
+            llvm::SmallVector<llvm::Type*, 8> args_type;
             for(auto& arg : args) {
                 args_type.push_back(_Ty(arg));
             }
@@ -168,6 +233,10 @@ namespace eokas
             return funcType;
         }
 
+        virtual omis_handle_t type_vector(omis_handle_t element, uint32_t lanes) override {
+            return llvm::FixedVectorType::get(_Ty(element), lanes);
+        }
+
         virtual bool is_type_void(omis_handle_t type) override {
             return _Ty(type)->isVoidTy();
         }
@@ -216,6 +285,22 @@ namespace eokas
         virtual bool is_type_struct(omis_handle_t type) override {
             return _Ty(type)->isStructTy();
         }
+
+        virtual bool is_type_pointer(omis_handle_t type) override {
+            return _Ty(type)->isPointerTy();
+        }
+
+        virtual omis_handle_t get_ptr_element_type(omis_handle_t type) override {
+            return _Ty(type)->getPointerElementType();
+        }
+
+        virtual bool is_type_vector(omis_handle_t type) override {
+            return llvm::isa<llvm::FixedVectorType>(_Ty(type));
+        }
+
+        virtual uint32_t get_vector_lanes(omis_handle_t type) override {
+            return llvm::cast<llvm::FixedVectorType>(_Ty(type))->getNumElements();
+        }
 		
 		virtual String get_type_name(omis_handle_t type) override {
 			auto ty = _Ty(type);
@@ -231,6 +316,10 @@ namespace eokas
 				auto eleTy = ty->getPointerElementType();
 				return String::format("Pointer<%s>", this->get_type_name(eleTy).cstr());
 			}
+			if(auto vecTy = llvm::dyn_cast<llvm::FixedVectorType>(ty)) {
+				auto eleTy = vecTy->getElementType();
+				return String::format("%sx%u", this->get_type_name(eleTy).cstr(), vecTy->getNumElements());
+			}
 			if(ty->isArrayTy()) {
 				auto eleTy = ty->getArrayElementType();
 				return String::format("Array<%s>", this->get_type_name(eleTy).cstr());
@@ -256,6 +345,41 @@ namespace eokas
 			return "Unknown";
 		}
 
+        virtual omis_handle_t find_type(const String& name) override {
+            static const std::map<String, llvm::Type* llvm_bridge_t::*> primitives = {
+                {"void", &llvm_bridge_t::ty_void},
+                {"bool", &llvm_bridge_t::ty_bool},
+                {"i8", &llvm_bridge_t::ty_i8},
+                {"i16", &llvm_bridge_t::ty_i16},
+                {"i32", &llvm_bridge_t::ty_i32},
+                {"i64", &llvm_bridge_t::ty_i64},
+                {"f32", &llvm_bridge_t::ty_f32},
+                {"f64", &llvm_bridge_t::ty_f64},
+            };
+            auto iter = primitives.find(name);
+            if(iter != primitives.end())
+                return this->*(iter->second);
+
+            // a vector is named by its lanes, f32x4.
+            for(auto& primitive : primitives) {
+                auto prefix = primitive.first + "x";
+                if(name.startsWith(prefix) && name.length() > prefix.length()) {
+                    auto lanes = String::stringToValue<u32_t>(name.substr(prefix.length()));
+                    return lanes > 0 ? llvm::FixedVectorType::get(this->*(primitive.second), lanes) : nullptr;
+                }
+            }
+
+            if(name.startsWith("Pointer<") && name.endsWith(">")) {
+                auto* eleTy = _Ty(this->find_type(name.substr(8, name.length() - 9)));
+                return eleTy != nullptr ? eleTy->getPointerTo() : nullptr;
+            }
+
+            // arrays and functions are named without their lengths and arguments.
+            if(name.startsWith("Array<") || name.startsWith("func(") || name == "Unknown")
+                return nullptr;
+            return llvm::StructType::getTypeByName(context, name.cstr());
+        }
+
         virtual omis_handle_t get_type_size(omis_handle_t type) override {
             llvm::Constant* size = llvm::ConstantExpr::getSizeOf(_Ty(type));
             return size;
@@ -299,15 +423,7 @@ namespace eokas
         }
 
         virtual omis_handle_t get_default_value(omis_handle_t type) override {
-            auto ty = _Ty(type);
-            if (ty->isIntegerTy()) {
-                auto bits = ty->getIntegerBitWidth();
-                return llvm::ConstantInt::get(context, llvm::APInt(bits, 0));
-            }
-            if (ty->isFloatingPointTy()) {
-                return llvm::ConstantFP::get(context, llvm::APFloat(0.0f));
-            }
-            return llvm::ConstantPointerNull::get(llvm::Type::getVoidTy(context)->getPointerTo());
+            return llvm::Constant::getNullValue(_Ty(type));
         }
 
         virtual omis_handle_t value_integer(uint64_t val, uint32_t bits) override {
@@ -389,35 +505,81 @@ namespace eokas
             auto rhs = _Val(a);
             auto rtype = rhs->getType();
 
-            if (rtype->isIntegerTy())
+            if (rtype->isIntOrIntVectorTy())
                 return IR.CreateNeg(rhs);
 
-            if (rtype->isFloatingPointTy())
+            if (rtype->isFPOrFPVectorTy())
                 return IR.CreateFNeg(rhs);
 
             printf("Type of RHS is invalid.\n");
             return nullptr;
         }
 
+        /// an int or float converted to another int or float type, nullptr for anything else.
+        llvm::Value* cast_scalar(llvm::Value* value, llvm::Type* type) {
+            auto from = value->getType();
+            if (from == type)
+                return value;
+            if (from->isIntegerTy() && type->isIntegerTy())
+                return IR.CreateSExtOrTrunc(value, type);
+            if (from->isIntegerTy() && type->isFloatingPointTy())
+                return IR.CreateSIToFP(value, type);
+            if (from->isFloatingPointTy() && type->isFloatingPointTy())
+                return IR.CreateFPCast(value, type);
+            if (from->isFloatingPointTy() && type->isIntegerTy())
+                return IR.CreateFPToSI(value, type);
+            return nullptr;
+        }
+
+        /// the value as the vector type, a scalar fills every lane.
+        llvm::Value* cast_lanes(llvm::Value* value, llvm::Type* type) {
+            if (value->getType() == type)
+                return value;
+            auto vecType = llvm::cast<llvm::FixedVectorType>(type);
+            auto lane = this->cast_scalar(value, vecType->getElementType());
+            if (lane == nullptr)
+                return nullptr;
+            return IR.CreateVectorSplat(vecType->getNumElements(), lane);
+        }
+
+        /// both sides as the vector type of either one, null if they do not fit together.
+        llvm::Type* splat_lanes(llvm::Value*& lhs, llvm::Value*& rhs) {
+            auto type = lhs->getType()->isVectorTy() ? lhs->getType() : rhs->getType();
+            lhs = this->cast_lanes(lhs, type);
+            rhs = this->cast_lanes(rhs, type);
+            return lhs != nullptr && rhs != nullptr ? type : nullptr;
+        }
+
+        /// a lane read gives a float next to the double of a literal, both go as the wider.
+        void widen_floats(llvm::Value*& lhs, llvm::Value*& rhs) {
+            auto ltype = lhs->getType();
+            auto rtype = rhs->getType();
+            if (ltype->getPrimitiveSizeInBits() < rtype->getPrimitiveSizeInBits())
+                lhs = IR.CreateFPExt(lhs, rtype);
+            else if (rtype->getPrimitiveSizeInBits() < ltype->getPrimitiveSizeInBits())
+                rhs = IR.CreateFPExt(rhs, ltype);
+        }
+
         enum class ArithOp {ADD, SUB, MUL, DIV, MOD};
         omis_handle_t arith(ArithOp op, omis_handle_t a, omis_handle_t b) {
             using ins_type_t = std::function<llvm::Value *(llvm::IRBuilder<> &IR, llvm::Value *LHS, llvm::Value *RHS)>;
-            using func_type_t = llvm::Value *(llvm::IRBuilder<>::*)(llvm::Value *LHS, llvm::Value *RHS);
 
+            // The Create* members take a name and flags after the operands, call them
+            // through lambdas rather than casting them to a two operand signature.
             static std::map<ArithOp, ins_type_t> ins_i = {
-                {ArithOp::ADD, (func_type_t) &llvm::IRBuilder<>::CreateAdd},
-                {ArithOp::SUB, (func_type_t) &llvm::IRBuilder<>::CreateSub},
-                {ArithOp::MUL, (func_type_t) &llvm::IRBuilder<>::CreateMul},
-                {ArithOp::DIV, (func_type_t) &llvm::IRBuilder<>::CreateSDiv},
-                {ArithOp::MOD, (func_type_t) &llvm::IRBuilder<>::CreateSRem},
+                {ArithOp::ADD, [](llvm::IRBuilder<> &IR, llvm::Value *LHS, llvm::Value *RHS) { return IR.CreateAdd(LHS, RHS); }},
+                {ArithOp::SUB, [](llvm::IRBuilder<> &IR, llvm::Value *LHS, llvm::Value *RHS) { return IR.CreateSub(LHS, RHS); }},
+                {ArithOp::MUL, [](llvm::IRBuilder<> &IR, llvm::Value *LHS, llvm::Value *RHS) { return IR.CreateMul(LHS, RHS); }},
+                {ArithOp::DIV, [](llvm::IRBuilder<> &IR, llvm::Value *LHS, llvm::Value *RHS) { return IR.CreateSDiv(LHS, RHS); }},
+                {ArithOp::MOD, [](llvm::IRBuilder<> &IR, llvm::Value *LHS, llvm::Value *RHS) { return IR.CreateSRem(LHS, RHS); }},
             };
 
             static std::map<ArithOp, ins_type_t> ins_f = {
-                {ArithOp::ADD, (func_type_t) &llvm::IRBuilder<>::CreateFAdd},
-                {ArithOp::SUB, (func_type_t) &llvm::IRBuilder<>::CreateFSub},
-                {ArithOp::MUL, (func_type_t) &llvm::IRBuilder<>::CreateFMul},
-                {ArithOp::DIV, (func_type_t) &llvm::IRBuilder<>::CreateFDiv},
-                {ArithOp::MOD, (func_type_t) &llvm::IRBuilder<>::CreateFRem},
+                {ArithOp::ADD, [](llvm::IRBuilder<> &IR, llvm::Value *LHS, llvm::Value *RHS) { return IR.CreateFAdd(LHS, RHS); }},
+                {ArithOp::SUB, [](llvm::IRBuilder<> &IR, llvm::Value *LHS, llvm::Value *RHS) { return IR.CreateFSub(LHS, RHS); }},
+                {ArithOp::MUL, [](llvm::IRBuilder<> &IR, llvm::Value *LHS, llvm::Value *RHS) { return IR.CreateFMul(LHS, RHS); }},
+                {ArithOp::DIV, [](llvm::IRBuilder<> &IR, llvm::Value *LHS, llvm::Value *RHS) { return IR.CreateFDiv(LHS, RHS); }},
+                {ArithOp::MOD, [](llvm::IRBuilder<> &IR, llvm::Value *LHS, llvm::Value *RHS) { return IR.CreateFRem(LHS, RHS); }},
             };
 
             auto lhs = _Val(a);
@@ -425,19 +587,31 @@ namespace eokas
             auto ltype = lhs->getType();
             auto rtype = rhs->getType();
 
+            // lane by lane, a scalar on either side is converted and splat.
+            if (ltype->isVectorTy() || rtype->isVectorTy()) {
+                auto type = this->splat_lanes(lhs, rhs);
+                if (type == nullptr) {
+                    printf("Type of LHS or RHS is invalid.\n");
+                    return nullptr;
+                }
+                return type->isIntOrIntVectorTy() ? ins_i[op](IR, lhs, rhs) : ins_f[op](IR, lhs, rhs);
+            }
+
             if (ltype->isIntegerTy() && rtype->isIntegerTy())
                 return ins_i[op](IR, lhs, rhs);
 
-            if (ltype->isFloatingPointTy() && rtype->isFloatingPointTy())
+            if (ltype->isFloatingPointTy() && rtype->isFloatingPointTy()) {
+                this->widen_floats(lhs, rhs);
                 return ins_f[op](IR, lhs, rhs);
+            }
 
             if (ltype->isIntegerTy() && rtype->isFloatingPointTy()) {
-                lhs = IR.CreateSIToFP(lhs, llvm::Type::getDoubleTy(context));
+                lhs = IR.CreateSIToFP(lhs, rtype);
                 return ins_f[op](IR, lhs, rhs);
             }
 
             if (ltype->isFloatingPointTy() && rtype->isIntegerTy()) {
-                rhs = IR.CreateSIToFP(rhs, llvm::Type::getDoubleTy(context));
+                rhs = IR.CreateSIToFP(rhs, ltype);
                 return ins_f[op](IR, lhs, rhs);
             }
 
@@ -490,6 +664,16 @@ namespace eokas
             auto ltype = lhs->getType();
             auto rtype = rhs->getType();
 
+            // lane by lane into a vector of bools.
+            if (ltype->isVectorTy() || rtype->isVectorTy()) {
+                auto type = this->splat_lanes(lhs, rhs);
+                if (type == nullptr) {
+                    printf("Type of LHS or RHS is invalid.\n");
+                    return nullptr;
+                }
+                return IR.CreateCmp(type->isIntOrIntVectorTy() ? op_i[op] : op_f[op], lhs, rhs, "", nullptr);
+            }
+
             if (ltype->isIntegerTy() && rtype->isIntegerTy())
                 return IR.CreateCmp(op_i[op], lhs, rhs, "", nullptr);
 
@@ -499,16 +683,18 @@ namespace eokas
                 return IR.CreateCmp(op_i[op], lhs, rhs, "", nullptr);
             }
 
-            if (ltype->isFloatingPointTy() && rtype->isFloatingPointTy())
+            if (ltype->isFloatingPointTy() && rtype->isFloatingPointTy()) {
+                this->widen_floats(lhs, rhs);
                 return IR.CreateCmp(op_f[op], lhs, rhs, "", nullptr);
+            }
 
             if (ltype->isIntegerTy() && rtype->isFloatingPointTy()) {
-                lhs = IR.CreateSIToFP(lhs, llvm::Type::getDoubleTy(context));
+                lhs = IR.CreateSIToFP(lhs, rtype);
                 return IR.CreateCmp(op_f[op], lhs, rhs, "", nullptr);
             }
 
             if (ltype->isFloatingPointTy() && rtype->isIntegerTy()) {
-                rhs = IR.CreateSIToFP(rhs, llvm::Type::getDoubleTy(context));
+                rhs = IR.CreateSIToFP(rhs, ltype);
                 return IR.CreateCmp(op_f[op], lhs, rhs, "", nullptr);
             }
 
@@ -544,7 +730,7 @@ namespace eokas
             auto rhs = _Val(a);
             auto rtype = rhs->getType();
 
-            if (rtype->isIntegerTy() && rtype->getIntegerBitWidth() == 1)
+            if (rtype->isIntOrIntVectorTy() && rtype->getScalarSizeInBits() == 1)
                 return IR.CreateNot(rhs);
 
             printf("Type of RHS is invalid.\n");
@@ -583,11 +769,8 @@ namespace eokas
             auto rhs _Val(a);
             auto rtype = rhs->getType();
 
-            if (rtype->isIntegerTy()) {
-                auto bits = rtype->getIntegerBitWidth();
-                auto mask = llvm::ConstantInt::get(rtype, llvm::APInt(bits, 0xFFFFFFFF));
-                return IR.CreateXor(rhs, mask);
-            }
+            if (rtype->isIntOrIntVectorTy())
+                return IR.CreateNot(rhs);
 
             printf("Type of RHS is invalid.\n");
             return nullptr;
@@ -599,7 +782,11 @@ namespace eokas
             auto ltype = lhs->getType();
             auto rtype = rhs->getType();
 
-            if (ltype->isIntegerTy() && rtype->isIntegerTy()) {
+            if (ltype->isIntOrIntVectorTy() && rtype->isIntOrIntVectorTy()) {
+                if ((ltype->isVectorTy() || rtype->isVectorTy()) && this->splat_lanes(lhs, rhs) == nullptr) {
+                    printf("Type of LHS or RHS is invalid.\n");
+                    return nullptr;
+                }
                 return IR.CreateAnd(lhs, rhs);
             }
 
@@ -613,7 +800,11 @@ namespace eokas
             auto ltype = lhs->getType();
             auto rtype = rhs->getType();
 
-            if (ltype->isIntegerTy() && rtype->isIntegerTy()) {
+            if (ltype->isIntOrIntVectorTy() && rtype->isIntOrIntVectorTy()) {
+                if ((ltype->isVectorTy() || rtype->isVectorTy()) && this->splat_lanes(lhs, rhs) == nullptr) {
+                    printf("Type of LHS or RHS is invalid.\n");
+                    return nullptr;
+                }
                 return IR.CreateOr(lhs, rhs);
             }
 
@@ -627,7 +818,11 @@ namespace eokas
             auto ltype = lhs->getType();
             auto rtype = rhs->getType();
 
-            if (ltype->isIntegerTy() && rtype->isIntegerTy()) {
+            if (ltype->isIntOrIntVectorTy() && rtype->isIntOrIntVectorTy()) {
+                if ((ltype->isVectorTy() || rtype->isVectorTy()) && this->splat_lanes(lhs, rhs) == nullptr) {
+                    printf("Type of LHS or RHS is invalid.\n");
+                    return nullptr;
+                }
                 return IR.CreateXor(lhs, rhs);
             }
 
@@ -641,7 +836,11 @@ namespace eokas
             auto ltype = lhs->getType();
             auto rtype = rhs->getType();
 
-            if (ltype->isIntegerTy() && rtype->isIntegerTy()) {
+            if (ltype->isIntOrIntVectorTy() && rtype->isIntOrIntVectorTy()) {
+                if ((ltype->isVectorTy() || rtype->isVectorTy()) && this->splat_lanes(lhs, rhs) == nullptr) {
+                    printf("Type of LHS or RHS is invalid.\n");
+                    return nullptr;
+                }
                 return IR.CreateShl(lhs, rhs);
             }
 
@@ -655,7 +854,11 @@ namespace eokas
             auto ltype = lhs->getType();
             auto rtype = rhs->getType();
 
-            if (ltype->isIntegerTy() && rtype->isIntegerTy()) {
+            if (ltype->isIntOrIntVectorTy() && rtype->isIntOrIntVectorTy()) {
+                if ((ltype->isVectorTy() || rtype->isVectorTy()) && this->splat_lanes(lhs, rhs) == nullptr) {
+                    printf("Type of LHS or RHS is invalid.\n");
+                    return nullptr;
+                }
                 // CreateLShr: 逻辑右移：在左边补 0
                 // CreateShr: 算术右移：在左边补 符号位
                 // 我们采用逻辑右移
@@ -679,10 +882,85 @@ namespace eokas
             for(auto& pair : incomings) {
                 phi->addIncoming(_Val(pair.first), _Block(pair.second));
             }
+            return phi;
+        }
+
+        virtual omis_handle_t block_phi(omis_handle_t block, omis_handle_t type) override {
+            auto blk = _Block(block);
+            if (blk->empty())
+                return llvm::PHINode::Create(_Ty(type), 2, "", blk);
+            return llvm::PHINode::Create(_Ty(type), 2, "", &blk->front());
         }
 
-        virtual omis_handle_t call(omis_handle_t func, const std::vector<omis_handle_t>& args) override {
-            std::vector<llvm::Value*> args_values;
+        virtual void add_incoming(omis_handle_t phi, omis_handle_t value, omis_handle_t block) override {
+            llvm::cast<llvm::PHINode>(_Val(phi))->addIncoming(_Val(value), _Block(block));
+        }
+
+        virtual void replace_value(omis_handle_t value, omis_handle_t with) override {
+            auto val = _Val(value);
+            val->replaceAllUsesWith(_Val(with));
+            if (auto ins = llvm::dyn_cast<llvm::Instruction>(val))
+                ins->eraseFromParent();
+        }
+
+        virtual void drop_blocks(const omis_handle_list_t& blocks, omis_handle_list_t& dropped) override {
+            // the phis of a successor keep a single incoming, the module may still hold them.
+            for (auto& block : blocks) {
+                auto blk = _Block(block);
+                for (auto succ : llvm::successors(blk)) {
+                    succ->removePredecessor(blk, true);
+                }
+                for (auto& ins : *blk) {
+                    dropped.push_back(&ins);
+                }
+                dropped.push_back(blk);
+                if (IR.GetInsertBlock() == blk)
+                    IR.ClearInsertionPoint();
+            }
+            for (auto& block : blocks) {
+                _Block(block)->dropAllReferences();
+            }
+            for (auto& block : blocks) {
+                _Block(block)->eraseFromParent();
+            }
+        }
+
+        virtual void retarget_call(omis_handle_t call, omis_handle_t func) override {
+            auto ins = llvm::cast<llvm::CallInst>(_Val(call));
+            if (func == nullptr)
+                ins->eraseFromParent();
+            else
+                ins->setCalledFunction(_Func(func));
+        }
+
+        virtual void stack_alloc(omis_handle_t call, omis_handle_t type, omis_handle_t count) override {
+            // in the entry block the slot is static, whichever block made the value.
+            auto ins = llvm::cast<llvm::CallInst>(_Val(call));
+            auto& entry = ins->getFunction()->getEntryBlock();
+            auto slot = new llvm::AllocaInst(_Ty(type), 0, count != nullptr ? _Val(count) : nullptr, "", &*entry.getFirstInsertionPt());
+            auto ptr = new llvm::BitCastInst(slot, ins->getType(), "", ins);
+            ins->replaceAllUsesWith(ptr);
+            ins->eraseFromParent();
+        }
+
+        virtual omis_handle_t block_call(omis_handle_t block, omis_handle_t func, const omis_handle_list_t& args, bool front) override {
+            llvm::SmallVector<llvm::Value*, 8> args_values;
+            for(auto& arg : args) {
+                args_values.push_back(_Val(arg));
+            }
+            auto blk = _Block(block);
+            llvm::IRBuilder<> builder(context);
+            if (front)
+                builder.SetInsertPoint(blk, blk->getFirstInsertionPt());
+            else if (auto tail = blk->getTerminator())
+                builder.SetInsertPoint(tail);
+            else
+                builder.SetInsertPoint(blk);
+            return builder.CreateCall(_Func(func), args_values);
+        }
+
+        virtual omis_handle_t call(omis_handle_t func, const omis_handle_list_t& args) override {
+            llvm::SmallVector<llvm::Value*, 8> args_values;
             for(auto& arg : args) {
                 args_values.push_back(_Val(arg));
             }
@@ -700,6 +978,20 @@ namespace eokas
             return IR.CreateBitCast(_Val(value), _Ty(type));
         }
 
+        virtual omis_handle_t insert_element(omis_handle_t vec, omis_handle_t value, omis_handle_t index) override {
+            auto vector = _Val(vec);
+            auto lane = this->cast_scalar(_Val(value), llvm::cast<llvm::VectorType>(vector->getType())->getElementType());
+            if (lane == nullptr) {
+                printf("Type of the lane is invalid.\n");
+                return nullptr;
+            }
+            return IR.CreateInsertElement(vector, lane, _Val(index));
+        }
+
+        virtual omis_handle_t extract_element(omis_handle_t vec, omis_handle_t index) override {
+            return IR.CreateExtractElement(_Val(vec), _Val(index));
+        }
+
         virtual omis_handle_t get_ptr_val(omis_handle_t ptr) override {
             auto value = _Val(ptr);
             llvm::Type* type = value->getType();
@@ -735,63 +1027,337 @@ namespace eokas
         // virtual omis_handle_t make(omis_handle_t type, omis_handle_t count) = 0;
         // virtual void drop(omis_handle_t ptr) = 0;
 
-        virtual bool jit(omis_handle_t mod) override {
+        virtual bool jit(omis_handle_t mod, const omis_handle_list_t& imports, const omis_compile_options_t& options, omis_compile_stats_t& stats) override {
+            Timer timer;
+            if(!this->prepare_session(mod, imports, options))
+                return false;
+
+            // Only a stub is returned, functions are compiled on their first call
+            // by the compile threads of the session.
+            auto symbol = session->lookup("$main");
+            if(!symbol) {
+                llvm::logAllUnhandledErrors(symbol.takeError(), llvm::errs(), "JIT: ");
+                return false;
+            }
+            auto entry = llvm::jitTargetAddressToFunction<int32_t(*)()>(symbol->getAddress());
+            stats.codegen = timer.elapse() / 1000.0;
+
+            i64_t optimizeTime = session_optimize_time;
+            stats.result = entry();
+            stats.run = timer.elapse() / 1000.0;
+            stats.optimize = (session_optimize_time - optimizeTime) / 1000.0;
+
+            return true;
+        }
+
+        virtual void* jit_symbol(omis_handle_t mod, const omis_handle_list_t& imports, const String& name, const omis_compile_options_t& options) override {
+            if(!this->prepare_session(mod, imports, options))
+                return nullptr;
+
+            auto symbol = session->lookup(name.cstr());
+            if(!symbol) {
+                llvm::logAllUnhandledErrors(symbol.takeError(), llvm::errs(), "JIT: ");
+                return nullptr;
+            }
+            return llvm::jitTargetAddressToPointer<void*>(symbol->getAddress());
+        }
+
+        virtual bool aot(omis_handle_t mod, const omis_compile_options_t& options, omis_compile_stats_t& stats) override {
+            auto filename = "output.o";
+            std::error_code EC;
+            llvm::raw_fd_ostream dest(filename, EC, llvm::sys::fs::OF_None);
+            if(EC)
+            {
+                llvm::errs() << "Could not open file: " << EC.message();
+                return false;
+            }
+
+            auto clone = llvm::CloneModule(*_Mod(mod));
+            define_runtime(clone.get());
+            if(!emit_object(clone.get(), options, dest, stats))
+                return false;
+            dest.flush();
+            return true;
+        }
+
+        /**
+         * The modules are cloned and linked into one object the way the jit session
+         * adds imports, with their $main kept private so that they do not clash.
+         */
+        virtual bool archive(const omis_handle_list_t& mods, const String& path, const omis_compile_options_t& options, omis_compile_stats_t& stats) override {
+            String name = File::fileNameWithoutExtension(path);
+            llvm::Module linked(name.cstr(), context);
+            llvm::Linker linker(linked);
+            for(auto& mod : mods) {
+                auto clone = llvm::CloneModule(*_Mod(mod));
+                localize_imports(clone.get());
+                if(auto* init = clone->getFunction("$main"))
+                    init->setLinkage(llvm::GlobalValue::InternalLinkage);
+                if(linker.linkInModule(std::move(clone))) {
+                    llvm::errs() << "Could not link the module " << _Mod(mod)->getName() << "\n";
+                    return false;
+                }
+            }
+
+            define_runtime(&linked);
+
+            llvm::SmallVector<char, 0> object;
+            llvm::raw_svector_ostream dest(object);
+            if(!emit_object(&linked, options, dest, stats))
+                return false;
+
+            llvm::Triple triple(linked.getTargetTriple());
+            auto kind = triple.isOSDarwin() ? llvm::object::Archive::K_DARWIN : llvm::object::Archive::K_GNU;
+            std::string objectName = (name + ".o").cstr();
+            std::vector<llvm::NewArchiveMember> members;
+            members.emplace_back(llvm::MemoryBufferRef(llvm::StringRef(object.data(), object.size()), objectName));
+            if(auto error = llvm::writeArchive(path.cstr(), members, true, kind, true, false)) {
+                llvm::logAllUnhandledErrors(std::move(error), llvm::errs(), "Archive: ");
+                return false;
+            }
+            return true;
+        }
+
+    private:
+        bool open_session(const omis_compile_options_t& options) {
+            if(session != nullptr && session_options.opt_level == options.opt_level && session_options.native == options.native)
+                return true;
+
             llvm::InitializeNativeTarget();
             llvm::InitializeNativeTargetAsmPrinter();
             llvm::InitializeNativeTargetAsmParser();
 
-            auto* module = _Mod(mod);
+            session.reset();
+            session_modules.clear();
+            session_options = options;
+
+            llvm::orc::JITTargetMachineBuilder builder((llvm::Triple(llvm::sys::getProcessTriple())));
+            if(options.native) {
+                auto host = llvm::orc::JITTargetMachineBuilder::detectHost();
+                if(!host) {
+                    llvm::logAllUnhandledErrors(host.takeError(), llvm::errs(), "JIT: ");
+                    return false;
+                }
+                builder = std::move(*host);
+            }
+            builder.setCodeGenOptLevel(codegen_level(options.opt_level));
+
+            auto jit = llvm::orc::LLLazyJITBuilder()
+                .setJITTargetMachineBuilder(builder)
+                .setNumCompileThreads(std::max(1u, std::thread::hardware_concurrency()))
+                .create();
+            if(!jit) {
+                llvm::logAllUnhandledErrors(jit.takeError(), llvm::errs(), "JIT: ");
+                return false;
+            }
+            session = std::move(*jit);
 
-            auto ee = llvm::EngineBuilder(std::unique_ptr<llvm::Module>(module))
-                    .setEngineKind(llvm::EngineKind::JIT)
-                    .create();
+            // printf, malloc and the other c functions come from the process.
+            auto generator = llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(session->getDataLayout().getGlobalPrefix());
+            if(!generator) {
+                llvm::logAllUnhandledErrors(generator.takeError(), llvm::errs(), "JIT: ");
+                return false;
+            }
+            session->getMainJITDylib().addGenerator(std::move(*generator));
+
+            // the runtime is linked into eokas, whose symbols the process search does not see.
+            llvm::orc::SymbolMap runtime;
+            for(auto& symbol : omis_runtime_symbols()) {
+                auto address = llvm::pointerToJITTargetAddress(symbol.address);
+                runtime[session->mangleAndIntern(symbol.name)] = llvm::JITEvaluatedSymbol(address, llvm::JITSymbolFlags::Exported);
+            }
+            if(auto error = session->getMainJITDylib().define(llvm::orc::absoluteSymbols(std::move(runtime)))) {
+                llvm::logAllUnhandledErrors(std::move(error), llvm::errs(), "JIT: ");
+                return false;
+            }
 
-            ee->finalizeObject();
+            // The lazy layer splits modules per function, so only what is called gets optimized.
+            auto level = options.opt_level;
+            session->getIRTransformLayer().setTransform(
+                [this, builder, level](llvm::orc::ThreadSafeModule tsm, llvm::orc::MaterializationResponsibility&)
+                -> llvm::Expected<llvm::orc::ThreadSafeModule> {
+                    if(level == omis_opt_level_t::O0)
+                        return std::move(tsm);
+                    auto targetMachine = llvm::orc::JITTargetMachineBuilder(builder).createTargetMachine();
+                    if(!targetMachine)
+                        return targetMachine.takeError();
+                    Timer timer;
+                    tsm.withModuleDo([&](llvm::Module& module) {
+                        optimize(&module, targetMachine->get(), level);
+                    });
+                    session_optimize_time += timer.elapse();
+                    return std::move(tsm);
+                });
 
-            llvm::Function* func = module->getFunction("$main");
-            if(func == nullptr)
+            return true;
+        }
+
+        bool prepare_session(omis_handle_t mod, const omis_handle_list_t& imports, const omis_compile_options_t& options) {
+            if(!this->open_session(options))
                 return false;
 
-            std::vector<llvm::GenericValue> args;
-            auto retval = ee->runFunction(func, args);
-            llvm::SmallString<32> str;
-            retval.IntVal.toString(str, 10, true);
-            printf("RET: %s \n", str.c_str());
+            for(auto& imp : imports) {
+                if(!this->add_to_session(imp, false))
+                    return false;
+            }
+            return this->add_to_session(mod, true);
+        }
+
+        /**
+         * The session owns a clone of the module, the omis module keeps and drops its own.
+         * $main of an imported module is its initializer, keep it private to the module
+         * so that it does not clash with the $main of the importer.
+         */
+        bool add_to_session(omis_handle_t mod, bool isMain) {
+            if(session_modules.contains(mod))
+                return true;
+
+            auto clone = llvm::CloneModule(*_Mod(mod));
+            localize_imports(clone.get());
+            if(!isMain) {
+                if(auto* init = clone->getFunction("$main"))
+                    init->setLinkage(llvm::GlobalValue::InternalLinkage);
+            }
+            clone->setDataLayout(session->getDataLayout());
 
+            if(auto error = session->addLazyIRModule(llvm::orc::ThreadSafeModule(std::move(clone), tsc))) {
+                llvm::logAllUnhandledErrors(std::move(error), llvm::errs(), "JIT: ");
+                return false;
+            }
+
+            session_modules.insert(mod);
             return true;
         }
 
-        virtual bool aot(omis_handle_t mod) override {
-            llvm::InitializeAllTargetInfos();
-            llvm::InitializeAllTargets();
-            llvm::InitializeAllTargetMCs();
-            llvm::InitializeAllAsmParsers();
-            llvm::InitializeAllAsmPrinters();
+        /**
+         * Symbols imported from other modules are used as they are by the coder, replace
+         * them with declarations of this module so that it can be compiled on its own.
+         */
+        static void localize_imports(llvm::Module* module) {
+            for(auto& func : *module) {
+                for(auto& block : func) {
+                    for(auto& ins : block) {
+                        for(auto& op : ins.operands()) {
+                            auto* global = llvm::dyn_cast<llvm::GlobalValue>(op.get());
+                            if(global == nullptr || global->getParent() == module)
+                                continue;
+                            if(auto* importFunc = llvm::dyn_cast<llvm::Function>(global)) {
+                                op.set(module->getOrInsertFunction(importFunc->getName(), importFunc->getFunctionType()).getCallee());
+                            }
+                            else if(auto* importVar = llvm::dyn_cast<llvm::GlobalVariable>(global)) {
+                                op.set(module->getOrInsertGlobal(importVar->getName(), importVar->getValueType()));
+                            }
+                        }
+                    }
+                }
+            }
+        }
 
-            auto* module = _Mod(mod);
+        /**
+         * An object is linked without the runtime the jit resolves, give the allocator
+         * functions it calls private bodies on malloc and free. A region is a list of
+         * blocks on the thread, each keeps the previous top in its first 16 bytes.
+         */
+        static void define_runtime(llvm::Module* module) {
+            auto& ctx = module->getContext();
+            auto* bytes = llvm::Type::getInt8PtrTy(ctx);
+            auto* slot = llvm::PointerType::getUnqual(bytes);
+            auto* i64 = llvm::Type::getInt64Ty(ctx);
+            auto malloc = module->getOrInsertFunction("malloc", bytes, i64);
+            auto free = module->getOrInsertFunction("free", llvm::Type::getVoidTy(ctx), bytes);
+
+            llvm::IRBuilder<> IR(ctx);
+            auto define = [&](const char* name) -> llvm::Function* {
+                auto* func = module->getFunction(name);
+                if(func == nullptr || !func->isDeclaration())
+                    return nullptr;
+                func->setLinkage(llvm::GlobalValue::InternalLinkage);
+                IR.SetInsertPoint(llvm::BasicBlock::Create(ctx, "entry", func));
+                return func;
+            };
+            auto arg = [&](llvm::Function* func, llvm::Type* type) {
+                return IR.CreatePointerCast(func->getArg(0), type);
+            };
+            auto ret = [&](llvm::Function* func, llvm::Value* value) {
+                IR.CreateRet(IR.CreatePointerCast(value, func->getReturnType()));
+            };
+            llvm::GlobalVariable* top = nullptr;
+            auto region = [&]() {
+                if(top == nullptr) {
+                    top = new llvm::GlobalVariable(*module, bytes, false, llvm::GlobalValue::InternalLinkage,
+                        llvm::ConstantPointerNull::get(bytes), "eokas_region_top", nullptr, llvm::GlobalValue::GeneralDynamicTLSModel);
+                }
+                return top;
+            };
 
-            auto targetTriple = llvm::sys::getDefaultTargetTriple();
-            std::string error;
-            auto target = llvm::TargetRegistry::lookupTarget(targetTriple, error);
+            if(auto* func = define("eokas_alloc")) {
+                ret(func, IR.CreateCall(malloc, {func->getArg(0)}));
+            }
+            if(auto* func = define("eokas_free")) {
+                IR.CreateCall(free, {arg(func, bytes)});
+                IR.CreateRetVoid();
+            }
+            if(auto* func = define("eokas_region_enter")) {
+                ret(func, IR.CreateLoad(bytes, region()));
+            }
+            if(auto* func = define("eokas_region_alloc")) {
+                auto size = IR.CreateAdd(func->getArg(0), llvm::ConstantInt::get(i64, 16));
+                auto block = IR.CreateCall(malloc, {size});
+                IR.CreateStore(IR.CreateLoad(bytes, region()), IR.CreatePointerCast(block, slot));
+                IR.CreateStore(block, region());
+                ret(func, IR.CreateGEP(llvm::Type::getInt8Ty(ctx), block, llvm::ConstantInt::get(i64, 16)));
+            }
+            if(auto* func = define("eokas_region_leave")) {
+                auto mark = arg(func, bytes);
+                auto* loop = llvm::BasicBlock::Create(ctx, "loop", func);
+                auto* pop = llvm::BasicBlock::Create(ctx, "pop", func);
+                auto* done = llvm::BasicBlock::Create(ctx, "done", func);
+                IR.CreateBr(loop);
+                IR.SetInsertPoint(loop);
+                auto block = IR.CreateLoad(bytes, region());
+                IR.CreateCondBr(IR.CreateICmpEQ(block, mark), done, pop);
+                IR.SetInsertPoint(pop);
+                IR.CreateStore(IR.CreateLoad(bytes, IR.CreatePointerCast(block, slot)), region());
+                IR.CreateCall(free, {block});
+                IR.CreateBr(loop);
+                IR.SetInsertPoint(done);
+                IR.CreateRetVoid();
+            }
+        }
 
-            auto CPU = "generic";
-            auto features = "";
-            llvm::TargetOptions opt;
-            auto RM = llvm::Optional<llvm::Reloc::Model>();
-            auto targetMachine = target->createTargetMachine(targetTriple, CPU, features, opt, RM);
+        static llvm::CodeGenOpt::Level codegen_level(omis_opt_level_t level) {
+            switch(level) {
+                case omis_opt_level_t::O0: return llvm::CodeGenOpt::None;
+                case omis_opt_level_t::O1: return llvm::CodeGenOpt::Less;
+                case omis_opt_level_t::O3: return llvm::CodeGenOpt::Aggressive;
+                default: return llvm::CodeGenOpt::Default;
+            }
+        }
 
-            module->setDataLayout(targetMachine->createDataLayout());
-            module->setTargetTriple(targetTriple);
+        bool emit_object(llvm::Module* module, const omis_compile_options_t& options, llvm::raw_pwrite_stream& dest, omis_compile_stats_t& stats) {
+            // packages are built on several threads, the registry is filled once.
+            static std::once_flag targetsInitialized;
+            std::call_once(targetsInitialized, []() {
+                llvm::InitializeAllTargetInfos();
+                llvm::InitializeAllTargets();
+                llvm::InitializeAllTargetMCs();
+                llvm::InitializeAllAsmParsers();
+                llvm::InitializeAllAsmPrinters();
+            });
 
-            auto filename = "output.o";
-            std::error_code EC;
-            llvm::raw_fd_ostream dest(filename, EC, llvm::sys::fs::OF_None);
-            if(EC)
-            {
-                llvm::errs() << "Could not open file: " << EC.message();
+            std::string error;
+            auto targetMachine = make_target_machine(llvm::sys::getDefaultTargetTriple(), options, error);
+            if(targetMachine == nullptr) {
+                llvm::errs() << error;
                 return false;
             }
 
+            Timer timer;
+            module->setDataLayout(targetMachine->createDataLayout());
+            module->setTargetTriple(targetMachine->getTargetTriple().str());
+            optimize(module, targetMachine.get(), options.opt_level);
+            stats.optimize = timer.elapse() / 1000.0;
+
             llvm::legacy::PassManager pass;
             auto fileType = llvm::CGFT_ObjectFile;
             if(targetMachine->addPassesToEmitFile(pass, dest, nullptr, fileType))
@@ -801,10 +1367,71 @@ namespace eokas
             }
 
             pass.run(*module);
-            dest.flush();
-
+            stats.codegen = timer.elapse() / 1000.0;
             return true;
         }
+
+        static std::unique_ptr<llvm::TargetMachine> make_target_machine(const std::string& triple, const omis_compile_options_t& options, std::string& error) {
+            auto target = llvm::TargetRegistry::lookupTarget(triple, error);
+            if(target == nullptr)
+                return nullptr;
+
+            std::string CPU = "generic";
+            std::string features = "";
+            if(options.native) {
+                CPU = llvm::sys::getHostCPUName().str();
+                llvm::StringMap<bool> hostFeatures;
+                llvm::SubtargetFeatures subtarget;
+                if(llvm::sys::getHostCPUFeatures(hostFeatures)) {
+                    for(auto& feature : hostFeatures) {
+                        subtarget.AddFeature(feature.first(), feature.second);
+                    }
+                }
+                features = subtarget.getString();
+            }
+
+            llvm::TargetOptions opt;
+            auto RM = llvm::Optional<llvm::Reloc::Model>();
+            auto targetMachine = target->createTargetMachine(triple, CPU, features, opt, RM, llvm::None, codegen_level(options.opt_level));
+            if(targetMachine == nullptr)
+                error = "Could not create the target machine for " + triple;
+
+            return std::unique_ptr<llvm::TargetMachine>(targetMachine);
+        }
+
+        /**
+         * Run the default new pass manager pipeline of the level, it covers SROA / mem2reg,
+         * inlining, GVN and the loop / SLP vectorizers from O2 up. O0 leaves the module as encoded.
+         */
+        static void optimize(llvm::Module* module, llvm::TargetMachine* targetMachine, omis_opt_level_t level) {
+            llvm::PassBuilder::OptimizationLevel optLevel;
+            switch(level) {
+                case omis_opt_level_t::O1: optLevel = llvm::PassBuilder::OptimizationLevel::O1; break;
+                case omis_opt_level_t::O2: optLevel = llvm::PassBuilder::OptimizationLevel::O2; break;
+                case omis_opt_level_t::O3: optLevel = llvm::PassBuilder::OptimizationLevel::O3; break;
+                case omis_opt_level_t::Os: optLevel = llvm::PassBuilder::OptimizationLevel::Os; break;
+                default: return;
+            }
+
+            llvm::LoopAnalysisManager LAM;
+            llvm::FunctionAnalysisManager FAM;
+            llvm::CGSCCAnalysisManager CGAM;
+            llvm::ModuleAnalysisManager MAM;
+
+            llvm::PipelineTuningOptions tuning;
+            tuning.LoopVectorization = level == omis_opt_level_t::O2 || level == omis_opt_level_t::O3;
+            tuning.SLPVectorization = tuning.LoopVectorization;
+
+            llvm::PassBuilder PB(targetMachine, tuning);
+            PB.registerModuleAnalyses(MAM);
+            PB.registerCGSCCAnalyses(CGAM);
+            PB.registerFunctionAnalyses(FAM);
+            PB.registerLoopAnalyses(LAM);
+            PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+            llvm::ModulePassManager MPM = PB.buildPerModuleDefaultPipeline(optLevel);
+            MPM.run(*module, MAM);
+        }
     };
 
     omis_bridge_t* llvm_init() {
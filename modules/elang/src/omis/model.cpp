@@ -2,6 +2,8 @@
 #include "./bridge.h"
 #include "context.h"
 
+#include <cmath>
+
 namespace eokas {
     omis_scope_t::omis_scope_t(omis_scope_t* parent, omis_value_t* func)
             : parent(parent), func(func), children(), types(), values() {}
@@ -27,6 +29,10 @@ namespace eokas {
     }
 
     omis_type_symbol_t* omis_scope_t::get_type_symbol(const String& name, bool lookup) {
+	    return this->get_type_symbol(HashKey(name), lookup);
+    }
+
+    omis_type_symbol_t* omis_scope_t::get_type_symbol(const HashKey& name, bool lookup) {
 	    if (lookup) {
 	    	for (auto scope = this; scope != nullptr; scope = scope->parent) {
 	    		auto* symbol = scope->types.get(name);
@@ -67,6 +73,10 @@ namespace eokas {
     }
 
     omis_value_symbol_t* omis_scope_t::get_value_symbol(const String& name, bool lookup) {
+	    return this->get_value_symbol(HashKey(name), lookup);
+    }
+
+    omis_value_symbol_t* omis_scope_t::get_value_symbol(const HashKey& name, bool lookup) {
 	    if (lookup) {
 	    	for (auto scope = this; scope != nullptr; scope = scope->parent) {
 	    		auto symbol = scope->values.get(name);
@@ -113,7 +123,15 @@ namespace eokas {
 	        , types()
 	        , values()
 			, break_point()
-			, continue_point() {
+			, continue_point()
+			, blocks()
+			, phis()
+			, replaced()
+			, variables()
+			, allocs()
+			, owners()
+			, runtime_funcs()
+			, retired() {
         this->handle = bridge->make_module(name.cstr());
     }
 
@@ -121,6 +139,8 @@ namespace eokas {
         _DeletePointer(root);
         _DeleteMap(types);
         _DeleteMap(values);
+        _DeleteList(variables);
+        _DeleteList(retired);
 
         this->bridge->drop_module(this->handle);
         this->handle = nullptr;
@@ -151,6 +171,26 @@ namespace eokas {
         return bridge->dump_module(handle);
     }
 
+    String omis_module_t::get_interface() const {
+        std::vector<String> lines;
+        for(const auto& pair : this->exports->types) {
+            const auto& symbol = pair.second;
+            String typeName = bridge->get_type_name(symbol->type->get_handle());
+            lines.push_back(String::format("type %s %s\n", symbol->name.cstr(), typeName.cstr()));
+        }
+        std::sort(lines.begin(), lines.end());
+
+        String text;
+        for(auto& line : lines) {
+            text += line;
+        }
+        return text;
+    }
+
+    bool omis_module_t::save(const String& path) const {
+        return bridge->save_module(handle, path);
+    }
+
     bool omis_module_t::using_module(const String& name) {
     	auto dep = this->context->get_module(name);
     	if(dep == nullptr) {
@@ -180,6 +220,10 @@ namespace eokas {
         return true;
     }
 
+    const std::map<String, omis_module_t*>& omis_module_t::get_dependencies() const {
+        return dependencies;
+    }
+
     omis_scope_t* omis_module_t::get_scope() {
         return scope;
     }
@@ -201,6 +245,10 @@ namespace eokas {
     }
 
     omis_type_symbol_t* omis_module_t::get_type_symbol(const String& name, bool lookup) {
+        return this->get_type_symbol(HashKey(name), lookup);
+    }
+
+    omis_type_symbol_t* omis_module_t::get_type_symbol(const HashKey& name, bool lookup) {
         omis_type_symbol_t* symbol = this->get_scope()->get_type_symbol(name, lookup);
     	if(symbol != nullptr) {
     		return symbol;
@@ -213,6 +261,10 @@ namespace eokas {
     }
 
     omis_value_symbol_t* omis_module_t::get_value_symbol(const String& name, bool lookup) {
+        return this->get_value_symbol(HashKey(name), lookup);
+    }
+
+    omis_value_symbol_t* omis_module_t::get_value_symbol(const HashKey& name, bool lookup) {
         omis_value_symbol_t* symbol = this->get_scope()->get_value_symbol(name, lookup);
     	if(symbol != nullptr) {
     		return symbol;
@@ -232,48 +284,39 @@ namespace eokas {
     }
 
     omis_type_t* omis_module_t::type_void() {
-        static omis_type_t* type = this->type(bridge->type_void());
-        return type;
+        return this->type(bridge->type_void());
     }
 
     omis_type_t* omis_module_t::type_i8() {
-        static omis_type_t* type = this->type(bridge->type_i8());
-        return type;
+        return this->type(bridge->type_i8());
     }
 
     omis_type_t* omis_module_t::type_i16() {
-        static omis_type_t* type = this->type(bridge->type_i16());
-        return type;
+        return this->type(bridge->type_i16());
     }
 
     omis_type_t* omis_module_t::type_i32() {
-        static omis_type_t* type = this->type(bridge->type_i32());
-        return type;
+        return this->type(bridge->type_i32());
     }
 
     omis_type_t* omis_module_t::type_i64() {
-        static omis_type_t* type = this->type(bridge->type_i64());
-        return type;
+        return this->type(bridge->type_i64());
     }
 
     omis_type_t* omis_module_t::type_f32() {
-        static omis_type_t* type = this->type(bridge->type_f32());
-        return type;
+        return this->type(bridge->type_f32());
     }
 
     omis_type_t* omis_module_t::type_f64() {
-        static omis_type_t* type = this->type(bridge->type_f64());
-        return type;
+        return this->type(bridge->type_f64());
     }
 
     omis_type_t* omis_module_t::type_bool() {
-        static omis_type_t* type = this->type(bridge->type_bool());
-        return type;
+        return this->type(bridge->type_bool());
     }
 
     omis_type_t* omis_module_t::type_bytes() {
-        static omis_type_t* type = this->type(bridge->type_bytes());
-        return type;
+        return this->type(bridge->type_bytes());
     }
 
     omis_type_t* omis_module_t::type_pointer(omis_type_t *type) {
@@ -283,7 +326,7 @@ namespace eokas {
 
     omis_type_t* omis_module_t::type_func(omis_type_t* ret, const std::vector<omis_type_t*>& args, bool varg) {
         omis_handle_t ret_type = ret->get_handle();
-        std::vector<omis_handle_t> args_type;
+        omis_handle_list_t args_type;
         for (auto& arg: args) {
             args_type.push_back(arg->get_handle());
         }
@@ -291,6 +334,11 @@ namespace eokas {
         return this->type(ft);
     }
 	
+    omis_type_t* omis_module_t::type_vector(omis_type_t* element, u32_t lanes) {
+        auto ret = bridge->type_vector(element->get_handle(), lanes);
+        return this->type(ret);
+    }
+	
 	String omis_module_t::get_type_name(omis_type_t *type) {
 		return bridge->get_type_name(type->get_handle());
 	}
@@ -325,19 +373,37 @@ namespace eokas {
         if (bits == 32)
             type = this->type_i32();
         auto ret = bridge->value_integer(val, bits);
-        return this->value(type, ret);
+        omis_constant_t constant;
+        constant.kind = omis_constant_t::INTEGER;
+        constant.bits = bits == 32 ? 32 : 64;
+        constant.integer = bits == 32 ? (i64_t)(i32_t)val : (i64_t)val;
+        auto value = this->value(type, ret);
+        value->set_constant(constant);
+        return value;
     }
 
     omis_value_t* omis_module_t::value_float(double val) {
         auto type = this->type_f64();
         auto ret = bridge->value_float(val);
-        return this->value(type, ret);
+        omis_constant_t constant;
+        constant.kind = omis_constant_t::FLOAT;
+        constant.bits = 64;
+        constant.number = val;
+        auto value = this->value(type, ret);
+        value->set_constant(constant);
+        return value;
     }
 
     omis_value_t* omis_module_t::value_bool(bool val) {
         auto type = this->type_bool();
         auto ret = bridge->value_bool(val);
-        return this->value(type, ret);
+        omis_constant_t constant;
+        constant.kind = omis_constant_t::BOOL;
+        constant.bits = 1;
+        constant.integer = val ? 1 : 0;
+        auto value = this->value(type, ret);
+        value->set_constant(constant);
+        return value;
     }
 
     omis_value_t* omis_module_t::value_string(const String& val) {
@@ -345,18 +411,27 @@ namespace eokas {
     }
 
     omis_value_t* omis_module_t::value_func(const String& name, omis_type_t* ret, const std::vector<omis_type_t*>& args, bool varg) {
-        omis_handle_t ret_type = ret->get_handle();
-
-        std::vector<omis_handle_t> args_types;
-        for (auto& arg: args) {
-            args_types.push_back(arg->get_handle());
-        }
-
         auto type = this->type_func(ret, args, varg);
         auto func = bridge->value_func(this->handle, name, type->get_handle());
         
 		return this->value(func);
     }
+
+    omis_value_t* omis_module_t::value_vector(omis_type_t* type, const std::vector<omis_value_t*>& lanes) {
+        u32_t count = type->get_vector_lanes();
+        if (lanes.size() != 1 && lanes.size() != count) {
+            printf("ERROR: The vector '%s' takes 1 or %u values, not %u.\n", this->get_type_name(type).cstr(), count, (u32_t)lanes.size());
+            return nullptr;
+        }
+        auto ret = this->value(type, bridge->get_default_value(type->get_handle()));
+        for (u32_t index = 0; index < count; index++) {
+            auto lane = lanes.size() == 1 ? lanes.front() : lanes.at(index);
+            ret = this->insert_element(ret, lane, this->value_integer(index, 32));
+            if (ret == nullptr)
+                return nullptr;
+        }
+        return ret;
+    }
 	
 	omis_type_t* omis_module_t::get_func_ret_type(omis_value_t* func) {
 		auto type = func->get_type()->get_handle();
@@ -471,6 +546,16 @@ namespace eokas {
         return bridge->is_type_struct(this->handle);
     }
 
+    bool omis_type_t::is_type_vector() {
+        auto bridge = module->get_bridge();
+        return bridge->is_type_vector(this->handle);
+    }
+
+    u32_t omis_type_t::get_vector_lanes() {
+        auto bridge = module->get_bridge();
+        return bridge->get_vector_lanes(this->handle);
+    }
+
     omis_type_t* omis_type_t::get_pointer_type() {
         auto bridge = module->get_bridge();
         auto ret = bridge->type_pointer(this->handle);
@@ -566,7 +651,7 @@ namespace eokas {
 
 namespace eokas {
 	omis_value_t::omis_value_t(omis_module_t *module, omis_type_t *type, void *handle)
-		: module(module), type(type), handle(handle) {
+		: module(module), type(type), handle(handle), constant() {
 		
 	}
 	
@@ -590,13 +675,57 @@ namespace eokas {
 		auto bridge = module->get_bridge();
 		bridge->set_value_name(this->handle, name);
 	}
+	
+	bool omis_value_t::is_constant() const {
+		return constant.kind != omis_constant_t::NONE;
+	}
+	
+	const omis_constant_t &omis_value_t::get_constant() const {
+		return constant;
+	}
+	
+	void omis_value_t::set_constant(const omis_constant_t &constant) {
+		this->constant = constant;
+	}
+	
+	omis_variable_t::omis_variable_t(omis_module_t *module, omis_type_t *type, omis_value_t *func, const String &name)
+		: omis_value_t(module, type, nullptr), func(func), name(name) {
+		
+	}
+	
+	omis_variable_t::~omis_variable_t() {
+		this->func = nullptr;
+	}
+	
+	omis_value_t *omis_variable_t::get_func() {
+		return func;
+	}
+	
+	const String &omis_variable_t::get_name() const {
+		return name;
+	}
 }
 
 namespace eokas {
 	omis_value_t *omis_module_t::create_block(const String &name) {
 		auto func = this->scope->func;
 		auto ret = bridge->create_block(func->get_handle(), name);
-		return this->value(this->type_void(), ret);
+		auto block = this->value(this->type_void(), ret);
+		
+		// the first block of a function is its entry, which has no predecessors to wait for.
+		auto &state = this->blocks[block];
+		state = block_state_t();
+		state.func = func;
+		state.entry = true;
+		for (auto &pair: this->blocks) {
+			if (pair.first != block && pair.second.func == func) {
+				state.entry = false;
+				break;
+			}
+		}
+		state.sealed = state.entry;
+		
+		return block;
 	}
 	
 	omis_value_t *omis_module_t::get_active_block() {
@@ -630,139 +759,216 @@ namespace eokas {
 	omis_value_t *omis_module_t::alloc(const String &name, omis_type_t *type, omis_value_t *value) {
 		auto ptr = bridge->alloc(type->get_handle(), name);
 		if(value != nullptr) {
+			this->escape(value);
 			auto ret = bridge->store(ptr, value->get_handle());
 		}
 		return this->value(ptr);
 	}
 	
+	omis_value_t *omis_module_t::variable(const String &name, omis_type_t *type, omis_value_t *value) {
+		auto variable = new omis_variable_t(this, type, this->scope->func, name);
+		this->variables.push_back(variable);
+		this->write_variable(variable, this->get_active_block(), value);
+		return variable;
+	}
+	
 	omis_value_t *omis_module_t::load(omis_value_t *ptr) {
+		if (auto variable = dynamic_cast<omis_variable_t *>(ptr))
+			return this->read_variable(variable, this->get_active_block());
 		auto ret = bridge->load(ptr->get_handle());
 		return this->value(ret);
 	}
 	
 	omis_value_t *omis_module_t::store(omis_value_t *ptr, omis_value_t *val) {
+		if (auto variable = dynamic_cast<omis_variable_t *>(ptr)) {
+			if (!this->equals_type(val->get_type(), variable->get_type())) {
+				if (!this->can_losslessly_bitcast(val->get_type(), variable->get_type())) {
+					printf("ERROR: Type of value can not cast to the type of symbol '%s'.\n", variable->get_name().cstr());
+					return nullptr;
+				}
+				val = this->bitcast(val, variable->get_type());
+			}
+			this->write_variable(variable, this->get_active_block(), val);
+			return val;
+		}
+		this->escape(val);
 		auto ret = bridge->store(ptr->get_handle(), val->get_handle());
 		return this->value(this->type_void(), ret);
 	}
 	
 	omis_value_t *omis_module_t::neg(omis_value_t *a) {
-		auto ret = bridge->neg(a->get_handle());
-		return this->value(a->get_type(), ret);
+		return this->pure(omis_op_t::NEG, a, nullptr, [&]() -> omis_value_t * {
+			auto ret = bridge->neg(a->get_handle());
+			return this->value(a->get_type(), ret);
+		});
 	}
 	
 	omis_value_t *omis_module_t::add(omis_value_t *a, omis_value_t *b) {
-		auto ret = bridge->add(a->get_handle(), b->get_handle());
-		return this->value(ret);
+		return this->pure(omis_op_t::ADD, a, b, [&]() -> omis_value_t * {
+			auto ret = bridge->add(a->get_handle(), b->get_handle());
+			return this->value(ret);
+		});
 	}
 	
 	omis_value_t *omis_module_t::sub(omis_value_t *a, omis_value_t *b) {
-		auto ret = bridge->sub(a->get_handle(), b->get_handle());
-		return this->value(ret);
+		return this->pure(omis_op_t::SUB, a, b, [&]() -> omis_value_t * {
+			auto ret = bridge->sub(a->get_handle(), b->get_handle());
+			return this->value(ret);
+		});
 	}
 	
 	omis_value_t *omis_module_t::mul(omis_value_t *a, omis_value_t *b) {
-		auto ret = bridge->mul(a->get_handle(), b->get_handle());
-		return this->value(ret);
+		return this->pure(omis_op_t::MUL, a, b, [&]() -> omis_value_t * {
+			auto ret = bridge->mul(a->get_handle(), b->get_handle());
+			return this->value(ret);
+		});
 	}
 	
 	omis_value_t *omis_module_t::div(omis_value_t *a, omis_value_t *b) {
-		auto ret = bridge->div(a->get_handle(), b->get_handle());
-		return this->value(ret);
+		return this->pure(omis_op_t::DIV, a, b, [&]() -> omis_value_t * {
+			auto ret = bridge->div(a->get_handle(), b->get_handle());
+			return this->value(ret);
+		});
 	}
 	
 	omis_value_t *omis_module_t::mod(omis_value_t *a, omis_value_t *b) {
-		auto ret = bridge->mod(a->get_handle(), b->get_handle());
-		return this->value(ret);
+		return this->pure(omis_op_t::MOD, a, b, [&]() -> omis_value_t * {
+			auto ret = bridge->mod(a->get_handle(), b->get_handle());
+			return this->value(ret);
+		});
 	}
 	
 	omis_value_t *omis_module_t::eq(omis_value_t *a, omis_value_t *b) {
-		auto ret = bridge->eq(a->get_handle(), b->get_handle());
-		return this->value(this->type_bool(), ret);
+		return this->pure(omis_op_t::EQ, a, b, [&]() -> omis_value_t * {
+			auto ret = bridge->eq(a->get_handle(), b->get_handle());
+			return this->value(this->type_compare(a, b), ret);
+		});
 	}
 	
 	omis_value_t *omis_module_t::ne(omis_value_t *a, omis_value_t *b) {
-		auto ret = bridge->ne(a->get_handle(), b->get_handle());
-		return this->value(this->type_bool(), ret);
+		return this->pure(omis_op_t::NE, a, b, [&]() -> omis_value_t * {
+			auto ret = bridge->ne(a->get_handle(), b->get_handle());
+			return this->value(this->type_compare(a, b), ret);
+		});
 	}
 	
 	omis_value_t *omis_module_t::gt(omis_value_t *a, omis_value_t *b) {
-		auto ret = bridge->gt(a->get_handle(), b->get_handle());
-		return this->value(this->type_bool(), ret);
+		return this->pure(omis_op_t::GT, a, b, [&]() -> omis_value_t * {
+			auto ret = bridge->gt(a->get_handle(), b->get_handle());
+			return this->value(this->type_compare(a, b), ret);
+		});
 	}
 	
 	omis_value_t *omis_module_t::ge(omis_value_t *a, omis_value_t *b) {
-		auto ret = bridge->ge(a->get_handle(), b->get_handle());
-		return this->value(this->type_bool(), ret);
+		return this->pure(omis_op_t::GE, a, b, [&]() -> omis_value_t * {
+			auto ret = bridge->ge(a->get_handle(), b->get_handle());
+			return this->value(this->type_compare(a, b), ret);
+		});
 	}
 	
 	omis_value_t *omis_module_t::lt(omis_value_t *a, omis_value_t *b) {
-		auto ret = bridge->lt(a->get_handle(), b->get_handle());
-		return this->value(this->type_bool(), ret);
+		return this->pure(omis_op_t::LT, a, b, [&]() -> omis_value_t * {
+			auto ret = bridge->lt(a->get_handle(), b->get_handle());
+			return this->value(this->type_compare(a, b), ret);
+		});
 	}
 	
 	omis_value_t *omis_module_t::le(omis_value_t *a, omis_value_t *b) {
-		auto ret = bridge->le(a->get_handle(), b->get_handle());
-		return this->value(this->type_bool(), ret);
+		return this->pure(omis_op_t::LE, a, b, [&]() -> omis_value_t * {
+			auto ret = bridge->le(a->get_handle(), b->get_handle());
+			return this->value(this->type_compare(a, b), ret);
+		});
 	}
 	
 	omis_value_t *omis_module_t::l_not(omis_value_t *a) {
-		auto ret = bridge->l_not(a->get_handle());
-		return this->value(this->type_bool(), ret);
+		return this->pure(omis_op_t::L_NOT, a, nullptr, [&]() -> omis_value_t * {
+			auto ret = bridge->l_not(a->get_handle());
+			return this->value(this->type_compare(a, nullptr), ret);
+		});
 	}
 	
 	omis_value_t *omis_module_t::l_and(omis_value_t *a, omis_value_t *b) {
-		auto ret = bridge->l_and(a->get_handle(), b->get_handle());
-		return this->value(this->type_bool(), ret);
+		return this->pure(omis_op_t::L_AND, a, b, [&]() -> omis_value_t * {
+			auto ret = bridge->l_and(a->get_handle(), b->get_handle());
+			return this->value(this->type_bool(), ret);
+		});
 	}
 	
 	omis_value_t *omis_module_t::l_or(omis_value_t *a, omis_value_t *b) {
-		auto ret = bridge->l_or(a->get_handle(), b->get_handle());
-		return this->value(this->type_bool(), ret);
+		return this->pure(omis_op_t::L_OR, a, b, [&]() -> omis_value_t * {
+			auto ret = bridge->l_or(a->get_handle(), b->get_handle());
+			return this->value(this->type_bool(), ret);
+		});
 	}
 	
 	omis_value_t *omis_module_t::b_flip(omis_value_t *a) {
-		auto ret = bridge->b_flip(a->get_handle());
-		return this->value(a->get_type(), ret);
+		return this->pure(omis_op_t::B_FLIP, a, nullptr, [&]() -> omis_value_t * {
+			auto ret = bridge->b_flip(a->get_handle());
+			return this->value(a->get_type(), ret);
+		});
 	}
 	
 	omis_value_t *omis_module_t::b_and(omis_value_t *a, omis_value_t *b) {
-		auto ret = bridge->b_and(a->get_handle(), b->get_handle());
-		return this->value(a->get_type(), ret);
+		return this->pure(omis_op_t::B_AND, a, b, [&]() -> omis_value_t * {
+			auto ret = bridge->b_and(a->get_handle(), b->get_handle());
+			return this->value(this->type_operands(a, b), ret);
+		});
 	}
 	
 	omis_value_t *omis_module_t::b_or(omis_value_t *a, omis_value_t *b) {
-		auto ret = bridge->b_or(a->get_handle(), b->get_handle());
-		return this->value(a->get_type(), ret);
+		return this->pure(omis_op_t::B_OR, a, b, [&]() -> omis_value_t * {
+			auto ret = bridge->b_or(a->get_handle(), b->get_handle());
+			return this->value(this->type_operands(a, b), ret);
+		});
 	}
 	
 	omis_value_t *omis_module_t::b_xor(omis_value_t *a, omis_value_t *b) {
-		auto ret = bridge->b_xor(a->get_handle(), b->get_handle());
-		return this->value(a->get_type(), ret);
+		return this->pure(omis_op_t::B_XOR, a, b, [&]() -> omis_value_t * {
+			auto ret = bridge->b_xor(a->get_handle(), b->get_handle());
+			return this->value(this->type_operands(a, b), ret);
+		});
 	}
 	
 	omis_value_t *omis_module_t::b_shl(omis_value_t *a, omis_value_t *b) {
-		auto ret = bridge->b_shl(a->get_handle(), b->get_handle());
-		return this->value(a->get_type(), ret);
+		return this->pure(omis_op_t::B_SHL, a, b, [&]() -> omis_value_t * {
+			auto ret = bridge->b_shl(a->get_handle(), b->get_handle());
+			return this->value(this->type_operands(a, b), ret);
+		});
 	}
 	
 	omis_value_t *omis_module_t::b_shr(omis_value_t *a, omis_value_t *b) {
-		auto ret = bridge->b_shr(a->get_handle(), b->get_handle());
-		return this->value(a->get_type(), ret);
+		return this->pure(omis_op_t::B_SHR, a, b, [&]() -> omis_value_t * {
+			auto ret = bridge->b_shr(a->get_handle(), b->get_handle());
+			return this->value(this->type_operands(a, b), ret);
+		});
 	}
 	
 	omis_value_t *omis_module_t::jump(omis_value_t *pos) {
+		auto block = this->get_active_block();
+		if (this->is_dead_block(block))
+			return nullptr;
 		auto ret = bridge->jump(pos->get_handle());
+		this->add_edge(block, pos);
 		return this->value(ret);
 	}
 	
 	omis_value_t *omis_module_t::jump_cond(omis_value_t *cond, omis_value_t *branch_true, omis_value_t *branch_false) {
+		if (cond->is_constant() && cond->get_constant().kind == omis_constant_t::BOOL) {
+			return this->jump(cond->get_constant().integer != 0 ? branch_true : branch_false);
+		}
+		auto block = this->get_active_block();
+		if (this->is_dead_block(block))
+			return nullptr;
 		auto ret = bridge->jump_cond(cond->get_handle(), branch_true->get_handle(), branch_false->get_handle());
+		this->add_edge(block, branch_true);
+		this->add_edge(block, branch_false);
 		return this->value(ret);
 	}
 	
 	omis_value_t *omis_module_t::phi(omis_type_t *type, const std::map<omis_value_t *, omis_value_t *> &incomings) {
 		std::map<omis_handle_t, omis_handle_t> incomings_handles;
 		for (auto &pair : incomings) {
+			this->escape(pair.first);
 			incomings_handles.insert(std::make_pair(pair.first->get_handle(), pair.second->get_handle()));
 		}
 		auto ret = bridge->phi(type->get_handle(), incomings_handles);
@@ -770,8 +976,9 @@ namespace eokas {
 	}
 	
 	omis_value_t *omis_module_t::call(omis_value_t *func, const std::vector<omis_value_t *> &args) {
-		std::vector<omis_handle_t> args_values;
+		omis_handle_list_t args_values;
 		for (auto &arg : args) {
+			this->escape(arg);
 			args_values.push_back(arg->get_handle());
 		}
 		auto ret = bridge->call(func->get_handle(), args_values);
@@ -779,6 +986,10 @@ namespace eokas {
 	}
 	
 	omis_value_t *omis_module_t::call(const String &func_name, const std::vector<omis_value_t *> &args) {
+		return this->call(HashKey(func_name), args);
+	}
+	
+	omis_value_t *omis_module_t::call(const HashKey &func_name, const std::vector<omis_value_t *> &args) {
 		auto symbol = this->get_value_symbol(func_name);
 		if (symbol == nullptr)
 			return nullptr;
@@ -789,51 +1000,75 @@ namespace eokas {
 	}
 	
 	omis_value_t *omis_module_t::ret(omis_value_t *value) {
+		if (value != nullptr)
+			this->escape(value);
 		auto ret = bridge->ret(value != nullptr ? value->get_handle() : nullptr);
 		return this->value(ret);
 	}
 	
 	omis_value_t *omis_module_t::bitcast(omis_value_t *value, omis_type_t *type) {
-		auto ret = bridge->bitcast(value->get_handle(), type->get_handle());
+		auto ret = this->value(bridge->bitcast(value->get_handle(), type->get_handle()));
+		auto owner = this->owners.find(value);
+		if (owner != this->owners.end())
+			this->owners[ret] = owner->second;
+		return ret;
+	}
+	
+	omis_value_t *omis_module_t::insert_element(omis_value_t *vec, omis_value_t *value, omis_value_t *index) {
+		auto ret = bridge->insert_element(vec->get_handle(), value->get_handle(), index->get_handle());
+		if (ret == nullptr)
+			return nullptr;
+		return this->value(vec->get_type(), ret);
+	}
+	
+	omis_value_t *omis_module_t::extract_element(omis_value_t *vec, omis_value_t *index) {
+		auto ret = bridge->extract_element(vec->get_handle(), index->get_handle());
+		if (ret == nullptr)
+			return nullptr;
 		return this->value(ret);
 	}
 	
 	omis_value_t *omis_module_t::get_ptr_val(omis_value_t *ptr) {
+		if (auto variable = dynamic_cast<omis_variable_t *>(ptr))
+			return this->read_variable(variable, this->get_active_block());
 		auto ret = bridge->get_ptr_val(ptr->get_handle());
 		return this->value(ret);
 	}
 	
 	omis_value_t *omis_module_t::get_ptr_ref(omis_value_t *ptr) {
+		if (dynamic_cast<omis_variable_t *>(ptr) != nullptr)
+			return ptr;
 		auto ret = bridge->get_ptr_ref(ptr->get_handle());
 		return this->value(ret);
 	}
 	
 	omis_value_t *omis_module_t::make(omis_type_t *type) {
-		auto len = this->get_type_size(type);
-		auto ptr = this->call("malloc", {len});
-		
-		auto cond = [&]() -> omis_value_t * {
-			return this->eq(ptr, this->value_integer(0, 64));
-		};
-		auto body = [&]() -> bool {
-			return true;
-		};
-		this->stmt_branch(cond, body, nullptr);
-		
-		auto val = this->bitcast(ptr, type);
-		return val;
+		return this->make(type, nullptr);
 	}
 	
 	omis_value_t *omis_module_t::make(omis_type_t *type, omis_value_t *count) {
-		auto stride = this->get_type_size(type);
-		auto len = this->mul(stride, count);
-		auto ptr = this->call("malloc", {len});
-		auto val = this->bitcast(ptr, type);
-		return val;
+		auto len = this->get_type_size(type);
+		if (count != nullptr)
+			len = this->mul(len, count);
+		auto ptr = this->call(this->runtime_func("eokas_alloc"), {len});
+		
+		auto &state = this->allocs[ptr];
+		state.block = this->get_active_block();
+		state.type = type;
+		state.count = count;
+		this->owners[ptr] = ptr;
+		return this->bitcast(ptr, this->type_pointer(type));
 	}
 	
+	// a drop is not a use that lets the pointer escape, end_func deletes it if the memory is not on the heap.
 	omis_value_t *omis_module_t::drop(omis_value_t *ptr) {
-		return this->call("free", {ptr});
+		auto free = this->runtime_func("eokas_free");
+		auto bytes = this->bitcast(ptr, this->type_bytes());
+		auto ret = this->value(bridge->call(free->get_handle(), {bytes->get_handle()}));
+		auto owner = this->owners.find(ptr);
+		if (owner != this->owners.end())
+			this->allocs[owner->second].drops.push_back(ret);
+		return ret;
 	}
 	
 	omis_value_t * omis_module_t::expr_branch(const omis_lambda_expr_t &lambda_cond, const omis_lambda_expr_t &lambda_true, const omis_lambda_expr_t &lambda_false) {
@@ -843,6 +1078,7 @@ namespace eokas {
 		auto trinary_end = this->create_block("trinary.end");
 		
 		this->jump(trinary_begin);
+		this->seal_block(trinary_begin);
 		this->set_active_block(trinary_begin);
 		auto *cond = lambda_cond();
 		if (cond == nullptr)
@@ -854,12 +1090,16 @@ namespace eokas {
 		}
 		
 		this->jump_cond(cond, trinary_true, trinary_false);
+		this->seal_block(trinary_true);
+		this->seal_block(trinary_false);
 		
+		// a branch may end in another block than it began with, when it nests a trinary.
 		this->set_active_block(trinary_true);
 		auto *true_val = lambda_true();
 		if (true_val == nullptr)
 			return nullptr;
 		true_val = this->get_ptr_val(true_val);
+		auto true_end = this->get_active_block();
 		this->jump(trinary_end);
 		
 		this->set_active_block(trinary_false);
@@ -867,20 +1107,33 @@ namespace eokas {
 		if (false_val == nullptr)
 			return nullptr;
 		false_val = this->get_ptr_val(false_val);
+		auto false_end = this->get_active_block();
 		this->jump(trinary_end);
 		
+		this->seal_block(trinary_end);
 		this->set_active_block(trinary_end);
 		if (!this->equals_type(true_val->get_type(), false_val->get_type())) {
 			printf("ERROR: Type of true-branch must be the same as false-branch.\n");
 			return nullptr;
 		}
 		
-		auto phi = this->phi(true_val->get_type(), {
-			{true_val,  trinary_true},
-			{false_val, trinary_false}
-		});
+		auto &preds = this->blocks[trinary_end].preds;
+		if (preds.empty()) {
+			auto ret = bridge->get_default_value(true_val->get_type()->get_handle());
+			return this->value(true_val->get_type(), ret);
+		}
+		if (preds.size() == 1) {
+			return preds.front() == true_end ? true_val : false_val;
+		}
+		if (this->equals_value(true_val, false_val)) {
+			return true_val;
+		}
 		
-		return phi;
+		auto phi = bridge->block_phi(trinary_end->get_handle(), true_val->get_type()->get_handle());
+		bridge->add_incoming(phi, true_val->get_handle(), true_end->get_handle());
+		bridge->add_incoming(phi, false_val->get_handle(), false_end->get_handle());
+		
+		return this->value(true_val->get_type(), phi);
 	}
 	
 	bool omis_module_t::stmt_block(const std::optional<omis_lambda_stmt_t> &lambda_body) {
@@ -950,7 +1203,17 @@ namespace eokas {
 			return false;
 		}
 		
-		auto symbol = this->alloc(name, stype, expr);
+		// scalars and vectors can not be pointed to, they live in SSA values instead of the stack.
+		omis_value_t *symbol = nullptr;
+		if (stype->is_type_bool() || stype->is_type_i8() || stype->is_type_i16() || stype->is_type_i32() ||
+			stype->is_type_i64() || stype->is_type_f32() || stype->is_type_f64() || stype->is_type_vector()) {
+			if (!this->equals_type(stype, vtype)) {
+				expr = this->bitcast(expr, stype);
+			}
+			symbol = this->variable(name, stype, expr);
+		} else {
+			symbol = this->alloc(name, stype, expr);
+		}
 		if (!this->add_value_symbol(name, symbol)) {
 			printf("ERROR: There is a symbol named %s in this scope.\n", name.cstr());
 			return false;
@@ -967,7 +1230,8 @@ namespace eokas {
 		
 		auto ptr = this->get_ptr_ref(lhs);
 		auto val = this->get_ptr_val(rhs);
-		this->store(ptr, val);
+		if (this->store(ptr, val) == nullptr)
+			return false;
 		
 		return true;
 	}
@@ -983,6 +1247,7 @@ namespace eokas {
 			}
 			
 			this->ret();
+			this->create_dead_block();
 			return true;
 		}
 		
@@ -1006,6 +1271,7 @@ namespace eokas {
 		}
 		
 		this->ret(expr);
+		this->create_dead_block();
 		
 		return true;
 	}
@@ -1026,6 +1292,8 @@ namespace eokas {
 			return false;
 		}
 		this->jump_cond(cond, if_true, if_false);
+		this->seal_block(if_true);
+		this->seal_block(if_false);
 		
 		// if-true
 		this->set_active_block(if_true);
@@ -1055,6 +1323,7 @@ namespace eokas {
 			}
 		}
 		
+		this->seal_block(if_end);
 		this->set_active_block(if_end);
 		
 		return true;
@@ -1095,6 +1364,7 @@ namespace eokas {
 				return false;
 			}
 			this->jump_cond(cond, loop_body, loop_end);
+			this->seal_block(loop_body);
 		}
 		
 		// body
@@ -1112,12 +1382,15 @@ namespace eokas {
 		}
 		
 		// step
+		this->seal_block(loop_step);
 		this->set_active_block(loop_step);
 		{
 			if (!lambda_step())
 				return false;
 			this->jump(loop_cond);
 		}
+		this->seal_block(loop_cond);
+		this->seal_block(loop_end);
 		
 		this->set_active_block(loop_end);
 		
@@ -1133,6 +1406,7 @@ namespace eokas {
 		if (this->break_point == nullptr)
 			return false;
 		this->jump(this->break_point);
+		this->create_dead_block();
 		return true;
 	}
 	
@@ -1140,6 +1414,7 @@ namespace eokas {
 		if (this->continue_point == nullptr)
 			return false;
 		this->jump(this->continue_point);
+		this->create_dead_block();
 		return true;
 	}
 	
@@ -1147,7 +1422,7 @@ namespace eokas {
 		auto block = bridge->get_active_block();
 		auto lastOp = bridge->get_block_tail(block);
 		
-		if (!bridge->is_terminator_ins(lastOp)) {
+		if (lastOp == nullptr || !bridge->is_terminator_ins(lastOp)) {
 			auto ret_type = bridge->get_func_ret_type(func->get_type()->get_handle());
 			if (ret_type == this->type_void()->get_handle())
 				bridge->ret();
@@ -1155,4 +1430,542 @@ namespace eokas {
 				bridge->ret(bridge->get_default_value(ret_type));
 		}
 	}
+	
+	/**
+	 * Place what make asked for, drop the blocks the entry can not reach, the code
+	 * after a return, break or continue and the branches of constant conditions,
+	 * and forget the blocks.
+	 */
+	void omis_module_t::end_func(omis_value_t *func) {
+		std::vector<omis_value_t *> pending;
+		for (auto &pair: this->blocks) {
+			if (pair.second.func == func && pair.second.entry)
+				pending.push_back(pair.first);
+		}
+		HashSet<omis_value_t *> reachable;
+		while (!pending.empty()) {
+			auto block = pending.back();
+			pending.pop_back();
+			if (!reachable.insert(block).second)
+				continue;
+			for (auto &succ: this->blocks[block].succs) {
+				pending.push_back(succ);
+			}
+		}
+		
+		this->place_allocs(func, reachable);
+		
+		HashSet<omis_value_t *> finished;
+		omis_handle_list_t dead;
+		for (auto &pair: this->blocks) {
+			if (pair.second.func != func)
+				continue;
+			finished.insert(pair.first);
+			if (!reachable.contains(pair.first))
+				dead.push_back(pair.first->get_handle());
+		}
+		if (!dead.empty()) {
+			omis_handle_list_t dropped;
+			bridge->drop_blocks(dead, dropped);
+			for (auto &handle: dropped) {
+				this->retire_value(handle);
+			}
+		}
+		
+		for (auto iter = this->phis.begin(); iter != this->phis.end();) {
+			if (finished.contains(iter->second.block))
+				iter = this->phis.erase(iter);
+			else
+				++iter;
+		}
+		for (auto &block: finished) {
+			this->blocks.erase(block);
+		}
+	}
+}
+
+namespace eokas {
+	omis_value_t *omis_module_t::pure(omis_op_t op, omis_value_t *a, omis_value_t *b, const std::function<omis_value_t *()> &emit) {
+		// comparing a pointer tells nothing about where it points, arithmetic could rebuild it elsewhere.
+		if (op != omis_op_t::EQ && op != omis_op_t::NE) {
+			this->escape(a);
+			if (b != nullptr)
+				this->escape(b);
+		}
+		if (auto folded = this->fold(op, a, b))
+			return folded;
+		
+		switch (op) {
+			case omis_op_t::ADD:
+			case omis_op_t::MUL:
+			case omis_op_t::EQ:
+			case omis_op_t::NE:
+			case omis_op_t::L_AND:
+			case omis_op_t::L_OR:
+			case omis_op_t::B_AND:
+			case omis_op_t::B_OR:
+			case omis_op_t::B_XOR:
+				if (b < a)
+					std::swap(a, b);
+				break;
+			default:
+				break;
+		}
+		
+		auto &exprs = this->blocks[this->get_active_block()].exprs;
+		auto key = std::make_tuple(op, a, b);
+		auto iter = exprs.find(key);
+		if (iter != exprs.end())
+			return iter->second;
+		
+		auto ret = emit();
+		if (ret != nullptr && ret->get_handle() != nullptr)
+			exprs[key] = ret;
+		return ret;
+	}
+	
+	omis_type_t *omis_module_t::type_operands(omis_value_t *a, omis_value_t *b) {
+		if (b != nullptr && !a->get_type()->is_type_vector() && b->get_type()->is_type_vector())
+			return b->get_type();
+		return a->get_type();
+	}
+	
+	omis_type_t *omis_module_t::type_compare(omis_value_t *a, omis_value_t *b) {
+		auto type = this->type_operands(a, b);
+		if (!type->is_type_vector())
+			return this->type_bool();
+		return this->type_vector(this->type_bool(), type->get_vector_lanes());
+	}
+	
+	/**
+	 * Evaluate op on constants the way the llvm bridge would emit it: ints of the
+	 * same width wrap, compare signed and shift right logically, an int meets a float
+	 * as f64, and bools are i1, where true is -1 in a signed compare. Anything else,
+	 * and what would trap or be undefined, is left to the bridge.
+	 */
+	omis_value_t *omis_module_t::fold(omis_op_t op, omis_value_t *a, omis_value_t *b) {
+		if (!a->is_constant() || (b != nullptr && !b->is_constant()))
+			return nullptr;
+		
+		const auto &x = a->get_constant();
+		if (b == nullptr) {
+			switch (op) {
+				case omis_op_t::NEG:
+					if (x.kind == omis_constant_t::INTEGER)
+						return this->value_integer(0 - (u64_t) x.integer, x.bits);
+					if (x.kind == omis_constant_t::FLOAT)
+						return this->value_float(-x.number);
+					return nullptr;
+				case omis_op_t::L_NOT:
+					if (x.kind == omis_constant_t::BOOL)
+						return this->value_bool(x.integer == 0);
+					return nullptr;
+				case omis_op_t::B_FLIP:
+					if (x.kind == omis_constant_t::INTEGER)
+						return this->value_integer((u64_t) x.integer ^ (x.bits >= 64 ? ~0ull : (1ull << x.bits) - 1), x.bits);
+					if (x.kind == omis_constant_t::BOOL)
+						return this->value_bool(x.integer == 0);
+					return nullptr;
+				default:
+					return nullptr;
+			}
+		}
+		
+		const auto &y = b->get_constant();
+		if (x.kind == omis_constant_t::INTEGER && y.kind == omis_constant_t::INTEGER) {
+			if (x.bits != y.bits)
+				return nullptr;
+			auto bits = x.bits;
+			auto min = bits == 32 ? (i64_t) INT32_MIN : INT64_MIN;
+			auto u = (u64_t) x.integer;
+			auto v = (u64_t) y.integer;
+			switch (op) {
+				case omis_op_t::ADD: return this->value_integer(u + v, bits);
+				case omis_op_t::SUB: return this->value_integer(u - v, bits);
+				case omis_op_t::MUL: return this->value_integer(u * v, bits);
+				case omis_op_t::DIV:
+					if (y.integer == 0 || (x.integer == min && y.integer == -1))
+						return nullptr;
+					return this->value_integer((u64_t) (x.integer / y.integer), bits);
+				case omis_op_t::MOD:
+					if (y.integer == 0 || (x.integer == min && y.integer == -1))
+						return nullptr;
+					return this->value_integer((u64_t) (x.integer % y.integer), bits);
+				case omis_op_t::EQ: return this->value_bool(x.integer == y.integer);
+				case omis_op_t::NE: return this->value_bool(x.integer != y.integer);
+				case omis_op_t::GT: return this->value_bool(x.integer > y.integer);
+				case omis_op_t::GE: return this->value_bool(x.integer >= y.integer);
+				case omis_op_t::LT: return this->value_bool(x.integer < y.integer);
+				case omis_op_t::LE: return this->value_bool(x.integer <= y.integer);
+				case omis_op_t::B_AND: return this->value_integer(u & v, bits);
+				case omis_op_t::B_OR: return this->value_integer(u | v, bits);
+				case omis_op_t::B_XOR: return this->value_integer(u ^ v, bits);
+				case omis_op_t::B_SHL:
+					if (y.integer < 0 || y.integer >= bits)
+						return nullptr;
+					return this->value_integer(u << v, bits);
+				case omis_op_t::B_SHR:
+					if (y.integer < 0 || y.integer >= bits)
+						return nullptr;
+					return this->value_integer((bits == 32 ? (u & 0xFFFFFFFFull) : u) >> v, bits);
+				default:
+					return nullptr;
+			}
+		}
+		
+		if (x.kind == omis_constant_t::BOOL && y.kind == omis_constant_t::BOOL) {
+			auto p = -x.integer;
+			auto q = -y.integer;
+			switch (op) {
+				case omis_op_t::EQ: return this->value_bool(p == q);
+				case omis_op_t::NE: return this->value_bool(p != q);
+				case omis_op_t::GT: return this->value_bool(p > q);
+				case omis_op_t::GE: return this->value_bool(p >= q);
+				case omis_op_t::LT: return this->value_bool(p < q);
+				case omis_op_t::LE: return this->value_bool(p <= q);
+				case omis_op_t::L_AND:
+				case omis_op_t::B_AND: return this->value_bool((x.integer & y.integer) != 0);
+				case omis_op_t::L_OR:
+				case omis_op_t::B_OR: return this->value_bool((x.integer | y.integer) != 0);
+				case omis_op_t::B_XOR: return this->value_bool((x.integer ^ y.integer) != 0);
+				default:
+					return nullptr;
+			}
+		}
+		
+		bool numeric_x = x.kind == omis_constant_t::INTEGER || x.kind == omis_constant_t::FLOAT;
+		bool numeric_y = y.kind == omis_constant_t::INTEGER || y.kind == omis_constant_t::FLOAT;
+		if (numeric_x && numeric_y) {
+			auto p = x.kind == omis_constant_t::FLOAT ? x.number : (f64_t) x.integer;
+			auto q = y.kind == omis_constant_t::FLOAT ? y.number : (f64_t) y.integer;
+			switch (op) {
+				case omis_op_t::ADD: return this->value_float(p + q);
+				case omis_op_t::SUB: return this->value_float(p - q);
+				case omis_op_t::MUL: return this->value_float(p * q);
+				case omis_op_t::DIV:
+					if (q == 0)
+						return nullptr;
+					return this->value_float(p / q);
+				case omis_op_t::MOD:
+					if (q == 0)
+						return nullptr;
+					return this->value_float(std::fmod(p, q));
+				case omis_op_t::EQ: return this->value_bool(p == q);
+				case omis_op_t::NE: return this->value_bool(p < q || p > q);
+				case omis_op_t::GT: return this->value_bool(p > q);
+				case omis_op_t::GE: return this->value_bool(p >= q);
+				case omis_op_t::LT: return this->value_bool(p < q);
+				case omis_op_t::LE: return this->value_bool(p <= q);
+				default:
+					return nullptr;
+			}
+		}
+		
+		return nullptr;
+	}
+	
+	omis_value_t *omis_module_t::create_dead_block() {
+		auto block = this->create_block("dead");
+		this->blocks[block].sealed = true;
+		this->set_active_block(block);
+		return block;
+	}
+	
+	bool omis_module_t::is_dead_block(omis_value_t *block) {
+		auto iter = this->blocks.find(block);
+		if (iter == this->blocks.end())
+			return false;
+		auto &state = iter->second;
+		return state.sealed && !state.entry && state.preds.empty();
+	}
+	
+	void omis_module_t::add_edge(omis_value_t *from, omis_value_t *to) {
+		this->blocks[from].succs.push_back(to);
+		this->blocks[to].preds.push_back(from);
+	}
+	
+	/**
+	 * SSA construction after Braun et al., "Simple and Efficient Construction of
+	 * Static Single Assignment Form".
+	 */
+	void omis_module_t::seal_block(omis_value_t *block) {
+		auto &state = this->blocks[block];
+		if (state.sealed)
+			return;
+		auto incomplete = state.incomplete;
+		state.incomplete.clear();
+		for (auto &pair: incomplete) {
+			this->add_phi_operands(pair.first, pair.second);
+		}
+		state.sealed = true;
+	}
+	
+	void omis_module_t::write_variable(omis_variable_t *variable, omis_value_t *block, omis_value_t *value) {
+		this->blocks[block].defs[variable] = value;
+	}
+	
+	omis_value_t *omis_module_t::read_variable(omis_variable_t *variable, omis_value_t *block) {
+		auto &defs = this->blocks[block].defs;
+		auto iter = defs.find(variable);
+		if (iter != defs.end())
+			return iter->second;
+		return this->read_variable_recursive(variable, block);
+	}
+	
+	omis_value_t *omis_module_t::read_variable_recursive(omis_variable_t *variable, omis_value_t *block) {
+		auto type = variable->get_type();
+		auto make_phi = [&]() -> omis_value_t * {
+			auto ret = bridge->block_phi(block->get_handle(), type->get_handle());
+			auto phi = this->value(type, ret);
+			phi->set_name(variable->get_name());
+			auto &phi_state = this->phis[phi];
+			phi_state.block = block;
+			phi_state.variable = variable;
+			return phi;
+		};
+		
+		auto &state = this->blocks[block];
+		omis_value_t *value = nullptr;
+		if (!state.sealed) {
+			value = make_phi();
+			state.incomplete[variable] = value;
+		} else if (state.preds.empty()) {
+			// not defined on the way here, or the block is unreachable.
+			value = this->value(type, bridge->get_default_value(type->get_handle()));
+		} else if (state.preds.size() == 1 && this->is_definition_cycle(variable, block)) {
+			value = this->value(type, bridge->get_default_value(type->get_handle()));
+		} else if (state.preds.size() == 1) {
+			value = this->read_variable(variable, state.preds.front());
+		} else {
+			auto phi = make_phi();
+			this->write_variable(variable, block, phi);
+			value = this->add_phi_operands(variable, phi);
+		}
+		
+		value = this->resolve_value(value);
+		this->write_variable(variable, block, value);
+		return value;
+	}
+	
+	/**
+	 * Blocks of unreachable code can form a loop in which each has one predecessor,
+	 * the variable is never defined on it and reading it would not end.
+	 */
+	bool omis_module_t::is_definition_cycle(omis_variable_t *variable, omis_value_t *block) {
+		HashSet<omis_value_t *> visited;
+		for (auto walk = block; visited.insert(walk).second;) {
+			auto &state = this->blocks[walk];
+			if (!state.sealed || state.preds.size() != 1)
+				return false;
+			if (walk != block && state.defs.find(variable) != state.defs.end())
+				return false;
+			walk = state.preds.front();
+		}
+		return true;
+	}
+	
+	omis_value_t *omis_module_t::add_phi_operands(omis_variable_t *variable, omis_value_t *phi) {
+		auto block = this->phis[phi].block;
+		auto preds = this->blocks[block].preds;
+		for (auto &pred: preds) {
+			auto value = this->read_variable(variable, pred);
+			this->escape(value);
+			this->phis[phi].operands.push_back(value);
+			bridge->add_incoming(phi->get_handle(), value->get_handle(), pred->get_handle());
+		}
+		this->phis[phi].complete = true;
+		return this->try_remove_trivial_phi(phi);
+	}
+	
+	/**
+	 * A phi that only merges one value with itself is that value. Removing it can
+	 * make the phis that used it trivial in turn.
+	 */
+	omis_value_t *omis_module_t::try_remove_trivial_phi(omis_value_t *phi) {
+		auto iter = this->phis.find(phi);
+		if (iter == this->phis.end())
+			return this->resolve_value(phi);
+		
+		omis_value_t *same = nullptr;
+		for (auto &operand: iter->second.operands) {
+			if (operand == same || operand == phi)
+				continue;
+			if (same != nullptr)
+				return phi;
+			same = operand;
+		}
+		if (same == nullptr) {
+			auto type = iter->second.variable->get_type();
+			same = this->value(type, bridge->get_default_value(type->get_handle()));
+		}
+		
+		std::vector<omis_value_t *> users;
+		for (auto &pair: this->phis) {
+			if (pair.first == phi)
+				continue;
+			for (auto &operand: pair.second.operands) {
+				if (operand == phi) {
+					users.push_back(pair.first);
+					break;
+				}
+			}
+		}
+		
+		bridge->replace_value(phi->get_handle(), same->get_handle());
+		this->replaced[phi] = same;
+		for (auto &pair: this->blocks) {
+			for (auto &def: pair.second.defs) {
+				if (def.second == phi)
+					def.second = same;
+			}
+			auto &exprs = pair.second.exprs;
+			for (auto expr = exprs.begin(); expr != exprs.end();) {
+				if (std::get<1>(expr->first) == phi || std::get<2>(expr->first) == phi)
+					expr = exprs.erase(expr);
+				else
+					++expr;
+			}
+		}
+		for (auto &pair: this->phis) {
+			for (auto &operand: pair.second.operands) {
+				if (operand == phi)
+					operand = same;
+			}
+		}
+		this->phis.erase(phi);
+		this->retire_value(phi->get_handle());
+		
+		for (auto &user: users) {
+			auto found = this->phis.find(user);
+			if (found != this->phis.end() && found->second.complete)
+				this->try_remove_trivial_phi(user);
+		}
+		
+		return this->resolve_value(same);
+	}
+	
+	omis_value_t *omis_module_t::resolve_value(omis_value_t *value) {
+		for (auto iter = this->replaced.find(value); iter != this->replaced.end(); iter = this->replaced.find(value)) {
+			value = iter->second;
+		}
+		return value;
+	}
+	
+	void omis_module_t::retire_value(omis_handle_t handle) {
+		auto iter = this->values.find(handle);
+		if (iter == this->values.end())
+			return;
+		this->retired.push_back(iter->second);
+		this->values.erase(iter);
+	}
+	
+	/// a function of runtime.h, declared in this module the first time it is used.
+	omis_value_t *omis_module_t::runtime_func(const String &name) {
+		auto iter = this->runtime_funcs.find(name);
+		if (iter != this->runtime_funcs.end())
+			return iter->second;
+		
+		auto bytes = this->type_bytes();
+		auto size = this->type_i64();
+		auto none = this->type_void();
+		omis_value_t *func = nullptr;
+		if (name == "eokas_alloc" || name == "eokas_region_alloc")
+			func = this->value_func(name, bytes, {size}, false);
+		else if (name == "eokas_region_enter")
+			func = this->value_func(name, bytes, {}, false);
+		else
+			func = this->value_func(name, none, {bytes}, false);
+		this->runtime_funcs[name] = func;
+		return func;
+	}
+	
+	void omis_module_t::escape(omis_value_t *value) {
+		auto owner = this->owners.find(value);
+		if (owner != this->owners.end())
+			this->allocs[owner->second].escaped = true;
+	}
+	
+	bool omis_module_t::is_in_cycle(omis_value_t *block) {
+		HashSet<omis_value_t *> visited;
+		std::vector<omis_value_t *> pending = this->blocks[block].succs;
+		while (!pending.empty()) {
+			auto walk = pending.back();
+			pending.pop_back();
+			if (walk == block)
+				return true;
+			if (!visited.insert(walk).second)
+				continue;
+			for (auto &succ: this->blocks[walk].succs) {
+				pending.push_back(succ);
+			}
+		}
+		return false;
+	}
+	
+	/**
+	 * What escapes stays on the heap. The rest is freed when the function returns
+	 * and its drops are deleted: a fixed size made once per call gets a slot in the
+	 * frame, anything else a region the function enters at its entry and leaves at
+	 * each return. Memory made in a loop and dropped there stays on the heap, a
+	 * region would keep every iteration of it until the return.
+	 */
+	void omis_module_t::place_allocs(omis_value_t *func, const HashSet<omis_value_t *> &reachable) {
+		static const i64_t MAX_STACK_COUNT = 64;
+		
+		bool regions = false;
+		for (auto iter = this->allocs.begin(); iter != this->allocs.end();) {
+			auto call = iter->first;
+			auto &state = iter->second;
+			if (this->blocks[state.block].func != func) {
+				++iter;
+				continue;
+			}
+			
+			if (reachable.contains(state.block) && !state.escaped) {
+				bool loop = this->is_in_cycle(state.block);
+				bool fixed = state.count == nullptr || (state.count->is_constant() &&
+				                                        state.count->get_constant().kind == omis_constant_t::INTEGER &&
+				                                        state.count->get_constant().integer <= MAX_STACK_COUNT);
+				if (!loop || state.drops.empty()) {
+					for (auto &drop: state.drops) {
+						bridge->retarget_call(drop->get_handle(), nullptr);
+						this->retire_value(drop->get_handle());
+					}
+					if (!loop && fixed) {
+						auto count = state.count != nullptr ? state.count->get_handle() : nullptr;
+						bridge->stack_alloc(call->get_handle(), state.type->get_handle(), count);
+						this->retire_value(call->get_handle());
+					}
+					else {
+						auto region_alloc = this->runtime_func("eokas_region_alloc");
+						bridge->retarget_call(call->get_handle(), region_alloc->get_handle());
+						regions = true;
+					}
+				}
+			}
+			
+			for (auto owner = this->owners.begin(); owner != this->owners.end();) {
+				if (owner->second == call)
+					owner = this->owners.erase(owner);
+				else
+					++owner;
+			}
+			iter = this->allocs.erase(iter);
+		}
+		if (!regions)
+			return;
+		
+		auto enter = this->runtime_func("eokas_region_enter");
+		auto leave = this->runtime_func("eokas_region_leave");
+		omis_handle_t mark = nullptr;
+		for (auto &pair: this->blocks) {
+			if (pair.second.func == func && pair.second.entry)
+				mark = bridge->block_call(pair.first->get_handle(), enter->get_handle(), {}, true);
+		}
+		// every block the entry reaches ends in a jump or a return, the ones without successors return.
+		for (auto &pair: this->blocks) {
+			if (pair.second.func == func && reachable.contains(pair.first) && pair.second.succs.empty())
+				bridge->block_call(pair.first->get_handle(), leave->get_handle(), {mark}, false);
+		}
+	}
 }
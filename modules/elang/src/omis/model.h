@@ -7,7 +7,7 @@
 namespace eokas {
     template<typename T, bool gc = true>
     struct omis_table_t {
-    	using container_t = std::map<String, T*>;
+    	using container_t = HashMap<Symbol, T*>;
     	using iterator_t = typename container_t::iterator;
     	using const_iterator_t = typename container_t::const_iterator;
 
@@ -40,13 +40,14 @@ namespace eokas {
     	}
 
     	bool add(const String &name, T *object) {
-    		if (this->table.find(name) != this->table.end())
-    			return false;
-    		this->table.insert(std::make_pair(name, object));
-    		return true;
+    		return this->table.insert(std::make_pair(Symbol(name), object)).second;
     	}
 
     	T *get(const String &name) {
+    		return this->get(HashKey(name));
+    	}
+
+    	T *get(const HashKey &name) {
     		auto iter = this->table.find(name);
     		if (iter == this->table.end())
     			return nullptr;
@@ -55,7 +56,7 @@ namespace eokas {
 
     	T *get(const std::function<bool(const String&, const T&)>& predicate) {
     		for(auto& pair : this->table) {
-    			if(predicate(pair.first, *pair.second)) {
+    			if(predicate(pair.first.str(), *pair.second)) {
     				return pair.second;
     			}
     		}
@@ -80,7 +81,7 @@ namespace eokas {
     {
         omis_scope_t* parent;
         omis_value_t* func;
-        std::vector<omis_scope_t*> children;
+        SmallVector<omis_scope_t*, 4> children;
 
         omis_table_t<omis_type_symbol_t> types;
         omis_table_t<omis_value_symbol_t> values;
@@ -92,13 +93,33 @@ namespace eokas {
 
         bool add_type_symbol(const String& name, omis_type_t* type);
         omis_type_symbol_t* get_type_symbol(const String& name, bool lookup);
+        omis_type_symbol_t* get_type_symbol(const HashKey& name, bool lookup);
         omis_type_symbol_t* get_type_symbol(omis_lambda_predicate_t<omis_type_symbol_t> predicate, bool lookup);
 
         bool add_value_symbol(const String& name, omis_value_t* value);
         omis_value_symbol_t* get_value_symbol(const String& name, bool lookup);
+        omis_value_symbol_t* get_value_symbol(const HashKey& name, bool lookup);
         omis_value_symbol_t* get_value_symbol(omis_lambda_predicate_t<omis_value_symbol_t> predicate, bool lookup);
     };
 
+    /// the pure operations, which are folded on constants and reused within a block.
+    enum class omis_op_t {
+        NEG, ADD, SUB, MUL, DIV, MOD,
+        EQ, NE, GT, GE, LT, LE,
+        L_NOT, L_AND, L_OR,
+        B_FLIP, B_AND, B_OR, B_XOR, B_SHL, B_SHR
+    };
+
+    /// a value the module made as a constant, integers are kept sign extended to 64 bits.
+    struct omis_constant_t {
+        enum kind_t { NONE, INTEGER, FLOAT, BOOL };
+
+        kind_t kind = NONE;
+        u32_t bits = 0;
+        i64_t integer = 0;
+        f64_t number = 0;
+    };
+
     class omis_module_t {
     public:
         omis_module_t(omis_context_t* context, const String& name);
@@ -111,8 +132,13 @@ namespace eokas {
         const String& get_name() const;
         omis_handle_t get_handle() const;
         String dump() const;
+        /// the exported symbols, one "type <name> <type>" line each and sorted, which
+        /// is all an importer sees of the module.
+        String get_interface() const;
+        bool save(const String& path) const;
 
         bool using_module(const String& name);
+        const std::map<String, omis_module_t*>& get_dependencies() const;
 
         omis_scope_t* get_scope();
         omis_scope_t* push_scope(omis_value_t* func = nullptr);
@@ -120,8 +146,10 @@ namespace eokas {
 
     	bool add_type_symbol(const String& name, omis_type_t* type);
         omis_type_symbol_t* get_type_symbol(const String& name, bool lookup = true);
+        omis_type_symbol_t* get_type_symbol(const HashKey& name, bool lookup = true);
     	bool add_value_symbol(const String& name, omis_value_t* type);
         omis_value_symbol_t* get_value_symbol(const String& name, bool lookup = true);
+        omis_value_symbol_t* get_value_symbol(const HashKey& name, bool lookup = true);
 
         omis_type_t* type(omis_handle_t handle);
         omis_type_t* type_void();
@@ -135,6 +163,7 @@ namespace eokas {
         omis_type_t* type_bytes();
         omis_type_t* type_pointer(omis_type_t* type);
         omis_type_t* type_func(omis_type_t* ret, const std::vector<omis_type_t*>& args, bool varg);
+        omis_type_t* type_vector(omis_type_t* element, u32_t lanes);
 		String get_type_name(omis_type_t* type);
         omis_value_t* get_type_size(omis_type_t* type);
         bool can_losslessly_bitcast(omis_type_t* a, omis_type_t* b);
@@ -146,6 +175,8 @@ namespace eokas {
         omis_value_t* value_bool(bool val);
         omis_value_t* value_string(const String& val);
         omis_value_t* value_func(const String& name, omis_type_t* ret, const std::vector<omis_type_t*>& args, bool varg);
+        /// a vector of the lanes, a single value fills them all.
+        omis_value_t* value_vector(omis_type_t* type, const std::vector<omis_value_t*>& lanes);
 
 		omis_type_t* get_func_ret_type(omis_value_t* func);
 		uint32_t get_func_arg_count(omis_value_t* func);
@@ -162,6 +193,7 @@ namespace eokas {
 		bool is_terminator_ins(omis_value_t* ins = nullptr);
 		
 		omis_value_t* alloc(const String& name, omis_type_t* type, omis_value_t* value = nullptr);
+		omis_value_t* variable(const String& name, omis_type_t* type, omis_value_t* value);
 		omis_value_t* load(omis_value_t* ptr);
 		omis_value_t* store(omis_value_t* ptr, omis_value_t* val);
 		omis_value_t* neg(omis_value_t* a);
@@ -190,11 +222,15 @@ namespace eokas {
 		omis_value_t* phi(omis_type_t* type, const std::map<omis_value_t*, omis_value_t*>& incomings);
 		omis_value_t* call(omis_value_t* func, const std::vector<omis_value_t*>& args);
 		omis_value_t* call(const String& func, const std::vector<omis_value_t*>& args);
+		omis_value_t* call(const HashKey& func, const std::vector<omis_value_t*>& args);
 		omis_value_t* ret(omis_value_t* value = nullptr);
 		omis_value_t* bitcast(omis_value_t* value, omis_type_t* type);
+		omis_value_t* insert_element(omis_value_t* vec, omis_value_t* value, omis_value_t* index);
+		omis_value_t* extract_element(omis_value_t* vec, omis_value_t* index);
 		
 		omis_value_t* get_ptr_val(omis_value_t* val);
 		omis_value_t* get_ptr_ref(omis_value_t* val);
+		/// a pointer to one value of type, or to an i64 count of them, end_func decides where they live.
 		omis_value_t* make(omis_type_t* type);
 		omis_value_t* make(omis_type_t* type, omis_value_t* count);
 		omis_value_t* drop(omis_value_t* ptr);
@@ -215,6 +251,67 @@ namespace eokas {
 		bool stmt_break();
 		bool stmt_continue();
 		void stmt_ensure_tail_ret(omis_value_t* func);
+		void end_func(omis_value_t* func);
+		
+	protected:
+		/**
+		 * The function being encoded is kept in SSA form as it is emitted. A block
+		 * knows its edges, the value each variable has at its end, and the pure
+		 * operations already done in it. It is sealed once all its predecessors are
+		 * known, a variable read in it before that gets a phi completed at sealing.
+		 */
+		struct block_state_t {
+			omis_value_t* func = nullptr;
+			bool entry = false;
+			bool sealed = false;
+			std::vector<omis_value_t*> preds;
+			std::vector<omis_value_t*> succs;
+			std::map<omis_variable_t*, omis_value_t*> defs;
+			std::map<omis_variable_t*, omis_value_t*> incomplete;
+			std::map<std::tuple<omis_op_t, omis_value_t*, omis_value_t*>, omis_value_t*> exprs;
+		};
+
+		struct phi_state_t {
+			omis_value_t* block = nullptr;
+			omis_variable_t* variable = nullptr;
+			bool complete = false;
+			std::vector<omis_value_t*> operands;
+		};
+
+		/**
+		 * The memory make asked for and the drops of it. It escapes once the pointer,
+		 * or a cast of it, is stored, passed, returned or merged with another value.
+		 */
+		struct alloc_state_t {
+			omis_value_t* block = nullptr;
+			omis_type_t* type = nullptr;
+			omis_value_t* count = nullptr;
+			bool escaped = false;
+			std::vector<omis_value_t*> drops;
+		};
+
+		omis_value_t* pure(omis_op_t op, omis_value_t* a, omis_value_t* b, const std::function<omis_value_t*()>& emit);
+		omis_value_t* fold(omis_op_t op, omis_value_t* a, omis_value_t* b);
+		/// the type of a, or that of b when only b is a vector, a scalar meets a vector lane by lane.
+		omis_type_t* type_operands(omis_value_t* a, omis_value_t* b);
+		/// bool, or a vector of as many bools as the lanes of the operands.
+		omis_type_t* type_compare(omis_value_t* a, omis_value_t* b);
+		omis_value_t* create_dead_block();
+		bool is_dead_block(omis_value_t* block);
+		void add_edge(omis_value_t* from, omis_value_t* to);
+		void seal_block(omis_value_t* block);
+		void write_variable(omis_variable_t* variable, omis_value_t* block, omis_value_t* value);
+		omis_value_t* read_variable(omis_variable_t* variable, omis_value_t* block);
+		omis_value_t* read_variable_recursive(omis_variable_t* variable, omis_value_t* block);
+		bool is_definition_cycle(omis_variable_t* variable, omis_value_t* block);
+		omis_value_t* add_phi_operands(omis_variable_t* variable, omis_value_t* phi);
+		omis_value_t* try_remove_trivial_phi(omis_value_t* phi);
+		omis_value_t* resolve_value(omis_value_t* value);
+		void retire_value(omis_handle_t handle);
+		omis_value_t* runtime_func(const String& name);
+		void escape(omis_value_t* value);
+		bool is_in_cycle(omis_value_t* block);
+		void place_allocs(omis_value_t* func, const HashSet<omis_value_t*>& reachable);
 		
 	protected:
     	omis_context_t* context;
@@ -228,10 +325,22 @@ namespace eokas {
     	omis_scope_t* imports;
     	omis_scope_t* exports;
 
-        std::map<omis_handle_t, omis_type_t*> types;
-        std::map<omis_handle_t, omis_value_t*> values;
+        HashMap<omis_handle_t, omis_type_t*> types;
+        HashMap<omis_handle_t, omis_value_t*> values;
 		omis_value_t* break_point;
 		omis_value_t* continue_point;
+
+		std::map<omis_value_t*, block_state_t> blocks;
+		std::map<omis_value_t*, phi_state_t> phis;
+		/// phis found trivial and what they were replaced with.
+		std::map<omis_value_t*, omis_value_t*> replaced;
+		std::vector<omis_variable_t*> variables;
+		/// the calls make emitted, and the values that are them or casts of them.
+		std::map<omis_value_t*, alloc_state_t> allocs;
+		std::map<omis_value_t*, omis_value_t*> owners;
+		std::map<String, omis_value_t*> runtime_funcs;
+		/// values whose instructions are gone, kept until the module goes.
+		std::vector<omis_value_t*> retired;
     };
 
     class omis_type_t {
@@ -255,6 +364,8 @@ namespace eokas {
         bool is_type_func();
         bool is_type_array();
         bool is_type_struct();
+        bool is_type_vector();
+        u32_t get_vector_lanes();
 
         omis_type_t* get_pointer_type();
 
@@ -302,10 +413,33 @@ namespace eokas {
         omis_handle_t get_handle();
         void set_name(const String& name);
 
+        bool is_constant() const;
+        const omis_constant_t& get_constant() const;
+        void set_constant(const omis_constant_t& constant);
+
     protected:
         omis_module_t* module;
         omis_type_t* type;
         omis_handle_t handle;
+        omis_constant_t constant;
+    };
+
+    /**
+     * A local symbol, which nothing can take the address of, so it needs no stack
+     * slot. It has no handle of its own, reading it gives the SSA value it has in
+     * the active block and storing to it makes a new one.
+     */
+    class omis_variable_t :public omis_value_t {
+    public:
+        omis_variable_t(omis_module_t* module, omis_type_t* type, omis_value_t* func, const String& name);
+        virtual ~omis_variable_t();
+
+        omis_value_t* get_func();
+        const String& get_name() const;
+
+    protected:
+        omis_value_t* func;
+        String name;
     };
 }
 
@@ -0,0 +1,209 @@
+
+#include "./runtime.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <mutex>
+
+namespace eokas {
+    // classes of 16 << index bytes, a block carries its class in the 16 bytes before it.
+    static const u32_t RUNTIME_CLASSES = 9;
+    static const u32_t RUNTIME_LARGE = RUNTIME_CLASSES;
+    static const size_t RUNTIME_HEADER = 16;
+    static const size_t RUNTIME_SLAB = 64 * 1024;
+    static const size_t RUNTIME_CHUNK = 64 * 1024;
+
+    struct runtime_block_t {
+        runtime_block_t* next;
+    };
+
+    /// free lists a thread left behind when it exited, the next new thread takes them.
+    struct runtime_depot_t {
+        std::mutex mutex;
+        runtime_block_t* free[RUNTIME_CLASSES] = {};
+    };
+
+    static runtime_depot_t& runtime_depot() {
+        // never destroyed, threads may still exit after the statics are gone.
+        static runtime_depot_t* depot = new runtime_depot_t();
+        return *depot;
+    }
+
+    struct runtime_heap_t {
+        runtime_block_t* free[RUNTIME_CLASSES] = {};
+        u8_t* cursor = nullptr;
+        u8_t* limit = nullptr;
+
+        runtime_heap_t() {
+            auto& depot = runtime_depot();
+            std::lock_guard<std::mutex> lock(depot.mutex);
+            for(u32_t index = 0; index < RUNTIME_CLASSES; index++) {
+                free[index] = depot.free[index];
+                depot.free[index] = nullptr;
+            }
+        }
+
+        // other threads may still hold blocks of the slabs, so they are never released.
+        ~runtime_heap_t() {
+            auto& depot = runtime_depot();
+            std::lock_guard<std::mutex> lock(depot.mutex);
+            for(u32_t index = 0; index < RUNTIME_CLASSES; index++) {
+                while(free[index] != nullptr) {
+                    auto block = free[index];
+                    free[index] = block->next;
+                    block->next = depot.free[index];
+                    depot.free[index] = block;
+                }
+            }
+        }
+
+        u8_t* carve(size_t size) {
+            if(cursor == nullptr || cursor + size > limit) {
+                cursor = (u8_t*)std::malloc(RUNTIME_SLAB);
+                if(cursor == nullptr)
+                    return nullptr;
+                limit = cursor + RUNTIME_SLAB;
+            }
+            auto ptr = cursor;
+            cursor += size;
+            return ptr;
+        }
+    };
+
+    struct runtime_chunk_t {
+        runtime_chunk_t* prev;
+        u8_t* limit;
+    };
+
+    struct runtime_region_t {
+        runtime_chunk_t* top = nullptr;
+        runtime_chunk_t* spare = nullptr;
+        u8_t* cursor = nullptr;
+
+        ~runtime_region_t() {
+            this->leave(nullptr);
+            std::free(spare);
+        }
+
+        static u8_t* begin(runtime_chunk_t* chunk) {
+            return (u8_t*)chunk + RUNTIME_HEADER;
+        }
+
+        u8_t* alloc(size_t size) {
+            if(top == nullptr || cursor + size > top->limit) {
+                size_t capacity = std::max(size, RUNTIME_CHUNK - RUNTIME_HEADER);
+                runtime_chunk_t* chunk = nullptr;
+                if(spare != nullptr && capacity == RUNTIME_CHUNK - RUNTIME_HEADER) {
+                    chunk = spare;
+                    spare = nullptr;
+                }
+                else {
+                    chunk = (runtime_chunk_t*)std::malloc(RUNTIME_HEADER + capacity);
+                    if(chunk == nullptr)
+                        return nullptr;
+                    chunk->limit = begin(chunk) + capacity;
+                }
+                chunk->prev = top;
+                top = chunk;
+                cursor = begin(chunk);
+            }
+            auto ptr = cursor;
+            cursor += size;
+            return ptr;
+        }
+
+        /// pop the chunks the mark is not in, the last one of the default size is kept for the next region.
+        void leave(u8_t* mark) {
+            while(top != nullptr && (mark < begin(top) || mark > top->limit)) {
+                auto chunk = top;
+                top = chunk->prev;
+                if(spare == nullptr && chunk->limit == begin(chunk) + RUNTIME_CHUNK - RUNTIME_HEADER) {
+                    spare = chunk;
+                }
+                else {
+                    std::free(chunk);
+                }
+            }
+            cursor = top != nullptr ? mark : nullptr;
+        }
+    };
+
+    static thread_local runtime_heap_t tRuntimeHeap;
+    static thread_local runtime_region_t tRuntimeRegion;
+
+    static u32_t runtime_class_of(size_t size) {
+        u32_t index = 0;
+        while(index < RUNTIME_CLASSES && ((size_t)16 << index) < size) {
+            index++;
+        }
+        return index;
+    }
+
+    static void runtime_out_of_memory(i64_t size) {
+        printf("ERROR: Out of memory, %lld bytes requested.\n", (long long)size);
+        std::abort();
+    }
+
+    const std::vector<omis_runtime_symbol_t>& omis_runtime_symbols() {
+        static const std::vector<omis_runtime_symbol_t> symbols = {
+            {"eokas_alloc", (void*)&eokas_alloc},
+            {"eokas_free", (void*)&eokas_free},
+            {"eokas_region_enter", (void*)&eokas_region_enter},
+            {"eokas_region_alloc", (void*)&eokas_region_alloc},
+            {"eokas_region_leave", (void*)&eokas_region_leave},
+        };
+        return symbols;
+    }
+}
+
+using namespace eokas;
+
+void* eokas_alloc(i64_t size) {
+    size_t bytes = size > 0 ? (size_t)size : 1;
+    u32_t index = runtime_class_of(bytes);
+    u8_t* block = nullptr;
+    if(index == RUNTIME_LARGE) {
+        block = (u8_t*)std::malloc(RUNTIME_HEADER + bytes);
+    }
+    else if(auto head = tRuntimeHeap.free[index]) {
+        tRuntimeHeap.free[index] = head->next;
+        block = (u8_t*)head - RUNTIME_HEADER;
+    }
+    else {
+        block = tRuntimeHeap.carve(RUNTIME_HEADER + ((size_t)16 << index));
+    }
+    if(block == nullptr)
+        runtime_out_of_memory(size);
+    *(u32_t*)block = index;
+    return block + RUNTIME_HEADER;
+}
+
+void eokas_free(void* ptr) {
+    if(ptr == nullptr)
+        return;
+    u8_t* block = (u8_t*)ptr - RUNTIME_HEADER;
+    u32_t index = *(u32_t*)block;
+    if(index == RUNTIME_LARGE) {
+        std::free(block);
+        return;
+    }
+    auto head = (runtime_block_t*)ptr;
+    head->next = tRuntimeHeap.free[index];
+    tRuntimeHeap.free[index] = head;
+}
+
+void* eokas_region_enter() {
+    return tRuntimeRegion.cursor;
+}
+
+void* eokas_region_alloc(i64_t size) {
+    size_t bytes = size > 0 ? ((size_t)size + 15) & ~(size_t)15 : 16;
+    auto ptr = tRuntimeRegion.alloc(bytes);
+    if(ptr == nullptr)
+        runtime_out_of_memory(size);
+    return ptr;
+}
+
+void eokas_region_leave(void* mark) {
+    tRuntimeRegion.leave((u8_t*)mark);
+}
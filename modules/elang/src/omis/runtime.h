@@ -0,0 +1,37 @@
+
+#ifndef _EOKAS_OMIS_RUNTIME_H_
+#define _EOKAS_OMIS_RUNTIME_H_
+
+#include "./header.h"
+
+/*
+The allocator behind make and drop. eokas_alloc hands out blocks of a few size
+classes from pools of the calling thread, larger ones come from malloc.
+eokas_free returns a block to the pool of the thread that frees it.
+
+A region belongs to a function and is a bump pointer on a stack of chunks of the
+thread, eokas_region_enter marks the top and eokas_region_leave frees all that was
+allocated since the mark at once. The encoder puts what does not escape the
+function that made it there, see omis_module_t::end_func.
+*/
+
+extern "C" {
+    void* eokas_alloc(eokas::i64_t size);
+    void eokas_free(void* ptr);
+    void* eokas_region_enter();
+    void* eokas_region_alloc(eokas::i64_t size);
+    void eokas_region_leave(void* mark);
+}
+
+namespace eokas {
+    struct omis_runtime_symbol_t {
+        const char* name;
+        void* address;
+    };
+
+    /// the functions above, the jit defines them before it looks into the process,
+    /// an object or archive gets private ones on malloc and free instead.
+    const std::vector<omis_runtime_symbol_t>& omis_runtime_symbols();
+}
+
+#endif //_EOKAS_OMIS_RUNTIME_H_
@@ -0,0 +1,1454 @@
+#include "vm.h"
+
+#include "../bridge.h"
+#include "../model.h"
+#include "../llvm/llvm.h"
+
+#include <algorithm>
+#include <cmath>
+
+/*
+Tiered execution. The vm bridge forwards every call to the llvm bridge, so the
+module is encoded to IR as before, and on the way it records a register
+bytecode of each function. jit() interprets the bytecode, which needs no code
+generation at all, and counts the calls and the loop back edges of each
+function; a hot function is compiled by the lazy jit session of the llvm bridge
+and is called natively from its next entry on. A function the bytecode can not
+express (phi, aggregates, indirect calls) is native from its first call.
+*/
+
+// gcc and clang dispatch through a table of labels, one indirect jump per instruction.
+#if defined(__GNUC__) || defined(__clang__)
+#define _VM_COMPUTED_GOTO 1
+#else
+#define _VM_COMPUTED_GOTO 0
+#endif
+
+// Native calls go through a variadic thunk that passes int and float arguments in
+// separate registers, which only matches the calling convention of these targets.
+#if (_EOKAS_ARCH == _EOKAS_ARCH_X64 && _EOKAS_OS != _EOKAS_OS_WIN64) || \
+    (_EOKAS_ARCH == _EOKAS_ARCH_ARM64 && _EOKAS_OS != _EOKAS_OS_MACOS && _EOKAS_OS != _EOKAS_OS_IOS)
+#define _VM_NATIVE_FLOAT_ARGS 1
+#else
+#define _VM_NATIVE_FLOAT_ARGS 0
+#endif
+
+#define _VmOps(_) \
+    _(MOV) _(ALLOCA) \
+    _(LD_U1) _(LD_I8) _(LD_I16) _(LD_I32) _(LD_I64) _(LD_F32) _(LD_F64) \
+    _(ST_I8) _(ST_I16) _(ST_I32) _(ST_I64) _(ST_F32) _(ST_F64) \
+    _(ADD_I32) _(SUB_I32) _(MUL_I32) _(DIV_I32) _(REM_I32) \
+    _(ADD_I64) _(SUB_I64) _(MUL_I64) _(DIV_I64) _(REM_I64) \
+    _(ADD_F) _(SUB_F) _(MUL_F) _(DIV_F) _(REM_F) \
+    _(NEG_I32) _(NEG_I64) _(NEG_F) \
+    _(I2F) _(ROUND_F32) _(SEXT) \
+    _(AND) _(OR) _(XOR) _(SHL) _(SHR) \
+    _(EQ_I) _(NE_I) _(LT_I) _(LE_I) _(GT_I) _(GE_I) \
+    _(EQ_F) _(NE_F) _(LT_F) _(LE_F) _(GT_F) _(GE_F) \
+    _(JMP) _(LOOP) _(BR) _(CALL) _(RET) _(RET_VOID)
+
+namespace eokas
+{
+    static const u32_t VM_HOT_CALLS = 1000;
+    static const u32_t VM_HOT_LOOPS = 10000;
+    static const u32_t VM_NATIVE_INT_ARGS = 6;
+    static const u32_t VM_NATIVE_FLOAT_ARGS = 8;
+
+    #define _VmOpEnum(name) VM_##name,
+    enum vm_op_t : u16_t {
+        _VmOps(_VmOpEnum)
+    };
+    #undef _VmOpEnum
+
+    /// integers are kept sign extended to 64 bits, bool as 0 / 1 and f32 as f64.
+    enum class vm_kind_t : u8_t {
+        VOID, I1, I8, I16, I32, I64, F32, F64, PTR, OTHER
+    };
+
+    union vm_value_t {
+        i64_t i;
+        f64_t f;
+        void* p;
+    };
+
+    /**
+     * dst is the result register, a and b the operands. Jumps hold the block index
+     * while recording and the pc once linked, BR goes to b when a is true and to dst
+     * otherwise, CALL refers to the call site a.
+     */
+    struct vm_ins_t {
+        u16_t op;
+        u16_t aux;
+        u32_t dst;
+        u32_t a;
+        u32_t b;
+    };
+
+    struct vm_func_t;
+
+    struct vm_call_site_t {
+        omis_handle_t callee = nullptr;
+        /// inline cache of the callee, resolved before the first run.
+        vm_func_t* target = nullptr;
+        vm_kind_t ret = vm_kind_t::VOID;
+        /// the arguments fit the native call thunk.
+        bool native = true;
+        SmallVector<u32_t, 8> args;
+        SmallVector<vm_kind_t, 8> kinds;
+    };
+
+    struct vm_func_t {
+        omis_handle_t handle = nullptr;
+        omis_handle_t module = nullptr;
+        String name;
+        vm_kind_t ret = vm_kind_t::VOID;
+        u32_t arg_count = 0;
+
+        std::vector<std::vector<vm_ins_t>> blocks;
+        std::vector<vm_ins_t> code;
+        /// initial registers, the arguments first and the constants in place.
+        std::vector<vm_value_t> frame;
+        std::vector<vm_call_site_t> sites;
+        HashMap<omis_handle_t, u32_t> regs;
+        /// bytes of the alloca slots, 8 each.
+        u32_t locals = 0;
+        bool linked = false;
+        bool unsupported = false;
+
+        u32_t calls = 0;
+        u32_t loops = 0;
+        void* native = nullptr;
+        bool promotable = true;
+
+        bool is_external() const {
+            return blocks.empty();
+        }
+
+        bool is_hot() const {
+            return calls >= VM_HOT_CALLS || loops >= VM_HOT_LOOPS;
+        }
+    };
+
+    static bool vm_is_int(vm_kind_t kind) {
+        return (kind >= vm_kind_t::I1 && kind <= vm_kind_t::I64) || kind == vm_kind_t::PTR;
+    }
+
+    static bool vm_is_float(vm_kind_t kind) {
+        return kind == vm_kind_t::F32 || kind == vm_kind_t::F64;
+    }
+
+    static u32_t vm_bits(vm_kind_t kind) {
+        switch(kind) {
+            case vm_kind_t::I1: return 1;
+            case vm_kind_t::I8: return 8;
+            case vm_kind_t::I16: return 16;
+            case vm_kind_t::I32: return 32;
+            default: return 64;
+        }
+    }
+
+    static u32_t vm_size(vm_kind_t kind) {
+        switch(kind) {
+            case vm_kind_t::I1:
+            case vm_kind_t::I8: return 1;
+            case vm_kind_t::I16: return 2;
+            case vm_kind_t::I32:
+            case vm_kind_t::F32: return 4;
+            default: return 8;
+        }
+    }
+
+    static i64_t vm_sext(i64_t value, u32_t bits) {
+        if(bits == 1)
+            return value & 1;
+        if(bits >= 64)
+            return value;
+        return (i64_t)((u64_t)value << (64 - bits)) >> (64 - bits);
+    }
+
+    static u64_t vm_zext(i64_t value, u32_t bits) {
+        return bits >= 64 ? (u64_t)value : (u64_t)value & ((1ull << bits) - 1);
+    }
+
+    static vm_value_t vm_normalize(vm_kind_t kind, vm_value_t value) {
+        if(vm_is_int(kind))
+            value.i = vm_sext(value.i, vm_bits(kind));
+        return value;
+    }
+
+    using vm_native_int_t = i64_t(*)(i64_t, i64_t, i64_t, i64_t, i64_t, i64_t, ...);
+    using vm_native_float_t = f64_t(*)(i64_t, i64_t, i64_t, i64_t, i64_t, i64_t, ...);
+
+    /**
+     * The int arguments fill the named parameters, the f64 ones go as variadic
+     * arguments and so land in the float registers in order; a callee reads the
+     * registers its own signature names and ignores the rest.
+     */
+    static vm_value_t vm_call_native(void* address, const vm_call_site_t& site, const vm_value_t* R) {
+        i64_t ints[VM_NATIVE_INT_ARGS] = {0};
+        f64_t floats[VM_NATIVE_FLOAT_ARGS] = {0};
+        u32_t intCount = 0;
+        u32_t floatCount = 0;
+        for(size_t index = 0; index < site.args.size(); index++) {
+            const vm_value_t& arg = R[site.args[index]];
+            if(site.kinds[index] == vm_kind_t::F64)
+                floats[floatCount++] = arg.f;
+            else
+                ints[intCount++] = arg.i;
+        }
+
+        vm_value_t ret{};
+        if(site.ret == vm_kind_t::F64) {
+            ret.f = ((vm_native_float_t)address)(ints[0], ints[1], ints[2], ints[3], ints[4], ints[5],
+                floats[0], floats[1], floats[2], floats[3], floats[4], floats[5], floats[6], floats[7]);
+        }
+        else {
+            ret.i = ((vm_native_int_t)address)(ints[0], ints[1], ints[2], ints[3], ints[4], ints[5],
+                floats[0], floats[1], floats[2], floats[3], floats[4], floats[5], floats[6], floats[7]);
+        }
+        return vm_normalize(site.ret, ret);
+    }
+
+    struct vm_bridge_t :public omis_bridge_t {
+        omis_bridge_t* inner;
+
+        HashMap<omis_handle_t, vm_func_t*> funcs;
+        HashMap<omis_handle_t, std::pair<vm_func_t*, u32_t>> blocks;
+        HashMap<omis_handle_t, vm_value_t> constants;
+        HashMap<omis_handle_t, vm_kind_t> kinds;
+        /// a phi reads a shadow register at the start of its block, each predecessor
+        /// sets the shadow before its jump, so all the phis of a block move at once.
+        HashMap<omis_handle_t, std::pair<vm_func_t*, u32_t>> phis;
+        /// the function and the site of each call, end_func rewrites some of them.
+        HashMap<omis_handle_t, std::pair<vm_func_t*, u32_t>> calls;
+
+        // where the encoder emits to.
+        vm_func_t* active_func;
+        u32_t active_block;
+
+        // the script being run, hot functions are compiled along with it.
+        omis_handle_t run_module;
+        omis_handle_list_t run_imports;
+        omis_compile_options_t run_options;
+        double promote_time;
+
+        explicit vm_bridge_t(omis_bridge_t* inner)
+            : omis_bridge_t()
+            , inner(inner)
+            , funcs()
+            , blocks()
+            , constants()
+            , kinds()
+            , phis()
+            , calls()
+            , active_func(nullptr)
+            , active_block(0)
+            , run_module(nullptr)
+            , run_imports()
+            , run_options()
+            , promote_time(0) {
+        }
+
+        virtual ~vm_bridge_t() {
+            for(auto& pair : funcs) {
+                delete pair.second;
+            }
+            funcs.clear();
+            llvm_quit(inner);
+        }
+
+        virtual omis_handle_t make_module(const String& name) override {
+            return inner->make_module(name);
+        }
+
+        virtual void drop_module(omis_handle_t mod) override {
+            std::vector<omis_handle_t> droppedFuncs;
+            for(auto& pair : funcs) {
+                if(pair.second->module == mod)
+                    droppedFuncs.push_back(pair.first);
+            }
+            std::vector<omis_handle_t> droppedBlocks;
+            for(auto& pair : blocks) {
+                if(pair.second.first->module == mod)
+                    droppedBlocks.push_back(pair.first);
+            }
+            for(auto& block : droppedBlocks) {
+                blocks.erase(block);
+            }
+            std::vector<omis_handle_t> droppedPhis;
+            for(auto& pair : phis) {
+                if(pair.second.first->module == mod)
+                    droppedPhis.push_back(pair.first);
+            }
+            for(auto& phi : droppedPhis) {
+                phis.erase(phi);
+            }
+            std::vector<omis_handle_t> droppedCalls;
+            for(auto& pair : calls) {
+                if(pair.second.first->module == mod)
+                    droppedCalls.push_back(pair.first);
+            }
+            for(auto& call : droppedCalls) {
+                calls.erase(call);
+            }
+            for(auto& handle : droppedFuncs) {
+                vm_func_t* func = *funcs.get(handle);
+                if(active_func == func)
+                    active_func = nullptr;
+                funcs.erase(handle);
+                delete func;
+            }
+
+            inner->drop_module(mod);
+        }
+
+        virtual String dump_module(omis_handle_t mod) override {
+            return inner->dump_module(mod);
+        }
+
+        virtual bool save_module(omis_handle_t mod, const String& path) override {
+            return inner->save_module(mod, path);
+        }
+
+        // a loaded module has no bytecode, scripts that reach into it are jitted.
+        virtual omis_handle_t load_module(const String& name, const String& path) override {
+            return inner->load_module(name, path);
+        }
+
+        virtual omis_handle_t type_void() override {
+            return inner->type_void();
+        }
+
+        virtual omis_handle_t type_i8() override {
+            return inner->type_i8();
+        }
+
+        virtual omis_handle_t type_i16() override {
+            return inner->type_i16();
+        }
+
+        virtual omis_handle_t type_i32() override {
+            return inner->type_i32();
+        }
+
+        virtual omis_handle_t type_i64() override {
+            return inner->type_i64();
+        }
+
+        virtual omis_handle_t type_u8() override {
+            return inner->type_u8();
+        }
+
+        virtual omis_handle_t type_u16() override {
+            return inner->type_u16();
+        }
+
+        virtual omis_handle_t type_u32() override {
+            return inner->type_u32();
+        }
+
+        virtual omis_handle_t type_u64() override {
+            return inner->type_u64();
+        }
+
+        virtual omis_handle_t type_f32() override {
+            return inner->type_f32();
+        }
+
+        virtual omis_handle_t type_f64() override {
+            return inner->type_f64();
+        }
+
+        virtual omis_handle_t type_bool() override {
+            return inner->type_bool();
+        }
+
+        virtual omis_handle_t type_bytes() override {
+            return inner->type_bytes();
+        }
+
+        virtual omis_handle_t type_pointer(omis_handle_t type) override {
+            return inner->type_pointer(type);
+        }
+
+        virtual omis_handle_t type_vector(omis_handle_t element, uint32_t lanes) override {
+            return inner->type_vector(element, lanes);
+        }
+
+        virtual omis_handle_t type_func(omis_handle_t ret, const omis_handle_list_t& args, bool varg) override {
+            return inner->type_func(ret, args, varg);
+        }
+
+        virtual bool is_type_void(omis_handle_t type) override {
+            return inner->is_type_void(type);
+        }
+
+        virtual bool is_type_i8(omis_handle_t type) override {
+            return inner->is_type_i8(type);
+        }
+
+        virtual bool is_type_i16(omis_handle_t type) override {
+            return inner->is_type_i16(type);
+        }
+
+        virtual bool is_type_i32(omis_handle_t type) override {
+            return inner->is_type_i32(type);
+        }
+
+        virtual bool is_type_i64(omis_handle_t type) override {
+            return inner->is_type_i64(type);
+        }
+
+        virtual bool is_type_f32(omis_handle_t type) override {
+            return inner->is_type_f32(type);
+        }
+
+        virtual bool is_type_f64(omis_handle_t type) override {
+            return inner->is_type_f64(type);
+        }
+
+        virtual bool is_type_bool(omis_handle_t type) override {
+            return inner->is_type_bool(type);
+        }
+
+        virtual bool is_type_bytes(omis_handle_t type) override {
+            return inner->is_type_bytes(type);
+        }
+
+        virtual bool is_type_func(omis_handle_t type) override {
+            return inner->is_type_func(type);
+        }
+
+        virtual bool is_type_array(omis_handle_t type) override {
+            return inner->is_type_array(type);
+        }
+
+        virtual bool is_type_struct(omis_handle_t type) override {
+            return inner->is_type_struct(type);
+        }
+
+        virtual bool is_type_pointer(omis_handle_t type) override {
+            return inner->is_type_pointer(type);
+        }
+
+        virtual omis_handle_t get_ptr_element_type(omis_handle_t type) override {
+            return inner->get_ptr_element_type(type);
+        }
+
+        virtual bool is_type_vector(omis_handle_t type) override {
+            return inner->is_type_vector(type);
+        }
+
+        virtual uint32_t get_vector_lanes(omis_handle_t type) override {
+            return inner->get_vector_lanes(type);
+        }
+
+        virtual String get_type_name(omis_handle_t type) override {
+            return inner->get_type_name(type);
+        }
+
+        virtual omis_handle_t find_type(const String& name) override {
+            return inner->find_type(name);
+        }
+
+        virtual omis_handle_t get_type_size(omis_handle_t type) override {
+            return inner->get_type_size(type);
+        }
+
+        virtual bool can_losslessly_cast(omis_handle_t a, omis_handle_t b) override {
+            return inner->can_losslessly_cast(a, b);
+        }
+
+        virtual omis_handle_t get_func_ret_type(omis_handle_t type_func) override {
+            return inner->get_func_ret_type(type_func);
+        }
+
+        virtual uint32_t get_func_arg_count(omis_handle_t type_func) override {
+            return inner->get_func_arg_count(type_func);
+        }
+
+        virtual omis_handle_t get_func_arg_type(omis_handle_t type_func, uint32_t index) override {
+            return inner->get_func_arg_type(type_func, index);
+        }
+
+        virtual omis_handle_t get_func_arg_value(omis_handle_t func, uint32_t index) override {
+            auto arg = inner->get_func_arg_value(func, index);
+            if(auto* target = funcs.get(func))
+                (*target)->regs[arg] = index;
+            return arg;
+        }
+
+        virtual omis_handle_t get_default_value(omis_handle_t type) override {
+            auto value = inner->get_default_value(type);
+            constants[value] = vm_value_t{};
+            return value;
+        }
+
+        virtual omis_handle_t value_integer(uint64_t val, uint32_t bits) override {
+            auto value = inner->value_integer(val, bits);
+            vm_value_t constant{};
+            constant.i = vm_sext((i64_t)val, vm_bits(this->kind_of(value)));
+            constants[value] = constant;
+            return value;
+        }
+
+        virtual omis_handle_t value_float(double val) override {
+            auto value = inner->value_float(val);
+            vm_value_t constant{};
+            constant.f = val;
+            constants[value] = constant;
+            return value;
+        }
+
+        virtual omis_handle_t value_bool(bool val) override {
+            auto value = inner->value_bool(val);
+            vm_value_t constant{};
+            constant.i = val ? 1 : 0;
+            constants[value] = constant;
+            return value;
+        }
+
+        virtual omis_handle_t value_func(omis_handle_t mod, const String& name, omis_handle_t type) override {
+            auto handle = inner->value_func(mod, name, type);
+
+            auto* func = new vm_func_t();
+            func->handle = handle;
+            func->module = mod;
+            func->name = name;
+            func->ret = this->kind_of_type(inner->get_func_ret_type(type));
+            func->arg_count = inner->get_func_arg_count(type);
+            func->frame.resize(func->arg_count, vm_value_t{});
+            func->unsupported = func->ret == vm_kind_t::OTHER;
+            for(u32_t index = 0; index < func->arg_count; index++) {
+                auto kind = this->kind_of_type(inner->get_func_arg_type(type, index));
+                if(kind == vm_kind_t::VOID || kind == vm_kind_t::OTHER)
+                    func->unsupported = true;
+            }
+            funcs[handle] = func;
+
+            return handle;
+        }
+
+        virtual omis_handle_t get_value_type(omis_handle_t value) override {
+            return inner->get_value_type(value);
+        }
+
+        virtual void set_value_name(omis_handle_t value, const String& name) override {
+            inner->set_value_name(value, name);
+        }
+
+        virtual omis_handle_t create_block(omis_handle_t func, const String& name) override {
+            auto block = inner->create_block(func, name);
+            if(auto* target = funcs.get(func)) {
+                auto* owner = *target;
+                blocks[block] = std::make_pair(owner, (u32_t)owner->blocks.size());
+                owner->blocks.emplace_back();
+                owner->linked = false;
+            }
+            return block;
+        }
+
+        virtual omis_handle_t get_active_block() override {
+            return inner->get_active_block();
+        }
+
+        virtual void set_active_block(omis_handle_t block) override {
+            inner->set_active_block(block);
+            auto* target = blocks.get(block);
+            active_func = target != nullptr ? target->first : nullptr;
+            active_block = target != nullptr ? target->second : 0;
+        }
+
+        virtual omis_handle_t get_block_tail(omis_handle_t block) override {
+            return inner->get_block_tail(block);
+        }
+
+        virtual bool is_terminator_ins(omis_handle_t ins) override {
+            return inner->is_terminator_ins(ins);
+        }
+
+        virtual omis_handle_t alloc(omis_handle_t type, const String& name) override {
+            auto ptr = inner->alloc(type, name);
+            if(this->recording(ptr)) {
+                auto kind = this->kind_of_type(type);
+                if(kind == vm_kind_t::VOID || kind == vm_kind_t::OTHER) {
+                    this->reject();
+                }
+                else {
+                    this->emit(VM_ALLOCA, this->result(ptr), active_func->locals);
+                    active_func->locals += 8;
+                }
+            }
+            return ptr;
+        }
+
+        virtual omis_handle_t load(omis_handle_t ptr) override {
+            static const u16_t ops[] = {
+                0, VM_LD_U1, VM_LD_I8, VM_LD_I16, VM_LD_I32, VM_LD_I64, VM_LD_F32, VM_LD_F64, VM_LD_I64, 0
+            };
+
+            auto val = inner->load(ptr);
+            u32_t p;
+            if(this->recording(val) && this->operand(ptr, p)) {
+                auto op = ops[(int)this->kind_of(val)];
+                if(op == 0)
+                    this->reject();
+                else
+                    this->emit(op, this->result(val), p);
+            }
+            return val;
+        }
+
+        virtual omis_handle_t store(omis_handle_t ptr, omis_handle_t val) override {
+            static const u16_t ops[] = {
+                0, VM_ST_I8, VM_ST_I8, VM_ST_I16, VM_ST_I32, VM_ST_I64, VM_ST_F32, VM_ST_F64, VM_ST_I64, 0
+            };
+
+            auto ins = inner->store(ptr, val);
+            u32_t p, v;
+            if(this->recording(ins) && this->operand(ptr, p) && this->operand(val, v)) {
+                auto op = ops[(int)this->kind_of(val)];
+                if(op == 0)
+                    this->reject();
+                else
+                    this->emit(op, 0, p, v);
+            }
+            return ins;
+        }
+
+        virtual omis_handle_t gep(omis_handle_t type, omis_handle_t ptr, omis_handle_t index) override {
+            auto ret = inner->gep(type, ptr, index);
+            u32_t p, i;
+            if(this->recording(ret) && this->operand(ptr, p) && this->operand(index, i)) {
+                auto kind = this->kind_of_type(type);
+                if(kind == vm_kind_t::VOID || kind == vm_kind_t::OTHER) {
+                    this->reject();
+                }
+                else {
+                    vm_value_t stride{};
+                    stride.i = vm_size(kind);
+                    u32_t offset = this->temp();
+                    this->emit(VM_MUL_I64, offset, i, this->constant(stride));
+                    this->emit(VM_ADD_I64, this->result(ret), p, offset);
+                }
+            }
+            return ret;
+        }
+
+        virtual omis_handle_t neg(omis_handle_t a) override {
+            auto ret = inner->neg(a);
+            u32_t ra;
+            if(this->recording(ret) && this->operand(a, ra) && this->scalar(ret)) {
+                auto kind = this->kind_of(ret);
+                u32_t dst = this->result(ret);
+                if(vm_is_float(kind)) {
+                    this->emit(VM_NEG_F, dst, ra);
+                }
+                else if(kind == vm_kind_t::I32) {
+                    this->emit(VM_NEG_I32, dst, ra);
+                }
+                else {
+                    this->emit(VM_NEG_I64, dst, ra);
+                    this->emit_sext(kind, dst);
+                }
+            }
+            return ret;
+        }
+
+        virtual omis_handle_t add(omis_handle_t a, omis_handle_t b) override {
+            return this->arith(0, inner->add(a, b), a, b);
+        }
+
+        virtual omis_handle_t sub(omis_handle_t a, omis_handle_t b) override {
+            return this->arith(1, inner->sub(a, b), a, b);
+        }
+
+        virtual omis_handle_t mul(omis_handle_t a, omis_handle_t b) override {
+            return this->arith(2, inner->mul(a, b), a, b);
+        }
+
+        virtual omis_handle_t div(omis_handle_t a, omis_handle_t b) override {
+            return this->arith(3, inner->div(a, b), a, b);
+        }
+
+        virtual omis_handle_t mod(omis_handle_t a, omis_handle_t b) override {
+            return this->arith(4, inner->mod(a, b), a, b);
+        }
+
+        virtual omis_handle_t eq(omis_handle_t a, omis_handle_t b) override {
+            return this->compare(VM_EQ_I, inner->eq(a, b), a, b);
+        }
+
+        virtual omis_handle_t ne(omis_handle_t a, omis_handle_t b) override {
+            return this->compare(VM_NE_I, inner->ne(a, b), a, b);
+        }
+
+        virtual omis_handle_t gt(omis_handle_t a, omis_handle_t b) override {
+            return this->compare(VM_GT_I, inner->gt(a, b), a, b);
+        }
+
+        virtual omis_handle_t ge(omis_handle_t a, omis_handle_t b) override {
+            return this->compare(VM_GE_I, inner->ge(a, b), a, b);
+        }
+
+        virtual omis_handle_t lt(omis_handle_t a, omis_handle_t b) override {
+            return this->compare(VM_LT_I, inner->lt(a, b), a, b);
+        }
+
+        virtual omis_handle_t le(omis_handle_t a, omis_handle_t b) override {
+            return this->compare(VM_LE_I, inner->le(a, b), a, b);
+        }
+
+        virtual omis_handle_t l_not(omis_handle_t a) override {
+            auto ret = inner->l_not(a);
+            u32_t ra;
+            if(this->recording(ret) && this->operand(a, ra) && this->scalar(ret)) {
+                vm_value_t one{};
+                one.i = 1;
+                this->emit(VM_XOR, this->result(ret), ra, this->constant(one));
+            }
+            return ret;
+        }
+
+        virtual omis_handle_t l_and(omis_handle_t a, omis_handle_t b) override {
+            return this->bitwise(VM_AND, inner->l_and(a, b), a, b);
+        }
+
+        virtual omis_handle_t l_or(omis_handle_t a, omis_handle_t b) override {
+            return this->bitwise(VM_OR, inner->l_or(a, b), a, b);
+        }
+
+        virtual omis_handle_t b_flip(omis_handle_t a) override {
+            auto ret = inner->b_flip(a);
+            u32_t ra;
+            if(this->recording(ret) && this->operand(a, ra) && this->scalar(ret)) {
+                // every bit flipped, as the llvm bridge does.
+                vm_value_t mask{};
+                mask.i = -1;
+                this->emit(VM_XOR, this->result(ret), ra, this->constant(mask));
+            }
+            return ret;
+        }
+
+        virtual omis_handle_t b_and(omis_handle_t a, omis_handle_t b) override {
+            return this->bitwise(VM_AND, inner->b_and(a, b), a, b);
+        }
+
+        virtual omis_handle_t b_or(omis_handle_t a, omis_handle_t b) override {
+            return this->bitwise(VM_OR, inner->b_or(a, b), a, b);
+        }
+
+        virtual omis_handle_t b_xor(omis_handle_t a, omis_handle_t b) override {
+            return this->bitwise(VM_XOR, inner->b_xor(a, b), a, b);
+        }
+
+        virtual omis_handle_t b_shl(omis_handle_t a, omis_handle_t b) override {
+            return this->bitwise(VM_SHL, inner->b_shl(a, b), a, b);
+        }
+
+        virtual omis_handle_t b_shr(omis_handle_t a, omis_handle_t b) override {
+            return this->bitwise(VM_SHR, inner->b_shr(a, b), a, b);
+        }
+
+        virtual omis_handle_t jump(omis_handle_t block) override {
+            auto ins = inner->jump(block);
+            if(this->recording(ins)) {
+                auto* target = blocks.get(block);
+                if(target == nullptr || target->first != active_func)
+                    this->reject();
+                else
+                    this->emit(VM_JMP, 0, target->second);
+            }
+            return ins;
+        }
+
+        virtual omis_handle_t jump_cond(omis_handle_t cond, omis_handle_t branch_true, omis_handle_t branch_false) override {
+            auto ins = inner->jump_cond(cond, branch_true, branch_false);
+            u32_t c;
+            if(this->recording(ins) && this->operand(cond, c)) {
+                auto* targetTrue = blocks.get(branch_true);
+                auto* targetFalse = blocks.get(branch_false);
+                if(targetTrue == nullptr || targetTrue->first != active_func || targetFalse == nullptr || targetFalse->first != active_func)
+                    this->reject();
+                else
+                    this->emit(VM_BR, targetFalse->second, c, targetTrue->second);
+            }
+            return ins;
+        }
+
+        virtual omis_handle_t phi(omis_handle_t type, const std::map<omis_handle_t, omis_handle_t>& incomings) override {
+            auto ret = inner->phi(type, incomings);
+            if(this->recording(ret))
+                this->reject();
+            return ret;
+        }
+
+        virtual omis_handle_t block_phi(omis_handle_t block, omis_handle_t type) override {
+            auto phi = inner->block_phi(block, type);
+            if(this->recording(phi)) {
+                auto* target = blocks.get(block);
+                auto kind = this->kind_of_type(type);
+                if(target == nullptr || target->first != active_func || kind == vm_kind_t::VOID || kind == vm_kind_t::OTHER) {
+                    this->reject();
+                }
+                else {
+                    u32_t shadow = this->temp();
+                    u32_t reg = this->result(phi);
+                    auto& code = active_func->blocks[target->second];
+                    code.insert(code.begin(), vm_ins_t{VM_MOV, 0, reg, shadow, 0});
+                    phis[phi] = std::make_pair(active_func, shadow);
+                }
+            }
+            return phi;
+        }
+
+        virtual void add_incoming(omis_handle_t phi, omis_handle_t value, omis_handle_t block) override {
+            inner->add_incoming(phi, value, block);
+            auto* found = phis.get(phi);
+            if(found == nullptr || found->first != active_func || active_func->unsupported)
+                return;
+            auto* target = blocks.get(block);
+            u32_t v;
+            if(target == nullptr || target->first != active_func) {
+                this->reject();
+            }
+            else if(this->operand(value, v)) {
+                auto& code = active_func->blocks[target->second];
+                auto pos = !code.empty() && is_terminator(code.back().op) ? code.end() - 1 : code.end();
+                code.insert(pos, vm_ins_t{VM_MOV, 0, found->second, v, 0});
+                active_func->linked = false;
+            }
+        }
+
+        /**
+         * The bytecode already read the register of the phi, the moves that keep it
+         * up to date stay and only the handle, which llvm frees, is forgotten.
+         */
+        virtual void replace_value(omis_handle_t value, omis_handle_t with) override {
+            inner->replace_value(value, with);
+            if(auto* found = phis.get(value)) {
+                found->first->regs.erase(value);
+                phis.erase(value);
+            }
+            else if(active_func != nullptr) {
+                active_func->regs.erase(value);
+            }
+        }
+
+        virtual void drop_blocks(const omis_handle_list_t& blocks, omis_handle_list_t& dropped) override {
+            vm_func_t* owner = nullptr;
+            for(auto& block : blocks) {
+                if(auto* target = this->blocks.get(block)) {
+                    owner = target->first;
+                    owner->blocks[target->second].clear();
+                    owner->linked = false;
+                    this->blocks.erase(block);
+                }
+            }
+            inner->drop_blocks(blocks, dropped);
+            for(auto& handle : dropped) {
+                phis.erase(handle);
+                calls.erase(handle);
+                if(owner != nullptr)
+                    owner->regs.erase(handle);
+            }
+            if(owner != nullptr && owner == active_func)
+                active_func = nullptr;
+        }
+
+        virtual void retarget_call(omis_handle_t call, omis_handle_t func) override {
+            inner->retarget_call(call, func);
+            auto* found = calls.get(call);
+            if(found == nullptr)
+                return;
+            auto owner = found->first;
+            auto index = found->second;
+            if(func != nullptr) {
+                // the inline cache is resolved again before the next run.
+                owner->sites[index].callee = func;
+                owner->sites[index].target = nullptr;
+                return;
+            }
+            for(auto& code : owner->blocks) {
+                code.erase(std::remove_if(code.begin(), code.end(), [&](const vm_ins_t& ins) {
+                    return ins.op == VM_CALL && ins.a == index;
+                }), code.end());
+            }
+            owner->regs.erase(call);
+            owner->linked = false;
+            calls.erase(call);
+        }
+
+        // the bytecode does not know the size of a type, the function runs natively.
+        virtual void stack_alloc(omis_handle_t call, omis_handle_t type, omis_handle_t count) override {
+            inner->stack_alloc(call, type, count);
+            if(auto* found = calls.get(call)) {
+                found->first->unsupported = true;
+                found->first->regs.erase(call);
+                calls.erase(call);
+            }
+        }
+
+        virtual omis_handle_t block_call(omis_handle_t block, omis_handle_t func, const omis_handle_list_t& args, bool front) override {
+            auto ret = inner->block_call(block, func, args, front);
+            auto* target = blocks.get(block);
+            if(ret == nullptr || target == nullptr || target->first->unsupported)
+                return ret;
+
+            // the registers belong to the function of the block, which may not be the active one.
+            auto owner = target->first;
+            auto active = active_func;
+            active_func = owner;
+            vm_call_site_t site;
+            if(this->call_site(func, args, site)) {
+                owner->sites.push_back(std::move(site));
+                u32_t index = (u32_t)owner->sites.size() - 1;
+                calls[ret] = std::make_pair(owner, index);
+                vm_ins_t ins{VM_CALL, 0, this->result(ret), index, 0};
+                auto& code = owner->blocks[target->second];
+                auto pos = front ? code.begin() : !code.empty() && is_terminator(code.back().op) ? code.end() - 1 : code.end();
+                code.insert(pos, ins);
+                owner->linked = false;
+            }
+            active_func = active;
+            return ret;
+        }
+
+        virtual omis_handle_t call(omis_handle_t func, const omis_handle_list_t& args) override {
+            auto ret = inner->call(func, args);
+            if(!this->recording(ret))
+                return ret;
+
+            vm_call_site_t site;
+            if(!this->call_site(func, args, site))
+                return ret;
+
+            active_func->sites.push_back(std::move(site));
+            u32_t index = (u32_t)active_func->sites.size() - 1;
+            calls[ret] = std::make_pair(active_func, index);
+            this->emit(VM_CALL, this->result(ret), index);
+            return ret;
+        }
+
+        virtual omis_handle_t ret(omis_handle_t value) override {
+            auto ins = inner->ret(value);
+            u32_t v;
+            if(this->recording(ins)) {
+                if(value == nullptr)
+                    this->emit(VM_RET_VOID, 0);
+                else if(this->operand(value, v))
+                    this->emit(VM_RET, 0, v);
+            }
+            return ins;
+        }
+
+        virtual omis_handle_t bitcast(omis_handle_t value, omis_handle_t type) override {
+            auto ret = inner->bitcast(value, type);
+            u32_t v;
+            if(this->recording(ret) && this->operand(value, v)) {
+                // registers hold 64 bits, only casts between 64 bit kinds keep their bits.
+                auto from = this->kind_of(value);
+                auto to = this->kind_of_type(type);
+                bool wide = vm_bits(from) == 64 && vm_bits(to) == 64 && from != vm_kind_t::F32 && to != vm_kind_t::F32;
+                if(from != to && !wide)
+                    this->reject();
+                else
+                    this->emit(VM_MOV, this->result(ret), v);
+            }
+            return ret;
+        }
+
+        // registers hold a single lane, a function with vectors runs natively.
+        virtual omis_handle_t insert_element(omis_handle_t vec, omis_handle_t value, omis_handle_t index) override {
+            auto ret = inner->insert_element(vec, value, index);
+            if(this->recording(ret))
+                this->reject();
+            return ret;
+        }
+
+        virtual omis_handle_t extract_element(omis_handle_t vec, omis_handle_t index) override {
+            auto ret = inner->extract_element(vec, index);
+            if(this->recording(ret))
+                this->reject();
+            return ret;
+        }
+
+        /**
+         * The llvm bridge loads through the pointer on its own, which the bytecode would
+         * miss, so the same loop is built here out of load().
+         */
+        virtual omis_handle_t get_ptr_val(omis_handle_t ptr) override {
+            auto value = ptr;
+            auto type = inner->get_value_type(value);
+            while(inner->is_type_pointer(type)) {
+                if(funcs.contains(value))
+                    break;
+                auto element = inner->get_ptr_element_type(type);
+                if(inner->is_type_func(element) || inner->is_type_struct(element) || inner->is_type_array(element))
+                    break;
+                value = this->load(value);
+                type = inner->get_value_type(value);
+            }
+            return value;
+        }
+
+        virtual omis_handle_t get_ptr_ref(omis_handle_t ptr) override {
+            auto value = ptr;
+            auto type = inner->get_value_type(value);
+            while(inner->is_type_pointer(type) && inner->is_type_pointer(inner->get_ptr_element_type(type))) {
+                value = this->load(value);
+                type = inner->get_value_type(value);
+            }
+            return value;
+        }
+
+        virtual bool jit(omis_handle_t mod, const omis_handle_list_t& imports, const omis_compile_options_t& options, omis_compile_stats_t& stats) override {
+            Timer timer;
+            vm_func_t* entry = nullptr;
+            for(auto& pair : funcs) {
+                if(pair.second->module == mod && pair.second->name == "$main")
+                    entry = pair.second;
+            }
+            if(entry == nullptr || !this->interpretable(entry))
+                return inner->jit(mod, imports, options, stats);
+
+            run_module = mod;
+            run_imports = imports;
+            run_options = options;
+            promote_time = 0;
+            stats.codegen = timer.elapse() / 1000.0;
+
+            // there is no on stack replacement, a hot entry is native from its next run.
+            if(entry->native == nullptr && entry->promotable && entry->is_hot())
+                this->promote(entry);
+            i32_t result = 0;
+            if(entry->native != nullptr)
+                result = ((i32_t(*)())entry->native)();
+            else
+                result = (i32_t)this->interpret(entry, nullptr).i;
+            stats.result = result;
+            stats.run = timer.elapse() / 1000.0;
+            stats.optimize = promote_time;
+
+            return true;
+        }
+
+        virtual void* jit_symbol(omis_handle_t mod, const omis_handle_list_t& imports, const String& name, const omis_compile_options_t& options) override {
+            return inner->jit_symbol(mod, imports, name, options);
+        }
+
+        virtual bool aot(omis_handle_t mod, const omis_compile_options_t& options, omis_compile_stats_t& stats) override {
+            return inner->aot(mod, options, stats);
+        }
+
+        virtual bool archive(const omis_handle_list_t& mods, const String& path, const omis_compile_options_t& options, omis_compile_stats_t& stats) override {
+            return inner->archive(mods, path, options, stats);
+        }
+
+    private:
+        vm_kind_t kind_of_type(omis_handle_t type) {
+            if(auto* kind = kinds.get(type))
+                return *kind;
+
+            vm_kind_t kind = vm_kind_t::OTHER;
+            if(inner->is_type_void(type)) kind = vm_kind_t::VOID;
+            else if(inner->is_type_bool(type)) kind = vm_kind_t::I1;
+            else if(inner->is_type_i8(type)) kind = vm_kind_t::I8;
+            else if(inner->is_type_i16(type)) kind = vm_kind_t::I16;
+            else if(inner->is_type_i32(type)) kind = vm_kind_t::I32;
+            else if(inner->is_type_i64(type)) kind = vm_kind_t::I64;
+            else if(inner->is_type_f32(type)) kind = vm_kind_t::F32;
+            else if(inner->is_type_f64(type)) kind = vm_kind_t::F64;
+            else if(inner->is_type_pointer(type)) kind = vm_kind_t::PTR;
+            kinds[type] = kind;
+            return kind;
+        }
+
+        vm_kind_t kind_of(omis_handle_t value) {
+            return this->kind_of_type(inner->get_value_type(value));
+        }
+
+        /// registers hold a single lane, the function is left to the jit for anything wider.
+        bool scalar(omis_handle_t value) {
+            if(this->kind_of(value) != vm_kind_t::OTHER)
+                return true;
+            this->reject();
+            return false;
+        }
+
+        /// the instruction was built and belongs to a function the bytecode still covers.
+        bool recording(omis_handle_t ins) {
+            return ins != nullptr && active_func != nullptr && !active_func->unsupported;
+        }
+
+        /// the function can not be expressed in bytecode, it runs natively.
+        bool reject() {
+            active_func->unsupported = true;
+            return false;
+        }
+
+        void emit(u16_t op, u32_t dst, u32_t a = 0, u32_t b = 0, u16_t aux = 0) {
+            active_func->blocks[active_block].push_back(vm_ins_t{op, aux, dst, a, b});
+            active_func->linked = false;
+        }
+
+        void emit_sext(vm_kind_t kind, u32_t reg) {
+            if(vm_bits(kind) < 64)
+                this->emit(VM_SEXT, reg, reg, 0, (u16_t)vm_bits(kind));
+        }
+
+        u32_t constant(vm_value_t value) {
+            active_func->frame.push_back(value);
+            return (u32_t)active_func->frame.size() - 1;
+        }
+
+        u32_t temp() {
+            return this->constant(vm_value_t{});
+        }
+
+        u32_t result(omis_handle_t value) {
+            u32_t reg = this->temp();
+            active_func->regs[value] = reg;
+            return reg;
+        }
+
+        bool operand(omis_handle_t value, u32_t& reg) {
+            if(auto* found = active_func->regs.get(value)) {
+                reg = *found;
+                return true;
+            }
+            if(auto* found = constants.get(value)) {
+                reg = this->constant(*found);
+                active_func->regs[value] = reg;
+                return true;
+            }
+            return this->reject();
+        }
+
+        u32_t to_float(omis_handle_t value, u32_t reg) {
+            if(!vm_is_int(this->kind_of(value)))
+                return reg;
+            u32_t ret = this->temp();
+            this->emit(VM_I2F, ret, reg);
+            return ret;
+        }
+
+        /// op: 0 add, 1 sub, 2 mul, 3 div, 4 mod, the opcodes of each kind are in this order.
+        omis_handle_t arith(u16_t op, omis_handle_t ret, omis_handle_t a, omis_handle_t b) {
+            u32_t ra, rb;
+            if(!this->recording(ret) || !this->operand(a, ra) || !this->operand(b, rb))
+                return ret;
+
+            auto kind = this->kind_of(ret);
+            if(vm_is_float(kind)) {
+                ra = this->to_float(a, ra);
+                rb = this->to_float(b, rb);
+                u32_t dst = this->result(ret);
+                this->emit(VM_ADD_F + op, dst, ra, rb);
+                if(kind == vm_kind_t::F32)
+                    this->emit(VM_ROUND_F32, dst, dst);
+            }
+            else if(kind == vm_kind_t::I32) {
+                this->emit(VM_ADD_I32 + op, this->result(ret), ra, rb);
+            }
+            else if(vm_is_int(kind)) {
+                u32_t dst = this->result(ret);
+                this->emit(VM_ADD_I64 + op, dst, ra, rb);
+                this->emit_sext(kind, dst);
+            }
+            else {
+                this->reject();
+            }
+            return ret;
+        }
+
+        /// op is the int opcode, the float ones follow in the same order.
+        omis_handle_t compare(u16_t op, omis_handle_t ret, omis_handle_t a, omis_handle_t b) {
+            u32_t ra, rb;
+            if(!this->recording(ret) || !this->operand(a, ra) || !this->operand(b, rb))
+                return ret;
+
+            auto ka = this->kind_of(a);
+            auto kb = this->kind_of(b);
+            if(vm_is_int(ka) && vm_is_int(kb)) {
+                this->emit(op, this->result(ret), ra, rb);
+            }
+            else if((vm_is_int(ka) || vm_is_float(ka)) && (vm_is_int(kb) || vm_is_float(kb))) {
+                ra = this->to_float(a, ra);
+                rb = this->to_float(b, rb);
+                this->emit(op + (VM_EQ_F - VM_EQ_I), this->result(ret), ra, rb);
+            }
+            else {
+                this->reject();
+            }
+            return ret;
+        }
+
+        omis_handle_t bitwise(u16_t op, omis_handle_t ret, omis_handle_t a, omis_handle_t b) {
+            u32_t ra, rb;
+            if(this->recording(ret) && this->operand(a, ra) && this->operand(b, rb) && this->scalar(ret))
+                this->emit(op, this->result(ret), ra, rb, (u16_t)vm_bits(this->kind_of(ret)));
+            return ret;
+        }
+
+        /// the site of a call to func from the active function, false if it was rejected.
+        bool call_site(omis_handle_t func, const omis_handle_list_t& args, vm_call_site_t& site) {
+            auto* target = funcs.get(func);
+            if(target == nullptr)
+                return this->reject();
+
+            site.callee = func;
+            site.ret = (*target)->ret;
+            site.native = site.ret == vm_kind_t::VOID || site.ret == vm_kind_t::F64 || vm_is_int(site.ret);
+            u32_t intCount = 0;
+            u32_t floatCount = 0;
+            for(auto& arg : args) {
+                u32_t reg;
+                if(!this->operand(arg, reg))
+                    return false;
+                auto kind = this->kind_of(arg);
+                site.args.push_back(reg);
+                site.kinds.push_back(kind);
+                if(kind == vm_kind_t::F64)
+                    floatCount++;
+                else if(vm_is_int(kind))
+                    intCount++;
+                else
+                    site.native = false;
+            }
+            if(intCount > VM_NATIVE_INT_ARGS || floatCount > VM_NATIVE_FLOAT_ARGS || (floatCount > 0 && !_VM_NATIVE_FLOAT_ARGS))
+                site.native = false;
+            return true;
+        }
+
+        static bool is_terminator(u16_t op) {
+            return op == VM_JMP || op == VM_BR || op == VM_RET || op == VM_RET_VOID;
+        }
+
+        /// lay the blocks out in order and turn their indices into pcs.
+        void link(vm_func_t* func) {
+            if(func->linked)
+                return;
+
+            std::vector<u32_t> starts;
+            func->code.clear();
+            for(auto& block : func->blocks) {
+                starts.push_back((u32_t)func->code.size());
+                func->code.insert(func->code.end(), block.begin(), block.end());
+                if(block.empty() || !is_terminator(block.back().op))
+                    func->code.push_back(vm_ins_t{VM_RET_VOID, 0, 0, 0, 0});
+            }
+
+            // a jump back to an earlier block closes a loop and is counted.
+            u32_t block = 0;
+            for(u32_t pc = 0; pc < func->code.size(); pc++) {
+                while(block + 1 < starts.size() && starts[block + 1] <= pc)
+                    block++;
+                auto& ins = func->code[pc];
+                if(ins.op == VM_JMP) {
+                    if(ins.a <= block)
+                        ins.op = VM_LOOP;
+                    ins.a = starts[ins.a];
+                }
+                else if(ins.op == VM_BR) {
+                    ins.aux = (ins.b <= block ? 1 : 0) | (ins.dst <= block ? 2 : 0);
+                    ins.b = starts[ins.b];
+                    ins.dst = starts[ins.dst];
+                }
+            }
+
+            func->linked = true;
+        }
+
+        /**
+         * Link everything reachable from the entry and resolve the call sites. A callee
+         * without bytecode has to be callable natively, or the whole script is jitted.
+         */
+        bool interpretable(vm_func_t* entry) {
+            if(entry->unsupported || entry->is_external())
+                return false;
+
+            HashSet<vm_func_t*> visited;
+            std::vector<vm_func_t*> pending = {entry};
+            while(!pending.empty()) {
+                vm_func_t* func = pending.back();
+                pending.pop_back();
+                if(!visited.insert(func).second)
+                    continue;
+
+                this->link(func);
+                for(auto& site : func->sites) {
+                    auto* target = funcs.get(site.callee);
+                    if(target == nullptr)
+                        return false;
+                    site.target = *target;
+                    if(site.target->unsupported || site.target->is_external()) {
+                        if(!site.native)
+                            return false;
+                    }
+                    else {
+                        pending.push_back(site.target);
+                    }
+                }
+            }
+            return true;
+        }
+
+        void promote(vm_func_t* func) {
+            Timer timer;
+            func->native = inner->jit_symbol(run_module, run_imports, func->name, run_options);
+            func->promotable = func->native != nullptr;
+            promote_time += timer.elapse() / 1000.0;
+        }
+
+        vm_value_t call(const vm_call_site_t& site, const vm_value_t* R) {
+            vm_func_t* target = site.target;
+            if(site.native) {
+                bool compiled = target->unsupported || target->is_external() || target->is_hot();
+                if(target->native == nullptr && target->promotable && compiled)
+                    this->promote(target);
+                if(target->native != nullptr)
+                    return vm_call_native(target->native, site, R);
+            }
+
+            SmallVector<vm_value_t, 8> args;
+            for(auto& arg : site.args) {
+                args.push_back(R[arg]);
+            }
+            return this->interpret(target, args.data());
+        }
+
+        vm_value_t interpret(vm_func_t* func, const vm_value_t* args) {
+            if(func->unsupported || func->is_external()) {
+                printf("VM: '%s' could not be compiled.\n", func->name.cstr());
+                return vm_value_t{};
+            }
+            if(func->calls < VM_HOT_CALLS)
+                func->calls++;
+
+            SmallVector<vm_value_t, 32> regs(func->frame.begin(), func->frame.end());
+            for(u32_t index = 0; index < func->arg_count; index++) {
+                regs[index] = args[index];
+            }
+            SmallVector<u64_t, 8> locals(func->locals / 8, 0);
+
+            vm_value_t* R = regs.data();
+            u8_t* L = (u8_t*)locals.data();
+            const vm_ins_t* code = func->code.data();
+            const vm_ins_t* pc = code;
+
+#if _VM_COMPUTED_GOTO
+            #define _VmOpLabel(name) &&vm_##name,
+            static void* labels[] = {
+                _VmOps(_VmOpLabel)
+            };
+            #undef _VmOpLabel
+            #define _VmDispatch() goto *labels[pc->op]
+            #define _VmCase(name) vm_##name:
+            #define _VmNext() { pc++; _VmDispatch(); }
+            #define _VmJump(target) { pc = code + (target); _VmDispatch(); }
+            _VmDispatch();
+#else
+            #define _VmCase(name) case VM_##name:
+            #define _VmNext() { pc++; continue; }
+            #define _VmJump(target) { pc = code + (target); continue; }
+            for(;;) switch(pc->op)
+#endif
+            {
+                _VmCase(MOV) { R[pc->dst] = R[pc->a]; _VmNext(); }
+                _VmCase(ALLOCA) { R[pc->dst].p = L + pc->a; _VmNext(); }
+
+                _VmCase(LD_U1) { R[pc->dst].i = *(u8_t*)R[pc->a].p & 1; _VmNext(); }
+                _VmCase(LD_I8) { R[pc->dst].i = *(i8_t*)R[pc->a].p; _VmNext(); }
+                _VmCase(LD_I16) { R[pc->dst].i = *(i16_t*)R[pc->a].p; _VmNext(); }
+                _VmCase(LD_I32) { R[pc->dst].i = *(i32_t*)R[pc->a].p; _VmNext(); }
+                _VmCase(LD_I64) { R[pc->dst].i = *(i64_t*)R[pc->a].p; _VmNext(); }
+                _VmCase(LD_F32) { R[pc->dst].f = *(f32_t*)R[pc->a].p; _VmNext(); }
+                _VmCase(LD_F64) { R[pc->dst].f = *(f64_t*)R[pc->a].p; _VmNext(); }
+
+                _VmCase(ST_I8) { *(i8_t*)R[pc->a].p = (i8_t)R[pc->b].i; _VmNext(); }
+                _VmCase(ST_I16) { *(i16_t*)R[pc->a].p = (i16_t)R[pc->b].i; _VmNext(); }
+                _VmCase(ST_I32) { *(i32_t*)R[pc->a].p = (i32_t)R[pc->b].i; _VmNext(); }
+                _VmCase(ST_I64) { *(i64_t*)R[pc->a].p = R[pc->b].i; _VmNext(); }
+                _VmCase(ST_F32) { *(f32_t*)R[pc->a].p = (f32_t)R[pc->b].f; _VmNext(); }
+                _VmCase(ST_F64) { *(f64_t*)R[pc->a].p = R[pc->b].f; _VmNext(); }
+
+                _VmCase(ADD_I32) { R[pc->dst].i = (i32_t)((u32_t)R[pc->a].i + (u32_t)R[pc->b].i); _VmNext(); }
+                _VmCase(SUB_I32) { R[pc->dst].i = (i32_t)((u32_t)R[pc->a].i - (u32_t)R[pc->b].i); _VmNext(); }
+                _VmCase(MUL_I32) { R[pc->dst].i = (i32_t)((u32_t)R[pc->a].i * (u32_t)R[pc->b].i); _VmNext(); }
+                _VmCase(DIV_I32) { R[pc->dst].i = (i32_t)R[pc->a].i / (i32_t)R[pc->b].i; _VmNext(); }
+                _VmCase(REM_I32) { R[pc->dst].i = (i32_t)R[pc->a].i % (i32_t)R[pc->b].i; _VmNext(); }
+
+                _VmCase(ADD_I64) { R[pc->dst].i = (i64_t)((u64_t)R[pc->a].i + (u64_t)R[pc->b].i); _VmNext(); }
+                _VmCase(SUB_I64) { R[pc->dst].i = (i64_t)((u64_t)R[pc->a].i - (u64_t)R[pc->b].i); _VmNext(); }
+                _VmCase(MUL_I64) { R[pc->dst].i = (i64_t)((u64_t)R[pc->a].i * (u64_t)R[pc->b].i); _VmNext(); }
+                _VmCase(DIV_I64) { R[pc->dst].i = R[pc->a].i / R[pc->b].i; _VmNext(); }
+                _VmCase(REM_I64) { R[pc->dst].i = R[pc->a].i % R[pc->b].i; _VmNext(); }
+
+                _VmCase(ADD_F) { R[pc->dst].f = R[pc->a].f + R[pc->b].f; _VmNext(); }
+                _VmCase(SUB_F) { R[pc->dst].f = R[pc->a].f - R[pc->b].f; _VmNext(); }
+                _VmCase(MUL_F) { R[pc->dst].f = R[pc->a].f * R[pc->b].f; _VmNext(); }
+                _VmCase(DIV_F) { R[pc->dst].f = R[pc->a].f / R[pc->b].f; _VmNext(); }
+                _VmCase(REM_F) { R[pc->dst].f = std::fmod(R[pc->a].f, R[pc->b].f); _VmNext(); }
+
+                _VmCase(NEG_I32) { R[pc->dst].i = (i32_t)(0u - (u32_t)R[pc->a].i); _VmNext(); }
+                _VmCase(NEG_I64) { R[pc->dst].i = (i64_t)(0ull - (u64_t)R[pc->a].i); _VmNext(); }
+                _VmCase(NEG_F) { R[pc->dst].f = -R[pc->a].f; _VmNext(); }
+
+                _VmCase(I2F) { R[pc->dst].f = (f64_t)R[pc->a].i; _VmNext(); }
+                _VmCase(ROUND_F32) { R[pc->dst].f = (f64_t)(f32_t)R[pc->a].f; _VmNext(); }
+                _VmCase(SEXT) { R[pc->dst].i = vm_sext(R[pc->a].i, pc->aux); _VmNext(); }
+
+                _VmCase(AND) { R[pc->dst].i = R[pc->a].i & R[pc->b].i; _VmNext(); }
+                _VmCase(OR) { R[pc->dst].i = R[pc->a].i | R[pc->b].i; _VmNext(); }
+                _VmCase(XOR) { R[pc->dst].i = R[pc->a].i ^ R[pc->b].i; _VmNext(); }
+                _VmCase(SHL) { R[pc->dst].i = vm_sext((i64_t)((u64_t)R[pc->a].i << (R[pc->b].i & 63)), pc->aux); _VmNext(); }
+                _VmCase(SHR) { R[pc->dst].i = vm_sext((i64_t)(vm_zext(R[pc->a].i, pc->aux) >> (R[pc->b].i & 63)), pc->aux); _VmNext(); }
+
+                _VmCase(EQ_I) { R[pc->dst].i = R[pc->a].i == R[pc->b].i; _VmNext(); }
+                _VmCase(NE_I) { R[pc->dst].i = R[pc->a].i != R[pc->b].i; _VmNext(); }
+                _VmCase(LT_I) { R[pc->dst].i = R[pc->a].i < R[pc->b].i; _VmNext(); }
+                _VmCase(LE_I) { R[pc->dst].i = R[pc->a].i <= R[pc->b].i; _VmNext(); }
+                _VmCase(GT_I) { R[pc->dst].i = R[pc->a].i > R[pc->b].i; _VmNext(); }
+                _VmCase(GE_I) { R[pc->dst].i = R[pc->a].i >= R[pc->b].i; _VmNext(); }
+
+                _VmCase(EQ_F) { R[pc->dst].i = R[pc->a].f == R[pc->b].f; _VmNext(); }
+                _VmCase(NE_F) { R[pc->dst].i = R[pc->a].f < R[pc->b].f || R[pc->a].f > R[pc->b].f; _VmNext(); }
+                _VmCase(LT_F) { R[pc->dst].i = R[pc->a].f < R[pc->b].f; _VmNext(); }
+                _VmCase(LE_F) { R[pc->dst].i = R[pc->a].f <= R[pc->b].f; _VmNext(); }
+                _VmCase(GT_F) { R[pc->dst].i = R[pc->a].f > R[pc->b].f; _VmNext(); }
+                _VmCase(GE_F) { R[pc->dst].i = R[pc->a].f >= R[pc->b].f; _VmNext(); }
+
+                _VmCase(JMP) { _VmJump(pc->a); }
+                _VmCase(LOOP) {
+                    if(func->loops < VM_HOT_LOOPS)
+                        func->loops++;
+                    _VmJump(pc->a);
+                }
+                _VmCase(BR) {
+                    bool taken = R[pc->a].i != 0;
+                    if((pc->aux & (taken ? 1 : 2)) && func->loops < VM_HOT_LOOPS)
+                        func->loops++;
+                    _VmJump(taken ? pc->b : pc->dst);
+                }
+                _VmCase(CALL) { R[pc->dst] = this->call(func->sites[pc->a], R); _VmNext(); }
+                _VmCase(RET) { return R[pc->a]; }
+                _VmCase(RET_VOID) { return vm_value_t{}; }
+            }
+            return vm_value_t{};
+
+            #undef _VmDispatch
+            #undef _VmCase
+            #undef _VmNext
+            #undef _VmJump
+        }
+    };
+
+    omis_bridge_t* vm_init() {
+        return new vm_bridge_t(llvm_init());
+    }
+
+    void vm_quit(omis_bridge_t* bridge) {
+        _DeletePointer(bridge);
+    }
+}
@@ -0,0 +1,12 @@
+#ifndef _EOKAS_VM_ENGINE_H_
+#define _EOKAS_VM_ENGINE_H_
+
+#include "../model.h"
+
+namespace eokas
+{
+    omis_bridge_t* vm_init();
+    void vm_quit(omis_bridge_t* bridge);
+}
+
+#endif//_EOKAS_VM_ENGINE_H_
@@ -0,0 +1,39 @@
+#include "./x-module-cache.h"
+#include "./model.h"
+#include "./bridge.h"
+
+namespace eokas {
+    omis_module_cache_t::omis_module_cache_t(omis_context_t* context, const String& name)
+            : omis_module_t(context, name) {
+    }
+
+    bool omis_module_cache_t::load_module(const String& path, const StringVector& imports, const String& interface) {
+        omis_handle_t loaded = bridge->load_module(name, path);
+        if(loaded == nullptr)
+            return false;
+        bridge->drop_module(this->handle);
+        this->handle = loaded;
+
+        // the same dependencies as the coder registers, the jit collects them from here.
+        this->using_module("core");
+        for(auto& imp : imports) {
+            if(!this->using_module(imp))
+                return false;
+        }
+
+        for(auto& line : interface.split("\n")) {
+            if(line.isEmpty())
+                continue;
+            StringVector parts = line.split(" ");
+            if(parts.size() < 3 || parts[0] != "type")
+                return false;
+            String typeName = line.substr(parts[0].length() + parts[1].length() + 2);
+            omis_handle_t type = bridge->find_type(typeName);
+            if(type == nullptr)
+                return false;
+            this->exports->add_type_symbol(parts[1], this->type(type));
+        }
+
+        return true;
+    }
+}
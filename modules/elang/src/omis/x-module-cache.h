@@ -0,0 +1,19 @@
+#ifndef _EOKAS_OMIS_MODULE_CACHE_H_
+#define _EOKAS_OMIS_MODULE_CACHE_H_
+
+#include "./model.h"
+
+namespace eokas {
+    /**
+     * A module encoded by an earlier run, read back from the bitcode it was saved
+     * as. Its interface stands in for the symbols the coder would have exported.
+     */
+    class omis_module_cache_t :public omis_module_t {
+    public:
+        omis_module_cache_t(omis_context_t* context, const String& name);
+
+        bool load_module(const String& path, const StringVector& imports, const String& interface);
+    };
+}
+
+#endif //_EOKAS_OMIS_MODULE_CACHE_H_
@@ -12,6 +12,11 @@ namespace eokas {
 
         // Imports
         this->using_module("core");
+
+        // the simd types are built in, their operators work lane by lane.
+        this->add_type_symbol("f32x4", this->type_vector(this->type_f32(), 4));
+        this->add_type_symbol("i32x4", this->type_vector(this->type_i32(), 4));
+        this->add_type_symbol("f32x8", this->type_vector(this->type_f32(), 8));
         for(auto& imp : node->imports) {
             if(!this->using_module(imp.second->target)) {
                 return false;
@@ -36,6 +41,7 @@ namespace eokas {
             }
 
             this->stmt_ensure_tail_ret(func);
+            this->end_func(func);
         }
         this->pop_scope();
 
@@ -264,11 +270,11 @@ namespace eokas {
                 return this->encode_expr_func_def(dynamic_cast<ast_node_func_def_t *>(node));
             case ast_category_t::FUNC_REF:
                 return this->encode_expr_func_ref(dynamic_cast<ast_node_func_ref_t *>(node));
+            case ast_category_t::ARRAY_REF:
+                return this->encode_expr_index_ref(dynamic_cast<ast_node_array_ref_t *>(node));
                 /*
                 case ast_category_t::ARRAY_DEF:
                     return this->encode_expr_array_def(dynamic_cast<ast_node_array_def_t *>(node));
-                case ast_category_t::ARRAY_REF:
-                    return this->encode_expr_index_ref(dynamic_cast<ast_node_array_ref_t *>(node));
                 case ast_category_t::OBJECT_DEF:
                     return this->encode_expr_object_def(dynamic_cast<ast_node_object_def_t *>(node));
                 case ast_category_t::OBJECT_REF:
@@ -425,6 +431,11 @@ namespace eokas {
             return symbol->value;
         }
 
+        if (dynamic_cast<omis_variable_t*>(symbol->value) != nullptr) {
+            printf("ERROR: The local '%s' of another function can not be used as an up-value.\n", node->name.cstr());
+            return nullptr;
+        }
+
         /*
         // up-value-ref
         {
@@ -499,6 +510,7 @@ namespace eokas {
             }
 			
             this->stmt_ensure_tail_ret(newFunc);
+            this->end_func(newFunc);
         }
         this->pop_scope();
 
@@ -508,6 +520,21 @@ namespace eokas {
     omis_value_t *omis_module_coder_t::encode_expr_func_ref(ast_node_func_ref_t *node) {
         if (node == nullptr)
             return nullptr;
+
+        // a vector type called like a function makes a vector of the arguments.
+        if (auto symbolRef = dynamic_cast<ast_node_symbol_ref_t *>(node->func)) {
+            auto *symbol = this->scope->get_type_symbol(symbolRef->name, true);
+            if (symbol != nullptr && symbol->type->is_type_vector() && this->scope->get_value_symbol(symbolRef->name, true) == nullptr) {
+                std::vector<omis_value_t *> lanes;
+                for (auto &arg: node->args) {
+                    auto *lane = this->encode_expr(arg);
+                    if (lane == nullptr)
+                        return nullptr;
+                    lanes.push_back(this->get_ptr_val(lane));
+                }
+                return this->value_vector(symbol->type, lanes);
+            }
+        }
 		
         auto expr = this->encode_expr(node->func);
         if (expr == nullptr) {
@@ -563,4 +590,24 @@ namespace eokas {
         
         return retval;
     }
+
+    // only the lanes of a vector can be indexed so far.
+    omis_value_t *omis_module_coder_t::encode_expr_index_ref(ast_node_array_ref_t *node) {
+        if (node == nullptr)
+            return nullptr;
+
+        auto obj = this->encode_expr(node->obj);
+        auto key = this->encode_expr(node->key);
+        if (obj == nullptr || key == nullptr)
+            return nullptr;
+
+        obj = this->get_ptr_val(obj);
+        key = this->get_ptr_val(key);
+        if (!obj->get_type()->is_type_vector()) {
+            printf("ERROR: Type '%s' can not be indexed.\n", this->get_type_name(obj->get_type()).cstr());
+            return nullptr;
+        }
+
+        return this->extract_element(obj, key);
+    }
 }
@@ -35,6 +35,7 @@ namespace eokas {
         omis_value_t *encode_expr_symbol_ref(ast_node_symbol_ref_t *node);
         omis_value_t* encode_expr_func_def(ast_node_func_def_t* node);
         omis_value_t* encode_expr_func_ref(ast_node_func_ref_t* node);
+        omis_value_t* encode_expr_index_ref(ast_node_array_ref_t* node);
     };
 }
 
@@ -230,7 +230,7 @@ namespace eokas
         section.remove(triangleId);
     }
     
-    const std::vector<TriangleID>& RawMesh::getSectionTriangles(const SectionID& sectionId) const
+    const RawMesh::TriangleList& RawMesh::getSectionTriangles(const SectionID& sectionId) const
     {
         return this->sections.at(sectionId).triangles;
     }
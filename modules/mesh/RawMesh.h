@@ -89,9 +89,12 @@ namespace eokas
             CornerID c2;
         };
 
+        /// most sections only hold a handful of triangles.
+        using TriangleList = SmallVector<TriangleID, 16>;
+        
         struct Section
         {
-            std::vector<TriangleID> triangles;
+            TriangleList triangles;
             
             bool contains(const TriangleID& triangleId)
             {
@@ -187,7 +190,7 @@ namespace eokas
         void addSectionTriangle(const SectionID& sectionId, const TriangleID& triangleId);
         void addSectionTriangles(const SectionID& sectionId, const std::vector<TriangleID>& triangleList);
         void delSectionTriangle(const SectionID& sectionId, const TriangleID& triangleId);
-        const std::vector<TriangleID>& getSectionTriangles(const SectionID& sectionId) const;
+        const TriangleList& getSectionTriangles(const SectionID& sectionId) const;
         void clearSectionTriangles(const SectionID& sectionId);
         void delSection(const SectionID& sectionId);
         
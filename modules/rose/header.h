@@ -6,6 +6,8 @@
 
 namespace eokas::datapot {
     class Library;
+    class Query;
+    class Snapshot;
 
     class Schema;
     class SchemaHeap;
@@ -0,0 +1,256 @@
+#include "./image.h"
+#include <cstring>
+
+namespace eokas::datapot {
+    LibraryImage::LibraryImage()
+        : mData(nullptr)
+        , mSize(0)
+        , mHeader(nullptr)
+        , mFile(nullptr) { }
+
+    LibraryImage::~LibraryImage() {
+        this->close();
+    }
+
+    bool LibraryImage::open(const String& filePath) {
+        this->close();
+
+        MappedFile* file = new MappedFile(filePath);
+        if(!file->open() || !this->attach(file->data(), file->size())) {
+            _DeletePointer(file);
+            return false;
+        }
+
+        mFile = file;
+        return true;
+    }
+
+    bool LibraryImage::open(const void* data, size_t size) {
+        this->close();
+        return this->attach(data, size);
+    }
+
+    bool LibraryImage::attach(const void* data, size_t size) {
+        if(data == nullptr || size < sizeof(ImageHeader) || uintptr_t(data) % alignof(ImageHeader) != 0)
+            return false;
+
+        const ImageHeader* header = (const ImageHeader*)data;
+        if(memcmp(header->magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC)) != 0)
+            return false;
+        if(header->version != IMAGE_VERSION || header->endian != IMAGE_ENDIAN)
+            return false;
+        if(header->size > size)
+            return false;
+
+        mData = (const u8_t*)data;
+        mSize = size_t(header->size);
+        mHeader = header;
+
+        bool valid = this->at<ImageSchema>(header->schemaOffset, header->schemaCount) != nullptr
+            && this->at<ImageMember>(header->memberOffset, header->memberCount) != nullptr
+            && this->at<ImageRoot>(header->rootOffset, header->rootCount) != nullptr
+            && this->at<u64_t>(header->stringOffset, header->stringCount) != nullptr;
+        if(!valid) {
+            mData = nullptr;
+            mSize = 0;
+            mHeader = nullptr;
+            return false;
+        }
+        return true;
+    }
+
+    void LibraryImage::close() {
+        mData = nullptr;
+        mSize = 0;
+        mHeader = nullptr;
+        _DeletePointer(mFile);
+    }
+
+    bool LibraryImage::isOpen() const {
+        return mHeader != nullptr;
+    }
+
+    template<typename T>
+    const T* LibraryImage::at(u64_t offset, u64_t count) const {
+        if(mData == nullptr || offset % alignof(T) != 0 || offset > mSize)
+            return nullptr;
+        if(count > (mSize - offset) / sizeof(T))
+            return nullptr;
+        return (const T*)(mData + offset);
+    }
+
+    const ImageSchema* LibraryImage::schema(u32_t index) const {
+        if(mHeader == nullptr || index >= mHeader->schemaCount)
+            return nullptr;
+        return this->at<ImageSchema>(mHeader->schemaOffset) + index;
+    }
+
+    const char* LibraryImage::string(u32_t index, u32_t* length) const {
+        if(mHeader == nullptr || index >= mHeader->stringCount)
+            return nullptr;
+        u64_t offset = this->at<u64_t>(mHeader->stringOffset)[index];
+        const u32_t* size = this->at<u32_t>(offset);
+        if(size == nullptr || this->at<char>(offset + sizeof(u32_t), u64_t(*size) + 1) == nullptr)
+            return nullptr;
+        if(length != nullptr) {
+            *length = *size;
+        }
+        return (const char*)(size + 1);
+    }
+
+    u32_t LibraryImage::getSchemaCount() const {
+        return mHeader != nullptr ? mHeader->schemaCount : 0;
+    }
+
+    u32_t LibraryImage::getSchemaIndex(const String& name) const {
+        for(u32_t index = 0; index < this->getSchemaCount(); index++) {
+            const char* schemaName = this->getSchemaName(index);
+            if(schemaName != nullptr && name == schemaName)
+                return index;
+        }
+        return -1;
+    }
+
+    const char* LibraryImage::getSchemaName(u32_t schema) const {
+        const ImageSchema* ptr = this->schema(schema);
+        return ptr != nullptr ? this->string(ptr->name) : nullptr;
+    }
+
+    SchemaType LibraryImage::getSchemaType(u32_t schema) const {
+        const ImageSchema* ptr = this->schema(schema);
+        return ptr != nullptr ? SchemaType(ptr->type) : SchemaType::None;
+    }
+
+    u32_t LibraryImage::getMemberIndex(u32_t schema, const String& name) const {
+        const ImageSchema* ptr = this->schema(schema);
+        if(ptr == nullptr || SchemaType(ptr->type) != SchemaType::Struct)
+            return -1;
+        const ImageMember* members = this->at<ImageMember>(mHeader->memberOffset);
+        if(u64_t(ptr->memberStart) + ptr->memberCount > mHeader->memberCount)
+            return -1;
+        for(u32_t index = 0; index < ptr->memberCount; index++) {
+            const char* memberName = this->string(members[ptr->memberStart + index].name);
+            if(memberName != nullptr && name == memberName)
+                return index;
+        }
+        return -1;
+    }
+
+    u32_t LibraryImage::getRootCount() const {
+        return mHeader != nullptr ? mHeader->rootCount : 0;
+    }
+
+    const char* LibraryImage::getRootName(u32_t index) const {
+        if(index >= this->getRootCount())
+            return nullptr;
+        const ImageRoot* roots = this->at<ImageRoot>(mHeader->rootOffset);
+        return this->string(roots[index].name);
+    }
+
+    SchemaType LibraryImage::typeOf(const ImageValue* ptr) const {
+        if(ptr == nullptr)
+            return SchemaType::None;
+        return this->getSchemaType(ptr->schema);
+    }
+
+    const ImageValue* LibraryImage::get(const String& name) const {
+        if(mHeader == nullptr)
+            return nullptr;
+        // roots are sorted by name when saved.
+        const ImageRoot* roots = this->at<ImageRoot>(mHeader->rootOffset);
+        u32_t low = 0;
+        u32_t high = mHeader->rootCount;
+        while(low < high) {
+            u32_t mid = low + (high - low) / 2;
+            const char* rootName = this->string(roots[mid].name);
+            if(rootName == nullptr)
+                return nullptr;
+            int cmp = strcmp(rootName, name.cstr());
+            if(cmp == 0)
+                return &roots[mid].value;
+            if(cmp < 0)
+                low = mid + 1;
+            else
+                high = mid;
+        }
+        return nullptr;
+    }
+
+    const ImageValue* LibraryImage::get(const ImageValue* ptr, u32_t index) const {
+        SchemaType type = this->typeOf(ptr);
+        if(type == SchemaType::List) {
+            const u64_t* count = this->at<u64_t>(ptr->value.u64);
+            if(count == nullptr || index >= *count)
+                return nullptr;
+            const ImageValue* elements = this->at<ImageValue>(ptr->value.u64 + sizeof(u64_t), *count);
+            return elements != nullptr ? &elements[index] : nullptr;
+        }
+        if(type == SchemaType::Struct) {
+            const ImageSchema* schema = this->schema(ptr->schema);
+            if(index >= schema->memberCount)
+                return nullptr;
+            const ImageValue* members = this->at<ImageValue>(ptr->value.u64, schema->memberCount);
+            return members != nullptr ? &members[index] : nullptr;
+        }
+        return nullptr;
+    }
+
+    const ImageValue* LibraryImage::get(const ImageValue* object, const String& field) const {
+        if(this->typeOf(object) != SchemaType::Struct)
+            return nullptr;
+        u32_t index = this->getMemberIndex(object->schema, field);
+        if(index == u32_t(-1))
+            return nullptr;
+        return this->get(object, index);
+    }
+
+    u32_t LibraryImage::size(const ImageValue* list) const {
+        if(this->typeOf(list) != SchemaType::List)
+            return 0;
+        const u64_t* count = this->at<u64_t>(list->value.u64);
+        return count != nullptr ? u32_t(*count) : 0;
+    }
+
+    bool LibraryImage::get(const ImageValue* ptr, i32_t& val) const {
+        if(this->typeOf(ptr) != SchemaType::Int)
+            return false;
+        val = (i32_t)ptr->value.i64;
+        return true;
+    }
+
+    bool LibraryImage::get(const ImageValue* ptr, i64_t& val) const {
+        if(this->typeOf(ptr) != SchemaType::Int)
+            return false;
+        val = ptr->value.i64;
+        return true;
+    }
+
+    bool LibraryImage::get(const ImageValue* ptr, f64_t& val) const {
+        if(this->typeOf(ptr) != SchemaType::Float)
+            return false;
+        val = ptr->value.f64;
+        return true;
+    }
+
+    bool LibraryImage::get(const ImageValue* ptr, bool& val) const {
+        if(this->typeOf(ptr) != SchemaType::Bool)
+            return false;
+        val = ptr->value.i64 != 0;
+        return true;
+    }
+
+    bool LibraryImage::get(const ImageValue* ptr, String& val) const {
+        u32_t length = 0;
+        const char* str = this->getString(ptr, &length);
+        if(str == nullptr)
+            return false;
+        val = String(str, length);
+        return true;
+    }
+
+    const char* LibraryImage::getString(const ImageValue* ptr, u32_t* length) const {
+        if(this->typeOf(ptr) != SchemaType::String)
+            return nullptr;
+        return this->string(u32_t(ptr->value.u64), length);
+    }
+}
@@ -0,0 +1,129 @@
+#ifndef _EOKAS_DATAPOT_IMAGE_H_
+#define _EOKAS_DATAPOT_IMAGE_H_
+
+#include "./header.h"
+#include "./schema.h"
+
+namespace eokas::datapot {
+    /*
+    Image layout, used in place after the file is mapped:
+        ImageHeader
+        ImageSchema[schemaCount]
+        ImageMember[memberCount]
+        ImageRoot[rootCount]      sorted by name
+        lists                     u64_t count, ImageValue[count]
+        objects                   ImageValue[memberCount of the schema], by member index
+        u64_t[stringCount]        offsets of the pooled strings
+        strings                   u32_t length, chars, '\0'
+    Offsets are relative to the start of the image and 8 bytes aligned.
+    */
+    struct ImageHeader {
+        char magic[8];
+        u32_t version;
+        u32_t endian;
+        u64_t size;
+        u32_t schemaCount;
+        u32_t memberCount;
+        u64_t schemaOffset;
+        u64_t memberOffset;
+        u32_t rootCount;
+        u32_t stringCount;
+        u64_t rootOffset;
+        u64_t stringOffset;
+    };
+
+    struct ImageSchema {
+        u32_t type;
+        u32_t name;
+        u32_t element;
+        u32_t memberStart;
+        u32_t memberCount;
+        u32_t reserved;
+    };
+
+    struct ImageMember {
+        u32_t name;
+        u32_t schema;
+    };
+
+    /// String: index in the string pool, List/Struct: offset of the body.
+    struct ImageValue {
+        u32_t schema;
+        u32_t reserved;
+        union {
+            i64_t i64;
+            u64_t u64;
+            f64_t f64;
+        } value;
+    };
+
+    struct ImageRoot {
+        u32_t name;
+        u32_t reserved;
+        ImageValue value;
+    };
+
+    static const char IMAGE_MAGIC[8] = {'D', 'A', 'T', 'A', 'P', 'O', 'T', 'I'};
+    static const u32_t IMAGE_VERSION = 1;
+    static const u32_t IMAGE_ENDIAN = 0x01020304;
+
+    /*
+    Read-only view of a library saved by Library::saveImage().
+    Opening validates the header only, nothing is parsed or copied, so the
+    mapped pages are shared by every process opening the same file.
+    Every offset is checked against the image size before it is followed.
+    */
+    class LibraryImage {
+        _ForbidCopy(LibraryImage);
+        _ForbidAssign(LibraryImage);
+
+    public:
+        LibraryImage();
+        virtual ~LibraryImage();
+
+        bool open(const String& filePath);
+        /// the memory is borrowed and must outlive the image.
+        bool open(const void* data, size_t size);
+        void close();
+        bool isOpen() const;
+
+        u32_t getSchemaCount() const;
+        u32_t getSchemaIndex(const String& name) const;
+        const char* getSchemaName(u32_t schema) const;
+        SchemaType getSchemaType(u32_t schema) const;
+        u32_t getMemberIndex(u32_t schema, const String& name) const;
+
+        u32_t getRootCount() const;
+        const char* getRootName(u32_t index) const;
+
+        SchemaType typeOf(const ImageValue* ptr) const;
+
+        const ImageValue* get(const String& name) const;
+        /// element of a list, or member of an object by member index.
+        const ImageValue* get(const ImageValue* ptr, u32_t index) const;
+        const ImageValue* get(const ImageValue* object, const String& field) const;
+        u32_t size(const ImageValue* list) const;
+
+        bool get(const ImageValue* ptr, i32_t& val) const;
+        bool get(const ImageValue* ptr, i64_t& val) const;
+        bool get(const ImageValue* ptr, f64_t& val) const;
+        bool get(const ImageValue* ptr, bool& val) const;
+        bool get(const ImageValue* ptr, String& val) const;
+        /// points into the image, no copy.
+        const char* getString(const ImageValue* ptr, u32_t* length = nullptr) const;
+
+    private:
+        const u8_t* mData;
+        size_t mSize;
+        const ImageHeader* mHeader;
+        MappedFile* mFile;
+
+        bool attach(const void* data, size_t size);
+        template<typename T>
+        const T* at(u64_t offset, u64_t count = 1) const;
+        const ImageSchema* schema(u32_t index) const;
+        const char* string(u32_t index, u32_t* length = nullptr) const;
+    };
+}
+
+#endif//_EOKAS_DATAPOT_IMAGE_H_
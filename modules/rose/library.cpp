@@ -1,15 +1,41 @@
 #include "./library.h"
 #include "./schema.h"
 #include "./value.h"
+#include <algorithm>
+#include <cstring>
 
 namespace eokas::datapot {
+    static const String DELTA_MAGIC = "DATAPOTD";
+    static const i32_t DELTA_VERSION = 1;
+    
+    static u32_t checksumOf(const void* data, size_t size) {
+        const u8_t* bytes = (const u8_t*)data;
+        u32_t hash = 2166136261u;
+        for(size_t index = 0; index < size; index++) {
+            hash = (hash ^ bytes[index]) * 16777619u;
+        }
+        return hash;
+    }
+    
     Library::Library(const String& name)
         : mName(name)
         , mSchemas()
         , mValues(mSchemas)
-        , mRoot() { }
+        , mRoot()
+        , mFilePath()
+        , mGeneration(0)
+        , mSnapshotSize(0)
+        , mLogSize(0)
+        , mCompactRatio(0.5)
+        , mDirtyRoots()
+        , mSchemaRevisions()
+        , mEpochs()
+        , mSnapshot(nullptr)
+        , mRootStamp(0) { }
     
     Library::~Library() {
+        // readers must be gone, retired snapshots go with the epoch domain.
+        delete mSnapshot.exchange(nullptr);
         mRoot.clear();
     }
     
@@ -20,17 +46,511 @@ namespace eokas::datapot {
         }
         
         BinaryStream stream(file);
-        return this->load(stream);
+        if(!this->load(stream))
+            return false;
+        mSnapshotSize = file.size();
+        file.close();
+        
+        mFilePath = filePath;
+        mLogSize = 0;
+        if(!this->replayDelta(filePath + ".delta"))
+            return false;
+        this->markClean();
+        return true;
     }
     
     bool Library::save(const String& filePath) {
-        FileStream file = File::open(filePath, "wb");
-        if(!file.isOpen()) {
+        String tempPath = filePath + ".tmp";
+        u64_t generation = mGeneration;
+        // a new generation orphans the log of the previous snapshot.
+        mGeneration = Timer::now();
+        if(mGeneration == generation) {
+            mGeneration++;
+        }
+        
+        u64_t size = 0;
+        {
+            FileStream file = File::open(tempPath, "wb");
+            if(!file.isOpen()) {
+                mGeneration = generation;
+                return false;
+            }
+            BinaryStream stream(file);
+            bool saved = this->save(stream) && file.sync();
+            size = file.pos();
+            file.close();
+            if(!saved) {
+                File::remove(tempPath);
+                mGeneration = generation;
+                return false;
+            }
+        }
+        
+        if(!File::replace(tempPath, filePath)) {
+            File::remove(tempPath);
+            mGeneration = generation;
             return false;
         }
+        File::remove(filePath + ".delta");
+        
+        mFilePath = filePath;
+        mSnapshotSize = size;
+        mLogSize = 0;
+        this->markClean();
+        return true;
+    }
+    
+    bool Library::saveDelta(const String& filePath) {
+        if(filePath != mFilePath || mGeneration == 0 || !File::exists(filePath))
+            return this->save(filePath);
+        if(!this->isDirty())
+            return true;
+        if(mValues.isAllDirty() || this->isSchemaChanged())
+            return this->save(filePath);
+        
+        MemoryStream buffer;
+        buffer.open();
+        BinaryStream payload(buffer);
+        this->writeDelta(payload);
+        u32_t size = u32_t(buffer.pos());
+        u32_t checksum = checksumOf(buffer.data(), size);
         
+        String logPath = filePath + ".delta";
+        FileStream file = File::open(logPath, mLogSize > 0 ? "rb+" : "wb");
+        if(!file.isOpen())
+            return this->save(filePath);
         BinaryStream stream(file);
-        return this->save(stream);
+        if(mLogSize > 0) {
+            // anything behind the last good record is a torn write.
+            file.seek(int(mLogSize), SEEK_SET);
+        }
+        else {
+            stream.write(DELTA_MAGIC);
+            stream.write(DELTA_VERSION);
+            stream.write(mGeneration);
+        }
+        stream.write(size);
+        file.write(buffer.data(), size);
+        stream.write(checksum);
+        if(!file.sync())
+            return false;
+        mLogSize = file.pos();
+        file.close();
+        
+        this->markClean();
+        
+        if(mLogSize > mSnapshotSize * mCompactRatio)
+            return this->save(filePath);
+        return true;
+    }
+    
+    void Library::setCompactRatio(f64_t ratio) {
+        mCompactRatio = ratio;
+    }
+    
+    bool Library::isDirty() const {
+        return mValues.isDirty()
+            || !mDirtyRoots.empty()
+            || mSchemaRevisions.size() != mSchemas.count()
+            || this->isSchemaChanged();
+    }
+    
+    bool Library::isSchemaChanged() const {
+        for(u32_t index = 0; index < mSchemaRevisions.size(); index++) {
+            Schema* schema = mSchemas.get(index);
+            if(schema == nullptr || schema->revision() != mSchemaRevisions[index])
+                return true;
+        }
+        return false;
+    }
+    
+    void Library::markClean() {
+        mValues.markClean();
+        mDirtyRoots.clear();
+        mSchemaRevisions.resize(mSchemas.count());
+        for(u32_t index = 0; index < mSchemas.count(); index++) {
+            mSchemaRevisions[index] = mSchemas.get(index)->revision();
+        }
+    }
+    
+    const Snapshot* Library::publish() {
+        static const u32_t PAGE_SIZE = ValueHeap::PAGE_SIZE;
+        static const u32_t CHUNK_SIZE = ValueHeap::CHUNK_SIZE;
+        
+        const Snapshot* prev = mSnapshot.load(std::memory_order_relaxed);
+        Snapshot* next = prev != nullptr ? new Snapshot(*prev) : new Snapshot();
+        bool all = prev == nullptr || prev->mAllStamp != mValues.allStamp();
+        next->mVersion = prev != nullptr ? prev->mVersion + 1 : 1;
+        next->mAllStamp = mValues.allStamp();
+        
+        auto unchanged = [all](const auto& chunk, u32_t stamp, u32_t count)->bool {
+            return !all && chunk != nullptr && chunk->stamp == stamp && chunk->items.size() == count;
+        };
+        
+        u32_t valueCount = mValues.size();
+        next->mValues.resize((valueCount + PAGE_SIZE - 1) / PAGE_SIZE);
+        for(u32_t page = 0; page < next->mValues.size(); page++) {
+            u32_t begin = page * PAGE_SIZE;
+            u32_t count = std::min(PAGE_SIZE, valueCount - begin);
+            u32_t stamp = mValues.pageStamp(page);
+            auto& chunk = next->mValues[page];
+            if(unchanged(chunk, stamp, count))
+                continue;
+            auto copy = std::make_shared<SnapshotChunk<Value>>();
+            const Value* values = mValues.at(ValueHandle{begin});
+            copy->stamp = stamp;
+            copy->items.assign(values, values + count);
+            chunk = copy;
+        }
+        next->mValueCount = valueCount;
+        
+        u32_t listCount = u32_t(mValues.lists.size());
+        next->mLists.resize((listCount + CHUNK_SIZE - 1) / CHUNK_SIZE);
+        for(u32_t index = 0; index < next->mLists.size(); index++) {
+            u32_t begin = index * CHUNK_SIZE;
+            u32_t count = std::min(CHUNK_SIZE, listCount - begin);
+            u32_t stamp = mValues.listChunkStamp(index);
+            auto& chunk = next->mLists[index];
+            if(unchanged(chunk, stamp, count))
+                continue;
+            // lists may be long, only the changed ones of the chunk are copied.
+            auto copy = std::make_shared<SnapshotChunk<SnapshotList>>();
+            copy->stamp = stamp;
+            copy->items.resize(count);
+            for(u32_t offset = 0; offset < count; offset++) {
+                u32_t listStamp = mValues.listStamp(begin + offset);
+                if(!all && chunk != nullptr && offset < chunk->items.size() && chunk->items[offset].stamp == listStamp) {
+                    copy->items[offset] = chunk->items[offset];
+                    continue;
+                }
+                copy->items[offset].stamp = listStamp;
+                copy->items[offset].list = std::make_shared<const List>(mValues.lists[begin + offset]);
+            }
+            chunk = copy;
+        }
+        
+        u32_t objectCount = u32_t(mValues.objects.size());
+        next->mObjects.resize((objectCount + CHUNK_SIZE - 1) / CHUNK_SIZE);
+        for(u32_t index = 0; index < next->mObjects.size(); index++) {
+            u32_t begin = index * CHUNK_SIZE;
+            u32_t count = std::min(CHUNK_SIZE, objectCount - begin);
+            u32_t stamp = mValues.objectChunkStamp(index);
+            auto& chunk = next->mObjects[index];
+            if(unchanged(chunk, stamp, count))
+                continue;
+            auto copy = std::make_shared<SnapshotChunk<Object>>();
+            copy->stamp = stamp;
+            copy->items.assign(mValues.objects.begin() + begin, mValues.objects.begin() + begin + count);
+            chunk = copy;
+        }
+        
+        // strings are only appended, the chunks below the last count are final.
+        u32_t stringCount = u32_t(mValues.strings.size());
+        u32_t stringStart = all || prev->mStringCount > stringCount ? 0 : prev->mStringCount / PAGE_SIZE;
+        next->mStrings.resize((stringCount + PAGE_SIZE - 1) / PAGE_SIZE);
+        for(u32_t index = stringStart; index < next->mStrings.size(); index++) {
+            u32_t begin = index * PAGE_SIZE;
+            u32_t count = std::min(PAGE_SIZE, stringCount - begin);
+            auto& chunk = next->mStrings[index];
+            if(unchanged(chunk, 0, count))
+                continue;
+            auto copy = std::make_shared<SnapshotChunk<String>>();
+            copy->items.assign(mValues.strings.begin() + begin, mValues.strings.begin() + begin + count);
+            chunk = copy;
+        }
+        next->mStringCount = stringCount;
+        
+        if(all || prev->mRootStamp != mRootStamp) {
+            auto roots = std::make_shared<std::map<String, u32_t>>();
+            for(auto& pair : mRoot) {
+                u32_t index = mValues.indexOf(pair.second);
+                if(index != u32_t(-1)) {
+                    roots->insert(std::make_pair(pair.first, index));
+                }
+            }
+            next->mRoots = roots;
+            next->mRootStamp = mRootStamp;
+        }
+        
+        std::vector<u32_t> revisions(mSchemas.count());
+        for(u32_t index = 0; index < mSchemas.count(); index++) {
+            revisions[index] = mSchemas.get(index)->revision();
+        }
+        if(all || revisions != prev->mSchemaRevisions) {
+            auto schemas = std::make_shared<std::unordered_map<const Schema*, SnapshotSchema>>();
+            for(u32_t index = 0; index < mSchemas.count(); index++) {
+                Schema* schema = mSchemas.get(index);
+                SnapshotSchema& frozen = (*schemas)[schema];
+                frozen.type = schema->type();
+                frozen.element = schema->getElement();
+                for(u32_t memberIndex = 0; memberIndex < schema->getMemberCount(); memberIndex++) {
+                    auto* member = schema->getMember(memberIndex);
+                    frozen.members.push_back(*member);
+                    frozen.indices.insert(std::make_pair(member->name, memberIndex));
+                }
+            }
+            next->mSchemas = schemas;
+            next->mSchemaRevisions.swap(revisions);
+        }
+        
+        mSnapshot.store(next, std::memory_order_release);
+        if(prev != nullptr) {
+            mEpochs.retire(const_cast<Snapshot*>(prev));
+        }
+        mEpochs.collect();
+        return next;
+    }
+    
+    SnapshotRef Library::acquire() {
+        return SnapshotRef(mEpochs, mSnapshot);
+    }
+    
+    u32_t Library::indexOf(Schema* schema) const {
+        return schema != nullptr ? mSchemas.indexOf(schema->symbol()) : u32_t(-1);
+    }
+    
+    void Library::writeSchema(BinaryStream& stream, Schema* schema) {
+        SchemaType type = schema->type();
+        stream.write(type);
+        
+        const String& name = schema->name();
+        stream.write(name);
+        
+        if(type == SchemaType::List) {
+            Schema* elementSchema = schema->getElement();
+            stream.write(this->indexOf(elementSchema));
+        }
+        else if(type == SchemaType::Struct) {
+            u32_t memberCount = schema->getMemberCount();
+            stream.write(memberCount);
+            for(u32_t memberIndex = 0; memberIndex < memberCount; memberIndex++) {
+                auto* member = schema->getMember(memberIndex);
+                stream.write(member->name.str());
+                stream.write(this->indexOf(member->schema));
+            }
+        }
+    }
+    
+    bool Library::readSchema(BinaryStream& stream) {
+        SchemaType type;
+        if(!stream.read(type)) return false;
+        String name;
+        if(!stream.read(name)) return false;
+        
+        Schema* schema = mSchemas.add(type, name);
+        
+        if(type == SchemaType::List) {
+            u32_t elementSchemaIndex = -1;
+            if(!stream.read(elementSchemaIndex)) return false;
+            Schema* elementSchema = mSchemas.get(elementSchemaIndex);
+            schema->setElement(elementSchema);
+        }
+        else if(type == SchemaType::Struct) {
+            u32_t memberCount = 0;
+            if(!stream.read(memberCount)) return false;
+            for(u32_t memberIndex = 0; memberIndex < memberCount; memberIndex ++) {
+                String memberName;
+                u32_t memberSchemaIndex = -1;
+                if(!stream.read(memberName)) return false;
+                if(!stream.read(memberSchemaIndex)) return false;
+                Schema* memberSchema = mSchemas.get(memberSchemaIndex);
+                schema->addMember(memberName, memberSchema);
+            }
+        }
+        return true;
+    }
+    
+    /*
+    A delta record holds the new state of everything changed, keyed by the
+    same indices as the snapshot: new schemas, appended strings, value
+    slots, whole lists, whole objects and roots.
+    */
+    void Library::writeDelta(BinaryStream& stream) {
+        u32_t schemaStart = u32_t(mSchemaRevisions.size());
+        stream.write(schemaStart);
+        stream.write(mSchemas.count() - schemaStart);
+        for(u32_t index = schemaStart; index < mSchemas.count(); index++) {
+            this->writeSchema(stream, mSchemas.get(index));
+        }
+        
+        u32_t stringStart = mValues.cleanStrings();
+        stream.write(stringStart);
+        stream.write(u32_t(mValues.strings.size()) - stringStart);
+        for(size_t index = stringStart; index < mValues.strings.size(); index++) {
+            stream.write(mValues.strings[index]);
+        }
+        
+        auto writeValue = [this](BinaryStream& stream, const Value& value) {
+            stream.write(this->indexOf(value.schema));
+            stream.write(value.value.u64);
+        };
+        
+        const auto& values = mValues.dirtyValues().indices;
+        stream.write(u32_t(values.size()));
+        for(u32_t index : values) {
+            stream.write(index);
+            writeValue(stream, *mValues.at(ValueHandle{index}));
+        }
+        
+        const auto& lists = mValues.dirtyLists().indices;
+        stream.write(u32_t(lists.size()));
+        for(u32_t index : lists) {
+            const auto& elements = mValues.lists[index].elements;
+            stream.write(index);
+            stream.write(u32_t(elements.size()));
+            for(const auto& element : elements) {
+                writeValue(stream, element);
+            }
+        }
+        
+        const auto& objects = mValues.dirtyObjects().indices;
+        stream.write(u32_t(objects.size()));
+        for(u32_t index : objects) {
+            const Object& obj = mValues.objects[index];
+            stream.write(index);
+            stream.write(this->indexOf(obj.schema));
+            stream.write(u32_t(obj.members.size()));
+            for(const auto& member : obj.members) {
+                writeValue(stream, member);
+            }
+        }
+        
+        stream.write(u32_t(mDirtyRoots.size()));
+        for(const auto& name : mDirtyRoots) {
+            auto iter = mRoot.find(name);
+            stream.write(name);
+            stream.write(iter != mRoot.end() ? mValues.indexOf(iter->second) : u32_t(-1));
+        }
+    }
+    
+    bool Library::readDelta(BinaryStream& stream) {
+        u32_t schemaStart = 0;
+        u32_t schemaCount = 0;
+        if(!stream.read(schemaStart) || !stream.read(schemaCount)) return false;
+        if(schemaStart != mSchemas.count()) return false;
+        for(u32_t index = 0; index < schemaCount; index++) {
+            if(!this->readSchema(stream)) return false;
+        }
+        
+        u32_t stringStart = 0;
+        u32_t stringCount = 0;
+        if(!stream.read(stringStart) || !stream.read(stringCount)) return false;
+        if(stringStart > mValues.strings.size()) return false;
+        mValues.strings.resize(stringStart);
+        for(u32_t index = 0; index < stringCount; index++) {
+            String& str = mValues.strings.emplace_back();
+            if(!stream.read(str)) return false;
+        }
+        
+        auto readValue = [this](BinaryStream& stream, Value& value)->bool {
+            u32_t schemaIndex = -1;
+            u64_t valueU64 = 0;
+            if(!stream.read(schemaIndex)) return false;
+            if(!stream.read(valueU64)) return false;
+            value.schema = mSchemas.get(schemaIndex);
+            value.value.u64 = valueU64;
+            return true;
+        };
+        
+        u32_t valueCount = 0;
+        if(!stream.read(valueCount)) return false;
+        for(u32_t count = 0; count < valueCount; count++) {
+            u32_t index = 0;
+            if(!stream.read(index)) return false;
+            mValues.resize(index + 1);
+            if(!readValue(stream, *mValues.at(ValueHandle{index}))) return false;
+        }
+        
+        u32_t listCount = 0;
+        if(!stream.read(listCount)) return false;
+        for(u32_t count = 0; count < listCount; count++) {
+            u32_t index = 0;
+            u32_t elementCount = 0;
+            if(!stream.read(index) || !stream.read(elementCount)) return false;
+            if(index >= mValues.lists.size()) {
+                mValues.lists.resize(index + 1);
+            }
+            auto& elements = mValues.lists[index].elements;
+            elements.resize(elementCount);
+            for(auto& element : elements) {
+                if(!readValue(stream, element)) return false;
+            }
+        }
+        
+        u32_t objectCount = 0;
+        if(!stream.read(objectCount)) return false;
+        for(u32_t count = 0; count < objectCount; count++) {
+            u32_t index = 0;
+            u32_t schemaIndex = -1;
+            u32_t memberCount = 0;
+            if(!stream.read(index) || !stream.read(schemaIndex) || !stream.read(memberCount)) return false;
+            if(index >= mValues.objects.size()) {
+                mValues.objects.resize(index + 1);
+            }
+            Object& obj = mValues.objects[index];
+            obj.schema = mSchemas.get(schemaIndex);
+            obj.members.resize(memberCount);
+            for(auto& member : obj.members) {
+                if(!readValue(stream, member)) return false;
+            }
+        }
+        
+        u32_t rootCount = 0;
+        if(!stream.read(rootCount)) return false;
+        for(u32_t count = 0; count < rootCount; count++) {
+            String name;
+            u32_t valueIndex = -1;
+            if(!stream.read(name) || !stream.read(valueIndex)) return false;
+            Value* value = mValues.at(ValueHandle{valueIndex});
+            if(value != nullptr) {
+                mRoot[name] = value;
+            }
+            else {
+                mRoot.erase(name);
+            }
+        }
+        
+        return true;
+    }
+    
+    bool Library::replayDelta(const String& logPath) {
+        FileStream file = File::open(logPath, "rb");
+        if(!file.isOpen())
+            return true;
+        
+        BinaryStream stream(file);
+        String magic;
+        i32_t version = 0;
+        u64_t generation = 0;
+        if(!stream.read(magic) || !stream.read(version) || !stream.read(generation))
+            return true;
+        // written against another snapshot, the snapshot already has it.
+        if(magic != DELTA_MAGIC || version != DELTA_VERSION || generation != mGeneration)
+            return true;
+        mLogSize = file.pos();
+        
+        std::vector<u8_t> payload;
+        while(true) {
+            u32_t size = 0;
+            u32_t checksum = 0;
+            if(!stream.read(size))
+                break;
+            payload.resize(size);
+            if(file.read(payload.data(), size) != size)
+                break;
+            if(!stream.read(checksum) || checksum != checksumOf(payload.data(), size))
+                break;
+            
+            MemoryStream buffer(payload.data(), size);
+            buffer.open();
+            BinaryStream record(buffer);
+            if(!this->readDelta(record))
+                return false;
+            mLogSize = file.pos();
+        }
+        
+        mValues.reclaim();
+        return true;
     }
     
     bool Library::load(BinaryStream& stream) {
@@ -53,31 +573,7 @@ namespace eokas::datapot {
         u32_t schemaCount = 0;
         if(!stream.read(schemaCount)) return false;
         for(u32_t schemaIndex = 0; schemaIndex < schemaCount; schemaIndex++) {
-            SchemaType type;
-            if(!stream.read(type)) return false;
-            String name;
-            if(!stream.read(name)) return false;
-            
-            Schema* schema = mSchemas.add(type, name);
-            
-            if(type == SchemaType::List) {
-                u32_t elementSchemaIndex = -1;
-                if(!stream.read(elementSchemaIndex)) return false;
-                Schema* elementSchema = mSchemas.get(elementSchemaIndex);
-                schema->setElement(elementSchema);
-            }
-            else if(type == SchemaType::Struct) {
-                u32_t memberCount = 0;
-                if(!stream.read(memberCount)) return false;
-                for(u32_t memberIndex = 0; memberIndex < memberCount; memberIndex ++) {
-                    String memberName;
-                    u32_t memberSchemaIndex = -1;
-                    if(!stream.read(memberName)) return false;
-                    if(!stream.read(memberSchemaIndex)) return false;
-                    Schema* memberSchema = mSchemas.get(memberSchemaIndex);
-                    schema->addMember(memberName, memberSchema);
-                }
-            }
+            if(!this->readSchema(stream)) return false;
         }
         
         auto readValue = [this](BinaryStream& stream, Value& value)->bool {
@@ -101,20 +597,30 @@ namespace eokas::datapot {
             return true;
         };
         
-        auto readValueMap = [this, &readValue](BinaryStream& stream, std::map<String, Value>& map)->bool {
+        using Field = std::pair<String, Value>;
+        auto readValueMap = [this, &readValue](BinaryStream& stream, std::vector<Field>& fields)->bool {
             u32_t count = -1;
             if(!stream.read(count)) return false;
             for(u32_t index = 0; index < count; index++) {
-                String name;
-                if(!stream.read(name)) return false;
-                Value& value = map[name];
-                if(!readValue(stream, value)) return false;
+                Field& field = fields.emplace_back();
+                if(!stream.read(field.first)) return false;
+                if(!readValue(stream, field.second)) return false;
             }
             return true;
         };
         
-        if(!readValueList(stream, mValues.values)) {
-            return false;
+        u32_t valueCount = 0;
+        if(!stream.read(valueCount)) return false;
+        for(u32_t index = 0; index < valueCount; index++) {
+            Value* value = mValues.at(mValues.alloc());
+            if(!readValue(stream, *value)) return false;
+        }
+        // slots without schema were dropped before saving.
+        for(u32_t index = 0; index < valueCount; index++) {
+            ValueHandle handle{index};
+            if(mValues.at(handle)->schema == nullptr) {
+                mValues.drop(handle);
+            }
         }
         
         u32_t listCount = 0;
@@ -126,9 +632,43 @@ namespace eokas::datapot {
         
         u32_t objectCount = 0;
         if(!stream.read(objectCount)) return false;
+        std::vector<std::vector<Field>> objectFields(objectCount);
         for(u32_t index = 0; index < objectCount; index++) {
-            Object& obj = mValues.objects.emplace_back();
-            if(!readValueMap(stream, obj.members)) return false;
+            mValues.objects.emplace_back();
+            if(!readValueMap(stream, objectFields[index])) return false;
+        }
+        
+        // objects are saved by member name, their schema is only known
+        // from the values referencing them.
+        auto bindObject = [this, &objectFields](const Value& value) {
+            if(value.schema == nullptr || !value.schema->is(SchemaType::Struct))
+                return;
+            u64_t index = value.value.u64;
+            if(index >= mValues.objects.size() || mValues.objects[index].schema != nullptr)
+                return;
+            Object& obj = mValues.objects[index];
+            obj.schema = value.schema;
+            obj.members.resize(value.schema->getMemberCount());
+            for(u32_t memberIndex = 0; memberIndex < obj.members.size(); memberIndex++) {
+                obj.members[memberIndex].schema = value.schema->getMember(memberIndex)->schema;
+                obj.members[memberIndex].value.u64 = 0;
+            }
+            for(auto& field : objectFields[index]) {
+                obj.set(value.schema->getMemberIndex(field.first), field.second);
+            }
+        };
+        for(u32_t index = 0; index < mValues.size(); index++) {
+            bindObject(*mValues.at(ValueHandle{index}));
+        }
+        for(auto& list : mValues.lists) {
+            for(auto& element : list.elements) {
+                bindObject(element);
+            }
+        }
+        for(auto& fields : objectFields) {
+            for(auto& field : fields) {
+                bindObject(field.second);
+            }
         }
         
         u32_t stringCount = 0;
@@ -145,9 +685,21 @@ namespace eokas::datapot {
             if(!stream.read(name)) return false;
             u32_t valueIndex = -1;
             if(!stream.read(valueIndex)) return false;
-            mRoot[name] = &mValues.values.at(valueIndex);
+            Value* value = mValues.at(ValueHandle{valueIndex});
+            if(value == nullptr) return false;
+            mRoot[name] = value;
+        }
+        
+        // older snapshots end here, they have no delta log.
+        u64_t generation = 0;
+        if(!stream.read(generation)) {
+            generation = 0;
         }
+        mGeneration = generation;
         
+        // nothing loaded is in a snapshot yet.
+        mValues.markAll();
+        this->markClean();
         return true;
     }
     
@@ -164,46 +716,33 @@ namespace eokas::datapot {
         
         stream.write(mSchemas.count());
         for(u32_t index = 0; index < mSchemas.count(); index++) {
-            Schema* schema = mSchemas.get(index);
-            
-            SchemaType type = schema->type();
-            stream.write(type);
-            
-            const String& name = schema->name();
-            stream.write(name);
-            
-            if(type == SchemaType::List) {
-                Schema* elementSchema = schema->getElement();
-                stream.write(mSchemas.indexOf(elementSchema->name()));
-            }
-            else if(type == SchemaType::Struct) {
-                u32_t memberCount = schema->getMemberCount();
-                stream.write(memberCount);
-                for(u32_t memberIndex = 0; memberIndex < memberCount; memberIndex++) {
-                    auto* member = schema->getMember(memberIndex);
-                    stream.write(member->name);
-                    stream.write(mSchemas.indexOf(member->schema->name()));
-                }
-            }
+            this->writeSchema(stream, mSchemas.get(index));
         }
         
         auto saveValueList = [this](BinaryStream& stream, const std::vector<Value>& list) {
             stream.write(u32_t(list.size()));
             for(const auto& value : list) {
-                stream.write(mSchemas.indexOf(value.schema->name()));
+                stream.write(this->indexOf(value.schema));
                 stream.write(value.value.u64);
             }
         };
-        auto saveValueMap = [this](BinaryStream& stream, const std::map<String, Value>& map) {
-            stream.write(u32_t(map.size()));
-            for(auto& pair : map) {
-                stream.write(pair.first);
-                stream.write(mSchemas.indexOf(pair.second.schema->name()));
-                stream.write(pair.second.value.u64);
+        auto saveValueMap = [this](BinaryStream& stream, const Object& obj) {
+            u32_t count = obj.schema != nullptr ? u32_t(obj.members.size()) : 0;
+            stream.write(count);
+            for(u32_t index = 0; index < count; index++) {
+                const Value& value = obj.members[index];
+                stream.write(obj.schema->getMember(index)->name.str());
+                stream.write(this->indexOf(value.schema));
+                stream.write(value.value.u64);
             }
         };
         
-        saveValueList(stream, mValues.values);
+        stream.write(mValues.size());
+        for(u32_t index = 0; index < mValues.size(); index++) {
+            const Value* value = mValues.at(ValueHandle{index});
+            stream.write(this->indexOf(value->schema));
+            stream.write(value->value.u64);
+        }
         
         stream.write(u32_t(mValues.lists.size()));
         for(List& list : mValues.lists) {
@@ -212,7 +751,7 @@ namespace eokas::datapot {
         
         stream.write(u32_t(mValues.objects.size()));
         for(Object& obj : mValues.objects) {
-            saveValueMap(stream, obj.members);
+            saveValueMap(stream, obj);
         }
         
         stream.write(u32_t(mValues.strings.size()));
@@ -226,9 +765,215 @@ namespace eokas::datapot {
             stream.write(mValues.indexOf(pair.second));
         }
         
+        stream.write(mGeneration);
+        
         return true;
     }
-    
+
+    bool Library::saveImage(const String& filePath) {
+        FileStream file = File::open(filePath, "wb");
+        if(!file.isOpen()) {
+            return false;
+        }
+
+        return this->saveImage(file);
+    }
+
+    bool Library::saveImage(Stream& stream) {
+        if(!stream.isOpen()) {
+            return false;
+        }
+
+        auto align = [](u64_t offset)->u64_t {
+            return (offset + 7) & ~u64_t(7);
+        };
+
+        std::map<Schema*, u32_t> schemaIndices;
+        u32_t memberCount = 0;
+        for(u32_t index = 0; index < mSchemas.count(); index++) {
+            Schema* schema = mSchemas.get(index);
+            schemaIndices[schema] = index;
+            if(schema->is(SchemaType::Struct)) {
+                memberCount += schema->getMemberCount();
+            }
+        }
+
+        std::vector<String> strings;
+        std::map<String, u32_t> stringIndices;
+        auto pool = [&strings, &stringIndices](const String& str)->u32_t {
+            auto iter = stringIndices.find(str);
+            if(iter != stringIndices.end())
+                return iter->second;
+            u32_t index = u32_t(strings.size());
+            strings.push_back(str);
+            stringIndices.insert(std::make_pair(str, index));
+            return index;
+        };
+
+        // only what is reachable from the roots is written.
+        std::vector<bool> usedLists(mValues.lists.size(), false);
+        std::vector<Schema*> objectSchemas(mValues.objects.size(), nullptr);
+        std::vector<Value> pending;
+        for(auto& pair : mRoot) {
+            if(pair.second != nullptr && pair.second->schema != nullptr) {
+                pending.push_back(*pair.second);
+            }
+        }
+        while(!pending.empty()) {
+            Value value = pending.back();
+            pending.pop_back();
+            if(value.schema == nullptr)
+                continue;
+            u64_t index = value.value.u64;
+            if(value.schema->is(SchemaType::List) && index < usedLists.size() && !usedLists[index]) {
+                usedLists[index] = true;
+                const auto& elements = mValues.lists[index].elements;
+                pending.insert(pending.end(), elements.begin(), elements.end());
+            }
+            else if(value.schema->is(SchemaType::Struct) && index < objectSchemas.size() && objectSchemas[index] == nullptr) {
+                const Object& obj = mValues.objects[index];
+                objectSchemas[index] = obj.schema;
+                pending.insert(pending.end(), obj.members.begin(), obj.members.end());
+            }
+        }
+
+        u64_t offset = align(sizeof(ImageHeader));
+        u64_t schemaOffset = offset;
+        offset = align(offset + sizeof(ImageSchema) * mSchemas.count());
+        u64_t memberOffset = offset;
+        offset = align(offset + sizeof(ImageMember) * memberCount);
+        u64_t rootOffset = offset;
+        offset = align(offset + sizeof(ImageRoot) * mRoot.size());
+
+        std::vector<u64_t> listOffsets(mValues.lists.size(), 0);
+        for(size_t index = 0; index < mValues.lists.size(); index++) {
+            if(!usedLists[index])
+                continue;
+            listOffsets[index] = offset;
+            offset += sizeof(u64_t) + sizeof(ImageValue) * mValues.lists[index].elements.size();
+        }
+        std::vector<u64_t> objectOffsets(mValues.objects.size(), 0);
+        for(size_t index = 0; index < mValues.objects.size(); index++) {
+            if(objectSchemas[index] == nullptr)
+                continue;
+            objectOffsets[index] = offset;
+            offset += sizeof(ImageValue) * objectSchemas[index]->getMemberCount();
+        }
+
+        std::vector<u8_t> image(size_t(offset), 0);
+
+        auto encode = [&](const Value& value)->ImageValue {
+            ImageValue result{};
+            result.schema = u32_t(-1);
+            if(value.schema == nullptr)
+                return result;
+            result.schema = schemaIndices[value.schema];
+            result.value.u64 = value.value.u64;
+            u64_t index = value.value.u64;
+            switch(value.schema->type()) {
+                case SchemaType::String:
+                    result.value.u64 = index < mValues.strings.size() ? pool(mValues.strings[index]) : pool("");
+                    break;
+                case SchemaType::List:
+                    result.value.u64 = index < listOffsets.size() ? listOffsets[index] : 0;
+                    break;
+                case SchemaType::Struct:
+                    result.value.u64 = index < objectOffsets.size() ? objectOffsets[index] : 0;
+                    break;
+                default:
+                    break;
+            }
+            return result;
+        };
+
+        ImageSchema* imageSchemas = (ImageSchema*)(image.data() + schemaOffset);
+        ImageMember* imageMembers = (ImageMember*)(image.data() + memberOffset);
+        u32_t memberStart = 0;
+        for(u32_t index = 0; index < mSchemas.count(); index++) {
+            Schema* schema = mSchemas.get(index);
+            ImageSchema& imageSchema = imageSchemas[index];
+            imageSchema.type = u32_t(schema->type());
+            imageSchema.name = pool(schema->name());
+            imageSchema.element = u32_t(-1);
+            imageSchema.memberStart = memberStart;
+            if(schema->is(SchemaType::List) && schema->getElement() != nullptr) {
+                imageSchema.element = schemaIndices[schema->getElement()];
+            }
+            if(schema->is(SchemaType::Struct)) {
+                imageSchema.memberCount = schema->getMemberCount();
+                for(u32_t memberIndex = 0; memberIndex < imageSchema.memberCount; memberIndex++) {
+                    auto* member = schema->getMember(memberIndex);
+                    ImageMember& imageMember = imageMembers[memberStart++];
+                    imageMember.name = pool(member->name.str());
+                    imageMember.schema = schemaIndices[member->schema];
+                }
+            }
+        }
+
+        std::vector<std::pair<String, Value*>> roots(mRoot.begin(), mRoot.end());
+        std::sort(roots.begin(), roots.end(), [](const auto& a, const auto& b) {
+            return strcmp(a.first.cstr(), b.first.cstr()) < 0;
+        });
+        ImageRoot* imageRoots = (ImageRoot*)(image.data() + rootOffset);
+        for(size_t index = 0; index < roots.size(); index++) {
+            imageRoots[index].name = pool(roots[index].first);
+            imageRoots[index].value = roots[index].second != nullptr ? encode(*roots[index].second) : encode(Value{});
+        }
+
+        for(size_t index = 0; index < mValues.lists.size(); index++) {
+            if(!usedLists[index])
+                continue;
+            const auto& elements = mValues.lists[index].elements;
+            *(u64_t*)(image.data() + listOffsets[index]) = elements.size();
+            ImageValue* imageElements = (ImageValue*)(image.data() + listOffsets[index] + sizeof(u64_t));
+            for(size_t elementIndex = 0; elementIndex < elements.size(); elementIndex++) {
+                imageElements[elementIndex] = encode(elements[elementIndex]);
+            }
+        }
+
+        for(size_t index = 0; index < mValues.objects.size(); index++) {
+            Schema* schema = objectSchemas[index];
+            if(schema == nullptr)
+                continue;
+            const auto& members = mValues.objects[index].members;
+            ImageValue* imageMembers = (ImageValue*)(image.data() + objectOffsets[index]);
+            for(u32_t memberIndex = 0; memberIndex < schema->getMemberCount(); memberIndex++) {
+                imageMembers[memberIndex] = memberIndex < members.size() ? encode(members[memberIndex]) : encode(Value{});
+            }
+        }
+
+        // the pool is complete once every value is encoded.
+        u64_t stringOffset = align(image.size());
+        u64_t stringData = align(stringOffset + sizeof(u64_t) * strings.size());
+        image.resize(size_t(stringData), 0);
+        for(size_t index = 0; index < strings.size(); index++) {
+            const String& str = strings[index];
+            u64_t strOffset = image.size();
+            ((u64_t*)(image.data() + stringOffset))[index] = strOffset;
+            u32_t length = u32_t(str.length());
+            image.resize(size_t(strOffset + sizeof(u32_t) + length + 1), 0);
+            memcpy(image.data() + strOffset, &length, sizeof(u32_t));
+            memcpy(image.data() + strOffset + sizeof(u32_t), str.cstr(), length);
+            image.resize(size_t(align(image.size())), 0);
+        }
+
+        ImageHeader& header = *(ImageHeader*)image.data();
+        memcpy(header.magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC));
+        header.version = IMAGE_VERSION;
+        header.endian = IMAGE_ENDIAN;
+        header.size = image.size();
+        header.schemaCount = mSchemas.count();
+        header.memberCount = memberCount;
+        header.schemaOffset = schemaOffset;
+        header.memberOffset = memberOffset;
+        header.rootCount = u32_t(roots.size());
+        header.stringCount = u32_t(strings.size());
+        header.rootOffset = rootOffset;
+        header.stringOffset = stringOffset;
+
+        return stream.write(image.data(), image.size()) == image.size();
+    }
+
     Schema* Library::addSchema(SchemaType type, const String& name) {
         return mSchemas.add(type, name);
     }
@@ -237,6 +982,10 @@ namespace eokas::datapot {
         return mSchemas.get(name);
     }
     
+    Schema* Library::getSchema(const HashKey& name) const {
+        return mSchemas.get(name);
+    }
+    
     Schema* Library::getSchema(u32_t index) const {
         return mSchemas.get(index);
     }
@@ -300,23 +1049,38 @@ namespace eokas::datapot {
     }
 
     bool Library::set(Value* ptr, i32_t val) {
-        return mValues.set(ptr, val);
+        if(!mValues.set(ptr, val))
+            return false;
+        mValues.touch(ptr);
+        return true;
     }
 
     bool Library::set(Value* ptr, i64_t val) {
-        return mValues.set(ptr, val);
+        if(!mValues.set(ptr, val))
+            return false;
+        mValues.touch(ptr);
+        return true;
     }
 
     bool Library::set(Value* ptr, f64_t val) {
-        return mValues.set(ptr, val);
+        if(!mValues.set(ptr, val))
+            return false;
+        mValues.touch(ptr);
+        return true;
     }
 
     bool Library::set(Value* ptr, bool val) {
-        return mValues.set(ptr, val);
+        if(!mValues.set(ptr, val))
+            return false;
+        mValues.touch(ptr);
+        return true;
     }
 
     bool Library::set(Value* ptr, const String& val) {
-        return mValues.set(ptr, val);
+        if(!mValues.set(ptr, val))
+            return false;
+        mValues.touch(ptr);
+        return true;
     }
     
     Value* Library::get(const String& name) {
@@ -353,31 +1117,43 @@ namespace eokas::datapot {
 
     void Library::set(const String& name, Value* val) {
         mRoot[name] = val;
+        mDirtyRoots.insert(name);
+        mRootStamp++;
     }
 
     void Library::set(const String& name, i32_t val) {
         Value* value = mValues.make(val);
         mRoot[name] = value;
+        mDirtyRoots.insert(name);
+        mRootStamp++;
     }
 
     void Library::set(const String& name, i64_t val) {
         Value* value = mValues.make(val);
         mRoot[name] = value;
+        mDirtyRoots.insert(name);
+        mRootStamp++;
     }
 
     void Library::set(const String& name, f64_t val) {
         Value* value = mValues.make(val);
         mRoot[name] = value;
+        mDirtyRoots.insert(name);
+        mRootStamp++;
     }
 
     void Library::set(const String& name, bool val) {
         Value* value = mValues.make(val);
         mRoot[name] = value;
+        mDirtyRoots.insert(name);
+        mRootStamp++;
     }
 
     void Library::set(const String& name, const String& val) {
         Value* value = mValues.make(val);
         mRoot[name] = value;
+        mDirtyRoots.insert(name);
+        mRootStamp++;
     }
     
     Value* Library::get(Value* list, u32_t index) {
@@ -415,27 +1191,37 @@ namespace eokas::datapot {
 
     bool Library::set(Value* list, u32_t index, i32_t val) {
         Value* value = mValues.make(val);
-        return mValues.set(list, index, value);
+        bool ret = mValues.set(list, index, value);
+        mValues.drop(value);
+        return ret;
     }
 
     bool Library::set(Value* list, u32_t index, i64_t val) {
         Value* value = mValues.make(val);
-        return mValues.set(list, index, value);
+        bool ret = mValues.set(list, index, value);
+        mValues.drop(value);
+        return ret;
     }
 
     bool Library::set(Value* list, u32_t index, f64_t val) {
         Value* value = mValues.make(val);
-        return mValues.set(list, index, value);
+        bool ret = mValues.set(list, index, value);
+        mValues.drop(value);
+        return ret;
     }
 
     bool Library::set(Value* list, u32_t index, bool val) {
         Value* value = mValues.make(val);
-        return mValues.set(list, index, value);
+        bool ret = mValues.set(list, index, value);
+        mValues.drop(value);
+        return ret;
     }
 
     bool Library::set(Value* list, u32_t index, const String& val) {
         Value* value = mValues.make(val);
-        return mValues.set(list, index, value);
+        bool ret = mValues.set(list, index, value);
+        mValues.drop(value);
+        return ret;
     }
 
     bool Library::push(Value* list, Value* val) {
@@ -444,26 +1230,36 @@ namespace eokas::datapot {
 
     bool Library::push(Value* list, i32_t val) {
         Value* value = mValues.make(val);
-        return mValues.push(list, value);
+        bool ret = mValues.push(list, value);
+        mValues.drop(value);
+        return ret;
     }
     bool Library::push(Value* list, i64_t val) {
         Value* value = mValues.make(val);
-        return mValues.push(list, value);
+        bool ret = mValues.push(list, value);
+        mValues.drop(value);
+        return ret;
     }
 
     bool Library::push(Value* list, f64_t val) {
         Value* value = mValues.make(val);
-        return mValues.push(list, value);
+        bool ret = mValues.push(list, value);
+        mValues.drop(value);
+        return ret;
     }
 
     bool Library::push(Value* list, bool val) {
         Value* value = mValues.make(val);
-        return mValues.push(list, value);
+        bool ret = mValues.push(list, value);
+        mValues.drop(value);
+        return ret;
     }
 
     bool Library::push(Value* list, const String& val) {
         Value* value = mValues.make(val);
-        return mValues.push(list, value);
+        bool ret = mValues.push(list, value);
+        mValues.drop(value);
+        return ret;
     }
 
     bool Library::pop(Value* list, Value* val) {
@@ -540,27 +1336,115 @@ namespace eokas::datapot {
 
     bool Library::set(Value* object, const String& field, i32_t val) {
         Value* value = mValues.make(val);
-        return mValues.set(object, field, value);
+        bool ret = mValues.set(object, field, value);
+        mValues.drop(value);
+        return ret;
     }
 
     bool Library::set(Value* object, const String& field, i64_t val) {
         Value* value = mValues.make(val);
-        return mValues.set(object, field, value);
+        bool ret = mValues.set(object, field, value);
+        mValues.drop(value);
+        return ret;
     }
 
     bool Library::set(Value* object, const String& field, f64_t val) {
         Value* value = mValues.make(val);
-        return mValues.set(object, field, value);
+        bool ret = mValues.set(object, field, value);
+        mValues.drop(value);
+        return ret;
     }
 
     bool Library::set(Value* object, const String& field, bool val) {
         Value* value = mValues.make(val);
-        return mValues.set(object, field, value);
+        bool ret = mValues.set(object, field, value);
+        mValues.drop(value);
+        return ret;
     }
 
     bool Library::set(Value* object, const String& field, const String& val) {
         Value* value = mValues.make(val);
-        return mValues.set(object, field, value);
+        bool ret = mValues.set(object, field, value);
+        mValues.drop(value);
+        return ret;
+    }
+
+    FieldHandle Library::resolve(Schema* schema, const String& field) {
+        return mValues.resolve(schema, field);
+    }
+
+    Value* Library::get(Value* object, const FieldHandle& field) {
+        return mValues.get(object, field);
+    }
+
+    bool Library::get(Value* object, const FieldHandle& field, i32_t& val) {
+        Value* ptr = mValues.get(object, field);
+        return mValues.get(ptr, val);
+    }
+
+    bool Library::get(Value* object, const FieldHandle& field, i64_t& val) {
+        Value* ptr = mValues.get(object, field);
+        return mValues.get(ptr, val);
+    }
+
+    bool Library::get(Value* object, const FieldHandle& field, f64_t& val) {
+        Value* ptr = mValues.get(object, field);
+        return mValues.get(ptr, val);
+    }
+
+    bool Library::get(Value* object, const FieldHandle& field, bool& val) {
+        Value* ptr = mValues.get(object, field);
+        return mValues.get(ptr, val);
+    }
+
+    bool Library::get(Value* object, const FieldHandle& field, String& val) {
+        Value* ptr = mValues.get(object, field);
+        return mValues.get(ptr, val);
+    }
+
+    bool Library::set(Value* object, const FieldHandle& field, Value* val) {
+        return mValues.set(object, field, val);
+    }
+
+    // scalar members are written in place, no temporary value is made.
+    bool Library::set(Value* object, const FieldHandle& field, i32_t val) {
+        Value* ptr = mValues.get(object, field);
+        if(!mValues.set(ptr, val))
+            return false;
+        mValues.markObject(object->value.u64);
+        return true;
+    }
+
+    bool Library::set(Value* object, const FieldHandle& field, i64_t val) {
+        Value* ptr = mValues.get(object, field);
+        if(!mValues.set(ptr, val))
+            return false;
+        mValues.markObject(object->value.u64);
+        return true;
+    }
+
+    bool Library::set(Value* object, const FieldHandle& field, f64_t val) {
+        Value* ptr = mValues.get(object, field);
+        if(!mValues.set(ptr, val))
+            return false;
+        mValues.markObject(object->value.u64);
+        return true;
+    }
+
+    bool Library::set(Value* object, const FieldHandle& field, bool val) {
+        Value* ptr = mValues.get(object, field);
+        if(!mValues.set(ptr, val))
+            return false;
+        mValues.markObject(object->value.u64);
+        return true;
+    }
+
+    bool Library::set(Value* object, const FieldHandle& field, const String& val) {
+        Value* ptr = mValues.get(object, field);
+        if(!mValues.set(ptr, val))
+            return false;
+        mValues.markObject(object->value.u64);
+        return true;
     }
 }
 
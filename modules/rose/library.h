@@ -5,6 +5,9 @@
 #include "./header.h"
 #include "./value.h"
 #include "./schema.h"
+#include "./image.h"
+#include "./snapshot.h"
+#include <set>
 
 namespace eokas::datapot {
     class Library {
@@ -14,14 +17,44 @@ namespace eokas::datapot {
         
         const String& name() const { return mName; }
         
+        /*
+        A library file is a full snapshot plus an append-only log of deltas
+        next to it (filePath + ".delta"). load() reads the snapshot and then
+        replays the log, a torn record at the end is ignored.
+        save() writes a new snapshot to a temporary file, flushes it to disk
+        and renames it over the old one, then drops the log.
+        saveDelta() appends only what changed since the last load or save,
+        and compacts into a new snapshot once the log outgrows the snapshot
+        by the compaction ratio.
+        */
         bool load(const String& filePath);
         bool save(const String& filePath);
+        bool saveDelta(const String& filePath);
+        /// log size relative to the snapshot which triggers a compaction.
+        void setCompactRatio(f64_t ratio);
+        bool isDirty() const;
+        
+        /*
+        One writer thread edits the library and publish()es a snapshot of
+        it, any number of reader threads acquire() the latest snapshot and
+        never touch the library itself. Publishing copies only the value
+        pages, object chunks and lists changed since the last snapshot,
+        replaced snapshots are deleted once their last reader released it.
+        */
+        const Snapshot* publish();
+        SnapshotRef acquire();
         
         bool load(BinaryStream& stream);
         bool save(BinaryStream& stream);
         
+        /// write the mmap-able layout read by LibraryImage.
+        bool saveImage(const String& filePath);
+        bool saveImage(Stream& stream);
+        
         Schema* addSchema(SchemaType type, const String& name);
         Schema* getSchema(const String& name) const;
+        /// getSchema("Int"_hash), no String is built.
+        Schema* getSchema(const HashKey& name) const;
         Schema* getSchema(u32_t index) const;
         u32_t getSchemaCount() const;
         u32_t getSchemaIndex(const String& name) const;
@@ -104,13 +137,51 @@ namespace eokas::datapot {
         bool set(Value* object, const String& field, bool val);
         bool set(Value* object, const String& field, const String& val);
         
+        FieldHandle resolve(Schema* schema, const String& field);
+        Value* get(Value* object, const FieldHandle& field);
+        bool get(Value* object, const FieldHandle& field, i32_t& val);
+        bool get(Value* object, const FieldHandle& field, i64_t& val);
+        bool get(Value* object, const FieldHandle& field, f64_t& val);
+        bool get(Value* object, const FieldHandle& field, bool& val);
+        bool get(Value* object, const FieldHandle& field, String& val);
+        
+        bool set(Value* object, const FieldHandle& field, Value* val);
+        bool set(Value* object, const FieldHandle& field, i32_t val);
+        bool set(Value* object, const FieldHandle& field, i64_t val);
+        bool set(Value* object, const FieldHandle& field, f64_t val);
+        bool set(Value* object, const FieldHandle& field, bool val);
+        bool set(Value* object, const FieldHandle& field, const String& val);
+        
     private:
+        friend class Query;
+        
         String mName;
 
         SchemaHeap mSchemas;
         ValueHeap mValues;
 
         std::map<String, Value*> mRoot;
+        
+        String mFilePath;
+        u64_t mGeneration;
+        u64_t mSnapshotSize;
+        u64_t mLogSize;
+        f64_t mCompactRatio;
+        std::set<String> mDirtyRoots;
+        std::vector<u32_t> mSchemaRevisions;
+        
+        EpochDomain mEpochs;
+        std::atomic<const Snapshot*> mSnapshot;
+        u32_t mRootStamp;
+        
+        u32_t indexOf(Schema* schema) const;
+        void writeSchema(BinaryStream& stream, Schema* schema);
+        bool readSchema(BinaryStream& stream);
+        void writeDelta(BinaryStream& stream);
+        bool readDelta(BinaryStream& stream);
+        bool replayDelta(const String& logPath);
+        bool isSchemaChanged() const;
+        void markClean();
     };
 }
 
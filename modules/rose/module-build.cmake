@@ -41,3 +41,6 @@ target_link_libraries(${EOKAS_TARGET_NAME} ${EOKAS_LIBRARY_FILES})
 
 install(TARGETS ${EOKAS_TARGET_NAME} DESTINATION bin/${EOKAS_OS_NAME}/${CMAKE_BUILD_TYPE})
 
+
+
+eokas_test_setup(${EOKAS_TARGET_NAME})
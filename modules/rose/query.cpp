@@ -0,0 +1,178 @@
+#include "./query.h"
+#include "base/async.h"
+#include <mutex>
+
+namespace eokas::datapot {
+    static const u32_t QUERY_MIN_RANGE = 4096;
+
+    Query::Query(Library& library, Schema* schema)
+        : mLibrary(library)
+        , mSchema(schema)
+        , mFields()
+        , mPredicates()
+        , mBatchSize(4096)
+        , mThreads(1) { }
+
+    Query& Query::select(const String& field) {
+        mFields.push_back(field);
+        return *this;
+    }
+
+    Query& Query::where(const Predicate& predicate) {
+        if(predicate) {
+            mPredicates.push_back(predicate);
+        }
+        return *this;
+    }
+
+    Query& Query::batch(u32_t size) {
+        mBatchSize = size > 0 ? size : 1;
+        return *this;
+    }
+
+    Query& Query::parallel(u32_t threads) {
+        mThreads = threads > 0 ? threads : 1;
+        return *this;
+    }
+
+    bool Query::match(Value* object) const {
+        for(auto& predicate : mPredicates) {
+            if(!predicate(object))
+                return false;
+        }
+        return true;
+    }
+
+    u32_t Query::count() {
+        u32_t count = 0;
+        std::vector<String> fields;
+        fields.swap(mFields);
+        this->stream([&count](QueryBatch& batch) {
+            count += u32_t(batch.size());
+        });
+        fields.swap(mFields);
+        return count;
+    }
+
+    void Query::each(const Visitor& visitor) {
+        if(mSchema == nullptr || !mSchema->is(SchemaType::Struct) || !visitor)
+            return;
+        ValueHeap& heap = mLibrary.mValues;
+        for(size_t index = 0; index < heap.objects.size(); index++) {
+            if(heap.objects[index].schema != mSchema)
+                continue;
+            Value object;
+            object.set(mSchema, u64_t(index));
+            if(this->match(&object)) {
+                visitor(&object);
+            }
+        }
+    }
+
+    bool Query::stream(const Sink& sink) {
+        if(mSchema == nullptr || !mSchema->is(SchemaType::Struct) || !sink)
+            return false;
+
+        ValueHeap& heap = mLibrary.mValues;
+
+        std::vector<FieldHandle> handles;
+        QueryBatch prototype;
+        for(auto& field : mFields) {
+            FieldHandle handle = heap.resolve(mSchema, field);
+            if(!handle.isValid())
+                return false;
+            handles.push_back(handle);
+            QueryColumn& column = prototype.columns.emplace_back();
+            column.name = field;
+            column.type = mSchema->getMember(handle.index)->schema->type();
+        }
+
+        std::mutex sinkMutex;
+        auto deliver = [&sink, &sinkMutex](QueryBatch& batch) {
+            std::lock_guard<std::mutex> lock(sinkMutex);
+            sink(batch);
+        };
+
+        auto scan = [&](size_t begin, size_t end) {
+            QueryBatch batch = prototype;
+            for(size_t index = begin; index < end; index++) {
+                Object& obj = heap.objects[index];
+                if(obj.schema != mSchema)
+                    continue;
+                Value object;
+                object.set(mSchema, u64_t(index));
+                if(!this->match(&object))
+                    continue;
+
+                batch.objects.push_back(u32_t(index));
+                for(size_t col = 0; col < handles.size(); col++) {
+                    QueryColumn& column = batch.columns[col];
+                    Value* member = obj.get(handles[col].index);
+                    Value value = member != nullptr ? *member : Value{};
+                    switch(column.type) {
+                        case SchemaType::Int:
+                        case SchemaType::Bool:
+                            column.ints.push_back(value.value.i64);
+                            break;
+                        case SchemaType::Float:
+                            column.floats.push_back(value.value.f64);
+                            break;
+                        case SchemaType::String:
+                            column.strings.push_back(value.value.u64 < heap.strings.size() ? &heap.strings[value.value.u64] : nullptr);
+                            break;
+                        default:
+                            column.values.push_back(value);
+                            break;
+                    }
+                }
+
+                if(batch.size() >= mBatchSize) {
+                    deliver(batch);
+                    batch = prototype;
+                }
+            }
+            if(batch.size() > 0) {
+                deliver(batch);
+            }
+        };
+
+        size_t total = heap.objects.size();
+        size_t threads = std::min<size_t>(mThreads, total / QUERY_MIN_RANGE + 1);
+        if(threads <= 1) {
+            scan(0, total);
+            return true;
+        }
+
+        size_t range = (total + threads - 1) / threads;
+        ThreadPool pool((unsigned short)threads);
+        std::vector<std::future<void>> ranges;
+        for(size_t begin = 0; begin < total; begin += range) {
+            ranges.push_back(pool.exec(scan, begin, std::min(begin + range, total)));
+        }
+        for(auto& future : ranges) {
+            future.get();
+        }
+        return true;
+    }
+
+    bool Query::collect(QueryBatch& result) {
+        bool first = true;
+        result = QueryBatch();
+        return this->stream([&result, &first](QueryBatch& batch) {
+            if(first) {
+                result = std::move(batch);
+                first = false;
+                return;
+            }
+            result.objects.insert(result.objects.end(), batch.objects.begin(), batch.objects.end());
+            for(size_t col = 0; col < batch.columns.size(); col++) {
+                QueryColumn& dst = result.columns[col];
+                QueryColumn& src = batch.columns[col];
+                dst.ints.insert(dst.ints.end(), src.ints.begin(), src.ints.end());
+                dst.floats.insert(dst.floats.end(), src.floats.begin(), src.floats.end());
+                dst.strings.insert(dst.strings.end(), src.strings.begin(), src.strings.end());
+                dst.values.insert(dst.values.end(), src.values.begin(), src.values.end());
+            }
+        });
+    }
+}
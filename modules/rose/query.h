@@ -0,0 +1,67 @@
+#ifndef _EOKAS_DATAPOT_QUERY_H_
+#define _EOKAS_DATAPOT_QUERY_H_
+
+#include "./header.h"
+#include "./library.h"
+
+namespace eokas::datapot {
+    /// one projected member, the rows are aligned with QueryBatch::objects.
+    struct QueryColumn {
+        String name;
+        SchemaType type = SchemaType::None;
+        std::vector<i64_t> ints;             // Int, Bool
+        std::vector<f64_t> floats;           // Float
+        std::vector<const String*> strings;  // String, owned by the library
+        std::vector<Value> values;           // List, Struct
+    };
+
+    struct QueryBatch {
+        std::vector<u32_t> objects;
+        std::vector<QueryColumn> columns;
+
+        size_t size() const { return objects.size(); }
+    };
+
+    /*
+    Bulk read over every object of a struct schema:
+        Query(library, schema).select("name").select("hp")
+            .where([&](Value* obj) { ... })
+            .batch(4096).parallel(8)
+            .stream([](QueryBatch& batch) { ... });
+    Members are resolved once and rows are copied into columns without any
+    name lookup. With parallel(n) the object array is split into n ranges,
+    predicates run concurrently and must only read the library, batches
+    reach the sink one at a time but in any order.
+    The library must not be modified while a query runs.
+    */
+    class Query {
+    public:
+        using Predicate = std::function<bool(Value* object)>;
+        using Visitor = std::function<void(Value* object)>;
+        using Sink = std::function<void(QueryBatch& batch)>;
+
+        Query(Library& library, Schema* schema);
+
+        Query& select(const String& field);
+        Query& where(const Predicate& predicate);
+        Query& batch(u32_t size);
+        Query& parallel(u32_t threads);
+
+        u32_t count();
+        void each(const Visitor& visitor);
+        bool stream(const Sink& sink);
+        bool collect(QueryBatch& result);
+
+    private:
+        Library& mLibrary;
+        Schema* mSchema;
+        std::vector<String> mFields;
+        std::vector<Predicate> mPredicates;
+        u32_t mBatchSize;
+        u32_t mThreads;
+
+        bool match(Value* object) const;
+    };
+}
+
+#endif//_EOKAS_DATAPOT_QUERY_H_
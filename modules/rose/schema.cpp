@@ -4,7 +4,8 @@ namespace eokas::datapot {
 
     Schema::Schema(SchemaType type, const String& name)
         : mType(type)
-        , mName(name) {
+        , mName(name)
+        , mRevision(0) {
         if(mType == SchemaType::List) {
             mBody.listBody = new ListBody();
         }
@@ -35,6 +36,7 @@ namespace eokas::datapot {
             return;
         if(mType == SchemaType::List) {
             mBody.listBody->element = schema;
+            mRevision++;
         }
     }
 
@@ -49,9 +51,13 @@ namespace eokas::datapot {
         if(mType != SchemaType::Struct)
             return;
 
+        u32_t index = u32_t(mBody.structBody->members.size());
         Member& mem = mBody.structBody->members.emplace_back();
         mem.name = name;
         mem.schema = schema;
+        // the first member wins when a name is added twice.
+        mBody.structBody->indices.insert(std::make_pair(mem.name, index));
+        mRevision++;
     }
 
     void Schema::setMember(const String& name, Schema* schema) {
@@ -61,6 +67,7 @@ namespace eokas::datapot {
         Member* exists = this->getMember(name);
         if(exists != nullptr) {
             exists->schema = schema;
+            mRevision++;
         }
         else {
             this->addMember(name, schema);
@@ -71,25 +78,27 @@ namespace eokas::datapot {
         if(mType != SchemaType::Struct)
             return;
 
+        Symbol symbol = Symbol::find(name);
         auto iter = mBody.structBody->members.begin();
         while(iter != mBody.structBody->members.end()) {
-            if(iter->name == name) {
+            if(iter->name == symbol) {
                 iter = mBody.structBody->members.erase(iter);
                 continue;
             }
             ++ iter;
         }
+        this->rebuildMemberIndices();
+        mRevision++;
     }
 
     Schema::Member* Schema::getMember(const String& name) {
         if(mType != SchemaType::Struct)
             return nullptr;
 
-        for(auto& mem : mBody.structBody->members) {
-            if(mem.name == name)
-                return &mem;
-        }
-        return nullptr;
+        u32_t index = this->getMemberIndex(name);
+        if(index == u32_t(-1))
+            return nullptr;
+        return &mBody.structBody->members.at(index);
     }
 
     Schema::Member* Schema::getMember(u32_t index) {
@@ -105,20 +114,35 @@ namespace eokas::datapot {
     }
     
     u32_t Schema::getMemberIndex(const String& name) {
-        if(mType != SchemaType::Struct)
+        // a name never interned is not a member of any schema.
+        return this->getMemberIndex(Symbol::find(name));
+    }
+    
+    u32_t Schema::getMemberIndex(Symbol name) {
+        if(mType != SchemaType::Struct || name.isNull())
             return -1;
+        const auto& indices = mBody.structBody->indices;
+        auto iter = indices.find(name);
+        if(iter == indices.end())
+            return -1;
+        return iter->second;
+    }
+    
+    void Schema::rebuildMemberIndices() {
+        if(mType != SchemaType::Struct)
+            return;
+        auto& indices = mBody.structBody->indices;
         const auto& members = mBody.structBody->members;
+        indices.clear();
         for(u32_t i = 0; i < u32_t(members.size()); i++) {
-            if(members[i].name == name) {
-                return u32_t(i);
-            }
+            indices.insert(std::make_pair(members[i].name, i));
         }
-        return -1;
     }
 
     SchemaHeap::SchemaHeap()
         : mSchemas() {
 
+        mSchemaMap.reserve(16);
         this->add(SchemaType::Int, "Int");
         this->add(SchemaType::Float, "Float");
         this->add(SchemaType::Bool, "Bool");
@@ -131,7 +155,8 @@ namespace eokas::datapot {
     }
 
     Schema* SchemaHeap::add(SchemaType type, const String& name) {
-        auto iter = mSchemaMap.find(name);
+        Symbol symbol(name);
+        auto iter = mSchemaMap.find(symbol);
         if(iter != mSchemaMap.end())
             return nullptr;
         
@@ -139,12 +164,16 @@ namespace eokas::datapot {
         Schema*& schema = mSchemas.emplace_back();
         schema = new Schema(type, name);
         
-        mSchemaMap.insert(std::make_pair(name, index));
+        mSchemaMap.insert(std::make_pair(symbol, index));
 
         return schema;
     }
 
     Schema* SchemaHeap::get(const String& name) const {
+        return this->get(HashKey(name));
+    }
+
+    Schema* SchemaHeap::get(const HashKey& name) const {
         auto iter = mSchemaMap.find(name);
         if(iter == mSchemaMap.end())
             return nullptr;
@@ -163,6 +192,10 @@ namespace eokas::datapot {
     }
     
     u32_t SchemaHeap::indexOf(const String& name) const {
+        return this->indexOf(Symbol::find(name));
+    }
+    
+    u32_t SchemaHeap::indexOf(Symbol name) const {
         auto iter = mSchemaMap.find(name);
         if(iter == mSchemaMap.end())
             return -1;
@@ -19,7 +19,7 @@ namespace eokas::datapot {
     class Schema {
     public:
         struct Member {
-            String name;
+            Symbol name;
             Schema* schema;
         };
 
@@ -28,7 +28,8 @@ namespace eokas::datapot {
         };
 
         struct StructBody {
-            std::vector<Member> members = {};
+            SmallVector<Member, 8> members = {};
+            std::unordered_map<Symbol, u32_t> indices = {};
         };
         
         Schema(SchemaType type, const String& name);
@@ -38,8 +39,11 @@ namespace eokas::datapot {
         bool operator!=(const Schema& other) const;
 
         SchemaType type() const { return mType; }
-        String name() const { return mName; }
+        const String& name() const { return mName.str(); }
+        Symbol symbol() const { return mName; }
         bool is(SchemaType type) const { return mType == type; }
+        /// bumped by every change of the element or the members.
+        u32_t revision() const { return mRevision; }
 
         void setElement(Schema* schema);
         Schema* getElement() const;
@@ -51,10 +55,14 @@ namespace eokas::datapot {
         Member* getMember(u32_t index);
         u32_t getMemberCount();
         u32_t getMemberIndex(const String& name);
+        u32_t getMemberIndex(Symbol name);
 
     private:
+        void rebuildMemberIndices();
+        
         SchemaType mType;
-        String mName;
+        Symbol mName;
+        u32_t mRevision;
         union {
             ListBody* listBody;
             StructBody* structBody;
@@ -68,12 +76,14 @@ namespace eokas::datapot {
         
         Schema* add(SchemaType type, const String& name);
         Schema* get(const String& name) const;
+        Schema* get(const HashKey& name) const;
         Schema* get(u32_t index) const;
         u32_t count() const;
         u32_t indexOf(const String& name) const;
+        u32_t indexOf(Symbol name) const;
 
     private:
-        std::map<String, u32_t> mSchemaMap;
+        HashMap<Symbol, u32_t> mSchemaMap;
         std::vector<Schema*> mSchemas;
     };
 }
@@ -0,0 +1,134 @@
+#include "./snapshot.h"
+
+namespace eokas::datapot {
+    static const u32_t PAGE_SIZE = ValueHeap::PAGE_SIZE;
+    static const u32_t CHUNK_SIZE = ValueHeap::CHUNK_SIZE;
+
+    const Value* Snapshot::value(u32_t index) const {
+        if(index >= mValueCount)
+            return nullptr;
+        const Value* value = &mValues[index / PAGE_SIZE]->items[index % PAGE_SIZE];
+        return value->schema != nullptr ? value : nullptr;
+    }
+
+    const List* Snapshot::list(const Value* list) const {
+        if(list == nullptr || list->schema == nullptr || !list->schema->is(SchemaType::List))
+            return nullptr;
+        u64_t index = list->value.u64;
+        if(index / CHUNK_SIZE >= mLists.size())
+            return nullptr;
+        const auto& items = mLists[index / CHUNK_SIZE]->items;
+        if(index % CHUNK_SIZE >= items.size())
+            return nullptr;
+        return items[index % CHUNK_SIZE].list.get();
+    }
+
+    const Object* Snapshot::object(const Value* object) const {
+        if(object == nullptr || object->schema == nullptr || !object->schema->is(SchemaType::Struct))
+            return nullptr;
+        u64_t index = object->value.u64;
+        if(index / CHUNK_SIZE >= mObjects.size())
+            return nullptr;
+        const auto& items = mObjects[index / CHUNK_SIZE]->items;
+        if(index % CHUNK_SIZE >= items.size())
+            return nullptr;
+        return &items[index % CHUNK_SIZE];
+    }
+
+    void Snapshot::getRootNames(std::vector<String>& names) const {
+        if(mRoots == nullptr)
+            return;
+        for(auto& pair : *mRoots) {
+            names.push_back(pair.first);
+        }
+    }
+
+    const Value* Snapshot::get(const String& name) const {
+        if(mRoots == nullptr)
+            return nullptr;
+        auto iter = mRoots->find(name);
+        if(iter == mRoots->end())
+            return nullptr;
+        return this->value(iter->second);
+    }
+
+    u32_t Snapshot::size(const Value* list) const {
+        const List* ref = this->list(list);
+        return ref != nullptr ? u32_t(ref->elements.size()) : 0;
+    }
+
+    const Value* Snapshot::get(const Value* list, u32_t index) const {
+        const List* ref = this->list(list);
+        if(ref == nullptr || index >= ref->elements.size())
+            return nullptr;
+        return &ref->elements[index];
+    }
+
+    FieldHandle Snapshot::resolve(Schema* schema, const String& field) const {
+        FieldHandle handle;
+        if(mSchemas == nullptr)
+            return handle;
+        auto iter = mSchemas->find(schema);
+        if(iter == mSchemas->end() || iter->second.type != SchemaType::Struct)
+            return handle;
+        auto member = iter->second.indices.find(Symbol::find(field));
+        if(member == iter->second.indices.end())
+            return handle;
+        handle.schema = schema;
+        handle.index = member->second;
+        return handle;
+    }
+
+    const Value* Snapshot::get(const Value* object, const String& field) const {
+        if(object == nullptr)
+            return nullptr;
+        return this->get(object, this->resolve(object->schema, field));
+    }
+
+    const Value* Snapshot::get(const Value* object, const FieldHandle& field) const {
+        if(object == nullptr || object->schema != field.schema || !field.isValid())
+            return nullptr;
+        const Object* ref = this->object(object);
+        if(ref == nullptr || field.index >= ref->members.size())
+            return nullptr;
+        return &ref->members[field.index];
+    }
+
+    bool Snapshot::get(const Value* ptr, i32_t& val) const {
+        if(ptr == nullptr || ptr->schema == nullptr || !ptr->schema->is(SchemaType::Int))
+            return false;
+        val = (i32_t)ptr->value.i64;
+        return true;
+    }
+
+    bool Snapshot::get(const Value* ptr, i64_t& val) const {
+        if(ptr == nullptr || ptr->schema == nullptr || !ptr->schema->is(SchemaType::Int))
+            return false;
+        val = ptr->value.i64;
+        return true;
+    }
+
+    bool Snapshot::get(const Value* ptr, f64_t& val) const {
+        if(ptr == nullptr || ptr->schema == nullptr || !ptr->schema->is(SchemaType::Float))
+            return false;
+        val = ptr->value.f64;
+        return true;
+    }
+
+    bool Snapshot::get(const Value* ptr, bool& val) const {
+        if(ptr == nullptr || ptr->schema == nullptr || !ptr->schema->is(SchemaType::Bool))
+            return false;
+        val = ptr->value.i64 != 0;
+        return true;
+    }
+
+    bool Snapshot::get(const Value* ptr, String& val) const {
+        if(ptr == nullptr || ptr->schema == nullptr || !ptr->schema->is(SchemaType::String))
+            return false;
+        u64_t index = ptr->value.u64;
+        if(index >= mStringCount)
+            return false;
+        val = mStrings[index / PAGE_SIZE]->items[index % PAGE_SIZE];
+        return true;
+    }
+}
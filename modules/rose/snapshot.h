@@ -0,0 +1,99 @@
+#ifndef _EOKAS_DATAPOT_SNAPSHOT_H_
+#define _EOKAS_DATAPOT_SNAPSHOT_H_
+
+#include "./header.h"
+#include "./value.h"
+#include "./schema.h"
+#include <atomic>
+
+namespace eokas::datapot {
+    template<typename T>
+    struct SnapshotChunk {
+        u32_t stamp = 0;
+        std::vector<T> items;
+    };
+
+    struct SnapshotList {
+        u32_t stamp = 0;
+        std::shared_ptr<const List> list;
+    };
+
+    /// schemas are frozen with the snapshot, the live ones may be edited.
+    struct SnapshotSchema {
+        SchemaType type = SchemaType::None;
+        Schema* element = nullptr;
+        std::vector<Schema::Member> members;
+        std::unordered_map<Symbol, u32_t> indices;
+    };
+
+    /*
+    Immutable view of a library at the time of Library::publish().
+    Value pages, object chunks and string chunks are shared with the
+    previous snapshot unless something in them changed, lists are shared
+    one by one. Value::schema of a returned value only identifies the
+    schema, members are resolved against the frozen copy.
+    */
+    class Snapshot {
+    public:
+        u64_t version() const { return mVersion; }
+
+        void getRootNames(std::vector<String>& names) const;
+        const Value* get(const String& name) const;
+
+        u32_t size(const Value* list) const;
+        const Value* get(const Value* list, u32_t index) const;
+
+        FieldHandle resolve(Schema* schema, const String& field) const;
+        const Value* get(const Value* object, const String& field) const;
+        const Value* get(const Value* object, const FieldHandle& field) const;
+
+        bool get(const Value* ptr, i32_t& val) const;
+        bool get(const Value* ptr, i64_t& val) const;
+        bool get(const Value* ptr, f64_t& val) const;
+        bool get(const Value* ptr, bool& val) const;
+        bool get(const Value* ptr, String& val) const;
+
+    private:
+        friend class Library;
+
+        u64_t mVersion = 0;
+        u32_t mAllStamp = 0;
+        u32_t mRootStamp = 0;
+        u32_t mValueCount = 0;
+        u32_t mStringCount = 0;
+        std::vector<u32_t> mSchemaRevisions;
+
+        std::vector<std::shared_ptr<const SnapshotChunk<Value>>> mValues;
+        std::vector<std::shared_ptr<const SnapshotChunk<SnapshotList>>> mLists;
+        std::vector<std::shared_ptr<const SnapshotChunk<Object>>> mObjects;
+        std::vector<std::shared_ptr<const SnapshotChunk<String>>> mStrings;
+        std::shared_ptr<const std::map<String, u32_t>> mRoots;
+        std::shared_ptr<const std::unordered_map<const Schema*, SnapshotSchema>> mSchemas;
+
+        const Value* value(u32_t index) const;
+        const List* list(const Value* list) const;
+        const Object* object(const Value* object) const;
+    };
+
+    /// keeps the snapshot alive for as long as the reference lives.
+    class SnapshotRef {
+        _ForbidCopy(SnapshotRef);
+        _ForbidAssign(SnapshotRef);
+
+    public:
+        SnapshotRef(EpochDomain& domain, const std::atomic<const Snapshot*>& current)
+            : mGuard(domain)
+            , mSnapshot(current.load(std::memory_order_acquire)) { }
+
+        const Snapshot* get() const { return mSnapshot; }
+        const Snapshot* operator->() const { return mSnapshot; }
+        const Snapshot& operator*() const { return *mSnapshot; }
+        explicit operator bool() const { return mSnapshot != nullptr; }
+
+    private:
+        EpochGuard mGuard;
+        const Snapshot* mSnapshot;
+    };
+}
+
+#endif//_EOKAS_DATAPOT_SNAPSHOT_H_
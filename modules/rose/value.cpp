@@ -3,60 +3,233 @@
 #include "./schema.h"
 
 namespace eokas::datapot {
+    static_assert((sizeof(Value) & (sizeof(Value) - 1)) == 0, "the page size must be a power of 2.");
+    static const size_t VALUE_PAGE_BYTES = ValueHeap::PAGE_SIZE * sizeof(Value);
+
     ValueHeap::ValueHeap(SchemaHeap& schemaHeap)
-        : mSchemaHeap(schemaHeap) { }
+        : mSchemaHeap(schemaHeap)
+        , mPages()
+        , mPageIndices()
+        , mFreeValues()
+        , mFreeSlots()
+        , mSize(0)
+        , mDirtyValues()
+        , mDirtyLists()
+        , mDirtyObjects()
+        , mCleanStrings(0)
+        , mDirtyAll(true)
+        , mPageStamps()
+        , mListStamps()
+        , mListChunkStamps()
+        , mObjectChunkStamps()
+        , mAllStamp(0)
+        , mStringIndices()
+        , mIndexedStrings(0) { }
 
     ValueHeap::~ValueHeap() {
         this->clear();
     }
     
+    ValueHandle ValueHeap::alloc() {
+        ValueHandle handle;
+        if(!mFreeValues.empty()) {
+            handle.index = mFreeValues.back();
+            mFreeValues.pop_back();
+            mFreeSlots[handle.index] = false;
+        }
+        else {
+            if(mSize == mPages.size() * PAGE_SIZE) {
+                this->addPage();
+            }
+            handle.index = mSize++;
+            mFreeSlots.push_back(false);
+        }
+        
+        Value* value = this->at(handle);
+        value->schema = nullptr;
+        value->value.u64 = 0;
+        this->markValue(handle.index);
+        return handle;
+    }
+    
+    void ValueHeap::addPage() {
+        void* ptr = ::operator new(VALUE_PAGE_BYTES, std::align_val_t(VALUE_PAGE_BYTES));
+        Value* page = static_cast<Value*>(ptr);
+        mPageIndices.insert(std::make_pair(uintptr_t(page), u32_t(mPages.size())));
+        mPages.push_back(page);
+    }
+    
+    void ValueHeap::drop(ValueHandle handle) {
+        Value* value = this->at(handle);
+        if(value == nullptr || mFreeSlots[handle.index])
+            return;
+        value->schema = nullptr;
+        value->value.u64 = 0;
+        mFreeValues.push_back(handle.index);
+        mFreeSlots[handle.index] = true;
+        this->markValue(handle.index);
+    }
+    
+    void ValueHeap::drop(Value* val) {
+        this->drop(this->handleOf(val));
+    }
+    
+    Value* ValueHeap::at(ValueHandle handle) const {
+        if(handle.index >= mSize)
+            return nullptr;
+        return mPages[handle.index / PAGE_SIZE] + handle.index % PAGE_SIZE;
+    }
+    
+    ValueHandle ValueHeap::handleOf(const Value* val) const {
+        ValueHandle handle;
+        uintptr_t base = uintptr_t(val) & ~uintptr_t(VALUE_PAGE_BYTES - 1);
+        auto iter = mPageIndices.find(base);
+        if(val == nullptr || iter == mPageIndices.end())
+            return handle;
+        u32_t index = iter->second * PAGE_SIZE + u32_t(val - mPages[iter->second]);
+        if(index < mSize) {
+            handle.index = index;
+        }
+        return handle;
+    }
+    
     u32_t ValueHeap::indexOf(Value* val) {
-        for(size_t index = 0; index < values.size(); index++) {
-            if(val == &values.at(index)) {
-                return u32_t(index);
+        return this->handleOf(val).index;
+    }
+    
+    u32_t ValueHeap::size() const {
+        return mSize;
+    }
+    
+    u32_t ValueHeap::count() const {
+        return mSize - u32_t(mFreeValues.size());
+    }
+    
+    void ValueHeap::resize(u32_t size) {
+        while(mSize < size) {
+            if(mSize == mPages.size() * PAGE_SIZE) {
+                this->addPage();
             }
+            Value* value = mPages[mSize / PAGE_SIZE] + mSize % PAGE_SIZE;
+            value->schema = nullptr;
+            value->value.u64 = 0;
+            mFreeValues.push_back(mSize);
+            mFreeSlots.push_back(true);
+            mSize++;
         }
-        return -1;
+    }
+    
+    void ValueHeap::reclaim() {
+        mFreeValues.clear();
+        mFreeSlots.assign(mSize, false);
+        // reversed, so the lowest slots are reused first.
+        for(u32_t index = mSize; index > 0; index--) {
+            if(this->at(ValueHandle{index - 1})->schema == nullptr) {
+                mFreeValues.push_back(index - 1);
+                mFreeSlots[index - 1] = true;
+            }
+        }
+    }
+    
+    void ValueHeap::touch(const Value* val) {
+        if(val == nullptr)
+            return;
+        ValueHandle handle = this->handleOf(val);
+        if(handle.isValid()) {
+            this->markValue(handle.index);
+        }
+        else {
+            this->markAll();
+        }
+    }
+    
+    static void bumpStamp(std::vector<u32_t>& stamps, size_t index) {
+        if(index >= stamps.size()) {
+            stamps.resize(std::max<size_t>(index + 1, stamps.size() * 2), 0);
+        }
+        stamps[index]++;
+    }
+    
+    void ValueHeap::markValue(u32_t index) {
+        mDirtyValues.mark(index);
+        bumpStamp(mPageStamps, index / PAGE_SIZE);
+    }
+    
+    void ValueHeap::markList(u64_t index) {
+        mDirtyLists.mark(u32_t(index));
+        bumpStamp(mListStamps, size_t(index));
+        bumpStamp(mListChunkStamps, size_t(index / CHUNK_SIZE));
+    }
+    
+    void ValueHeap::markObject(u64_t index) {
+        mDirtyObjects.mark(u32_t(index));
+        bumpStamp(mObjectChunkStamps, size_t(index / CHUNK_SIZE));
+    }
+    
+    void ValueHeap::markAll() {
+        mDirtyAll = true;
+        mAllStamp++;
+    }
+    
+    void ValueHeap::markClean() {
+        mDirtyValues.clear();
+        mDirtyLists.clear();
+        mDirtyObjects.clear();
+        mCleanStrings = u32_t(this->strings.size());
+        mDirtyAll = false;
+    }
+    
+    bool ValueHeap::isDirty() const {
+        return mDirtyAll
+            || !mDirtyValues.empty()
+            || !mDirtyLists.empty()
+            || !mDirtyObjects.empty()
+            || mCleanStrings != this->strings.size();
+    }
+    
+    Value* ValueHeap::makeValue(Schema* schema) {
+        Value* value = this->at(this->alloc());
+        value->schema = schema;
+        return value;
     }
 
     Value* ValueHeap::make(i32_t val) {
         Schema* schema = mSchemaHeap.get("Int");
-        Value& value = this->values.emplace_back();
-        value.set(schema, val);
-        return &value;
+        Value* value = this->makeValue(schema);
+        value->set(schema, val);
+        return value;
     }
 
     Value* ValueHeap::make(i64_t val) {
         Schema* schema = mSchemaHeap.get("Int");
-        Value& value = this->values.emplace_back();
-        value.set(schema, val);
-        return &value;
+        Value* value = this->makeValue(schema);
+        value->set(schema, val);
+        return value;
     }
 
     Value* ValueHeap::make(f64_t val) {
         Schema* schema = mSchemaHeap.get("Float");
-        Value& value = this->values.emplace_back();
-        value.set(schema, val);
-        return &value;
+        Value* value = this->makeValue(schema);
+        value->set(schema, val);
+        return value;
     }
 
     Value* ValueHeap::make(bool val) {
         Schema* schema = mSchemaHeap.get("Bool");
-        Value& value = this->values.emplace_back();
-        value.set(schema, val ? 1 : 0);
-        return &value;
+        Value* value = this->makeValue(schema);
+        value->set(schema, val ? 1 : 0);
+        return value;
     }
 
     Value* ValueHeap::make(const String& val) {
         Schema* schema = mSchemaHeap.get("String");
 
-        size_t index = this->strings.size();
-        String& str = this->strings.emplace_back(val);
+        u32_t index = this->internString(val);
 
-        Value& value = this->values.emplace_back();
-        value.set(schema, u32_t(index));
+        Value* value = this->makeValue(schema);
+        value->set(schema, index);
 
-        return &value;
+        return value;
     }
 
     Value* ValueHeap::make(Schema* schema) {
@@ -64,59 +237,64 @@ namespace eokas::datapot {
             return nullptr;
 
         if(schema->type() == SchemaType::Int) {
-            Value& value = this->values.emplace_back();
-            value.set(schema, 0);
-            return &value;
+            Value* value = this->makeValue(schema);
+            value->set(schema, 0);
+            return value;
         }
 
         if(schema->type() == SchemaType::Float) {
-            Value& value = this->values.emplace_back();
-            value.set(schema, 0.0);
-            return &value;
+            Value* value = this->makeValue(schema);
+            value->set(schema, 0.0);
+            return value;
         }
 
         if(schema->type() == SchemaType::Bool) {
-            Value& value = this->values.emplace_back();
-            value.set(schema, 0);
-            return &value;
+            Value* value = this->makeValue(schema);
+            value->set(schema, 0);
+            return value;
         }
 
         if(schema->type() == SchemaType::String) {
-            size_t index = this->strings.size();
-            String& str = this->strings.emplace_back("");
+            u32_t index = this->internString("");
 
-            Value& value = this->values.emplace_back();
-            value.set(schema, u32_t(index));
+            Value* value = this->makeValue(schema);
+            value->set(schema, index);
 
-            return &value;
+            return value;
         }
 
         if(schema->type() == SchemaType::List)
         {
             size_t index = this->lists.size();
             List& list = this->lists.emplace_back();
+            this->markList(index);
 
-            Value& value = this->values.emplace_back();
-            value.set(schema, u32_t(index));
+            Value* value = this->makeValue(schema);
+            value->set(schema, u32_t(index));
 
-            return &value;
+            return value;
         }
 
         if(schema->type() == SchemaType::Struct)
         {
             size_t index = this->objects.size();
-            Object& object = this->objects.emplace_back();
+            this->objects.emplace_back().schema = schema;
+            this->markObject(index);
 
-            Value& value = this->values.emplace_back();
-            value.set(schema, u32_t(index));
+            Value* value = this->makeValue(schema);
+            value->set(schema, u32_t(index));
 
-            for(size_t i = 0; i < schema->getMemberCount(); i++) {
+            u32_t memberCount = schema->getMemberCount();
+            this->objects.at(index).members.reserve(memberCount);
+            for(u32_t i = 0; i < memberCount; i++) {
                 auto* member = schema->getMember(i);
                 Value* v = this->make(member->schema);
-                object.members.insert(std::make_pair(member->name, *v));
+                // the member is stored by value, the slot is only temporary.
+                this->objects.at(index).members.push_back(*v);
+                this->drop(v);
             }
 
-            return &value;
+            return value;
         }
 
         return nullptr;
@@ -142,6 +320,7 @@ namespace eokas::datapot {
             return false;
         List& ref = this->lists.at(list->value.i64);
         ref.set(index, *val);
+        this->markList(list->value.u64);
         return true;
     }
 
@@ -154,6 +333,7 @@ namespace eokas::datapot {
             return false;
         List& ref = this->lists.at(list->value.i64);
         ref.push(*val);
+        this->markList(list->value.u64);
         return true;
     }
 
@@ -165,7 +345,10 @@ namespace eokas::datapot {
         if(list->value.i64 < 0 || list->value.i64 >= this->lists.size())
             return false;
         List& ref = this->lists.at(list->value.i64);
-        return ref.pop(*val);
+        if(!ref.pop(*val))
+            return false;
+        this->markList(list->value.u64);
+        return true;
     }
 
     Value* ValueHeap::get(Value* object, const String& field) {
@@ -176,7 +359,7 @@ namespace eokas::datapot {
         if(object->value.i64 < 0 || object->value.i64 >= this->objects.size())
             return nullptr;
         Object& ref = this->objects.at(object->value.i64);
-        return &ref.get(field);
+        return ref.get(object->schema->getMemberIndex(field));
     }
 
     bool ValueHeap::set(Value* object, const String& field, Value* val) {
@@ -186,8 +369,45 @@ namespace eokas::datapot {
             return false;
         if(object->value.i64 < 0 || object->value.i64 >= this->objects.size())
             return false;
+        if(val == nullptr)
+            return false;
         Object& ref = this->objects.at(object->value.i64);
-        ref.set(field, *val);
+        if(!ref.set(object->schema->getMemberIndex(field), *val))
+            return false;
+        this->markObject(object->value.u64);
+        return true;
+    }
+
+    FieldHandle ValueHeap::resolve(Schema* schema, const String& field) {
+        FieldHandle handle;
+        if(schema == nullptr || !schema->is(SchemaType::Struct))
+            return handle;
+        u32_t index = schema->getMemberIndex(field);
+        if(index == u32_t(-1))
+            return handle;
+        handle.schema = schema;
+        handle.index = index;
+        return handle;
+    }
+
+    Value* ValueHeap::get(Value* object, const FieldHandle& field) {
+        if(object == nullptr || object->schema != field.schema || !field.isValid())
+            return nullptr;
+        u64_t index = object->value.u64;
+        if(index >= this->objects.size())
+            return nullptr;
+        return this->objects[index].get(field.index);
+    }
+
+    bool ValueHeap::set(Value* object, const FieldHandle& field, Value* val) {
+        if(object == nullptr || val == nullptr || object->schema != field.schema || !field.isValid())
+            return false;
+        u64_t index = object->value.u64;
+        if(index >= this->objects.size())
+            return false;
+        if(!this->objects[index].set(field.index, *val))
+            return false;
+        this->markObject(index);
         return true;
     }
 
@@ -281,27 +501,54 @@ namespace eokas::datapot {
         if(!ptr->schema->is(SchemaType::String))
             return false;
 
-        size_t index = this->strings.size();
-        for(size_t i = 0; i < this->strings.size(); i++) {
-            if(val == this->strings.at(i)) {
-                index = i;
-                break;
-            }
+        ptr->value.u64 = this->internString(val);
+
+        return true;
+    }
+
+    u32_t ValueHeap::findString(const String& str) {
+        // strings are appended by make() and load() too, index them lazily.
+        if(mIndexedStrings > this->strings.size()) {
+            mStringIndices.clear();
+            mIndexedStrings = 0;
         }
-        if(index == this->strings.size()) {
-            this->strings.push_back(val);
+        for(; mIndexedStrings < this->strings.size(); mIndexedStrings++) {
+            mStringIndices.insert(std::make_pair(this->strings[mIndexedStrings], mIndexedStrings));
         }
+        auto iter = mStringIndices.find(str);
+        return iter != mStringIndices.end() ? iter->second : u32_t(-1);
+    }
 
-        ptr->value.u64 = u32_t(index);
-
-        return true;
+    u32_t ValueHeap::internString(const String& str) {
+        u32_t index = this->findString(str);
+        if(index == u32_t(-1)) {
+            index = u32_t(this->strings.size());
+            this->strings.push_back(str);
+        }
+        return index;
     }
 
     void ValueHeap::clear() {
-        this->values.clear();
+        for(Value* page : mPages) {
+            ::operator delete(page, std::align_val_t(VALUE_PAGE_BYTES));
+        }
+        mPages.clear();
+        mPageIndices.clear();
+        mFreeValues.clear();
+        mFreeSlots.clear();
+        mSize = 0;
+        
         this->lists.clear();
         this->objects.clear();
         this->strings.clear();
+        mStringIndices.clear();
+        mIndexedStrings = 0;
+        
+        mDirtyValues.clear();
+        mDirtyLists.clear();
+        mDirtyObjects.clear();
+        mCleanStrings = 0;
+        this->markAll();
     }
 
 }
@@ -2,6 +2,8 @@
 #define _EOKAS_DATAPOT_VALUE_H_
 
 #include "./header.h"
+#include <algorithm>
+#include <unordered_map>
 
 namespace eokas::datapot {
     struct Value {
@@ -38,6 +40,16 @@ namespace eokas::datapot {
         }
     };
     
+    struct ValueHandle {
+        static const u32_t INVALID = 0xFFFFFFFF;
+        
+        u32_t index = INVALID;
+        
+        bool isValid() const { return index != INVALID; }
+        bool operator==(const ValueHandle& other) const { return index == other.index; }
+        bool operator!=(const ValueHandle& other) const { return index != other.index; }
+    };
+    
     struct List {
         std::vector<Value> elements;
 
@@ -63,31 +75,118 @@ namespace eokas::datapot {
         }
     };
     
+    /// members are stored by the member index of the schema.
     struct Object {
-        std::map<String, Value> members;
+        Schema* schema = nullptr;
+        std::vector<Value> members;
+
+        Value* get(u32_t index) {
+            return index < members.size() ? &members[index] : nullptr;
+        }
+
+        bool set(u32_t index, const Value& value) {
+            if(index >= members.size())
+                return false;
+            members[index] = value;
+            return true;
+        }
+    };
+    
+    /// a member resolved once by name, then used without any string lookup.
+    struct FieldHandle {
+        Schema* schema = nullptr;
+        u32_t index = u32_t(-1);
+        
+        bool isValid() const { return schema != nullptr && index != u32_t(-1); }
+    };
+    
+    /// indices changed since the last save, each one listed once.
+    struct DirtySet {
+        std::vector<u32_t> indices;
+        std::vector<bool> flags;
 
-        Value& get(const String& name) {
-            return members.at(name);
+        void mark(u32_t index) {
+            if(index >= flags.size()) {
+                flags.resize(std::max<size_t>(index + 1, flags.size() * 2), false);
+            }
+            if(!flags[index]) {
+                flags[index] = true;
+                indices.push_back(index);
+            }
         }
 
-        void set(const String& name, const Value& value) {
-            members.at(name) = value;
+        void clear() {
+            for(u32_t index : indices) {
+                flags[index] = false;
+            }
+            indices.clear();
         }
+
+        bool empty() const { return indices.empty(); }
     };
     
+    /*
+    Values live in fixed size pages which never move, so a Value* stays
+    valid until the value is dropped. A page is aligned to its own size,
+    which maps a pointer back to its handle in O(1).
+    Dropped slots are reused by later makes. Lists, objects and strings
+    hold their elements by value, so they are not reclaimed with the slot.
+    
+    Every change made through the heap marks the slot, list or object it
+    touched, strings are only appended and tracked by a watermark. A value
+    written through a raw pointer is reported with touch(), pointers into a
+    list or an object can not be traced back and mark everything dirty.
+    Independent of the dirty sets, which are reset by every save, change
+    counters per value page, per list and per object chunk let
+    Library::publish() find what to copy into the next snapshot.
+    */
     class ValueHeap {
     public:
+        static const u32_t PAGE_SIZE = 1024;
+        static const u32_t CHUNK_SIZE = 64;
+        
         ValueHeap(SchemaHeap& schemaHeap);
         virtual ~ValueHeap();
-
-        std::vector<Value> values;
         
         std::vector<List> lists;
         std::vector<Object> objects;
         
         std::vector<String> strings;
         
+        ValueHandle alloc();
+        void drop(ValueHandle handle);
+        void drop(Value* val);
+        Value* at(ValueHandle handle) const;
+        ValueHandle handleOf(const Value* val) const;
         u32_t indexOf(Value* val);
+        /// number of slots, including the dropped ones.
+        u32_t size() const;
+        /// number of alive values.
+        u32_t count() const;
+        /// grow to at least size slots, the new ones are free.
+        void resize(u32_t size);
+        /// rebuild the free list from the slots without schema.
+        void reclaim();
+        
+        void touch(const Value* val);
+        void markList(u64_t index);
+        void markObject(u64_t index);
+        void markAll();
+        void markClean();
+        bool isDirty() const;
+        bool isAllDirty() const { return mDirtyAll; }
+        const DirtySet& dirtyValues() const { return mDirtyValues; }
+        const DirtySet& dirtyLists() const { return mDirtyLists; }
+        const DirtySet& dirtyObjects() const { return mDirtyObjects; }
+        /// strings below this index are unchanged since the last save.
+        u32_t cleanStrings() const { return mCleanStrings; }
+        
+        u32_t pageStamp(u32_t page) const { return page < mPageStamps.size() ? mPageStamps[page] : 0; }
+        u32_t listStamp(u32_t index) const { return index < mListStamps.size() ? mListStamps[index] : 0; }
+        u32_t listChunkStamp(u32_t chunk) const { return chunk < mListChunkStamps.size() ? mListChunkStamps[chunk] : 0; }
+        u32_t objectChunkStamp(u32_t chunk) const { return chunk < mObjectChunkStamps.size() ? mObjectChunkStamps[chunk] : 0; }
+        /// bumped whenever the stamps can not tell what changed.
+        u32_t allStamp() const { return mAllStamp; }
         
         Value* make(i32_t val);
         Value* make(i64_t val);
@@ -103,6 +202,10 @@ namespace eokas::datapot {
 
         Value* get(Value* object, const String& field);
         bool set(Value* object, const String& field, Value* val);
+        
+        FieldHandle resolve(Schema* schema, const String& field);
+        Value* get(Value* object, const FieldHandle& field);
+        bool set(Value* object, const FieldHandle& field, Value* val);
 
         bool get(Value* ptr, i32_t& val);
         bool get(Value* ptr, i64_t& val);
@@ -120,6 +223,36 @@ namespace eokas::datapot {
 
     private:
         SchemaHeap& mSchemaHeap;
+        
+        std::vector<Value*> mPages;
+        std::unordered_map<uintptr_t, u32_t> mPageIndices;
+        std::vector<u32_t> mFreeValues;
+        /// set for the slots on the free list, a second drop of one is ignored.
+        std::vector<bool> mFreeSlots;
+        u32_t mSize;
+        
+        DirtySet mDirtyValues;
+        DirtySet mDirtyLists;
+        DirtySet mDirtyObjects;
+        u32_t mCleanStrings;
+        bool mDirtyAll;
+        
+        std::vector<u32_t> mPageStamps;
+        std::vector<u32_t> mListStamps;
+        std::vector<u32_t> mListChunkStamps;
+        std::vector<u32_t> mObjectChunkStamps;
+        u32_t mAllStamp;
+        
+        /// first index of each string value, covers strings below mIndexedStrings.
+        std::unordered_map<String, u32_t> mStringIndices;
+        u32_t mIndexedStrings;
+        
+        Value* makeValue(Schema* schema);
+        void markValue(u32_t index);
+        u32_t findString(const String& str);
+        /// index of an equal string, appended if there is none yet.
+        u32_t internString(const String& str);
+        void addPage();
     };
 }
 
@@ -0,0 +1,103 @@
+#include "../engine/main.h"
+#include <thread>
+using namespace eokas;
+
+struct EpochTable {
+    static std::atomic<u32_t> alive;
+
+    std::vector<u64_t> items;
+    u64_t sum = 0;
+
+    EpochTable(size_t size, u64_t seed)
+        : items(size) {
+        for (size_t i = 0; i < size; i++) {
+            items[i] = seed + i;
+            sum += items[i];
+        }
+        alive++;
+    }
+
+    ~EpochTable() {
+        alive--;
+    }
+};
+
+std::atomic<u32_t> EpochTable::alive = {0};
+
+_eokas_test_case(epoch)
+{
+    // a retired object waits for the readers of its epoch.
+    {
+        EpochDomain domain;
+        EpochTable* table = new EpochTable(4, 0);
+        domain.enter();
+        domain.enter();
+        domain.retire(table);
+        _eokas_test_check(domain.collect() == 1);
+        domain.leave();
+        _eokas_test_check(domain.collect() == 1);
+        domain.leave();
+        _eokas_test_check(domain.collect() == 0);
+        _eokas_test_check(EpochTable::alive.load() == 0);
+
+        domain.retire(new EpochTable(4, 0));
+    }
+    _eokas_test_check(EpochTable::alive.load() == 0);
+
+    // readers validate the table they hold while a writer keeps replacing it.
+    {
+        const u32_t READERS = 3;
+        const u32_t UPDATES = 2000;
+
+        EpochDomain domain;
+        std::atomic<EpochTable*> current = {new EpochTable(256, 0)};
+        std::atomic<bool> done = {false};
+        std::atomic<u64_t> reads = {0};
+        std::atomic<u32_t> broken = {0};
+
+        Timer timer;
+        std::vector<std::thread> readers;
+        for (u32_t r = 0; r < READERS; r++) {
+            readers.emplace_back([&] {
+                u64_t count = 0;
+                while (!done.load(std::memory_order_relaxed)) {
+                    EpochGuard guard(domain);
+                    EpochTable* table = current.load(std::memory_order_acquire);
+                    u64_t sum = 0;
+                    for (u64_t item: table->items) {
+                        sum += item;
+                    }
+                    if (sum != table->sum) {
+                        broken++;
+                    }
+                    if (++count % 64 == 0) {
+                        std::this_thread::yield();
+                    }
+                }
+                reads += count;
+            });
+        }
+
+        for (u32_t i = 1; i <= UPDATES; i++) {
+            EpochTable* table = current.exchange(new EpochTable(256, i), std::memory_order_acq_rel);
+            domain.retire(table);
+            domain.collect();
+            if (i % 16 == 0) {
+                std::this_thread::yield();
+            }
+        }
+        done = true;
+        for (auto& thread: readers) {
+            thread.join();
+        }
+        f64_t time = timer.elapseNanos() / 1e6;
+
+        _eokas_test_check(broken.load() == 0);
+        _eokas_test_check(domain.collect() == 0);
+        _eokas_test_check(EpochTable::alive.load() == 1);
+        delete current.load();
+        printf("EpochDomain: %llu reads, %u updates in %.2f ms\n", (unsigned long long) reads.load(), UPDATES, time);
+    }
+
+    return 0;
+}
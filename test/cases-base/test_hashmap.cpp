@@ -0,0 +1,166 @@
+#include "../engine/main.h"
+#include <random>
+#include <algorithm>
+using namespace eokas;
+
+template<typename Map, typename Key>
+static bool bench(const char* name, const std::vector<Key>& keys, const std::vector<Key>& misses) {
+    Map map;
+    u64_t found = 0;
+
+    Timer timer;
+    for (size_t i = 0; i < keys.size(); i++) {
+        map.insert(std::make_pair(keys[i], i));
+    }
+    f64_t insertTime = timer.elapseNanos() / 1e6;
+
+    timer.reset();
+    for (u32_t round = 0; round < 4; round++) {
+        for (auto& key: keys) {
+            found += map.find(key) != map.end();
+        }
+        for (auto& key: misses) {
+            found += map.find(key) != map.end();
+        }
+    }
+    f64_t lookupTime = timer.elapseNanos() / 1e6;
+
+    timer.reset();
+    for (auto& key: keys) {
+        map.erase(key);
+    }
+    f64_t eraseTime = timer.elapseNanos() / 1e6;
+
+    printf("%-24s insert %8.2f ms  lookup %8.2f ms  erase %8.2f ms\n", name, insertTime, lookupTime, eraseTime);
+    return found == keys.size() * 4 && map.empty();
+}
+
+template<typename Key>
+static bool benchAll(const char* keyName, const std::vector<Key>& keys, const std::vector<Key>& misses) {
+    printf("%s, %zu keys:\n", keyName, keys.size());
+    bool ok = bench<std::map<Key, size_t>>("  std::map", keys, misses);
+    ok = bench<std::unordered_map<Key, size_t>>("  std::unordered_map", keys, misses) && ok;
+    ok = bench<HashMap<Key, size_t>>("  HashMap", keys, misses) && ok;
+    return ok;
+}
+
+_eokas_test_case(hashmap)
+{
+    // basics
+    {
+        HashMap<String, i32_t> map;
+        _eokas_test_check(map.empty());
+        _eokas_test_check(map.insert(std::make_pair(String("a"), 1)).second);
+        _eokas_test_check(!map.insert(std::make_pair(String("a"), 2)).second);
+        map["b"] = 2;
+        map["c"] = 3;
+        _eokas_test_check(map.size() == 3);
+        _eokas_test_check(map.find("a")->second == 1);
+        _eokas_test_check(map.contains("c"));
+        _eokas_test_check(!map.contains("d"));
+        _eokas_test_check(map.get("b") != nullptr && *map.get("b") == 2);
+        _eokas_test_check(map.get("d") == nullptr);
+        _eokas_test_check(map.erase("b") == 1);
+        _eokas_test_check(map.erase("b") == 0);
+        _eokas_test_check(map.find(String("b")) == map.end());
+        map.insert_or_assign("a", 10);
+        _eokas_test_check(map["a"] == 10);
+
+        for (auto iter = map.begin(); iter != map.end();) {
+            iter = iter->second == 10 ? map.erase(iter) : std::next(iter);
+        }
+        _eokas_test_check(map.size() == 1 && map.begin()->first == "c");
+        map.clear();
+        _eokas_test_check(map.empty() && !map.contains("c"));
+    }
+
+    // iteration follows insertion, the stable variant keeps it across erase.
+    {
+        StableHashMap<String, i32_t> map;
+        for (i32_t i = 0; i < 100; i++) {
+            map[String::format("key%d", i)] = i;
+        }
+        for (i32_t i = 0; i < 100; i += 3) {
+            map.erase(String::format("key%d", i));
+        }
+        i32_t last = -1;
+        bool ordered = true;
+        for (auto& pair: map) {
+            ordered = ordered && pair.second > last && pair.second % 3 != 0;
+            last = pair.second;
+        }
+        _eokas_test_check(ordered);
+        _eokas_test_check(map.size() == 66);
+        _eokas_test_check(map["key98"] == 98);
+    }
+
+    // sets and reserve
+    {
+        HashSet<u32_t> set;
+        set.reserve(1000);
+        size_t buckets = set.bucket_count();
+        for (u32_t i = 0; i < 1000; i++) {
+            set.insert(i * 7);
+        }
+        _eokas_test_check(set.bucket_count() == buckets);
+        _eokas_test_check(set.size() == 1000 && set.contains(693) && !set.contains(694));
+    }
+
+    // random operations agree with std::unordered_map.
+    {
+        std::mt19937 random(7);
+        HashMap<u64_t, u64_t> map;
+        std::unordered_map<u64_t, u64_t> reference;
+        bool same = true;
+        for (u32_t step = 0; step < 200000; step++) {
+            u64_t key = random() % 5000;
+            switch (random() % 3) {
+                case 0:
+                    map[key] = step;
+                    reference[key] = step;
+                    break;
+                case 1:
+                    same = same && map.erase(key) == reference.erase(key);
+                    break;
+                default: {
+                    auto iter = map.find(key);
+                    auto refIter = reference.find(key);
+                    same = same && (iter == map.end()) == (refIter == reference.end());
+                    same = same && (iter == map.end() || iter->second == refIter->second);
+                    break;
+                }
+            }
+        }
+        _eokas_test_check(same);
+        _eokas_test_check(map.size() == reference.size());
+    }
+
+    // benchmarks on the key types the project uses.
+    {
+        const u32_t COUNT = 100000;
+        std::vector<String> names;
+        std::vector<String> missNames;
+        std::vector<Symbol> symbols;
+        std::vector<Symbol> missSymbols;
+        std::vector<void*> handles;
+        std::vector<void*> missHandles;
+        std::vector<std::unique_ptr<u64_t>> storage;
+        for (u32_t i = 0; i < COUNT; i++) {
+            names.push_back(String::format("module.scope.symbol_%u", i));
+            missNames.push_back(String::format("module.scope.missing_%u", i));
+            symbols.push_back(Symbol(names.back()));
+            missSymbols.push_back(Symbol(missNames.back()));
+            storage.emplace_back(new u64_t(i));
+            handles.push_back(storage.back().get());
+            storage.emplace_back(new u64_t(i));
+            missHandles.push_back(storage.back().get());
+        }
+        std::shuffle(handles.begin(), handles.end(), std::mt19937(1));
+
+        _eokas_test_check(benchAll("String", names, missNames));
+        _eokas_test_check(benchAll("Symbol", symbols, missSymbols));
+        _eokas_test_check(benchAll("handle", handles, missHandles));
+    }
+
+    return 0;
+}
@@ -28,6 +28,16 @@ _eokas_test_case(io)
         }
     }
     
+    printf("== File::createFolder\n");
+    {
+        _eokas_test_check(File::createFolder("./eokas-test-io/a/b"));
+        _eokas_test_check(File::isFolder("./eokas-test-io/a/b"));
+        _eokas_test_check(File::createFolder("./eokas-test-io/a/b"));
+        File::remove("./eokas-test-io/a/b");
+        File::remove("./eokas-test-io/a");
+        File::remove("./eokas-test-io");
+    }
+    
     printf("== Process Info");
     {
         printf("Process ID: %d\n", Process::getPID());
@@ -1,4 +1,3 @@
-
 #include "../engine/main.h"
 using namespace eokas;
 
@@ -10,35 +9,28 @@ _eokas_test_case(json)
         "\"files\"= [ "
             "\"README.md\","
             "\"package.json\""
-        "],"
-        "\"index\": 100"
+        "],\n"
+        "\"index\": 100, "
+        "\"ratio\": -0.25, "
+        "\"public\": true"
     "}";
 
-    /*
-    auto obj = static_cast<HomObject*>(JSON::parse(str).get());
-    printf("{\n");
-    printf("\tname: %s\n", obj->getString("name").cstr());
-    printf("\tversion: %s\n", obj->getString("version").cstr());
-    printf("\tindex: %f\n", obj->getNumber("index"));
-    printf("\tfiles: [\n");
-    auto files = obj->getArray("files");
-    for(auto& f : files) {
-        auto p = static_cast<HomString*>(f.get());
-        printf("\t\t%s,\n", p->value.cstr());
-    }
-    printf("\t]\n");
-    printf("}\n");
+    HomNode obj = JSON::parse(str);
+    _eokas_test_check(obj.isObject());
+    _eokas_test_check(obj.get("name").asString() == "eokas-json");
+    _eokas_test_check(obj.get("version").asString() == "0.0.1");
+    _eokas_test_check(obj.get("index").asNumber() == 100);
+    _eokas_test_check(obj.get("ratio").asNumber() == -0.25);
+    _eokas_test_check(obj.get("public").asBoolean());
+
+    HomNode files = obj.get("files");
+    _eokas_test_check(files.isArray());
+    _eokas_test_check(files.get(0).asString() == "README.md");
+    _eokas_test_check(files.get(1).asString() == "package.json");
 
-    auto obj = JSON.parse(str);
-    obj->getString("");
-    obj->getString("");
-    obj->getNumber("");
-    obj->getBoolean("");
-    auto files = obj->getArray("");
-    for(auto& f : files) {
-        f.get();
-    }
-    */
+    String text = JSON::stringify(files);
+    printf("files: %s\n", text.cstr());
+    _eokas_test_check(text == "[\"README.md\", \"package.json\"]");
 
     return 0;
 }
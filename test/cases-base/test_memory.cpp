@@ -0,0 +1,115 @@
+
+#include "../engine/main.h"
+using namespace eokas;
+
+_eokas_test_case(memory)
+{
+    // MemoryPool
+    {
+        MemoryPool pool;
+        void* ptr = pool.acquire(100);
+        _eokas_test_check(ptr != nullptr);
+        _eokas_test_check(pool.capacity(ptr) >= 100);
+        pool.release(ptr);
+        _eokas_test_check(pool.cachedBytes() == pool.capacity(ptr));
+        void* again = pool.acquire(200);
+        _eokas_test_check(again == ptr);
+        pool.release(again);
+        pool.trim();
+        _eokas_test_check(pool.cachedBytes() == 0);
+    }
+
+    // MemoryStream
+    {
+        MemoryStream stream;
+        stream.open();
+        for (u32_t i = 0; i < 1000; i++) {
+            _eokas_test_check(stream.write(&i, sizeof(i)) == sizeof(i));
+        }
+        stream.seek(0, 0);
+        u32_t value = 0;
+        for (u32_t i = 0; i < 1000; i++) {
+            stream.read(&value, sizeof(value));
+            _eokas_test_check(value == i);
+        }
+    }
+
+    // ChunkStream
+    {
+        ChunkStream stream(256);
+        stream.open();
+        for (u32_t i = 0; i < 10000; i++) {
+            _eokas_test_check(stream.write(&i, sizeof(i)) == sizeof(i));
+        }
+        _eokas_test_check(stream.size() == 10000 * sizeof(u32_t));
+        _eokas_test_check(stream.chunkCount() > 1);
+        printf("ChunkStream: size=%zu chunks=%zu\n", stream.size(), stream.chunkCount());
+
+        stream.seek(0, 0);
+        u32_t value = 0;
+        for (u32_t i = 0; i < 10000; i++) {
+            stream.read(&value, sizeof(value));
+            _eokas_test_check(value == i);
+        }
+        _eokas_test_check(stream.eos());
+
+        MemorySliceList slices = stream.freeze();
+        size_t total = 0;
+        for (auto& slice: slices) {
+            total += slice.size();
+        }
+        _eokas_test_check(total == stream.size());
+
+        // overwriting doesn't change the frozen slices.
+        u32_t head = 0xFFFFFFFF;
+        stream.seek(0, 0);
+        stream.write(&head, sizeof(head));
+        _eokas_test_check(*(const u32_t*) slices[0].data() == 0);
+        MemorySlice sub = slices[0].slice(sizeof(u32_t), sizeof(u32_t));
+        _eokas_test_check(sub.size() == sizeof(u32_t));
+        _eokas_test_check(*(const u32_t*) sub.data() == 1);
+
+        MemoryBuffer buffer = stream.flatten();
+        _eokas_test_check(buffer.size() == stream.size());
+        _eokas_test_check(((u32_t*) buffer.data())[0] == 0xFFFFFFFF);
+        _eokas_test_check(((u32_t*) buffer.data())[9999] == 9999);
+
+        stream.clear();
+        _eokas_test_check(stream.size() == 0);
+        _eokas_test_check(*(const u32_t*) slices[0].data() == 0);
+    }
+
+    // a chunk the pool can't hand out stops the write short.
+    {
+        ChunkStream stream(size_t(1) << 62);
+        stream.open();
+        u32_t value = 7;
+        _eokas_test_check(stream.write(&value, sizeof(value)) == 0);
+        _eokas_test_check(stream.chunkCount() == 0);
+        _eokas_test_check(stream.size() == 0);
+    }
+
+    // VirtualRegion
+    {
+        VirtualRegion region(64 * 1024 * 1024);
+        _eokas_test_check(region.data() != nullptr);
+        _eokas_test_check(region.committed() == 0);
+        printf("VirtualRegion: reserved=%zu granularity=%zu\n", region.reserved(), region.granularity());
+
+        void* base = region.data();
+        _eokas_test_check(region.grow(100));
+        _eokas_test_check(region.committed() == region.granularity());
+        ((u8_t*) region.data())[99] = 0x5A;
+        _eokas_test_check(region.grow(4 * 1024 * 1024));
+        _eokas_test_check(region.data() == base);
+        ((u8_t*) region.data())[4 * 1024 * 1024 - 1] = 0xA5;
+        _eokas_test_check(((u8_t*) region.data())[99] == 0x5A);
+        _eokas_test_check(!region.grow(region.reserved() + 1));
+
+        region.shrink(100);
+        _eokas_test_check(region.committed() == region.granularity());
+        _eokas_test_check(((u8_t*) region.data())[99] == 0x5A);
+    }
+
+    return 0;
+}
@@ -0,0 +1,101 @@
+
+#include "../engine/main.h"
+#include <thread>
+using namespace eokas;
+
+static void profileWork(int depth) {
+    _eokas_profile_zone("work");
+    if (depth > 0) {
+        profileWork(depth - 1);
+    }
+}
+
+_eokas_test_case(profiler)
+{
+    Profiler profiler;
+    profiler.setCapturing(true);
+
+    profiler.begin("frame");
+    for (int i = 0; i < 3; i++) {
+        profiler.begin("outer");
+        profiler.begin("inner");
+        profiler.end();
+        profiler.end();
+    }
+    std::thread worker([&profiler] {
+        profiler.begin("worker");
+        profiler.end();
+    });
+    worker.join();
+    profiler.end();
+    profiler.frame();
+
+    const ProfileFrame& frame = profiler.lastFrame();
+    _eokas_test_check(frame.index == 0);
+    _eokas_test_check(frame.dropped == 0);
+    _eokas_test_check(frame.zones.size() == 4);
+    for (auto& zone: frame.zones) {
+        printf("zone: %s calls=%u total=%llu ns\n", zone.name.cstr(), zone.calls, (unsigned long long) zone.total);
+        if (zone.name == "outer" || zone.name == "inner") {
+            _eokas_test_check(zone.calls == 3);
+        }
+        _eokas_test_check(zone.max <= zone.total);
+    }
+    _eokas_test_check(profiler.capturedCount() == 8);
+
+    // the global instance is used by the zone macro.
+    Profiler::instance().clear();
+    profileWork(4);
+    Profiler::instance().frame();
+    _eokas_test_check(Profiler::instance().lastFrame().zones.size() == 1);
+    _eokas_test_check(Profiler::instance().lastFrame().zones[0].calls == 5);
+
+    // a zone begun while disabled doesn't end its parent.
+    Profiler::instance().begin("parent");
+    Profiler::instance().setEnabled(false);
+    {
+        ProfileZone zone("child");
+        Profiler::instance().setEnabled(true);
+    }
+    Profiler::instance().end();
+    Profiler::instance().frame();
+    _eokas_test_check(Profiler::instance().lastFrame().zones.size() == 1);
+    _eokas_test_check(Profiler::instance().lastFrame().zones[0].name == "parent");
+
+    // a thread switching between profilers keeps one buffer and one zone stack for each.
+    {
+        Profiler other;
+        profiler.begin("a");
+        other.begin("b");
+        other.end();
+        profiler.end();
+        other.begin("b");
+        other.end();
+        profiler.frame();
+        other.frame();
+        _eokas_test_check(profiler.lastFrame().zones.size() == 1);
+        _eokas_test_check(profiler.lastFrame().zones[0].name == "a");
+        _eokas_test_check(other.lastFrame().zones.size() == 1);
+        _eokas_test_check(other.lastFrame().zones[0].calls == 2);
+    }
+
+    profiler.setEnabled(false);
+    _eokas_test_check(!profiler.begin("disabled"));
+    profiler.frame();
+    _eokas_test_check(profiler.lastFrame().index == 2);
+    _eokas_test_check(profiler.lastFrame().zones.empty());
+
+    String path = "./eokas-test-profiler.json";
+    _eokas_test_check(profiler.exportChromeTrace(path));
+    String json;
+    FileStream stream(path, "rb");
+    _eokas_test_check(stream.open());
+    std::vector<char> text(stream.size() + 1, '\0');
+    stream.read(text.data(), text.size() - 1);
+    stream.close();
+    _eokas_test_check(strstr(text.data(), "\"traceEvents\"") != nullptr);
+    _eokas_test_check(strstr(text.data(), "\"name\":\"worker\"") != nullptr);
+    std::remove(path.cstr());
+
+    return 0;
+}
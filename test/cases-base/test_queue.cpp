@@ -0,0 +1,150 @@
+
+#include "../engine/main.h"
+#include <thread>
+using namespace eokas;
+
+struct QueueItem : public MpscNode {
+    u32_t producer = 0;
+    u32_t index = 0;
+};
+
+_eokas_test_case(queue)
+{
+    const u32_t COUNT = 1000000;
+    const u32_t THREADS = 4;
+
+    // SpscRing
+    {
+        SpscRing<u32_t> ring(1000);
+        _eokas_test_check(ring.capacity() == 1024);
+        u32_t items[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+        _eokas_test_check(ring.pushBatch(items, 8) == 8);
+        _eokas_test_check(ring.size() == 8);
+        u32_t out[8] = {};
+        _eokas_test_check(ring.popBatch(out, 16) == 8);
+        _eokas_test_check(out[7] == 7);
+        _eokas_test_check(ring.empty());
+
+        Timer timer;
+        std::thread producer([&ring, COUNT] {
+            u32_t batch[32];
+            for (u32_t i = 0; i < COUNT;) {
+                u32_t n = 0;
+                for (; n < 32 && i + n < COUNT; n++) {
+                    batch[n] = i + n;
+                }
+                size_t pushed = 0;
+                while (pushed < n) {
+                    size_t count = ring.pushBatch(batch + pushed, n - pushed);
+                    if (count == 0) {
+                        std::this_thread::yield();
+                    }
+                    pushed += count;
+                }
+                i += n;
+            }
+        });
+        bool ordered = true;
+        u32_t expect = 0;
+        u32_t value = 0;
+        while (expect < COUNT) {
+            if (!ring.pop(value)) {
+                std::this_thread::yield();
+                continue;
+            }
+            ordered = ordered && value == expect;
+            expect++;
+        }
+        producer.join();
+        _eokas_test_check(ordered);
+        printf("SpscRing: %u items in %.2f ms\n", COUNT, timer.elapseNanos() / 1e6);
+    }
+
+    // MpmcQueue
+    {
+        MpmcQueue<u64_t> queue(1024);
+        std::atomic<u64_t> sum = {0};
+        std::atomic<u32_t> popped = {0};
+        std::vector<std::thread> threads;
+
+        Timer timer;
+        for (u32_t t = 0; t < THREADS; t++) {
+            threads.emplace_back([&queue, t, COUNT, THREADS] {
+                for (u32_t i = t; i < COUNT; i += THREADS) {
+                    while (!queue.push(u64_t(i))) {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+            threads.emplace_back([&queue, &sum, &popped, COUNT] {
+                u64_t items[16];
+                while (popped.load() < COUNT) {
+                    size_t n = queue.popBatch(items, 16);
+                    if (n == 0) {
+                        std::this_thread::yield();
+                    }
+                    for (size_t i = 0; i < n; i++) {
+                        sum += items[i];
+                    }
+                    popped += u32_t(n);
+                }
+            });
+        }
+        for (auto& thread: threads) {
+            thread.join();
+        }
+        _eokas_test_check(popped.load() == COUNT);
+        _eokas_test_check(sum.load() == u64_t(COUNT) * (COUNT - 1) / 2);
+        _eokas_test_check(queue.empty());
+        printf("MpmcQueue: %u items in %.2f ms\n", COUNT, timer.elapseNanos() / 1e6);
+    }
+
+    // MpscQueue
+    {
+        const u32_t PER_THREAD = COUNT / THREADS;
+        std::vector<QueueItem> items(COUNT);
+        MpscQueue<QueueItem> queue;
+        _eokas_test_check(queue.pop() == nullptr);
+        _eokas_test_check(queue.empty());
+
+        Timer timer;
+        std::vector<std::thread> threads;
+        for (u32_t t = 0; t < THREADS; t++) {
+            threads.emplace_back([&queue, &items, t, PER_THREAD] {
+                QueueItem* batch[8];
+                for (u32_t i = 0; i < PER_THREAD; i += 8) {
+                    for (u32_t k = 0; k < 8; k++) {
+                        QueueItem* item = &items[t * PER_THREAD + i + k];
+                        item->producer = t;
+                        item->index = i + k;
+                        batch[k] = item;
+                    }
+                    queue.pushBatch(batch, 8);
+                }
+            });
+        }
+
+        // every producer's items arrive in order.
+        std::vector<u32_t> next(THREADS, 0);
+        bool ordered = true;
+        u32_t received = 0;
+        while (received < PER_THREAD * THREADS) {
+            QueueItem* item = queue.pop();
+            if (item == nullptr) {
+                std::this_thread::yield();
+                continue;
+            }
+            ordered = ordered && item->index == next[item->producer];
+            next[item->producer] = item->index + 1;
+            received++;
+        }
+        for (auto& thread: threads) {
+            thread.join();
+        }
+        _eokas_test_check(ordered);
+        _eokas_test_check(queue.pop() == nullptr);
+        printf("MpscQueue: %u items in %.2f ms\n", received, timer.elapseNanos() / 1e6);
+    }
+
+    return 0;
+}
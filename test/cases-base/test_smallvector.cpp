@@ -0,0 +1,160 @@
+#include "../engine/main.h"
+#include <atomic>
+#include <cstdlib>
+using namespace eokas;
+
+// counts every heap allocation of the test executable, the other cases just pay an atomic add.
+static std::atomic<u64_t> sAllocations{0};
+
+void* operator new(size_t size) {
+    sAllocations.fetch_add(1, std::memory_order_relaxed);
+    void* ptr = malloc(size > 0 ? size : 1);
+    if (ptr == nullptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    free(ptr);
+}
+
+struct Tracked {
+    static i32_t alive;
+    i32_t value;
+
+    Tracked(i32_t value = 0) : value(value) { alive++; }
+    Tracked(const Tracked& other) : value(other.value) { alive++; }
+    Tracked(Tracked&& other) noexcept : value(other.value) { other.value = -1; alive++; }
+    ~Tracked() { alive--; }
+    Tracked& operator=(const Tracked& other) = default;
+    Tracked& operator=(Tracked&& other) noexcept { value = other.value; other.value = -1; return *this; }
+    bool operator==(const Tracked& other) const { return value == other.value; }
+};
+
+i32_t Tracked::alive = 0;
+
+// the shape of an argument list built per call: a few handles, handed over by reference.
+template<typename List>
+static void bench(const char* name, u32_t args) {
+    const u32_t COUNT = 200000;
+    u64_t sum = 0;
+    u64_t allocations = sAllocations.load();
+    Timer timer;
+    for (u32_t i = 0; i < COUNT; i++) {
+        List list;
+        for (u32_t arg = 0; arg < args; arg++) {
+            list.push_back((void*)uintptr_t(i + arg));
+        }
+        sum += uintptr_t(list.back());
+    }
+    f64_t time = timer.elapseNanos() / 1e6;
+    allocations = sAllocations.load() - allocations;
+    printf("%-32s %u args: %8llu allocations %8.2f ms (%llu)\n", name, args, (unsigned long long)allocations, time, (unsigned long long)(sum & 0xff));
+}
+
+_eokas_test_case(smallvector)
+{
+    // inline, then spilled to the heap.
+    {
+        SmallVector<Tracked, 4> vec;
+        _eokas_test_check(vec.empty() && vec.capacity() == 4 && vec.isInline());
+        u64_t allocations = sAllocations.load();
+        for (i32_t i = 0; i < 4; i++) {
+            vec.emplace_back(i);
+        }
+        _eokas_test_check(sAllocations.load() == allocations);
+        _eokas_test_check(vec.isInline() && vec.size() == 4);
+        vec.push_back(vec[0]);
+        _eokas_test_check(!vec.isInline() && vec.size() == 5 && vec[4].value == 0);
+        _eokas_test_check(Tracked::alive == 5);
+
+        vec.insert(vec.begin() + 1, Tracked(10));
+        _eokas_test_check(vec[0].value == 0 && vec[1].value == 10 && vec[2].value == 1);
+        vec.erase(vec.begin());
+        _eokas_test_check(vec.front().value == 10 && vec.size() == 5);
+        vec.erase(vec.begin() + 1, vec.begin() + 3);
+        _eokas_test_check(vec.size() == 3 && vec[1].value == 3 && vec.back().value == 0);
+
+        vec.shrink_to_fit();
+        _eokas_test_check(vec.isInline() && vec.size() == 3);
+        _eokas_test_check(Tracked::alive == 3);
+
+        bool thrown = false;
+        try {
+            vec.at(3);
+        }
+        catch (const std::out_of_range&) {
+            thrown = true;
+        }
+        _eokas_test_check(thrown);
+    }
+    _eokas_test_check(Tracked::alive == 0);
+
+    // copies and moves, inline and on the heap.
+    {
+        SmallVector<Tracked, 2> small = {1, 2};
+        SmallVector<Tracked, 2> large = {1, 2, 3, 4};
+        SmallVector<Tracked, 2> copy = large;
+        _eokas_test_check(copy == large && !copy.isInline());
+
+        const Tracked* data = large.data();
+        SmallVector<Tracked, 2> moved = std::move(large);
+        _eokas_test_check(moved.data() == data && large.empty() && large.isInline());
+
+        moved = std::move(small);
+        _eokas_test_check(moved.size() == 2 && moved.isInline() && moved[1].value == 2);
+        _eokas_test_check(small.empty());
+
+        copy.resize(1);
+        _eokas_test_check(copy.size() == 1 && copy[0].value == 1);
+        copy.resize(3, Tracked(7));
+        _eokas_test_check(copy.size() == 3 && copy[2].value == 7);
+        _eokas_test_check(Tracked::alive == 5);
+    }
+    _eokas_test_check(Tracked::alive == 0);
+
+    // fixed capacity.
+    {
+        StaticVector<Tracked, 3> vec = {1, 2};
+        vec.push_back(3);
+        _eokas_test_check(vec.full() && vec.size() == 3);
+        bool thrown = false;
+        try {
+            vec.push_back(4);
+        }
+        catch (const std::length_error&) {
+            thrown = true;
+        }
+        _eokas_test_check(thrown && vec.size() == 3);
+        vec.erase(vec.begin());
+        _eokas_test_check(vec.size() == 2 && vec[0].value == 2 && vec[1].value == 3);
+        StaticVector<Tracked, 3> copy = vec;
+        _eokas_test_check(copy.size() == 2 && copy.back().value == 3);
+    }
+    _eokas_test_check(Tracked::alive == 0);
+
+    // option lookups no longer split the option names.
+    {
+        cli::Command cmd("run");
+        cmd.option("--file,-f", "", "a.txt").option("--out,-o", "", "b.txt");
+        _eokas_test_check(cmd.fetchValue("-f").string() == "a.txt");
+        _eokas_test_check(cmd.fetchValue("--out").string() == "b.txt");
+        _eokas_test_check(!cmd.fetchOption("--fi").has_value());
+        u64_t allocations = sAllocations.load();
+        for (u32_t i = 0; i < 100; i++) {
+            cmd.fetchOption("-o");
+        }
+        printf("cli: 100 option lookups, %llu allocations\n", (unsigned long long)(sAllocations.load() - allocations));
+    }
+
+    bench<std::vector<void*>>("std::vector<void*>", 3);
+    bench<SmallVector<void*, 8>>("SmallVector<void*, 8>", 3);
+    bench<std::vector<void*>>("std::vector<void*>", 12);
+    bench<SmallVector<void*, 8>>("SmallVector<void*, 8>", 12);
+
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include "../engine/main.h"
+#include <thread>
+using namespace eokas;
+
+_eokas_test_case(symbol)
+{
+    Symbol a = "name";
+    Symbol b = String("name");
+    Symbol c = "version";
+    _eokas_test_check(a == b);
+    _eokas_test_check(a != c);
+    _eokas_test_check(a.id() != c.id());
+    _eokas_test_check(a.str() == "name");
+    _eokas_test_check(a.hash() == std::hash<String>()(String("name")));
+
+    Symbol empty = "";
+    _eokas_test_check(!empty.isNull());
+    _eokas_test_check(empty.length() == 0);
+    _eokas_test_check(Symbol().isNull());
+    _eokas_test_check(Symbol() != empty);
+
+    _eokas_test_check(Symbol::find("version") == c);
+    _eokas_test_check(Symbol::find("symbol-never-interned").isNull());
+
+    // every thread gets the same entry for the same string.
+    const u32_t THREADS = 4;
+    const u32_t COUNT = 2000;
+    std::vector<std::vector<Symbol>> results(THREADS);
+    std::vector<std::thread> threads;
+    for (u32_t t = 0; t < THREADS; t++) {
+        threads.emplace_back([&results, t, COUNT] {
+            for (u32_t i = 0; i < COUNT; i++) {
+                results[t].push_back(Symbol(String::format("symbol-%u", i)));
+            }
+        });
+    }
+    for (auto& thread: threads) {
+        thread.join();
+    }
+    bool same = true;
+    for (u32_t t = 1; t < THREADS; t++) {
+        same = same && results[t] == results[0];
+    }
+    _eokas_test_check(same);
+    _eokas_test_check(results[0][7].str() == "symbol-7");
+
+    std::unordered_map<Symbol, u32_t> map;
+    map[a] = 1;
+    map[c] = 2;
+    _eokas_test_check(map[Symbol("name")] == 1);
+
+    // precomputed keys.
+    static_assert("name"_hash == HashKey::fnv1a("name", 4), "the literal hashes at compile time");
+    _eokas_test_check("name"_hash.hash == a.hash());
+    _eokas_test_check(Symbol::find("version"_hash) == c);
+    _eokas_test_check(Symbol::find("symbol-never-interned"_hash).isNull());
+    _eokas_test_check(Symbol("name"_hash) == a);
+
+    HashMap<Symbol, u32_t> symbols;
+    symbols[a] = 1;
+    _eokas_test_check(symbols.find("name"_hash) != symbols.end());
+    _eokas_test_check(symbols.find("version"_hash) == symbols.end());
+    HashMap<String, u32_t> strings;
+    strings["name"] = 1;
+    _eokas_test_check(strings.contains("name"_hash) && !strings.contains("nam"_hash));
+
+    u32_t matched = 0;
+    for (auto& word: {String("name"), String("version"), String("other")}) {
+        switch (HashKey(word)) {
+            case "name"_hash:
+                matched += 1;
+                break;
+            case "version"_hash:
+                matched += 10;
+                break;
+            default:
+                matched += 100;
+                break;
+        }
+    }
+    _eokas_test_check(matched == 111);
+
+    return 0;
+}
@@ -9,9 +9,20 @@ _eokas_test_case(timer)
     timer.reset();
     for(int i = 0; i < 10; i++) {
         i64_t e = timer.elapse();
-        printf("elapse: %llu \n", e);
+        printf("elapse: %lld \n", (long long) e);
     }
     timer.reset();
 
+    u64_t last = Timer::now();
+    for(int i = 0; i < 1000; i++) {
+        u64_t now = Timer::now();
+        _eokas_test_check(now >= last);
+        last = now;
+    }
+
+    i64_t nanos = timer.elapseNanos(false);
+    _eokas_test_check(nanos >= 0);
+    _eokas_test_check(timer.elapse(false) >= nanos / 1000);
+
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,113 @@
+
+#include "../engine/main.h"
+#include <thread>
+using namespace eokas;
+
+struct WatcherReceiver {
+    FileChangeList changes;
+
+    SignalResult onChanged(FileWatcher::FileChangeSignalMessage& message) {
+        changes = message.changes;
+        return SignalResult::Continue;
+    }
+};
+
+static void write(const String& path, const String& content) {
+    FileStream stream(path, "w");
+    if (stream.open()) {
+        stream.write((void*) content.cstr(), content.length());
+        stream.close();
+    }
+}
+
+static size_t pump(FileWatcher& watcher, FileChangeList& changes) {
+    Timer timer;
+    while (changes.empty() && timer.elapse(false) < 500000) {
+        watcher.update();
+        std::this_thread::yield();
+    }
+    return changes.size();
+}
+
+_eokas_test_case(watcher)
+{
+    String path = "./eokas-test-watcher.txt";
+    String temp = "./eokas-test-watcher.tmp";
+    String folder = "./eokas-test-watcher";
+    String sub = File::combinePath(folder, "sub");
+    String subFile = File::combinePath(sub, "file.txt");
+    String moved = "./eokas-test-watcher-moved";
+    String movedFile = File::combinePath(moved, "file.txt");
+    write(path, "eokas");
+    File::createFolder(folder);
+
+    for (bool polling : {false, true}) {
+        FileWatcher watcher(polling);
+        watcher.setDebounce(0);
+        watcher.setPollInterval(0);
+        printf("FileWatcher polling: %s\n", watcher.isPolling() ? "true" : "false");
+
+        WatcherReceiver receiver;
+        FileChangeList& changes = receiver.changes;
+        watcher.callback.attachHandler(&receiver, &WatcherReceiver::onChanged);
+
+        _eokas_test_check(watcher.watch(path, false));
+        _eokas_test_check(watcher.isWatching(path));
+
+        // several writes are coalesced into one change.
+        write(path, "eokas-test-watcher");
+        write(path, "eokas-test-watcher-modified");
+        _eokas_test_check(pump(watcher, changes) == 1);
+        _eokas_test_check(changes[0].path == path);
+        _eokas_test_check(changes[0].type == FileChangeType::Modified);
+
+        // a rewrite of the same size within the same second.
+        changes.clear();
+        write(path, "eokas-test-watcher-MODIFIED");
+        _eokas_test_check(pump(watcher, changes) == 1);
+        _eokas_test_check(changes[0].type == FileChangeType::Modified);
+
+        // saved through a rename, the file is still watched afterwards.
+        changes.clear();
+        write(temp, "eokas-test-watcher-renamed");
+        _eokas_test_check(File::replace(temp, path));
+        _eokas_test_check(pump(watcher, changes) == 1);
+        _eokas_test_check(changes[0].path == path);
+        _eokas_test_check(changes[0].type == FileChangeType::Modified);
+        changes.clear();
+        write(path, "eokas-test-watcher-rewritten");
+        _eokas_test_check(pump(watcher, changes) == 1);
+        _eokas_test_check(changes[0].type == FileChangeType::Modified);
+
+        changes.clear();
+        watcher.unwatch(path);
+        _eokas_test_check(!watcher.isWatching(path));
+        write(path, "eokas");
+        _eokas_test_check(pump(watcher, changes) == 0);
+
+        // a folder is reported through its files, and nothing under it once it is moved away.
+        _eokas_test_check(watcher.watch(folder, true));
+        _eokas_test_check(File::createFolder(sub));
+        write(subFile, "eokas");
+        _eokas_test_check(pump(watcher, changes) == 1);
+        _eokas_test_check(changes[0].path == subFile);
+        _eokas_test_check(changes[0].type == FileChangeType::Created);
+        changes.clear();
+        _eokas_test_check(File::replace(sub, moved));
+        _eokas_test_check(pump(watcher, changes) == 1);
+        _eokas_test_check(changes[0].path == subFile);
+        _eokas_test_check(changes[0].type == FileChangeType::Removed);
+        changes.clear();
+        write(movedFile, "eokas-moved");
+        _eokas_test_check(pump(watcher, changes) == 0);
+        watcher.unwatch(folder);
+
+        File::remove(movedFile);
+        File::remove(moved);
+    }
+
+    File::remove(path);
+    File::remove(folder);
+
+    return 0;
+}
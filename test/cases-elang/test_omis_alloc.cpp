@@ -0,0 +1,209 @@
+#include "../engine/main.h"
+#include "elang/src/omis/context.h"
+#include "elang/src/omis/model.h"
+#include "elang/src/omis/bridge.h"
+#include "elang/src/omis/runtime.h"
+using namespace eokas;
+
+/*
+Functions whose memory ends up in each of the places end_func picks:
+$main  a fixed size that does not escape, a frame slot.
+g      a count only known at runtime, the region of the function.
+h      made in a loop and never dropped, the region of the function.
+k      made and dropped in a loop, the pooled heap.
+e      handed to a call, the heap.
+*/
+struct omis_alloc_module_t : omis_module_t {
+    explicit omis_alloc_module_t(omis_context_t* context)
+        : omis_module_t(context, "alloc") {}
+
+    omis_value_t* begin_func(const char* name, const std::vector<omis_type_t*>& args) {
+        auto func = this->value_func(name, this->type_i32(), args, false);
+        this->scope->add_value_symbol(name, func);
+        this->push_scope(func);
+        this->set_active_block(this->create_block("entry"));
+        return func;
+    }
+
+    void end_func_scope(omis_value_t* func) {
+        this->stmt_ensure_tail_ret(func);
+        this->end_func(func);
+        this->pop_scope();
+    }
+
+    omis_value_t* i32(int value) {
+        return this->value_integer(value, 32);
+    }
+
+    /// the sum of i for i < 100, each read through memory made in the loop.
+    omis_value_t* loop_func(const char* name, bool drop) {
+        auto func = this->begin_func(name, {});
+        auto sum = this->variable("sum", this->type_i32(), this->i32(0));
+        auto i = this->variable("i", this->type_i32(), this->i32(0));
+        this->stmt_loop(
+            [&]() { return true; },
+            [&]() { return this->lt(this->load(i), this->i32(100)); },
+            [&]() { this->store(i, this->add(this->load(i), this->i32(1))); return true; },
+            [&]() {
+                auto item = this->make(this->type_i32());
+                this->store(item, this->load(i));
+                this->store(sum, this->add(this->load(sum), this->load(item)));
+                if (drop) {
+                    this->drop(item);
+                }
+                return true;
+            });
+        this->ret(this->load(sum));
+        this->end_func_scope(func);
+        return func;
+    }
+
+    bool main() override {
+        auto g = this->begin_func("g", {this->type_i64()});
+        {
+            auto items = this->make(this->type_i32(), this->get_func_arg_value(g, 0));
+            this->store(items, this->i32(2));
+            auto value = this->load(items);
+            this->drop(items);
+            this->ret(value);
+        }
+        this->end_func_scope(g);
+
+        auto h = this->loop_func("h", false);
+        auto k = this->loop_func("k", true);
+
+        auto sink = this->begin_func("sink", {this->type_bytes()});
+        this->ret(this->i32(0));
+        this->end_func_scope(sink);
+
+        auto e = this->begin_func("e", {});
+        {
+            auto item = this->make(this->type_i32());
+            this->store(item, this->i32(7));
+            this->call(sink, {this->bitcast(item, this->type_bytes())});
+            auto value = this->load(item);
+            this->drop(item);
+            this->ret(value);
+        }
+        this->end_func_scope(e);
+
+        auto m = this->begin_func("$main", {});
+        {
+            auto item = this->make(this->type_i32());
+            this->store(item, this->i32(40));
+            auto total = this->load(item);
+            this->drop(item);
+            total = this->add(total, this->call(g, {this->value_integer(2, 64)}));
+            total = this->add(total, this->call(h, {}));
+            total = this->add(total, this->call(k, {}));
+            total = this->add(total, this->call(e, {}));
+            this->ret(total);
+        }
+        this->end_func_scope(m);
+        return true;
+    }
+};
+
+/// the text of a function in the dump of its module.
+static std::string func_ir(const std::string& ir, const char* name) {
+    size_t start = ir.find(String::format("define i32 @%s(", name).cstr());
+    if (start == std::string::npos)
+        return "";
+    size_t end = ir.find("\n}\n", start);
+    return ir.substr(start, end - start);
+}
+
+static bool contains(const std::string& text, const char* part) {
+    return text.find(part) != std::string::npos;
+}
+
+static bool run_alloc_module(omis_backend_t backend, std::string& ir, i64_t& result) {
+    omis_context_t context(backend);
+    context.load_default_modules();
+    auto* mod = new omis_alloc_module_t(&context);
+    context.add_module("alloc", mod);
+    if (!mod->main())
+        return false;
+    ir = mod->dump().cstr();
+
+    omis_compile_options_t options;
+    omis_compile_stats_t stats;
+    if (!context.jit(mod, options, stats))
+        return false;
+    result = stats.result;
+    return true;
+}
+
+_eokas_test_case(omis_alloc)
+{
+    // the pools, a freed block is the next one handed out for its size.
+    {
+        u8_t* a = (u8_t*) eokas_alloc(24);
+        _eokas_test_check(a != nullptr && uintptr_t(a) % 16 == 0);
+        memset(a, 0x5A, 24);
+        eokas_free(a);
+        _eokas_test_check(eokas_alloc(20) == a);
+        eokas_free(a);
+
+        u8_t* large = (u8_t*) eokas_alloc(100000);
+        _eokas_test_check(large != nullptr);
+        large[99999] = 1;
+        eokas_free(large);
+        eokas_free(nullptr);
+    }
+
+    // regions, leaving frees everything since the mark, nested ones included.
+    {
+        void* outer = eokas_region_enter();
+        u8_t* a = (u8_t*) eokas_region_alloc(40);
+        u8_t* b = (u8_t*) eokas_region_alloc(8);
+        _eokas_test_check(b - a == 48);
+        void* inner = eokas_region_enter();
+        _eokas_test_check(inner == a + 64);
+        u8_t* huge = (u8_t*) eokas_region_alloc(200000);
+        _eokas_test_check(huge != nullptr);
+        huge[199999] = 1;
+        eokas_region_leave(inner);
+        _eokas_test_check(eokas_region_enter() == inner);
+        _eokas_test_check(eokas_region_alloc(16) == inner);
+        eokas_region_leave(outer);
+        _eokas_test_check(eokas_region_enter() == outer);
+    }
+
+    // where the encoder put each value.
+    {
+        std::string ir;
+        i64_t result = 0;
+        _eokas_test_check(run_alloc_module(omis_backend_t::LLVM, ir, result));
+        _eokas_test_check(result == 40 + 2 + 4950 + 4950 + 7);
+
+        std::string main = func_ir(ir, "\"$main\"");
+        _eokas_test_check(contains(main, "alloca"));
+        _eokas_test_check(!contains(main, "@eokas_alloc(") && !contains(main, "@eokas_region_alloc("));
+
+        for (const char* name: {"g", "h"}) {
+            std::string func = func_ir(ir, name);
+            _eokas_test_check(contains(func, "@eokas_region_enter("));
+            _eokas_test_check(contains(func, "@eokas_region_alloc("));
+            _eokas_test_check(contains(func, "@eokas_region_leave("));
+            _eokas_test_check(!contains(func, "@eokas_alloc(") && !contains(func, "@eokas_free("));
+        }
+
+        for (const char* name: {"k", "e"}) {
+            std::string func = func_ir(ir, name);
+            _eokas_test_check(contains(func, "@eokas_alloc("));
+            _eokas_test_check(contains(func, "@eokas_free("));
+            _eokas_test_check(!contains(func, "@eokas_region_") && !contains(func, "alloca"));
+        }
+    }
+
+    // the interpreter leaves the functions it can not run to the jit.
+    {
+        std::string ir;
+        i64_t result = 0;
+        _eokas_test_check(run_alloc_module(omis_backend_t::TIERED, ir, result));
+        _eokas_test_check(result == 40 + 2 + 4950 + 4950 + 7);
+    }
+
+    return 0;
+}
@@ -0,0 +1,61 @@
+#include "../engine/main.h"
+#include "elang/src/omis/context.h"
+#include "elang/src/omis/model.h"
+#include "elang/src/omis/bridge.h"
+using namespace eokas;
+
+/*
+$main returns 1 when ~x + x + 1 is zero, x a constant or loaded, of 32 or 64 bits.
+*/
+struct omis_flip_module_t : omis_module_t {
+    bool constant;
+    u32_t bits;
+
+    omis_flip_module_t(omis_context_t* context, bool constant, u32_t bits)
+        : omis_module_t(context, "flip"), constant(constant), bits(bits) {}
+
+    bool main() override {
+        auto func = this->value_func("$main", this->type_i32(), {}, false);
+        this->scope->add_value_symbol("$main", func);
+        this->push_scope(func);
+        this->set_active_block(this->create_block("entry"));
+
+        omis_value_t* x = this->value_integer(bits == 64 ? 0x100000005ull : 5, bits);
+        if (!constant) {
+            auto var = this->variable("x", bits == 64 ? this->type_i64() : this->type_i32(), x);
+            x = this->load(var);
+        }
+        auto zero = this->add(this->add(this->b_flip(x), x), this->value_integer(1, bits));
+        this->stmt_branch(
+            [&]() { return this->eq(zero, this->value_integer(0, bits)); },
+            [&]() { this->ret(this->value_integer(1, 32)); return true; },
+            [&]() { this->ret(this->value_integer(0, 32)); return true; });
+
+        this->stmt_ensure_tail_ret(func);
+        this->end_func(func);
+        this->pop_scope();
+        return true;
+    }
+};
+
+_eokas_test_case(omis_flip)
+{
+    for (auto backend: {omis_backend_t::LLVM, omis_backend_t::TIERED}) {
+        for (bool constant: {true, false}) {
+            for (u32_t bits: {32u, 64u}) {
+                omis_context_t context(backend);
+                context.load_default_modules();
+                auto* mod = new omis_flip_module_t(&context, constant, bits);
+                context.add_module("flip", mod);
+                _eokas_test_check(mod->main());
+
+                omis_compile_options_t options;
+                omis_compile_stats_t stats;
+                _eokas_test_check(context.jit(mod, options, stats));
+                _eokas_test_check(stats.result == 1);
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,141 @@
+#include "../engine/main.h"
+#include "rose/library.h"
+#include <thread>
+using namespace eokas;
+using namespace eokas::datapot;
+
+_eokas_test_case(snapshot)
+{
+    const u32_t COUNT = 20000;
+    const u32_t READERS = 3;
+    const u32_t UPDATES = 200;
+    const u32_t EDITS = 32;
+
+    Library library("snapshot");
+    Schema* schema = library.addSchema(SchemaType::Struct, "Item");
+    schema->addMember("x", library.getSchema("Int"));
+    schema->addMember("y", library.getSchema("Int"));
+    Schema* listSchema = library.addSchema(SchemaType::List, "Items");
+    listSchema->setElement(schema);
+
+    FieldHandle x = library.resolve(schema, "x");
+    FieldHandle y = library.resolve(schema, "y");
+    Value* items = library.make(listSchema);
+    for (u32_t i = 0; i < COUNT; i++) {
+        Value* item = library.make(schema);
+        library.set(item, x, i32_t(i));
+        library.set(item, y, -i32_t(i));
+        library.push(items, item);
+    }
+    library.set("items", items);
+    library.set("version", i32_t(0));
+
+    {
+        SnapshotRef empty = library.acquire();
+        _eokas_test_check(!empty);
+    }
+    const Snapshot* first = library.publish();
+    _eokas_test_check(first->version() == 1);
+
+    // every snapshot keeps x + y == 0 for each item, a reader seeing a half
+    // applied update would break it.
+    std::atomic<bool> done = {false};
+    std::atomic<u64_t> reads = {0};
+    std::atomic<u32_t> broken = {0};
+
+    auto read = [&library, &broken]() {
+        SnapshotRef snapshot = library.acquire();
+        const Value* list = snapshot->get("items");
+        FieldHandle sx = snapshot->resolve(list != nullptr ? snapshot->get(list, 0)->schema : nullptr, "x");
+        FieldHandle sy = snapshot->resolve(sx.schema, "y");
+        u32_t size = snapshot->size(list);
+        for (u32_t i = 0; i < size; i += 16) {
+            const Value* item = snapshot->get(list, i);
+            i32_t vx = 0, vy = 0;
+            if (!snapshot->get(snapshot->get(item, sx), vx) || !snapshot->get(snapshot->get(item, sy), vy) || vx + vy != 0) {
+                broken++;
+                return;
+            }
+        }
+    };
+
+    auto measure = [&](bool updating, u64_t& total, f64_t& time) {
+        done = false;
+        reads = 0;
+        Timer timer;
+        std::vector<std::thread> readers;
+        for (u32_t r = 0; r < READERS; r++) {
+            readers.emplace_back([&] {
+                u64_t count = 0;
+                while (!done.load(std::memory_order_relaxed)) {
+                    read();
+                    count++;
+                    std::this_thread::yield();
+                }
+                reads += count;
+            });
+        }
+        for (u32_t u = 1; u <= UPDATES; u++) {
+            if (updating) {
+                for (u32_t e = 0; e < EDITS; e++) {
+                    Value item = *library.get(items, (u * 7919 + e * 104729) % COUNT);
+                    library.set(&item, x, i32_t(u + e));
+                    library.set(&item, y, -i32_t(u + e));
+                }
+                library.set("version", i32_t(u));
+                library.publish();
+            }
+            std::this_thread::yield();
+        }
+        done = true;
+        for (auto& thread: readers) {
+            thread.join();
+        }
+        total = reads.load();
+        time = timer.elapseNanos() / 1e6;
+    };
+
+    u64_t idleReads = 0, busyReads = 0;
+    f64_t idleTime = 0, busyTime = 0;
+    measure(false, idleReads, idleTime);
+    measure(true, busyReads, busyTime);
+
+    _eokas_test_check(broken.load() == 0);
+    {
+        SnapshotRef snapshot = library.acquire();
+        i32_t version = 0;
+        _eokas_test_check(snapshot->get(snapshot->get("version"), version) && version == i32_t(UPDATES));
+        _eokas_test_check(snapshot->version() == UPDATES + 1);
+    }
+
+    // a value dropped twice is freed once, two later allocations don't share its slot.
+    {
+        SchemaHeap schemas;
+        ValueHeap values(schemas);
+        ValueHandle handle = values.alloc();
+        values.drop(handle);
+        values.drop(handle);
+        _eokas_test_check(values.count() == 0);
+        ValueHandle a = values.alloc();
+        ValueHandle b = values.alloc();
+        _eokas_test_check(a != b);
+        _eokas_test_check(values.count() == 2);
+    }
+
+    // equal strings share one entry whether they are made or set.
+    {
+        SchemaHeap schemas;
+        ValueHeap values(schemas);
+        Value* a = values.make(String("eokas"));
+        Value* b = values.make(String("eokas"));
+        Value* c = values.make(schemas.get("String"));
+        _eokas_test_check(a->value.u64 == b->value.u64);
+        _eokas_test_check(values.set(c, String("eokas")) && c->value.u64 == a->value.u64);
+        _eokas_test_check(values.strings.size() == 2);
+    }
+
+    printf("Snapshot idle: %.0f reads/s, %llu reads in %.2f ms\n", idleReads * 1000.0 / idleTime, (unsigned long long) idleReads, idleTime);
+    printf("Snapshot busy: %.0f reads/s, %llu reads in %.2f ms, %u publishes\n", busyReads * 1000.0 / busyTime, (unsigned long long) busyReads, busyTime, UPDATES);
+
+    return 0;
+}